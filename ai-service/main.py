@@ -32,6 +32,10 @@ load_dotenv()
 BACKEND_URL = os.getenv('BACKEND_URL', 'http://localhost')
 YOLO_MODEL = os.getenv('YOLO_MODEL', 'yolo11n.pt')  # YOLOv11 nano
 PARKING_REGIONS_FILE = 'parking_regions.json'
+# Frame the polygons were drawn on (SVGA camera frame, see slot.png);
+# detections on other frame sizes are scaled to it
+REGIONS_FRAME_WIDTH = int(os.getenv('REGIONS_FRAME_WIDTH', '800'))
+REGIONS_FRAME_HEIGHT = int(os.getenv('REGIONS_FRAME_HEIGHT', '600'))
 CONFIDENCE_THRESHOLD = 0.5
 DETECTION_INTERVAL = 5  # seconds
 
@@ -159,6 +163,22 @@ def detect_objects(image):
     
     return objects
 
+def offset_detections(objects, dx, dy):
+    """Map boxes from a cropped upload back to full-frame coordinates"""
+    for obj in objects:
+        x1, y1, x2, y2 = obj['box']
+        obj['box'] = [x1 + dx, y1 + dy, x2 + dx, y2 + dy]
+        obj['center'] = box_center(obj['box'])
+    return objects
+
+def scale_detections(objects, sx, sy):
+    """Map boxes from camera frame pixels to region frame pixels"""
+    for obj in objects:
+        x1, y1, x2, y2 = obj['box']
+        obj['box'] = [x1 * sx, y1 * sy, x2 * sx, y2 * sy]
+        obj['center'] = box_center(obj['box'])
+    return objects
+
 # Alias for backward compatibility
 def detect_vehicles(image):
     """Alias for detect_objects (backward compatibility)"""
@@ -186,10 +206,13 @@ def analyze_parking_slots(image, vehicles):
     
     return slot_status
 
-def analyze_image(image_path_or_array):
+def analyze_image(image_path_or_array, offset=(0, 0), frame_size=None):
     """
     Main analysis function
     Takes image path or numpy array, returns slot occupancy
+    offset: (x, y) of the image inside the camera frame, for cropped uploads
+    frame_size: (width, height) of the camera frame; the image's own size
+    if None and not cropped, else the region frame
     """
     # Load image if path is provided
     if isinstance(image_path_or_array, str):
@@ -203,6 +226,14 @@ def analyze_image(image_path_or_array):
     
     # Detect vehicles
     vehicles = detect_vehicles(image)
+    if offset != (0, 0):
+        offset_detections(vehicles, *offset)
+    if frame_size is None:
+        frame_size = ((image.shape[1], image.shape[0]) if offset == (0, 0)
+                      else (REGIONS_FRAME_WIDTH, REGIONS_FRAME_HEIGHT))
+    if frame_size != (REGIONS_FRAME_WIDTH, REGIONS_FRAME_HEIGHT):
+        scale_detections(vehicles, REGIONS_FRAME_WIDTH / frame_size[0],
+                         REGIONS_FRAME_HEIGHT / frame_size[1])
     print(f"Detected {len(vehicles)} vehicles")
     
     # Analyze slots
@@ -300,8 +331,12 @@ def analyze_endpoint():
     """
     Analyze uploaded image for parking occupancy
     
-    POST /analyze
+    POST /analyze[?frame_w=W&frame_h=H][&crop_x=X&crop_y=Y]
     Body: multipart/form-data with 'image' file
+    frame_w/frame_h: camera frame size (default: the image's own size);
+    boxes are scaled from it to the frame the polygons were drawn on
+    crop_x/crop_y: offset of a cropped image (ESP32 ROI uploads) in the
+    camera frame
     
     Returns: {
         'success': true,
@@ -322,7 +357,14 @@ def analyze_endpoint():
         return jsonify({'success': False, 'error': 'Invalid image'}), 400
     
     # Analyze
-    result = analyze_image(image)
+    offset = (request.values.get('crop_x', 0, type=int),
+              request.values.get('crop_y', 0, type=int))
+    frame_size = None
+    frame_w = request.values.get('frame_w', 0, type=int)
+    frame_h = request.values.get('frame_h', 0, type=int)
+    if frame_w > 0 and frame_h > 0:
+        frame_size = (frame_w, frame_h)
+    result = analyze_image(image, offset, frame_size)
     
     if result is None:
         return jsonify({'success': False, 'error': 'Analysis failed'}), 500
@@ -346,9 +388,10 @@ def analyze_endpoint():
 
 @app.route('/regions', methods=['GET'])
 def get_regions():
-    """Get defined parking regions"""
+    """Get defined parking regions, in pixels of 'frame'"""
     return jsonify({
         'success': True,
+        'frame': {'width': REGIONS_FRAME_WIDTH, 'height': REGIONS_FRAME_HEIGHT},
         'regions': parking_regions
     })
 
@@ -384,6 +427,7 @@ def get_overlay():
     
     Returns: {
         'success': true,
+        'frame': {'width': 800, 'height': 600},   # Frame the points are in
         'regions': [
             {
                 'code': 'P1',
@@ -409,6 +453,7 @@ def get_overlay():
     
     return jsonify({
         'success': True,
+        'frame': {'width': REGIONS_FRAME_WIDTH, 'height': REGIONS_FRAME_HEIGHT},
         'regions': overlay_regions,
         'last_detection': {
             'vehicles_detected': last_detection['vehicles_detected'],
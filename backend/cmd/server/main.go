@@ -91,6 +91,7 @@ func main() {
 		sessionHandler := handlers.NewSessionHandler(db, hub)
 		api.POST("/sessions/entry", sessionHandler.HandleEntry)
 		api.POST("/sessions/exit", sessionHandler.HandleExit)
+		api.POST("/sessions/batch", sessionHandler.HandleBatch)
 		api.GET("/sessions", sessionHandler.GetAll)
 		api.GET("/sessions/stats", sessionHandler.GetStats)
 		api.GET("/sessions/:id", sessionHandler.GetByID)
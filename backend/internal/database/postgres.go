@@ -20,7 +20,7 @@ func Connect(databaseURL string) (*gorm.DB, error) {
 	}
 
 	// Auto migrate models
-	err = db.AutoMigrate(&models.Slot{}, &models.Capture{}, &models.Session{})
+	err = db.AutoMigrate(&models.Slot{}, &models.Capture{}, &models.Session{}, &models.DeviceCursor{})
 	if err != nil {
 		log.Printf("Warning: AutoMigrate failed: %v", err)
 	}
@@ -173,6 +173,7 @@ func (h *CaptureHandler) analyzeWithAI(imageData []byte, filename string) {
 	log.Printf("AI Analysis: Detected %d vehicles", aiResponse.VehiclesDetected)
 
 	// Update slot status in database based on AI detection
+	changed := false
 	for slotCode, isOccupied := range aiResponse.SlotStatus {
 		var slot models.Slot
 		if err := h.db.Where("code = ?", slotCode).First(&slot).Error; err != nil {
@@ -191,8 +192,13 @@ func (h *CaptureHandler) analyzeWithAI(imageData []byte, filename string) {
 			})
 			
 			log.Printf("AI Analysis: Updated %s to %v", slotCode, isOccupied)
+			changed = true
 		}
 	}
+
+	if changed {
+		broadcastSlotStats(h.db, h.hub)
+	}
 }
 
 // GetLatest returns the latest capture
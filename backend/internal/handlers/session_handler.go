@@ -1,7 +1,9 @@
 package handlers
 
 import (
+	"errors"
 	"net/http"
+	"sync"
 	"time"
 
 	"smart-parking/internal/models"
@@ -9,12 +11,17 @@ import (
 
 	"github.com/gin-gonic/gin"
 	"gorm.io/gorm"
+	"gorm.io/gorm/clause"
 )
 
 // SessionHandler handles parking session-related HTTP requests
 type SessionHandler struct {
 	db  *gorm.DB
 	hub *websocket.Hub
+
+	// One batch per device at a time; devices do not wait on each other.
+	// The applied sequence itself lives in device_cursors.
+	deviceLocks sync.Map // camera ID -> *sync.Mutex
 }
 
 // NewSessionHandler creates a new SessionHandler
@@ -26,12 +33,44 @@ func NewSessionHandler(db *gorm.DB, hub *websocket.Hub) *SessionHandler {
 type EntryRequest struct {
 	CameraID  string `json:"camera_id"`
 	EventType string `json:"event_type"`
+	Seq       uint32 `json:"seq"`    // Device journal sequence number
+	AgeMs     int64  `json:"age_ms"` // How long ago the event happened (replayed events)
 }
 
 // ExitRequest represents the exit event request from ESP32
 type ExitRequest struct {
 	CameraID  string `json:"camera_id"`
 	EventType string `json:"event_type"`
+	Seq       uint32 `json:"seq"`
+	AgeMs     int64  `json:"age_ms"`
+}
+
+// BatchEvent is one entry/exit event inside a batch
+type BatchEvent struct {
+	Seq       uint32 `json:"seq"`
+	EventType string `json:"event_type" binding:"required,oneof=entry exit"`
+	AgeMs     int64  `json:"age_ms"`
+}
+
+// BatchRequest represents a batch of gate events from ESP32
+type BatchRequest struct {
+	CameraID string       `json:"camera_id"`
+	Epoch    uint32       `json:"epoch"` // Device journal epoch; sequences restart with a new one
+	Events   []BatchEvent `json:"events" binding:"required,min=1,max=64,dive"`
+}
+
+// errNoActiveSession is returned when an exit has no session to close
+var errNoActiveSession = errors.New("no active session found")
+
+// eventTime returns when a device event happened, given its age on arrival.
+// Events replayed from the device journal arrive late; their age keeps
+// entry/exit times and fees correct.
+func eventTime(ageMs int64) time.Time {
+	now := time.Now()
+	if ageMs <= 0 {
+		return now
+	}
+	return now.Add(-time.Duration(ageMs) * time.Millisecond)
 }
 
 // HandleEntry creates a new parking session when a vehicle enters
@@ -45,12 +84,8 @@ func (h *SessionHandler) HandleEntry(c *gin.Context) {
 		return
 	}
 
-	// Create new session with status 'active'
-	session := models.Session{
-		Status: "active",
-	}
-
-	if err := h.db.Create(&session).Error; err != nil {
+	session, err := openSession(h.db, eventTime(req.AgeMs))
+	if err != nil {
 		c.JSON(http.StatusInternalServerError, gin.H{
 			"success": false,
 			"error":   "Failed to create session",
@@ -58,15 +93,7 @@ func (h *SessionHandler) HandleEntry(c *gin.Context) {
 		return
 	}
 
-	// Broadcast session event via WebSocket
-	h.hub.Broadcast(websocket.Message{
-		Type: "session_entry",
-		Data: gin.H{
-			"session_id": session.ID,
-			"entry_time": session.EntryTime,
-			"camera_id":  req.CameraID,
-		},
-	})
+	h.broadcastEntry(session, req.CameraID)
 
 	c.JSON(http.StatusCreated, gin.H{
 		"success": true,
@@ -86,27 +113,170 @@ func (h *SessionHandler) HandleExit(c *gin.Context) {
 		return
 	}
 
-	// Find the oldest active session (FIFO)
-	var session models.Session
-	if err := h.db.Where("status = ?", "active").Order("entry_time ASC").First(&session).Error; err != nil {
-		if err == gorm.ErrRecordNotFound {
-			c.JSON(http.StatusNotFound, gin.H{
-				"success": false,
-				"error":   "No active session found",
-			})
-			return
-		}
+	session, err := closeOldestSession(h.db, eventTime(req.AgeMs))
+	if err == errNoActiveSession {
+		c.JSON(http.StatusNotFound, gin.H{
+			"success": false,
+			"error":   "No active session found",
+		})
+		return
+	}
+	if err != nil {
 		c.JSON(http.StatusInternalServerError, gin.H{
 			"success": false,
-			"error":   "Failed to find active session",
+			"error":   "Failed to update session",
 		})
 		return
 	}
 
+	h.broadcastExit(session, req.CameraID)
+
+	c.JSON(http.StatusOK, gin.H{
+		"success": true,
+		"message": "Exit recorded",
+		"data":    session,
+	})
+}
+
+// deviceLock returns the lock serializing batches of one device
+func (h *SessionHandler) deviceLock(cameraID string) *sync.Mutex {
+	lock, _ := h.deviceLocks.LoadOrStore(cameraID, &sync.Mutex{})
+	return lock.(*sync.Mutex)
+}
+
+// HandleBatch applies a batch of entry/exit events in one transaction.
+// The response acks the highest sequence number the backend now holds;
+// events at or below the device's cursor are skipped as duplicates. The
+// cursor is updated in the same transaction as the sessions, and starts
+// over when the device reports a new journal epoch.
+func (h *SessionHandler) HandleBatch(c *gin.Context) {
+	var req BatchRequest
+	if err := bindBody(c, &req); err != nil {
+		respond(c, http.StatusBadRequest, gin.H{
+			"success": false,
+			"error":   "Invalid request body",
+		})
+		return
+	}
+
+	// One batch per device at a time keeps the duplicate check consistent;
+	// the row lock covers other backend instances
+	lock := h.deviceLock(req.CameraID)
+	lock.Lock()
+	defer lock.Unlock()
+
+	type applied struct {
+		event   BatchEvent
+		session models.Session
+	}
+	var done []applied
+	results := make([]string, len(req.Events))
+	var ackedSeq uint32
+
+	err := h.db.Transaction(func(tx *gorm.DB) error {
+		cursor := models.DeviceCursor{CameraID: req.CameraID}
+		err := tx.Clauses(clause.Locking{Strength: "UPDATE"}).
+			Where("camera_id = ?", req.CameraID).Take(&cursor).Error
+		if err != nil && !errors.Is(err, gorm.ErrRecordNotFound) {
+			return err
+		}
+		if cursor.Epoch != req.Epoch {
+			// New journal on the device: sequence numbers start over
+			cursor.Epoch = req.Epoch
+			cursor.LastSeq = 0
+		}
+		lastSeq := cursor.LastSeq
+		ackedSeq = lastSeq
+
+		for i, ev := range req.Events {
+			if ev.Seq != 0 && ev.Seq <= lastSeq {
+				results[i] = "duplicate"
+				continue
+			}
+
+			at := eventTime(ev.AgeMs)
+			var session models.Session
+			var err error
+			if ev.EventType == "entry" {
+				session, err = openSession(tx, at)
+			} else {
+				session, err = closeOldestSession(tx, at)
+			}
+
+			switch {
+			case err == errNoActiveSession:
+				results[i] = "no_active_session"
+			case err != nil:
+				return err
+			default:
+				results[i] = "applied"
+				done = append(done, applied{ev, session})
+			}
+			if ev.Seq > ackedSeq {
+				ackedSeq = ev.Seq
+			}
+		}
+
+		cursor.LastSeq = ackedSeq
+		return tx.Clauses(clause.OnConflict{
+			Columns:   []clause.Column{{Name: "camera_id"}},
+			DoUpdates: clause.AssignmentColumns([]string{"epoch", "last_seq", "updated_at"}),
+		}).Create(&cursor).Error
+	})
+	if err != nil {
+		respond(c, http.StatusInternalServerError, gin.H{
+			"success": false,
+			"error":   "Failed to apply events",
+		})
+		return
+	}
+
+	// Broadcast only after the transaction has committed
+	for _, a := range done {
+		if a.event.EventType == "entry" {
+			h.broadcastEntry(a.session, req.CameraID)
+		} else {
+			h.broadcastExit(a.session, req.CameraID)
+		}
+	}
+
+	respond(c, http.StatusOK, gin.H{
+		"success": true,
+		"message": "Events recorded",
+		"data": gin.H{
+			"acked_seq": ackedSeq,
+			"results":   results,
+		},
+	})
+}
+
+// openSession creates a new active session that started at the given time
+func openSession(db *gorm.DB, at time.Time) (models.Session, error) {
+	session := models.Session{
+		EntryTime: at,
+		Status:    "active",
+	}
+	err := db.Create(&session).Error
+	return session, err
+}
+
+// closeOldestSession completes the oldest active session (FIFO) at the
+// given time and calculates its duration and fee
+func closeOldestSession(db *gorm.DB, at time.Time) (models.Session, error) {
+	var session models.Session
+	if err := db.Where("status = ?", "active").Order("entry_time ASC").First(&session).Error; err != nil {
+		if err == gorm.ErrRecordNotFound {
+			return session, errNoActiveSession
+		}
+		return session, err
+	}
+
 	// Update session with exit time and calculate duration
-	now := time.Now()
-	session.ExitTime = &now
-	duration := int(now.Sub(session.EntryTime).Minutes())
+	if at.Before(session.EntryTime) {
+		at = session.EntryTime
+	}
+	session.ExitTime = &at
+	duration := int(at.Sub(session.EntryTime).Minutes())
 	session.DurationMinutes = &duration
 	session.Status = "completed"
 
@@ -119,15 +289,24 @@ func (h *SessionHandler) HandleExit(c *gin.Context) {
 	fee := hours * feePerHour
 	session.TotalFee = &fee
 
-	if err := h.db.Save(&session).Error; err != nil {
-		c.JSON(http.StatusInternalServerError, gin.H{
-			"success": false,
-			"error":   "Failed to update session",
-		})
-		return
-	}
+	err := db.Save(&session).Error
+	return session, err
+}
+
+// broadcastEntry sends a session_entry event via WebSocket
+func (h *SessionHandler) broadcastEntry(session models.Session, cameraID string) {
+	h.hub.Broadcast(websocket.Message{
+		Type: "session_entry",
+		Data: gin.H{
+			"session_id": session.ID,
+			"entry_time": session.EntryTime,
+			"camera_id":  cameraID,
+		},
+	})
+}
 
-	// Broadcast session event via WebSocket
+// broadcastExit sends a session_exit event via WebSocket
+func (h *SessionHandler) broadcastExit(session models.Session, cameraID string) {
 	h.hub.Broadcast(websocket.Message{
 		Type: "session_exit",
 		Data: gin.H{
@@ -136,15 +315,9 @@ func (h *SessionHandler) HandleExit(c *gin.Context) {
 			"exit_time":        session.ExitTime,
 			"duration_minutes": session.DurationMinutes,
 			"total_fee":        session.TotalFee,
-			"camera_id":        req.CameraID,
+			"camera_id":        cameraID,
 		},
 	})
-
-	c.JSON(http.StatusOK, gin.H{
-		"success": true,
-		"message": "Exit recorded",
-		"data":    session,
-	})
 }
 
 // GetAll returns all parking sessions
@@ -27,14 +27,14 @@ func (h *SlotHandler) GetAll(c *gin.Context) {
 	var slots []models.Slot
 
 	if err := h.db.Order("position_y, position_x").Find(&slots).Error; err != nil {
-		c.JSON(http.StatusInternalServerError, gin.H{
+		respond(c, http.StatusInternalServerError, gin.H{
 			"success": false,
 			"error":   "Failed to fetch slots",
 		})
 		return
 	}
 
-	c.JSON(http.StatusOK, gin.H{
+	respond(c, http.StatusOK, gin.H{
 		"success": true,
 		"data":    slots,
 	})
@@ -46,14 +46,14 @@ func (h *SlotHandler) GetByID(c *gin.Context) {
 
 	var slot models.Slot
 	if err := h.db.First(&slot, "id = ?", id).Error; err != nil {
-		c.JSON(http.StatusNotFound, gin.H{
+		respond(c, http.StatusNotFound, gin.H{
 			"success": false,
 			"error":   "Slot not found",
 		})
 		return
 	}
 
-	c.JSON(http.StatusOK, gin.H{
+	respond(c, http.StatusOK, gin.H{
 		"success": true,
 		"data":    slot,
 	})
@@ -69,8 +69,8 @@ func (h *SlotHandler) Update(c *gin.Context) {
 	id := c.Param("id")
 
 	var req UpdateRequest
-	if err := c.ShouldBindJSON(&req); err != nil {
-		c.JSON(http.StatusBadRequest, gin.H{
+	if err := bindBody(c, &req); err != nil {
+		respond(c, http.StatusBadRequest, gin.H{
 			"success": false,
 			"error":   "Invalid request body",
 		})
@@ -79,7 +79,7 @@ func (h *SlotHandler) Update(c *gin.Context) {
 
 	var slot models.Slot
 	if err := h.db.First(&slot, "id = ?", id).Error; err != nil {
-		c.JSON(http.StatusNotFound, gin.H{
+		respond(c, http.StatusNotFound, gin.H{
 			"success": false,
 			"error":   "Slot not found",
 		})
@@ -92,7 +92,7 @@ func (h *SlotHandler) Update(c *gin.Context) {
 	}
 
 	if err := h.db.Save(&slot).Error; err != nil {
-		c.JSON(http.StatusInternalServerError, gin.H{
+		respond(c, http.StatusInternalServerError, gin.H{
 			"success": false,
 			"error":   "Failed to update slot",
 		})
@@ -104,8 +104,9 @@ func (h *SlotHandler) Update(c *gin.Context) {
 		Type: "slot_update",
 		Data: slot,
 	})
+	broadcastSlotStats(h.db, h.hub)
 
-	c.JSON(http.StatusOK, gin.H{
+	respond(c, http.StatusOK, gin.H{
 		"success": true,
 		"data":    slot,
 	})
@@ -118,7 +119,7 @@ func (h *SlotHandler) Toggle(c *gin.Context) {
 	// Parse UUID
 	slotID, err := uuid.Parse(id)
 	if err != nil {
-		c.JSON(http.StatusBadRequest, gin.H{
+		respond(c, http.StatusBadRequest, gin.H{
 			"success": false,
 			"error":   "Invalid slot ID",
 		})
@@ -127,7 +128,7 @@ func (h *SlotHandler) Toggle(c *gin.Context) {
 
 	var slot models.Slot
 	if err := h.db.First(&slot, "id = ?", slotID).Error; err != nil {
-		c.JSON(http.StatusNotFound, gin.H{
+		respond(c, http.StatusNotFound, gin.H{
 			"success": false,
 			"error":   "Slot not found",
 		})
@@ -138,7 +139,7 @@ func (h *SlotHandler) Toggle(c *gin.Context) {
 	slot.IsOccupied = !slot.IsOccupied
 
 	if err := h.db.Save(&slot).Error; err != nil {
-		c.JSON(http.StatusInternalServerError, gin.H{
+		respond(c, http.StatusInternalServerError, gin.H{
 			"success": false,
 			"error":   "Failed to toggle slot",
 		})
@@ -150,8 +151,9 @@ func (h *SlotHandler) Toggle(c *gin.Context) {
 		Type: "slot_update",
 		Data: slot,
 	})
+	broadcastSlotStats(h.db, h.hub)
 
-	c.JSON(http.StatusOK, gin.H{
+	respond(c, http.StatusOK, gin.H{
 		"success": true,
 		"data":    slot,
 	})
@@ -159,15 +161,25 @@ func (h *SlotHandler) Toggle(c *gin.Context) {
 
 // GetStats returns parking statistics
 func (h *SlotHandler) GetStats(c *gin.Context) {
+	stats := computeSlotStats(h.db)
+
+	respond(c, http.StatusOK, gin.H{
+		"success": true,
+		"data":    stats,
+	})
+}
+
+// computeSlotStats counts total and occupied slots
+func computeSlotStats(db *gorm.DB) models.SlotStats {
 	var stats models.SlotStats
 	var totalCount, occupiedCount int64
 
 	// Count total slots
-	h.db.Model(&models.Slot{}).Count(&totalCount)
+	db.Model(&models.Slot{}).Count(&totalCount)
 	stats.Total = int(totalCount)
 
 	// Count occupied slots
-	h.db.Model(&models.Slot{}).Where("is_occupied = ?", true).Count(&occupiedCount)
+	db.Model(&models.Slot{}).Where("is_occupied = ?", true).Count(&occupiedCount)
 	stats.Occupied = int(occupiedCount)
 
 	// Calculate available
@@ -178,8 +190,14 @@ func (h *SlotHandler) GetStats(c *gin.Context) {
 		stats.OccupancyRate = float64(stats.Occupied) / float64(stats.Total) * 100
 	}
 
-	c.JSON(http.StatusOK, gin.H{
-		"success": true,
-		"data":    stats,
+	return stats
+}
+
+// broadcastSlotStats pushes the current totals to WebSocket clients so
+// devices can update their display without polling /api/slots/stats
+func broadcastSlotStats(db *gorm.DB, hub *websocket.Hub) {
+	hub.Broadcast(websocket.Message{
+		Type: "slot_stats",
+		Data: computeSlotStats(db),
 	})
 }
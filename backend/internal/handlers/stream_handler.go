@@ -4,7 +4,9 @@ import (
 	"io"
 	"log"
 	"net/http"
+	"net/url"
 	"os"
+	"sync"
 	"time"
 
 	"github.com/gin-gonic/gin"
@@ -13,6 +15,11 @@ import (
 // StreamHandler handles camera stream proxying
 type StreamHandler struct {
 	esp32URL string
+
+	// Last frame from /capture, revalidated with its ETag on the next poll
+	captureMu   sync.Mutex
+	captureETag string
+	captureData []byte
 }
 
 // NewStreamHandler creates a new StreamHandler
@@ -77,9 +84,14 @@ func (h *StreamHandler) ProxyStream(c *gin.Context) {
 	}
 }
 
-// ProxyCapture proxies single frame capture from ESP32
+// ProxyCapture proxies single frame capture from ESP32.
+// The ESP32 serves its newest frame with an ETag; polls send the cached
+// frame's ETag and reuse it on 304, so an unchanged frame is not resent.
 func (h *StreamHandler) ProxyCapture(c *gin.Context) {
 	captureURL := h.esp32URL + "/capture"
+	if maxAge := c.Query("max_age"); maxAge != "" {
+		captureURL += "?max_age=" + url.QueryEscape(maxAge)
+	}
 
 	log.Printf("Proxying capture from: %s", captureURL)
 
@@ -87,7 +99,23 @@ func (h *StreamHandler) ProxyCapture(c *gin.Context) {
 		Timeout: 10 * time.Second,
 	}
 
-	resp, err := client.Get(captureURL)
+	req, err := http.NewRequest("GET", captureURL, nil)
+	if err != nil {
+		c.JSON(http.StatusInternalServerError, gin.H{
+			"success": false,
+			"error":   "Failed to create capture request",
+		})
+		return
+	}
+
+	h.captureMu.Lock()
+	cachedETag := h.captureETag
+	h.captureMu.Unlock()
+	if cachedETag != "" {
+		req.Header.Set("If-None-Match", cachedETag)
+	}
+
+	resp, err := client.Do(req)
 	if err != nil {
 		c.JSON(http.StatusBadGateway, gin.H{
 			"success": false,
@@ -97,18 +125,47 @@ func (h *StreamHandler) ProxyCapture(c *gin.Context) {
 	}
 	defer resp.Body.Close()
 
-	// Read image data
-	imageData, err := io.ReadAll(resp.Body)
-	if err != nil {
-		c.JSON(http.StatusInternalServerError, gin.H{
+	var etag string
+	var imageData []byte
+	switch resp.StatusCode {
+	case http.StatusNotModified:
+		h.captureMu.Lock()
+		etag, imageData = h.captureETag, h.captureData
+		h.captureMu.Unlock()
+	case http.StatusOK:
+		// Read image data
+		imageData, err = io.ReadAll(resp.Body)
+		if err != nil {
+			c.JSON(http.StatusInternalServerError, gin.H{
+				"success": false,
+				"error":   "Failed to read capture data",
+			})
+			return
+		}
+		etag = resp.Header.Get("ETag")
+		h.captureMu.Lock()
+		h.captureETag, h.captureData = etag, imageData
+		h.captureMu.Unlock()
+	default:
+		c.JSON(http.StatusBadGateway, gin.H{
 			"success": false,
-			"error":   "Failed to read capture data",
+			"error":   "Camera capture failed",
 		})
 		return
 	}
 
-	// Send image
 	c.Header("Access-Control-Allow-Origin", "*")
+	c.Header("Access-Control-Expose-Headers", "ETag")
+	c.Header("Cache-Control", "no-cache")
+	if etag != "" {
+		c.Header("ETag", etag)
+		if c.GetHeader("If-None-Match") == etag {
+			c.Status(http.StatusNotModified)
+			return
+		}
+	}
+
+	// Send image
 	c.Data(http.StatusOK, "image/jpeg", imageData)
 }
 
@@ -153,6 +210,9 @@ func (h *StreamHandler) SetCameraURL(c *gin.Context) {
 	}
 
 	h.esp32URL = req.URL
+	h.captureMu.Lock()
+	h.captureETag, h.captureData = "", nil
+	h.captureMu.Unlock()
 	log.Printf("Camera URL updated to: %s", h.esp32URL)
 
 	c.JSON(http.StatusOK, gin.H{
@@ -0,0 +1,82 @@
+package handlers
+
+import (
+	"bytes"
+	"encoding/json"
+	"net/http"
+
+	"github.com/gin-gonic/gin"
+	"github.com/gin-gonic/gin/binding"
+	"github.com/gin-gonic/gin/render"
+)
+
+// Devices may speak MessagePack instead of JSON on the endpoints they use:
+// request bodies are decoded by Content-Type, responses follow the Accept
+// header. Anything that does not ask for MessagePack keeps getting JSON.
+
+// mimeMsgPack is the MessagePack content type devices send and accept
+const mimeMsgPack = binding.MIMEMSGPACK2
+
+// bindBody decodes a JSON or MessagePack request body into obj
+func bindBody(c *gin.Context, obj interface{}) error {
+	switch c.ContentType() {
+	case binding.MIMEMSGPACK, binding.MIMEMSGPACK2:
+		return c.ShouldBindWith(obj, binding.MsgPack)
+	default:
+		return c.ShouldBindJSON(obj)
+	}
+}
+
+// respond writes obj as MessagePack if the client prefers it, JSON otherwise
+func respond(c *gin.Context, code int, obj interface{}) {
+	if c.NegotiateFormat(binding.MIMEJSON, mimeMsgPack) != mimeMsgPack {
+		c.JSON(code, obj)
+		return
+	}
+	data, err := msgpackValue(obj)
+	if err != nil {
+		c.JSON(http.StatusInternalServerError, gin.H{
+			"success": false,
+			"error":   "Failed to encode response",
+		})
+		return
+	}
+	c.Render(code, render.MsgPack{Data: data})
+}
+
+// msgpackValue converts obj to the same document its JSON encoding would
+// give (UUIDs and times as strings, json tags, omitempty), keeping whole
+// numbers as integers so they pack small.
+func msgpackValue(obj interface{}) (interface{}, error) {
+	raw, err := json.Marshal(obj)
+	if err != nil {
+		return nil, err
+	}
+	dec := json.NewDecoder(bytes.NewReader(raw))
+	dec.UseNumber()
+	var v interface{}
+	if err := dec.Decode(&v); err != nil {
+		return nil, err
+	}
+	return packNumbers(v), nil
+}
+
+func packNumbers(v interface{}) interface{} {
+	switch t := v.(type) {
+	case map[string]interface{}:
+		for k, e := range t {
+			t[k] = packNumbers(e)
+		}
+	case []interface{}:
+		for i, e := range t {
+			t[i] = packNumbers(e)
+		}
+	case json.Number:
+		if n, err := t.Int64(); err == nil {
+			return n
+		}
+		f, _ := t.Float64()
+		return f
+	}
+	return v
+}
@@ -0,0 +1,20 @@
+package models
+
+import (
+	"time"
+)
+
+// DeviceCursor is the highest gate event sequence applied for a device.
+// Sequence numbers are only unique within one journal epoch of the device,
+// so a new epoch starts the cursor over.
+type DeviceCursor struct {
+	CameraID  string    `gorm:"type:varchar(50);primaryKey" json:"camera_id"`
+	Epoch     uint32    `gorm:"type:bigint;not null;default:0" json:"epoch"`
+	LastSeq   uint32    `gorm:"type:bigint;not null;default:0" json:"last_seq"`
+	UpdatedAt time.Time `gorm:"autoUpdateTime" json:"updated_at"`
+}
+
+// TableName overrides the table name
+func (DeviceCursor) TableName() string {
+	return "device_cursors"
+}
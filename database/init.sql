@@ -43,6 +43,16 @@ CREATE TABLE IF NOT EXISTS sessions (
     created_at TIMESTAMP WITH TIME ZONE DEFAULT CURRENT_TIMESTAMP
 );
 
+-- ===========================================
+-- DEVICE CURSORS TABLE (event terakhir yang sudah diterapkan per ESP32)
+-- ===========================================
+CREATE TABLE IF NOT EXISTS device_cursors (
+    camera_id VARCHAR(50) PRIMARY KEY,
+    epoch BIGINT NOT NULL DEFAULT 0,
+    last_seq BIGINT NOT NULL DEFAULT 0,
+    updated_at TIMESTAMP WITH TIME ZONE DEFAULT CURRENT_TIMESTAMP
+);
+
 -- ===========================================
 -- SEED DATA - 4 Parking Slots (2 Kiri, 2 Kanan)
 -- Layout:
@@ -25,6 +25,7 @@
 #include <ArduinoJson.h>
 #include <Wire.h>
 #include <LiquidCrystal_I2C.h>
+#include <MultipartUploader.h>  // firmware/lib/HttpLite
 
 // ===========================================
 // CONFIGURATION - EDIT THESE!
@@ -94,6 +95,7 @@ const char* AI_SERVICE_URL = "http://10.93.213.141:5000";
 // ===========================================
 WebServer server(80);
 LiquidCrystal_I2C lcd(0x27, 16, 2);
+MultipartUploader imageUploader("image", "capture.jpg", "image/jpeg");
 
 // State variables
 int availableSlots = 0;
@@ -104,6 +106,7 @@ unsigned long lastStatsTime = 0;
 bool cameraReady = false;
 bool wifiConnected = false;
 bool streamActive = false;
+unsigned long restartAt = 0;        // Deferred /restart (0 = none)
 
 // MJPEG stream
 #define PART_BOUNDARY "123456789000000000000987654321"
@@ -199,6 +202,11 @@ void loop() {
     lastStatsTime = now;
   }
   
+  // Restart once the /restart response has gone out
+  if (restartAt != 0 && (long)(now - restartAt) >= 0) {
+    ESP.restart();
+  }
+  
   updateLEDs();
   delay(10);
 }
@@ -384,8 +392,7 @@ void handleRestart() {
   Serial.println("[RESTART] Requested");
   server.sendHeader("Access-Control-Allow-Origin", "*");
   server.send(200, "application/json", "{\"success\":true,\"message\":\"Restarting...\"}");
-  delay(1000);
-  ESP.restart();
+  restartAt = millis() + 1000;  // Restarted from loop()
 }
 
 // ===========================================
@@ -402,37 +409,18 @@ void runDetection() {
   }
   
   if (WiFi.status() == WL_CONNECTED) {
-    HTTPClient http;
-    String url = String(AI_SERVICE_URL) + "/analyze";
-    
-    http.begin(url);
-    http.setTimeout(15000);
+    HttpUrl url;
+    url.parse(AI_SERVICE_URL, "/analyze");
     
-    String boundary = "----ESP32Boundary";
-    http.addHeader("Content-Type", "multipart/form-data; boundary=" + boundary);
-    
-    String bodyStart = "--" + boundary + "\r\n";
-    bodyStart += "Content-Disposition: form-data; name=\"image\"; filename=\"capture.jpg\"\r\n";
-    bodyStart += "Content-Type: image/jpeg\r\n\r\n";
-    String bodyEnd = "\r\n--" + boundary + "--\r\n";
-    
-    size_t totalLen = bodyStart.length() + fb->len + bodyEnd.length();
-    uint8_t *payload = (uint8_t*)malloc(totalLen);
-    
-    if (payload) {
-      memcpy(payload, bodyStart.c_str(), bodyStart.length());
-      memcpy(payload + bodyStart.length(), fb->buf, fb->len);
-      memcpy(payload + bodyStart.length() + fb->len, bodyEnd.c_str(), bodyEnd.length());
-      
-      int code = http.POST(payload, totalLen);
-      if (code == 200) {
-        Serial.println("[DETECT] Success");
-      } else {
-        Serial.printf("[DETECT] Error: %d\n", code);
-      }
-      free(payload);
+    // Streams fb->buf to the socket, no full-frame copy
+    WiFiClient client;
+    HttpResponse resp;
+    int code = imageUploader.post(client, url, fb->buf, fb->len, resp, 15000);
+    if (code == 200) {
+      Serial.println("[DETECT] Success");
+    } else {
+      Serial.printf("[DETECT] Error: %d\n", code);
     }
-    http.end();
   }
   
   esp_camera_fb_return(fb);
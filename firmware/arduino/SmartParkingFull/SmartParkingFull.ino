@@ -25,6 +25,7 @@
 #include <ArduinoJson.h>
 #include <Wire.h>
 #include <LiquidCrystal_I2C.h>
+#include <MultipartUploader.h>  // firmware/lib/HttpLite
 
 // ===========================================
 // CONFIGURATION - EDIT THESE!
@@ -94,6 +95,7 @@ const char* AI_SERVICE_URL = "http://10.93.213.141:5000";
 // ===========================================
 WebServer server(80);
 LiquidCrystal_I2C lcd(0x27, 16, 2);
+MultipartUploader imageUploader("image", "capture.jpg", "image/jpeg");
 
 // State
 int availableSlots = 0;
@@ -103,6 +105,8 @@ bool streamActive = false;
 unsigned long lastDetectionTime = 0;
 unsigned long lastStatsTime = 0;
 unsigned long gateOpenTime = 0;
+unsigned long lcdRestoreAt = 0;     // Redraw slot count at this time (0 = none)
+unsigned long restartAt = 0;        // Deferred /restart (0 = none)
 
 // Sensor cooldown state (for single gate setup)
 unsigned long entrySensorCooldownUntil = 0;
@@ -212,6 +216,17 @@ void loop() {
     lastStatsTime = now;
   }
   
+  // Temporary LCD message expired
+  if (lcdRestoreAt != 0 && (long)(now - lcdRestoreAt) >= 0) {
+    lcdRestoreAt = 0;
+    updateLCD();
+  }
+  
+  // Restart once the /restart response has gone out
+  if (restartAt != 0 && (long)(now - restartAt) >= 0) {
+    ESP.restart();
+  }
+  
   updateLEDs();
   delay(10);
 }
@@ -363,8 +378,7 @@ void handleStatus() {
 
 void handleRestart() {
   server.send(200, "application/json", "{\"success\":true}");
-  delay(1000);
-  ESP.restart();
+  restartAt = millis() + 1000;  // Restarted from loop()
 }
 
 // ===========================================
@@ -401,8 +415,9 @@ void checkVehicleAtGate() {
         lcd.clear();
         lcd.print("PARKIR PENUH!");
         Serial.println("[GATE] Parking FULL - Entry denied");
-        delay(2000);
-        updateLCD();
+        // Restored from loop(); same cooldown as an entry keeps it from re-triggering
+        lcdRestoreAt = now + 2000;
+        exitSensorCooldownUntil = now + SENSOR_COOLDOWN_MS;
       }
     }
   }
@@ -475,26 +490,13 @@ void runDetection() {
   if (!fb) { digitalWrite(LED_STATUS, LOW); return; }
   
   if (WiFi.status() == WL_CONNECTED) {
-    HTTPClient http;
-    http.begin(String(AI_SERVICE_URL) + "/analyze");
-    http.setTimeout(15000);
-    
-    String boundary = "----ESP32";
-    http.addHeader("Content-Type", "multipart/form-data; boundary=" + boundary);
+    HttpUrl url;
+    url.parse(AI_SERVICE_URL, "/analyze");
     
-    String bodyStart = "--" + boundary + "\r\nContent-Disposition: form-data; name=\"image\"; filename=\"c.jpg\"\r\nContent-Type: image/jpeg\r\n\r\n";
-    String bodyEnd = "\r\n--" + boundary + "--\r\n";
-    
-    size_t len = bodyStart.length() + fb->len + bodyEnd.length();
-    uint8_t *buf = (uint8_t*)malloc(len);
-    if (buf) {
-      memcpy(buf, bodyStart.c_str(), bodyStart.length());
-      memcpy(buf + bodyStart.length(), fb->buf, fb->len);
-      memcpy(buf + bodyStart.length() + fb->len, bodyEnd.c_str(), bodyEnd.length());
-      http.POST(buf, len);
-      free(buf);
-    }
-    http.end();
+    // Streams fb->buf to the socket, no full-frame copy
+    WiFiClient client;
+    HttpResponse resp;
+    imageUploader.post(client, url, fb->buf, fb->len, resp, 15000);
   }
   esp_camera_fb_return(fb);
   digitalWrite(LED_STATUS, LOW);
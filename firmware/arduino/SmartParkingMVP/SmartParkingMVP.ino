@@ -159,7 +159,10 @@ void checkSensors() {
         lcd.print("PARKIR PENUH!");
         Blynk.virtualWrite(V_VEHICLE, "❌ PENUH - Ditolak");
         Blynk.logEvent("parking_full", "Parkir PENUH! Kendaraan ditolak masuk.");
-        delay(2000);
+        // Keep the message up for 2 s without blocking the sensor timer
+        timer.setTimeout(2000L, updateDisplay);
+        exitCooldown = now + COOLDOWN_MS;
+        return;
       }
       exitCooldown = now + COOLDOWN_MS;
       updateDisplay();
@@ -0,0 +1,257 @@
+/*
+ * firmware_bench - host benchmarks of the firmware (see host/README.md)
+ *
+ *   detection  SceneGate signature, SlotClassifier and RoiCrop on one
+ *              frame: the uplink task's CPU cost per detection cycle
+ *   wire       bytes and encode/decode time per backend message, JSON
+ *              against MessagePack (WireFormat)
+ *   stream     MJPEG frames/s and Mbit/s per viewer, 1 and 2 viewers
+ *   gate       car at the entry sensor -> servo command, while the
+ *              uplink task waits SLOW_PEER_MS for the AI service (or the
+ *              backend, when the slots were decided on the device)
+ *
+ * Host numbers: compare runs on the same machine, not with the device.
+ * Usage: firmware_bench [--quick]
+ */
+
+#include "HostTest.h"
+#include "RoiCrop.h"
+#include "SceneGate.h"
+#include "SlotClassifier.h"
+#include "WireFormat.h"
+
+#define FRAME_W                 640
+#define FRAME_H                 480
+#define SLOW_PEER_MS            3000
+#define STREAM_SECONDS          3
+#define WIRE_BATCH_EVENTS       16    // EVENT_BATCH_MAX in src/main.cpp
+#define WIRE_SLOTS              16
+
+static double elapsedUs(const std::chrono::steady_clock::time_point &start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void benchDetection(int iterations) {
+    std::string regions = regionsReply();
+    std::vector<uint8_t> jpeg = sceneFrame(FRAME_W, FRAME_H, 0);
+
+    SceneGate scene(12, 4, 60000);
+    SlotClassifier slots;
+    RoiCrop crop(80);
+    slots.loadRegions(regions.c_str(), regions.size());
+    int x0 = 0, y0 = 0, x1 = FRAME_W, y1 = FRAME_H;
+    slots.bounds(FRAME_W, FRAME_H, x0, y0, x1, y1);
+    RoiRect roi = RoiCrop::align(x0, y0, x1, y1, FRAME_W, FRAME_H, 16);
+
+    double sceneUs = 0, classifyUs = 0, cropUs = 0;
+    size_t cropBytes = 0;
+    for (int i = 0; i < iterations; i++) {
+        SceneSignature sig;
+        std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+        scene.signature(jpeg.data(), jpeg.size(), sig);
+        sceneUs += elapsedUs(t);
+
+        t = std::chrono::steady_clock::now();
+        slots.classify(jpeg.data(), jpeg.size(), FRAME_W, FRAME_H);
+        classifyUs += elapsedUs(t);
+
+        uint8_t *out = NULL;
+        size_t outLen = 0;
+        t = std::chrono::steady_clock::now();
+        if (crop.crop(jpeg.data(), jpeg.size(), roi, &out, &outLen)) {
+            cropBytes = outLen;
+        }
+        cropUs += elapsedUs(t);
+        free(out);
+    }
+
+    printf("detection  frame %ux%u, %u bytes, %d iterations\n", FRAME_W, FRAME_H, (unsigned)jpeg.size(),
+           iterations);
+    printf("  scene signature   %9.0f us\n", sceneUs / iterations);
+    printf("  slot classify     %9.0f us\n", classifyUs / iterations);
+    printf("  roi crop          %9.0f us  (%ux%u at %u,%u -> %u bytes)\n", cropUs / iterations, roi.w, roi.h,
+           roi.x, roi.y, (unsigned)cropBytes);
+    printf("  cycle total       %9.0f us\n", (sceneUs + classifyUs + cropUs) / iterations);
+}
+
+// The backend traffic of one uplink pass, as src/main.cpp builds it
+static void wireBatch(JsonDocument &doc) {
+    doc["camera_id"] = "esp32-main";
+    doc["epoch"] = 2841553617u;
+    JsonArray events = doc.createNestedArray("events");
+    for (int i = 0; i < WIRE_BATCH_EVENTS; i++) {
+        JsonObject e = events.createNestedObject();
+        e["seq"] = 1000 + i;
+        e["event_type"] = i % 2 ? "exit" : "entry";
+        e["age_ms"] = 250 + i * 40;
+    }
+}
+
+static void wireSlotUpdate(JsonDocument &doc) {
+    doc["is_occupied"] = true;
+}
+
+static void wireSlotList(JsonDocument &doc) {
+    doc["success"] = true;
+    JsonArray data = doc.createNestedArray("data");
+    for (int i = 0; i < WIRE_SLOTS; i++) {
+        char code[8];
+        char id[40];
+        snprintf(code, sizeof(code), "A%02d", i + 1);
+        snprintf(id, sizeof(id), "6f1c2a9e-4b7d-4e21-9a55-%012d", i);
+        JsonObject slot = data.createNestedObject();
+        slot["id"] = id;
+        slot["code"] = code;
+        slot["is_occupied"] = i % 3 == 0;
+        slot["updated_at"] = "2026-10-17T08:15:42Z";
+    }
+}
+
+static void wireStats(JsonDocument &doc) {
+    JsonObject data = doc.createNestedObject("data");
+    data["total_slots"] = WIRE_SLOTS;
+    data["available_slots"] = 11;
+    data["occupied_slots"] = 5;
+    data["occupancy_rate"] = 31.25;
+}
+
+static void benchWire(int iterations) {
+    struct Message { const char *name; void (*build)(JsonDocument &); } messages[] = {
+        { "event batch", wireBatch },
+        { "slot update", wireSlotUpdate },
+        { "slot list", wireSlotList },
+        { "stats", wireStats },
+    };
+    static const char *MIME[WIRE_ENCODING_COUNT] = { WIRE_MIME_JSON, WIRE_MIME_MSGPACK };
+    DynamicJsonDocument doc(4096), decoded(4096);
+    static char buf[4096];
+
+    printf("wire       per message, %d iterations\n", iterations);
+    printf("  %-12s  %-7s  %6s  %10s  %10s\n", "message", "format", "bytes", "encode ns", "decode ns");
+    for (const Message &msg : messages) {
+        doc.clear();
+        msg.build(doc);
+        for (uint8_t enc = 0; enc < WIRE_ENCODING_COUNT; enc++) {
+            // A peer that answered in MessagePack gets MessagePack bodies
+            WireFormat wire;
+            if (enc == WIRE_MSGPACK) {
+                HttpResponse hello;
+                hello.status = 200;
+                strcpy(hello.contentType, WIRE_MIME_MSGPACK);
+                hello.body = String("\x80");
+                wire.deserialize(decoded, hello);
+            }
+
+            size_t len = 0;
+            std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++) {
+                len = wire.serialize(doc, buf, sizeof(buf));
+            }
+            double encodeNs = elapsedUs(t) * 1000 / iterations;
+
+            HttpResponse resp;
+            resp.status = 200;
+            strcpy(resp.contentType, MIME[enc]);
+            resp.body = String(std::string(buf, len));
+            t = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++) {
+                wire.deserialize(decoded, resp);
+            }
+            double decodeNs = elapsedUs(t) * 1000 / iterations;
+
+            printf("  %-12s  %-7s  %6u  %10.0f  %10.0f\n", msg.name, WireFormat::name((WireEncoding)enc),
+                   (unsigned)len, encodeNs, decodeNs);
+        }
+    }
+}
+
+static void benchStream(uint16_t port, int viewers) {
+    std::vector<StreamViewer *> open;
+    std::vector<uint32_t> frames0;
+    std::vector<uint64_t> bytes0;
+    for (int i = 0; i < viewers; i++) {
+        open.push_back(new StreamViewer(port));
+        // The server takes the next client only after HTTP_MAX_CLOSE_WAIT
+        waitFor([&] { return open.back()->frames() > 0; }, 5000);
+    }
+    for (size_t i = 0; i < open.size(); i++) {
+        frames0.push_back(open[i]->frames());
+        bytes0.push_back(open[i]->bytes());
+    }
+    sleep(STREAM_SECONDS);
+    printf("stream     %d viewer(s), %d s\n", viewers, STREAM_SECONDS);
+    for (size_t i = 0; i < open.size(); i++) {
+        uint32_t frames = open[i]->frames() - frames0[i];
+        uint64_t bytes = open[i]->bytes() - bytes0[i];
+        printf("  viewer %u          %6.1f frames/s  %7.2f Mbit/s\n", (unsigned)i,
+               frames / (double)STREAM_SECONDS, bytes * 8 / 1e6 / STREAM_SECONDS);
+    }
+    for (size_t i = 0; i < open.size(); i++) {
+        open[i]->close();
+        delete open[i];
+    }
+    // The server holds a finished stream client until it has hung up
+    usleep(300000);
+}
+
+static void benchGate(FakeBackend &backend, FakeAiService &ai, int trials) {
+    std::vector<double> latencies;
+    for (int i = 0; i < trials; i++) {
+        // New scene, so the next detection frame is sent out; the car
+        // arrives while the uplink task waits for the answer
+        HostCamera::clear();
+        HostCamera::addFrame(sceneFrame(FRAME_W, FRAME_H, i + 1));
+        uint32_t sent = ai.analyzed() + backend.slotReads();
+        waitFor([&] { return ai.analyzed() + backend.slotReads() != sent; }, 30000);
+        usleep(200000);
+
+        size_t before = HostServo::history().size();
+        uint64_t arrivedUs = HostClock::nowUs();
+        HostGpio::setDistance(1, 3.0f);
+        waitFor([&] { return HostServo::history().size() > before; }, 2000);
+        std::vector<HostServoCommand> history = HostServo::history();
+        if (history.size() > before) {
+            latencies.push_back((history[before].atUs - arrivedUs) / 1000.0);
+        }
+        HostGpio::setDistance(1, 0);
+        // Closed again and past the sensor cooldown
+        waitFor([] { return HostServo::angle() == 0; }, 8000);
+        usleep(600000);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for (size_t i = 0; i < latencies.size(); i++) sum += latencies[i];
+    printf("gate       entry sensor -> servo, peers answering in %d ms, %u/%d trials\n", SLOW_PEER_MS,
+           (unsigned)latencies.size(), trials);
+    if (!latencies.empty()) {
+        printf("  latency           %6.1f ms avg  %6.1f ms max  %6.1f ms min\n", sum / latencies.size(),
+               latencies.back(), latencies.front());
+    }
+    printf("  uplink requests   %u to the AI service, %u slot reads\n", ai.analyzed(), backend.slotReads());
+}
+
+int main(int argc, char **argv) {
+    bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+    HostSerial::mute(getenv("HOST_VERBOSE") == NULL);
+
+    benchDetection(quick ? 5 : 30);
+    benchWire(quick ? 2000 : 20000);
+
+    HostCamera::clear();
+    HostCamera::addFrame(sceneFrame(FRAME_W, FRAME_H, 0));
+    FakeBackend backend;
+    FakeAiService ai(SLOW_PEER_MS);
+    HostGpio::attachEcho(1, 2);
+    HostGpio::attachEcho(42, 41);
+    HostArduino::start();
+
+    uint16_t port = HostNet::boundPort(80);
+    benchStream(port, 1);
+    benchStream(port, 2);
+    backend.setDelay(SLOW_PEER_MS);
+    benchGate(backend, ai, quick ? 2 : 5);
+
+    fflush(stdout);
+    HostArduino::exit(0);
+}
@@ -0,0 +1,262 @@
+/*
+ * Arduino core stand-in for the host build (see host/README.md)
+ *
+ * Just enough of the Arduino-ESP32 core for the firmware sources to compile
+ * unchanged on Linux: String, Print/Stream, Serial, GPIO, timing and ESP.
+ * Time comes from HostClock and pins from HostGpio (HostHarness.h), so
+ * tests can drive both. Everything here is thread-safe unless noted.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <algorithm>
+
+#include "esp32-hal.h"
+#include "freertos/FreeRTOS.h"
+
+#define HIGH            1
+#define LOW             0
+#define INPUT           0x01
+#define OUTPUT          0x03
+#define INPUT_PULLUP    0x05
+#define RISING          0x01
+#define FALLING         0x02
+#define CHANGE          0x03
+
+#define PROGMEM
+#define PSTR(s)         (s)
+#define F(s)            (s)
+#define IRAM_ATTR
+#define ARDUINO_ISR_ATTR
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+#define digitalPinToInterrupt(p) (p)
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+
+using std::min;
+using std::max;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+size_t strlcpy(char *dst, const char *src, size_t size);
+
+// ===========================================
+// String
+// ===========================================
+class String {
+public:
+    String() {}
+    String(const char *s) : _s(s ? s : "") {}
+    String(const std::string &s) : _s(s) {}
+    explicit String(char c) : _s(1, c) {}
+    explicit String(int v, unsigned char base = 10);
+    explicit String(unsigned int v, unsigned char base = 10);
+    explicit String(long v, unsigned char base = 10);
+    explicit String(unsigned long v, unsigned char base = 10);
+    explicit String(float v, unsigned char decimals = 2);
+    explicit String(double v, unsigned char decimals = 2);
+
+    const char *c_str() const { return _s.c_str(); }
+    unsigned int length() const { return (unsigned int)_s.size(); }
+    bool reserve(unsigned int size) { _s.reserve(size); return true; }
+    bool isEmpty() const { return _s.empty(); }
+
+    bool concat(const String &s) { _s += s._s; return true; }
+    bool concat(const char *s) { if (!s) return false; _s += s; return true; }
+    bool concat(const char *s, unsigned int len) { if (!s) return false; _s.append(s, len); return true; }
+    bool concat(char c) { _s += c; return true; }
+    bool concat(int v) { return concat(String(v)); }
+    bool concat(unsigned int v) { return concat(String(v)); }
+    bool concat(long v) { return concat(String(v)); }
+    bool concat(unsigned long v) { return concat(String(v)); }
+
+    String &operator+=(const String &s) { concat(s); return *this; }
+    String &operator+=(const char *s) { concat(s); return *this; }
+    String &operator+=(char c) { concat(c); return *this; }
+    String &operator+=(int v) { concat(v); return *this; }
+    String &operator+=(unsigned int v) { concat(v); return *this; }
+    String &operator+=(long v) { concat(v); return *this; }
+    String &operator+=(unsigned long v) { concat(v); return *this; }
+
+    friend String operator+(const String &a, const String &b) { return String(a._s + b._s); }
+    friend String operator+(const String &a, const char *b) { return String(a._s + (b ? b : "")); }
+    friend String operator+(const char *a, const String &b) { return String(std::string(a ? a : "") + b._s); }
+
+    bool operator==(const String &o) const { return _s == o._s; }
+    bool operator==(const char *o) const { return _s == (o ? o : ""); }
+    bool operator!=(const String &o) const { return _s != o._s; }
+    bool operator!=(const char *o) const { return !(*this == o); }
+    bool operator<(const String &o) const { return _s < o._s; }
+    bool equals(const String &o) const { return _s == o._s; }
+    bool equalsIgnoreCase(const String &o) const;
+
+    char operator[](unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+    char &operator[](unsigned int i) { return _s[i]; }
+    char charAt(unsigned int i) const { return (*this)[i]; }
+
+    bool startsWith(const String &prefix) const { return _s.compare(0, prefix._s.size(), prefix._s) == 0; }
+    bool endsWith(const String &suffix) const;
+    int indexOf(char c, unsigned int from = 0) const;
+    int indexOf(const String &s, unsigned int from = 0) const;
+    int lastIndexOf(char c) const;
+    String substring(unsigned int from) const { return substring(from, length()); }
+    String substring(unsigned int from, unsigned int to) const;
+
+    void trim();
+    void toLowerCase();
+    void toUpperCase();
+    void replace(const String &from, const String &to);
+    void remove(unsigned int index, unsigned int count = (unsigned int)-1);
+
+    long toInt() const { return atol(_s.c_str()); }
+    float toFloat() const { return (float)atof(_s.c_str()); }
+    double toDouble() const { return atof(_s.c_str()); }
+
+    const std::string &str() const { return _s; }
+
+private:
+    std::string _s;
+};
+
+// ===========================================
+// Print / Stream
+// ===========================================
+class Printable;
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *s) { return s ? write((const uint8_t *)s, strlen(s)) : 0; }
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    size_t print(const String &s) { return write(s.c_str(), s.length()); }
+    size_t print(const char *s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char v, int base = 10) { return print((unsigned long)v, base); }
+    size_t print(int v, int base = 10) { return print((long)v, base); }
+    size_t print(unsigned int v, int base = 10) { return print((unsigned long)v, base); }
+    size_t print(long v, int base = 10);
+    size_t print(unsigned long v, int base = 10);
+    size_t print(long long v, int base = 10);
+    size_t print(unsigned long long v, int base = 10);
+    size_t print(double v, int digits = 2);
+    size_t print(const Printable &p);
+
+    size_t println() { return write("\r\n"); }
+    template<class T> size_t println(const T &v) { size_t n = print(v); return n + println(); }
+    template<class T> size_t println(const T &v, int fmt) { size_t n = print(v, fmt); return n + println(); }
+};
+
+class Printable {
+public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print &p) const = 0;
+};
+
+class Stream : public Print {
+public:
+    Stream() : _timeout(1000) {}
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeoutMs) { _timeout = timeoutMs; }
+    unsigned long getTimeout() const { return _timeout; }
+    size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+    String readString();
+    String readStringUntil(char terminator);
+
+protected:
+    int timedRead();
+    unsigned long _timeout;
+};
+
+// Serial goes to stdout (HostSerial::mute() silences it)
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    void end() {}
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    operator bool() const { return true; }
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+// ===========================================
+// IPAddress
+// ===========================================
+class IPAddress : public Printable {
+public:
+    IPAddress() : _addr(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : _addr((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+    IPAddress(uint32_t addr) : _addr(addr) {}
+    operator uint32_t() const { return _addr; }
+    uint8_t operator[](int i) const { return (uint8_t)(_addr >> (8 * i)); }
+    bool operator==(const IPAddress &o) const { return _addr == o._addr; }
+    String toString() const;
+    size_t printTo(Print &p) const override;
+
+private:
+    uint32_t _addr;   // Network order, like lwIP
+};
+
+// ===========================================
+// ESP
+// ===========================================
+class EspClass {
+public:
+    void restart();
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getHeapSize();
+    uint32_t getMaxAllocHeap();
+    uint32_t getPsramSize();
+    uint32_t getFreePsram();
+    uint32_t getMinFreePsram();
+    uint32_t getMaxAllocPsram();
+    uint32_t getCpuFreqMHz() { return 240; }
+    uint64_t getEfuseMac() { return 0x24AC2C3B6A10ULL; }
+    const char *getSdkVersion() { return "host"; }
+};
+
+extern EspClass ESP;
+
+// Sketch entry points, called by the host runtime (HostArduino)
+void setup();
+void loop();
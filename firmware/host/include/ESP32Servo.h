@@ -0,0 +1,23 @@
+/*
+ * ESP32Servo stand-in for the host build: records every command in
+ * HostServo (HostHarness.h) with its HostClock timestamp.
+ */
+
+#pragma once
+
+#include "Arduino.h"
+
+class Servo {
+public:
+    Servo() : _pin(-1), _angle(0) {}
+    int attach(int pin);
+    int attach(int pin, int minUs, int maxUs) { (void)minUs; (void)maxUs; return attach(pin); }
+    void detach();
+    void write(int angle);
+    int read() const { return _angle; }
+    bool attached() const { return _pin >= 0; }
+
+private:
+    int _pin;
+    int _angle;
+};
@@ -0,0 +1,272 @@
+/*
+ * HostHarness - test-side controls of the host stand-ins
+ *
+ * The stand-in headers (Arduino.h, WiFi.h, esp_camera.h, ...) let the
+ * firmware compile unchanged on Linux; this header is what tests and the
+ * benchmark runner use to drive and observe them:
+ *
+ *   HostClock   virtual millis()/micros(): real time, frozen (advanced by
+ *               the test) or with delays skipped
+ *   HostGpio    pin recorder, input edges, HC-SR04 echo model
+ *   HostCamera  frames from JPEG files or generated test cards
+ *   HostNet     loopback sockets, device port -> host port map, WiFi drops
+ *   HostHttpServer  stand-in backend / AI service over loopback
+ *   HostFs      LittleFS on a host directory, failing writes
+ *   HostHeap    allocation counters (process and calling thread)
+ *   HostServo, HostLcd, HostSerial  recorders
+ *   HostJpeg    libjpeg encode/decode, the reference for StripeJpeg
+ *   HostArduino runs setup()/loop() like the Arduino loopTask
+ *
+ * Usage (full firmware against a slow AI service):
+ *   HostHttpServer ai([](const HostHttpRequest &r) { ... });
+ *   HostNet::mapPort(5000, ai.port());
+ *   HostGpio::attachEcho(1, 2);
+ *   HostArduino::start();                      // setup(), tasks running
+ *   HostGpio::setDistance(1, 3.0f);            // car at the entry sensor
+ *
+ * Thread-safe unless noted. Host-only: never included by firmware code.
+ */
+
+#pragma once
+
+#include "Arduino.h"
+#include "esp_camera.h"
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// ===========================================
+// Clock
+// ===========================================
+class HostClock {
+public:
+    // Follow the host's steady clock (the default)
+    static void run();
+    // Stop time; it moves only through advance()/advanceUs() or delays on
+    // the calling thread, which becomes the driver. Other threads sleeping
+    // in delay()/vTaskDelay() wake when the driver passes their deadline.
+    static void freeze();
+    static bool frozen();
+    static void advance(uint32_t ms) { advanceUs((uint64_t)ms * 1000); }
+    static void advanceUs(uint64_t us);
+    // delay()/vTaskDelay() on the calling thread return at once and move
+    // time forward instead; HostArduino::start() uses it for setup()
+    static void skipDelays(bool on);
+    static uint64_t nowUs();
+
+    // Used by the stand-ins: sleep until nowUs() >= targetUs
+    static void sleepUntilUs(uint64_t targetUs);
+};
+
+// ===========================================
+// GPIO
+// ===========================================
+class HostGpio {
+public:
+    static int level(uint8_t pin);
+    static int mode(uint8_t pin);
+    static uint32_t writes(uint8_t pin);
+    // Drives an input pin and runs its interrupt handler on this thread
+    static void drive(uint8_t pin, int level);
+
+    // HC-SR04 on trigPin/echoPin: a 10 us trigger pulse raises echo after
+    // HOST_ECHO_DELAY_US for the round trip to the current distance; no
+    // object gives the sensor's 38 ms timeout pulse
+    static void attachEcho(uint8_t trigPin, uint8_t echoPin);
+    static void setDistance(uint8_t trigPin, float cm);   // <= 0: nothing in range
+    static uint32_t pings(uint8_t trigPin);
+    // Runs the echo edges that are due (called by the clock while frozen)
+    static void runDue(uint64_t nowUs);
+    static void reset();
+};
+
+#define HOST_ECHO_DELAY_US      450
+#define HOST_ECHO_TIMEOUT_US    38000
+
+// ===========================================
+// Camera
+// ===========================================
+class HostCamera {
+public:
+    static bool loadFile(const char *path);
+    static size_t loadDir(const char *dir);       // All *.jpg, sorted by name
+    static void addFrame(const uint8_t *jpeg, size_t len);
+    static void addFrame(const std::vector<uint8_t> &jpeg) { addFrame(jpeg.data(), jpeg.size()); }
+    // Generated test card of this size: gradient, grid and a block at
+    // (blockX, blockY) so consecutive cards can differ where a test wants
+    static void addPattern(uint16_t width, uint16_t height, int blockX = -1, int blockY = -1,
+                           int quality = 80);
+    static void clear();
+    static size_t frameCount();
+
+    static void setFps(uint32_t fps);             // Default 25
+    static framesize_t framesize();
+    static int quality();
+    static uint32_t grabs();
+    static uint32_t failures();
+    static uint32_t sizeChanges();
+    static uint32_t held();                       // Frame buffers out right now
+};
+
+// ===========================================
+// Network
+// ===========================================
+class HostNet {
+public:
+    // Device port -> host port, for WebServer/WiFiServer and for outbound
+    // connects. 0 lets the kernel pick a listening port. Unmapped ports
+    // below 1024 get +10000, others stay as they are.
+    static void mapPort(uint16_t devicePort, uint16_t hostPort);
+    static uint16_t hostPort(uint16_t devicePort);
+    // Port a server for devicePort actually listens on
+    static uint16_t boundPort(uint16_t devicePort);
+    static void bound(uint16_t devicePort, uint16_t hostPort);
+
+    // Station drop/recovery, with the same events as the WiFi driver
+    static void dropWiFi();
+    static void restoreWiFi();
+    static bool wifiUp();
+    static uint32_t connects();                   // Outbound TCP connects
+};
+
+struct HostHttpRequest {
+    std::string method;
+    std::string path;                             // Without the query
+    std::string query;
+    std::map<std::string, std::string> headers;   // Lower-case names
+    std::string body;
+
+    std::string header(const char *name) const;
+    std::string arg(const char *name) const;      // From the query
+};
+
+struct HostHttpReply {
+    HostHttpReply() : status(200), contentType("application/json"), chunked(false), close(false),
+                      delayMs(0) {}
+    int status;
+    std::string contentType;
+    std::string body;
+    bool chunked;                                 // Transfer-Encoding: chunked, 512-byte chunks
+    bool close;                                   // Connection: close and hang up
+    uint32_t delayMs;                             // Host time before the reply goes out
+    std::vector<std::pair<std::string, std::string> > headers;
+};
+
+// HTTP/1.1 server on 127.0.0.1 with keep-alive, one thread per connection
+class HostHttpServer {
+public:
+    typedef std::function<HostHttpReply(const HostHttpRequest &)> Handler;
+
+    explicit HostHttpServer(Handler handler);
+    ~HostHttpServer();
+    uint16_t port() const { return _port; }
+    uint32_t requests() const;
+    uint32_t connections() const;
+    void stop();
+
+private:
+    struct State;
+    State *_state;
+    uint16_t _port;
+};
+
+// Minimal blocking client for tests: one request, Connection: close
+struct HostHttpResult {
+    int status;
+    std::map<std::string, std::string> headers;   // Lower-case names
+    std::string body;                             // Chunked bodies are decoded
+};
+
+class HostHttpClient {
+public:
+    static bool request(uint16_t port, const char *method, const char *target,
+                        HostHttpResult &out, const std::string &body = std::string(),
+                        const std::map<std::string, std::string> &headers =
+                            std::map<std::string, std::string>(),
+                        uint32_t timeoutMs = 5000);
+    static bool get(uint16_t port, const char *target, HostHttpResult &out) {
+        return request(port, "GET", target, out);
+    }
+};
+
+// ===========================================
+// Flash file system
+// ===========================================
+class HostFs {
+public:
+    static void mount(const char *dir);           // Default: a fresh temp directory
+    static std::string root();
+    static void failWrites(bool fail);            // Writes return 0, files keep their size
+    static void wipe();                           // Empty the mounted directory
+};
+
+// ===========================================
+// Heap
+// ===========================================
+class HostHeap {
+public:
+    static uint64_t allocations();                // malloc/new calls, whole process
+    static uint64_t threadAllocations();          // By the calling thread
+    static size_t liveBytes();
+};
+
+// ===========================================
+// Recorders
+// ===========================================
+struct HostServoCommand {
+    uint64_t atUs;
+    int pin;
+    int angle;
+};
+
+class HostServo {
+public:
+    static int angle();                           // Last commanded angle
+    static std::vector<HostServoCommand> history();
+    static void clear();
+};
+
+class HostLcd {
+public:
+    static std::string line(uint8_t row);        // Without trailing blanks
+    static uint32_t clears();
+    static bool backlight();
+};
+
+class HostSerial {
+public:
+    static void mute(bool on);
+    // Keep Serial output in a buffer instead of printing it
+    static void capture(bool on);
+    static std::string take();
+};
+
+// ===========================================
+// JPEG reference codec (libjpeg)
+// ===========================================
+class HostJpeg {
+public:
+    static bool encode(const uint8_t *rgb, uint16_t width, uint16_t height, int quality,
+                       std::vector<uint8_t> &out);
+    static bool decode(const uint8_t *jpeg, size_t len, std::vector<uint8_t> &rgb,
+                       uint16_t &width, uint16_t &height);
+    // Frame size from the SOF marker, without decoding
+    static bool size(const uint8_t *jpeg, size_t len, uint16_t &width, uint16_t &height);
+    static double psnr(const uint8_t *a, const uint8_t *b, size_t len);
+};
+
+// ===========================================
+// Sketch runtime
+// ===========================================
+class HostArduino {
+public:
+    // setup() then loop() forever on a "loopTask" thread (core 1); returns
+    // once setup() has returned. Delays in setup() are skipped.
+    static void start();
+    // setup() and loop() on the calling thread; for the app binaries
+    static void run();
+    static bool started();
+    // Ends the process without running static destructors under live tasks
+    static void exit(int code);
+};
@@ -0,0 +1,29 @@
+/*
+ * LiquidCrystal_I2C stand-in for the host build: keeps the character
+ * buffer in HostLcd (HostHarness.h) so tests can read what is shown.
+ */
+
+#pragma once
+
+#include "Arduino.h"
+#include "Wire.h"
+
+class LiquidCrystal_I2C : public Print {
+public:
+    LiquidCrystal_I2C(uint8_t address, uint8_t cols, uint8_t rows);
+    void init();
+    void begin() { init(); }
+    void clear();
+    void home() { setCursor(0, 0); }
+    void setCursor(uint8_t col, uint8_t row);
+    void backlight();
+    void noBacklight();
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+private:
+    uint8_t _cols;
+    uint8_t _rows;
+    uint8_t _col;
+    uint8_t _row;
+};
@@ -0,0 +1,81 @@
+/*
+ * Arduino-ESP32 WebServer stand-in for the host build
+ *
+ * Same request cycle as the ESP32 library: handleClient() accepts at most
+ * one connection, parses the request line, query arguments and the
+ * collected headers, runs the matching handler and drops its reference to
+ * the socket (a handler that copied server.client() keeps it open). The
+ * port is remapped through HostNet (80 -> 10080 unless a test maps it).
+ * Not thread-safe: call it from one task, like on the device.
+ */
+
+#pragma once
+
+#include "WiFi.h"
+#include <functional>
+#include <vector>
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+
+class WebServer {
+public:
+    typedef std::function<void(void)> THandlerFunction;
+
+    WebServer(int port = 80);
+    ~WebServer();
+
+    void begin();
+    void close();
+    void handleClient();
+
+    void on(const String &uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+    void on(const String &uri, HTTPMethod method, THandlerFunction handler);
+    void onNotFound(THandlerFunction handler) { _notFound = handler; }
+
+    String uri() const { return _uri; }
+    HTTPMethod method() const { return _method; }
+    WiFiClient client() { return _client; }
+
+    String arg(const char *name) const;
+    String arg(const String &name) const { return arg(name.c_str()); }
+    bool hasArg(const char *name) const;
+    bool hasArg(const String &name) const { return hasArg(name.c_str()); }
+    int args() const { return (int)_args.size(); }
+
+    void collectHeaders(const char *headerKeys[], const size_t headerKeysCount);
+    String header(const char *name) const;
+    bool hasHeader(const char *name) const;
+
+    void sendHeader(const String &name, const String &value, bool first = false);
+    void setContentLength(size_t contentLength) { _contentLength = contentLength; }
+    void send(int code, const char *contentType = NULL, const String &content = String(""));
+    void send(int code, const String &contentType, const String &content) { send(code, contentType.c_str(), content); }
+    void send(int code, const char *contentType, const char *content) { send(code, contentType, String(content)); }
+    void send_P(int code, const char *contentType, const char *content, size_t contentLength);
+    void send_P(int code, const char *contentType, const char *content) { send_P(code, contentType, content, strlen(content)); }
+    void sendContent(const String &content) { sendContent(content.c_str(), content.length()); }
+    void sendContent(const char *content, size_t size);
+
+private:
+    struct Route { String uri; HTTPMethod method; THandlerFunction handler; };
+    struct Pair { String name; String value; };
+
+    bool readRequest();
+    void writeHead(int code, const char *contentType, size_t contentLength);
+
+    int _port;
+    WiFiServer _server;
+    WiFiClient _client;
+    std::vector<Route> _routes;
+    THandlerFunction _notFound;
+    std::vector<Pair> _args;
+    std::vector<Pair> _headers;          // Collected keys, values of this request
+    String _responseHeaders;
+    String _uri;
+    HTTPMethod _method;
+    size_t _contentLength;
+    bool _chunked;
+};
@@ -0,0 +1,121 @@
+/*
+ * WiFi / WiFiClient / WiFiServer stand-ins for the host build
+ *
+ * The station is always up unless a test drops it (HostNet::dropWiFi()).
+ * Clients and servers are loopback TCP sockets: every host name resolves
+ * to 127.0.0.1 and device ports are remapped through HostNet, so the
+ * firmware's URLs reach stand-in servers unchanged. Copies of a
+ * WiFiClient share one socket, which closes with the last copy or stop(),
+ * as on the ESP32.
+ */
+
+#pragma once
+
+#include "Arduino.h"
+#include "Client.h"
+#include <memory>
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} wifi_mode_t;
+
+typedef enum {
+    ARDUINO_EVENT_WIFI_READY = 0,
+    ARDUINO_EVENT_WIFI_STA_START,
+    ARDUINO_EVENT_WIFI_STA_STOP,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP,
+    ARDUINO_EVENT_WIFI_STA_LOST_IP,
+    ARDUINO_EVENT_MAX
+} arduino_event_id_t;
+
+typedef void (*WiFiEventCb)(arduino_event_id_t event);
+typedef int wifi_event_id_t;
+
+class HostSocket;
+
+class WiFiClient : public Client {
+public:
+    WiFiClient();
+    explicit WiFiClient(int fd);
+    ~WiFiClient();
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(IPAddress ip, uint16_t port, int32_t timeoutMs);
+    int connect(const char *host, uint16_t port) override;
+    int connect(const char *host, uint16_t port, int32_t timeoutMs);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t *buf, size_t size) override;
+    int peek() override;
+    void flush() override {}
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected(); }
+    bool operator==(const WiFiClient &other) const { return _sock == other._sock; }
+
+    int setNoDelay(bool nodelay);
+    int setTimeout(uint32_t seconds);
+    int fd() const;
+    IPAddress remoteIP() const;
+    uint16_t remotePort() const;
+
+    using Print::write;
+
+private:
+    std::shared_ptr<HostSocket> _sock;
+    uint32_t _timeoutMs;
+};
+
+class WiFiServer {
+public:
+    WiFiServer(uint16_t port = 80, uint8_t maxClients = 4);
+    ~WiFiServer();
+    void begin(uint16_t port = 0);
+    void end();
+    WiFiClient accept();
+    WiFiClient available() { return accept(); }
+    bool hasClient();
+    void setNoDelay(bool nodelay) { _noDelay = nodelay; }
+    operator bool() const { return _fd >= 0; }
+
+private:
+    uint16_t _port;
+    int _fd;
+    bool _noDelay;
+};
+
+class WiFiClass {
+public:
+    wifi_event_id_t onEvent(WiFiEventCb cb, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+    bool mode(wifi_mode_t mode);
+    wl_status_t begin(const char *ssid, const char *passphrase = NULL);
+    wl_status_t status();
+    bool reconnect();
+    bool disconnect(bool wifioff = false);
+    bool setAutoReconnect(bool autoReconnect);
+    bool setSleep(bool enabled);
+    bool isConnected() { return status() == WL_CONNECTED; }
+    IPAddress localIP();
+    String macAddress();
+    int8_t RSSI();
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,21 @@
+/*
+ * TwoWire stand-in for the host build (the LCD is the only I2C device)
+ */
+
+#pragma once
+
+#include "Arduino.h"
+
+class TwoWire {
+public:
+    TwoWire() : _sda(-1), _scl(-1) {}
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+    int sda() const { return _sda; }
+    int scl() const { return _scl; }
+
+private:
+    int _sda;
+    int _scl;
+};
+
+extern TwoWire Wire;
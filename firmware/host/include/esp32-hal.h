@@ -0,0 +1,29 @@
+/*
+ * ESP-IDF system calls used by the firmware, host stand-ins (see Arduino.h)
+ *
+ * Heap figures come from HostHeap: a notional 320 KB internal heap and
+ * 8 MB PSRAM, minus the bytes the host process has live.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MALLOC_CAP_EXEC         (1 << 0)
+#define MALLOC_CAP_32BIT        (1 << 1)
+#define MALLOC_CAP_8BIT         (1 << 2)
+#define MALLOC_CAP_DMA          (1 << 3)
+#define MALLOC_CAP_SPIRAM       (1 << 10)
+#define MALLOC_CAP_INTERNAL     (1 << 11)
+#define MALLOC_CAP_DEFAULT      (1 << 12)
+
+void *heap_caps_malloc(size_t size, uint32_t caps);
+void heap_caps_free(void *ptr);
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+void *ps_malloc(size_t size);
+
+int64_t esp_timer_get_time();
+uint32_t esp_random();
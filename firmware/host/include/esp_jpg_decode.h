@@ -0,0 +1,33 @@
+/*
+ * esp32-camera JPEG decoder stand-in for the host build (libjpeg)
+ *
+ * Same contract as the ROM TJpgDec wrapper: the writer gets a start call
+ * (data NULL, x = y = 0, w/h = output size), RGB888 blocks in MCU order,
+ * then an end call (data NULL, x = w, y = h). Output size is the frame
+ * size divided by the scale and rounded down.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int esp_err_t;
+
+#ifndef ESP_OK
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#endif
+
+typedef enum {
+    JPG_SCALE_NONE,
+    JPG_SCALE_2X,
+    JPG_SCALE_4X,
+    JPG_SCALE_8X,
+    JPG_SCALE_MAX = JPG_SCALE_8X
+} jpg_scale_t;
+
+typedef size_t (*jpg_reader_cb)(void *arg, size_t index, uint8_t *buf, size_t len);
+typedef bool (*jpg_writer_cb)(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data);
+
+esp_err_t esp_jpg_decode(size_t len, jpg_scale_t scale, jpg_reader_cb reader, jpg_writer_cb writer, void *arg);
@@ -0,0 +1,7 @@
+/*
+ * esp_timer stand-in for the host build: esp_timer_get_time() is HostClock
+ */
+
+#pragma once
+
+#include "esp32-hal.h"
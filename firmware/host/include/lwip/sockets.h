@@ -0,0 +1,15 @@
+/*
+ * lwIP sockets stand-in for the host build: the BSD socket API is the same,
+ * so WiFiClient::fd() hands out real host descriptors.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
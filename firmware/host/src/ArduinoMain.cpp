@@ -0,0 +1,11 @@
+/*
+ * Entry point of the host firmware binaries: runs setup()/loop() the way
+ * the Arduino core's loopTask does
+ */
+
+#include <HostHarness.h>
+
+int main() {
+    HostArduino::run();
+    return 0;
+}
@@ -0,0 +1,435 @@
+/*
+ * Arduino core stand-in - see Arduino.h; HostArduino, HostSerial - see HostHarness.h
+ */
+
+#include "HostHarness.h"
+#include "HostInternal.h"
+#include "esp_log.h"
+#include "freertos/task.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <ctype.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+// ===========================================
+// Console (Serial and esp_log)
+// ===========================================
+static std::mutex consoleMutex;
+static bool consoleMuted = false;
+static bool consoleCaptured = false;
+static std::string consoleBuffer;
+
+void hostConsoleWrite(const char *data, size_t len) {
+    std::lock_guard<std::mutex> lock(consoleMutex);
+    if (consoleCaptured) {
+        consoleBuffer.append(data, len);
+    } else if (!consoleMuted) {
+        fwrite(data, 1, len, stdout);
+        fflush(stdout);
+    }
+}
+
+void HostSerial::mute(bool on) {
+    std::lock_guard<std::mutex> lock(consoleMutex);
+    consoleMuted = on;
+}
+
+void HostSerial::capture(bool on) {
+    std::lock_guard<std::mutex> lock(consoleMutex);
+    consoleCaptured = on;
+}
+
+std::string HostSerial::take() {
+    std::lock_guard<std::mutex> lock(consoleMutex);
+    std::string out;
+    out.swap(consoleBuffer);
+    return out;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    hostConsoleWrite((const char *)&c, 1);
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+    hostConsoleWrite((const char *)buffer, size);
+    return size;
+}
+
+static int consoleVprintf(const char *format, va_list args) {
+    char line[256];
+    int n = vsnprintf(line, sizeof(line), format, args);
+    if (n > 0) {
+        hostConsoleWrite(line, (size_t)n < sizeof(line) ? (size_t)n : sizeof(line) - 1);
+    }
+    return n;
+}
+
+static std::atomic<vprintf_like_t> logOutput(consoleVprintf);
+static std::atomic<int> logLevel(ESP_LOG_INFO);
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func) {
+    return logOutput.exchange(func);
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    // One level for every tag is enough for the firmware's use
+    (void)tag;
+    logLevel = level;
+}
+
+uint32_t esp_log_timestamp() {
+    return millis();
+}
+
+static void logWriteV(esp_log_level_t level, const char *format, va_list args) {
+    if (level > logLevel) return;
+    logOutput.load()(format, args);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    (void)tag;
+    va_list args;
+    va_start(args, format);
+    logWriteV(level, format, args);
+    va_end(args);
+}
+
+static void logWriteF(esp_log_level_t level, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    logWriteV(level, format, args);
+    va_end(args);
+}
+
+void hostCamLog(const char *message) {
+    // Same format string the driver's ESP_LOGW produces
+    std::string format = std::string("W (%u) %s: ") + message + "\n";
+    logWriteF(ESP_LOG_WARN, format.c_str(), (unsigned)esp_log_timestamp(), "cam_hal");
+}
+
+// ===========================================
+// String
+// ===========================================
+static std::string formatInteger(unsigned long long v, bool negative, unsigned char base) {
+    if (base < 2 || base > 36) base = 10;
+    char buf[72];
+    char *p = buf + sizeof(buf);
+    *--p = 0;
+    do {
+        unsigned digit = (unsigned)(v % base);
+        *--p = (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+        v /= base;
+    } while (v);
+    if (negative) *--p = '-';
+    return std::string(p);
+}
+
+static std::string formatSigned(long long v, unsigned char base) {
+    if (base == 10 && v < 0) {
+        return formatInteger(0ULL - (unsigned long long)v, true, base);
+    }
+    return formatInteger((unsigned long long)v, false, base);
+}
+
+static std::string formatFloat(double v, unsigned char decimals) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+    return std::string(buf);
+}
+
+String::String(int v, unsigned char base) : _s(formatSigned(v, base)) {}
+String::String(unsigned int v, unsigned char base) : _s(formatInteger(v, false, base)) {}
+String::String(long v, unsigned char base) : _s(formatSigned(v, base)) {}
+String::String(unsigned long v, unsigned char base) : _s(formatInteger(v, false, base)) {}
+String::String(float v, unsigned char decimals) : _s(formatFloat(v, decimals)) {}
+String::String(double v, unsigned char decimals) : _s(formatFloat(v, decimals)) {}
+
+bool String::equalsIgnoreCase(const String &o) const {
+    if (_s.size() != o._s.size()) return false;
+    for (size_t i = 0; i < _s.size(); i++) {
+        if (tolower((unsigned char)_s[i]) != tolower((unsigned char)o._s[i])) return false;
+    }
+    return true;
+}
+
+bool String::endsWith(const String &suffix) const {
+    return _s.size() >= suffix._s.size() &&
+           _s.compare(_s.size() - suffix._s.size(), suffix._s.size(), suffix._s) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+    size_t r = _s.find(c, from);
+    return r == std::string::npos ? -1 : (int)r;
+}
+
+int String::indexOf(const String &s, unsigned int from) const {
+    size_t r = _s.find(s._s, from);
+    return r == std::string::npos ? -1 : (int)r;
+}
+
+int String::lastIndexOf(char c) const {
+    size_t r = _s.rfind(c);
+    return r == std::string::npos ? -1 : (int)r;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) std::swap(from, to);
+    if (from >= _s.size()) return String();
+    if (to > _s.size()) to = (unsigned int)_s.size();
+    return String(_s.substr(from, to - from));
+}
+
+void String::trim() {
+    size_t b = 0;
+    size_t e = _s.size();
+    while (b < e && isspace((unsigned char)_s[b])) b++;
+    while (e > b && isspace((unsigned char)_s[e - 1])) e--;
+    _s = _s.substr(b, e - b);
+}
+
+void String::toLowerCase() {
+    for (size_t i = 0; i < _s.size(); i++) _s[i] = (char)tolower((unsigned char)_s[i]);
+}
+
+void String::toUpperCase() {
+    for (size_t i = 0; i < _s.size(); i++) _s[i] = (char)toupper((unsigned char)_s[i]);
+}
+
+void String::replace(const String &from, const String &to) {
+    if (from._s.empty()) return;
+    size_t pos = 0;
+    while ((pos = _s.find(from._s, pos)) != std::string::npos) {
+        _s.replace(pos, from._s.size(), to._s);
+        pos += to._s.size();
+    }
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+    if (index >= _s.size()) return;
+    _s.erase(index, count);
+}
+
+size_t strlcpy(char *dst, const char *src, size_t size) {
+    size_t len = strlen(src);
+    if (size) {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = 0;
+    }
+    return len;
+}
+
+// ===========================================
+// Print / Stream
+// ===========================================
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+        if (!write(*buffer++)) break;
+        n++;
+    }
+    return n;
+}
+
+size_t Print::printf(const char *format, ...) {
+    char small[128];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(small, sizeof(small), format, args);
+    va_end(args);
+    if (len < 0) return 0;
+    if ((size_t)len < sizeof(small)) {
+        return write((const uint8_t *)small, len);
+    }
+    std::string big(len + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&big[0], big.size(), format, args);
+    va_end(args);
+    return write((const uint8_t *)big.data(), len);
+}
+
+size_t Print::print(long v, int base) {
+    std::string s = formatSigned(v, (unsigned char)base);
+    return write(s.c_str(), s.size());
+}
+
+size_t Print::print(unsigned long v, int base) {
+    std::string s = formatInteger(v, false, (unsigned char)base);
+    return write(s.c_str(), s.size());
+}
+
+size_t Print::print(long long v, int base) {
+    std::string s = formatSigned(v, (unsigned char)base);
+    return write(s.c_str(), s.size());
+}
+
+size_t Print::print(unsigned long long v, int base) {
+    std::string s = formatInteger(v, false, (unsigned char)base);
+    return write(s.c_str(), s.size());
+}
+
+size_t Print::print(double v, int digits) {
+    std::string s = formatFloat(v, (unsigned char)digits);
+    return write(s.c_str(), s.size());
+}
+
+size_t Print::print(const Printable &p) {
+    return p.printTo(*this);
+}
+
+int Stream::timedRead() {
+    unsigned long start = millis();
+    do {
+        int c = read();
+        if (c >= 0) return c;
+        delay(1);
+    } while (millis() - start < _timeout);
+    return -1;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int c = timedRead();
+        if (c < 0) break;
+        buffer[count++] = (char)c;
+    }
+    return count;
+}
+
+String Stream::readString() {
+    std::string s;
+    int c;
+    while ((c = timedRead()) >= 0) s += (char)c;
+    return String(s);
+}
+
+String Stream::readStringUntil(char terminator) {
+    std::string s;
+    int c;
+    while ((c = timedRead()) >= 0 && c != terminator) s += (char)c;
+    return String(s);
+}
+
+// ===========================================
+// IPAddress
+// ===========================================
+String IPAddress::toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+    return String(buf);
+}
+
+size_t IPAddress::printTo(Print &p) const {
+    return p.print(toString());
+}
+
+// ===========================================
+// ESP / random
+// ===========================================
+static std::mutex randomMutex;
+static std::mt19937 randomEngine(std::random_device{}());
+
+uint32_t esp_random() {
+    std::lock_guard<std::mutex> lock(randomMutex);
+    return (uint32_t)randomEngine();
+}
+
+long random(long howbig) {
+    return howbig <= 0 ? 0 : (long)(esp_random() % (uint32_t)howbig);
+}
+
+long random(long howsmall, long howbig) {
+    return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+void EspClass::restart() {
+    // Nothing to reboot into on the host: end the process like a reset
+    Serial.println("[HOST] ESP.restart()");
+    HostArduino::exit(0);
+}
+
+std::string hostTempDir() {
+    static std::mutex dirMutex;
+    static std::string dir;
+    std::lock_guard<std::mutex> lock(dirMutex);
+    if (dir.empty()) {
+        char tmpl[] = "/tmp/firmware-host-XXXXXX";
+        const char *made = mkdtemp(tmpl);
+        dir = made ? made : "/tmp";
+    }
+    return dir;
+}
+
+// ===========================================
+// HostArduino
+// ===========================================
+static std::atomic<bool> sketchStarted(false);
+
+// Library tests link without a sketch; a sketch's definitions win
+__attribute__((weak)) void setup() {
+}
+
+__attribute__((weak)) void loop() {
+    vTaskDelete(NULL);
+}
+
+static void runLoop() {
+    try {
+        while (true) {
+            loop();
+        }
+    } catch (const HostTaskExit &) {
+        // loop() deleted the loopTask; the pinned tasks carry on
+    }
+}
+
+void HostArduino::start() {
+    std::mutex m;
+    std::condition_variable cv;
+    bool ready = false;
+    std::thread([&] {
+        hostSetCore(1);
+        HostClock::skipDelays(true);
+        setup();
+        HostClock::skipDelays(false);
+        {
+            // Notified under the lock: start() returns and drops m/cv after
+            std::lock_guard<std::mutex> lock(m);
+            ready = true;
+            sketchStarted = true;
+            cv.notify_all();
+        }
+        runLoop();
+    }).detach();
+    std::unique_lock<std::mutex> lock(m);
+    cv.wait(lock, [&] { return ready; });
+}
+
+void HostArduino::run() {
+    hostSetCore(1);
+    setup();
+    sketchStarted = true;
+    runLoop();
+    while (true) {
+        sleep(3600);
+    }
+}
+
+bool HostArduino::started() {
+    return sketchStarted;
+}
+
+void HostArduino::exit(int code) {
+    fflush(stdout);
+    fflush(stderr);
+    _exit(code);
+}
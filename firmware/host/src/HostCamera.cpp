@@ -0,0 +1,340 @@
+/*
+ * esp32-camera stand-in - see esp_camera.h and HostHarness.h
+ */
+
+#include <HostHarness.h>
+#include "HostInternal.h"
+#include <dirent.h>
+#include <mutex>
+
+#define CAM_FB_GET_TIMEOUT_MS   4000      // cam_hal's FB_GET_TIMEOUT
+#define CAM_FB_MIN_CAPACITY     (64 * 1024)
+
+const resolution_info_t resolution[] = {
+    {   96,   96 },   // 96X96
+    {  160,  120 },   // QQVGA
+    {  176,  144 },   // QCIF
+    {  240,  176 },   // HQVGA
+    {  240,  240 },   // 240X240
+    {  320,  240 },   // QVGA
+    {  400,  296 },   // CIF
+    {  480,  320 },   // HVGA
+    {  640,  480 },   // VGA
+    {  800,  600 },   // SVGA
+    { 1024,  768 },   // XGA
+    { 1280,  720 },   // HD
+    { 1280, 1024 },   // SXGA
+    { 1600, 1200 },   // UXGA
+    {    0,    0 },   // INVALID
+};
+
+namespace {
+
+struct Frame {
+    std::vector<uint8_t> jpeg;
+    uint16_t width;
+    uint16_t height;
+};
+
+struct Buffer {
+    camera_fb_t fb;
+    size_t capacity;
+    bool out;
+};
+
+std::mutex camMutex;
+std::vector<Frame> frames;
+std::vector<Buffer> buffers;
+bool initialised = false;
+camera_grab_mode_t grabMode = CAMERA_GRAB_WHEN_EMPTY;
+uint32_t fps = 25;
+uint64_t startUs = 0;
+uint64_t lastSeq = 0;
+uint64_t droppedSeq = 0;
+uint32_t grabCount = 0;
+uint32_t failureCount = 0;
+uint32_t sizeChangeCount = 0;
+size_t nextFrame = 0;
+sensor_t sensor;
+
+uint64_t framePeriodUs() {
+    return 1000000ULL / (fps ? fps : 1);
+}
+
+// Frames of the current size, or every frame if none matches it
+void pickFrames(std::vector<size_t> &out) {
+    out.clear();
+    const resolution_info_t &res = resolution[sensor.status.framesize];
+    for (size_t i = 0; i < frames.size(); i++) {
+        if (frames[i].width == res.width && frames[i].height == res.height) out.push_back(i);
+    }
+    if (out.empty()) {
+        for (size_t i = 0; i < frames.size(); i++) out.push_back(i);
+    }
+}
+
+int setFramesize(sensor_t *s, framesize_t size) {
+    if (size >= FRAMESIZE_INVALID) return -1;
+    std::lock_guard<std::mutex> lock(camMutex);
+    if (s->status.framesize != size) {
+        s->status.framesize = size;
+        sizeChangeCount++;
+    }
+    return 0;
+}
+
+int setQuality(sensor_t *s, int quality) {
+    std::lock_guard<std::mutex> lock(camMutex);
+    s->status.quality = (uint8_t)quality;
+    return 0;
+}
+
+int setBrightness(sensor_t *s, int level) { s->status.brightness = (int8_t)level; return 0; }
+int setContrast(sensor_t *s, int level) { s->status.contrast = (int8_t)level; return 0; }
+int setSaturation(sensor_t *s, int level) { s->status.saturation = (int8_t)level; return 0; }
+int setWhitebal(sensor_t *s, int enable) { s->status.awb = (uint8_t)enable; return 0; }
+int setAwbGain(sensor_t *s, int enable) { s->status.awb_gain = (uint8_t)enable; return 0; }
+int setExposureCtrl(sensor_t *s, int enable) { s->status.aec = (uint8_t)enable; return 0; }
+int setAec2(sensor_t *s, int enable) { s->status.aec2 = (uint8_t)enable; return 0; }
+int setFlag(sensor_t *, int) { return 0; }
+
+}  // namespace
+
+// ===========================================
+// HostCamera
+// ===========================================
+void HostCamera::addFrame(const uint8_t *jpeg, size_t len) {
+    Frame f;
+    f.jpeg.assign(jpeg, jpeg + len);
+    if (!HostJpeg::size(jpeg, len, f.width, f.height)) {
+        f.width = f.height = 0;
+    }
+    std::lock_guard<std::mutex> lock(camMutex);
+    frames.push_back(f);
+}
+
+bool HostCamera::loadFile(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    fclose(f);
+    if (data.size() < 4) return false;
+    addFrame(data);
+    return true;
+}
+
+size_t HostCamera::loadDir(const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) return 0;
+    std::vector<std::string> names;
+    while (struct dirent *e = readdir(d)) {
+        std::string name = e->d_name;
+        if (name.size() > 4 && (name.substr(name.size() - 4) == ".jpg" || name.substr(name.size() - 4) == ".JPG")) {
+            names.push_back(name);
+        }
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+    size_t loaded = 0;
+    for (size_t i = 0; i < names.size(); i++) {
+        loaded += loadFile((std::string(dir) + "/" + names[i]).c_str()) ? 1 : 0;
+    }
+    return loaded;
+}
+
+void HostCamera::addPattern(uint16_t width, uint16_t height, int blockX, int blockY, int quality) {
+    std::vector<uint8_t> rgb((size_t)width * height * 3);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t *p = &rgb[((size_t)y * width + x) * 3];
+            bool grid = x % 64 == 0 || y % 64 == 0;
+            bool inBlock = blockX >= 0 && x >= blockX && x < blockX + 48 && y >= blockY && y < blockY + 48;
+            p[0] = inBlock ? 230 : grid ? 20 : (uint8_t)(x * 255 / width);
+            p[1] = inBlock ? 40 : grid ? 20 : (uint8_t)(y * 255 / height);
+            p[2] = inBlock ? 40 : grid ? 20 : (uint8_t)(128 + (x + y) % 64);
+        }
+    }
+    std::vector<uint8_t> jpeg;
+    if (HostJpeg::encode(rgb.data(), width, height, quality, jpeg)) {
+        addFrame(jpeg);
+    }
+}
+
+void HostCamera::clear() {
+    std::lock_guard<std::mutex> lock(camMutex);
+    frames.clear();
+    nextFrame = 0;
+}
+
+size_t HostCamera::frameCount() {
+    std::lock_guard<std::mutex> lock(camMutex);
+    return frames.size();
+}
+
+void HostCamera::setFps(uint32_t value) {
+    std::lock_guard<std::mutex> lock(camMutex);
+    fps = value ? value : 1;
+}
+
+framesize_t HostCamera::framesize() {
+    std::lock_guard<std::mutex> lock(camMutex);
+    return sensor.status.framesize;
+}
+
+int HostCamera::quality() {
+    std::lock_guard<std::mutex> lock(camMutex);
+    return sensor.status.quality;
+}
+
+uint32_t HostCamera::grabs() {
+    std::lock_guard<std::mutex> lock(camMutex);
+    return grabCount;
+}
+
+uint32_t HostCamera::failures() {
+    std::lock_guard<std::mutex> lock(camMutex);
+    return failureCount;
+}
+
+uint32_t HostCamera::sizeChanges() {
+    std::lock_guard<std::mutex> lock(camMutex);
+    return sizeChangeCount;
+}
+
+uint32_t HostCamera::held() {
+    std::lock_guard<std::mutex> lock(camMutex);
+    uint32_t n = 0;
+    for (size_t i = 0; i < buffers.size(); i++) n += buffers[i].out ? 1 : 0;
+    return n;
+}
+
+// ===========================================
+// esp_camera API
+// ===========================================
+esp_err_t esp_camera_init(const camera_config_t *config) {
+    if (!config || config->pixel_format != PIXFORMAT_JPEG || config->frame_size >= FRAMESIZE_INVALID ||
+        config->fb_count == 0) {
+        return ESP_FAIL;
+    }
+    if (HostCamera::frameCount() == 0) {
+        const resolution_info_t &res = resolution[config->frame_size];
+        HostCamera::addPattern(res.width, res.height);
+    }
+
+    std::lock_guard<std::mutex> lock(camMutex);
+    size_t capacity = CAM_FB_MIN_CAPACITY;
+    for (size_t i = 0; i < frames.size(); i++) capacity = std::max(capacity, frames[i].jpeg.size());
+    for (size_t i = 0; i < buffers.size(); i++) free(buffers[i].fb.buf);
+    // Frame buffers are allocated once, like the driver's PSRAM buffers
+    buffers.assign(config->fb_count, Buffer());
+    for (size_t i = 0; i < buffers.size(); i++) {
+        memset(&buffers[i].fb, 0, sizeof(camera_fb_t));
+        buffers[i].fb.buf = (uint8_t *)heap_caps_malloc(capacity, MALLOC_CAP_SPIRAM);
+        buffers[i].fb.format = PIXFORMAT_JPEG;
+        buffers[i].capacity = capacity;
+        buffers[i].out = false;
+    }
+
+    memset(&sensor, 0, sizeof(sensor));
+    sensor.pixformat = PIXFORMAT_JPEG;
+    sensor.status.framesize = config->frame_size;
+    sensor.status.quality = (uint8_t)config->jpeg_quality;
+    sensor.set_framesize = setFramesize;
+    sensor.set_quality = setQuality;
+    sensor.set_brightness = setBrightness;
+    sensor.set_contrast = setContrast;
+    sensor.set_saturation = setSaturation;
+    sensor.set_whitebal = setWhitebal;
+    sensor.set_awb_gain = setAwbGain;
+    sensor.set_exposure_ctrl = setExposureCtrl;
+    sensor.set_aec2 = setAec2;
+    sensor.set_vflip = setFlag;
+    sensor.set_hmirror = setFlag;
+
+    grabMode = config->grab_mode;
+    startUs = HostClock::nowUs();
+    lastSeq = 0;
+    droppedSeq = 0;
+    initialised = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_camera_deinit() {
+    std::lock_guard<std::mutex> lock(camMutex);
+    for (size_t i = 0; i < buffers.size(); i++) free(buffers[i].fb.buf);
+    buffers.clear();
+    initialised = false;
+    return ESP_OK;
+}
+
+sensor_t *esp_camera_sensor_get() {
+    return initialised ? &sensor : NULL;
+}
+
+camera_fb_t *esp_camera_fb_get() {
+    uint64_t deadlineUs = HostClock::nowUs() + (uint64_t)CAM_FB_GET_TIMEOUT_MS * 1000;
+    std::vector<size_t> pick;
+    while (true) {
+        uint64_t wakeUs;
+        {
+            std::lock_guard<std::mutex> lock(camMutex);
+            if (!initialised) return NULL;
+            uint64_t now = HostClock::nowUs();
+            uint64_t period = framePeriodUs();
+            uint64_t seq = (now - startUs) / period + 1;   // Frames completed so far
+            Buffer *free_ = NULL;
+            for (size_t i = 0; i < buffers.size() && !free_; i++) {
+                if (!buffers[i].out) free_ = &buffers[i];
+            }
+
+            if (!free_) {
+                // Every buffer is out: the DMA has nowhere to put new frames
+                if (seq > droppedSeq) {
+                    droppedSeq = seq;
+                    hostCamLog("FBQ-RCV");
+                }
+            } else if (seq > lastSeq) {
+                if (grabMode == CAMERA_GRAB_WHEN_EMPTY && seq > lastSeq + 1) {
+                    seq = lastSeq + 1;                    // Oldest queued frame first
+                }
+                lastSeq = seq;
+                pickFrames(pick);
+                const Frame &frame = frames[pick[nextFrame++ % pick.size()]];
+                if (frame.jpeg.size() > free_->capacity) {
+                    free(free_->fb.buf);
+                    free_->fb.buf = (uint8_t *)heap_caps_malloc(frame.jpeg.size(), MALLOC_CAP_SPIRAM);
+                    free_->capacity = frame.jpeg.size();
+                }
+                memcpy(free_->fb.buf, frame.jpeg.data(), frame.jpeg.size());
+                free_->fb.len = frame.jpeg.size();
+                free_->fb.width = frame.width;
+                free_->fb.height = frame.height;
+                uint64_t stampUs = startUs + seq * period;
+                free_->fb.timestamp.tv_sec = (time_t)(stampUs / 1000000);
+                free_->fb.timestamp.tv_usec = (suseconds_t)(stampUs % 1000000);
+                free_->out = true;
+                grabCount++;
+                return &free_->fb;
+            }
+
+            if (now >= deadlineUs) {
+                failureCount++;
+                hostCamLog("Failed to get the frame on time!");
+                return NULL;
+            }
+            wakeUs = std::min(startUs + seq * period, deadlineUs);
+            if (!free_) wakeUs = std::min(now + 1000, deadlineUs);
+        }
+        HostClock::sleepUntilUs(wakeUs);
+    }
+}
+
+void esp_camera_fb_return(camera_fb_t *fb) {
+    std::lock_guard<std::mutex> lock(camMutex);
+    for (size_t i = 0; i < buffers.size(); i++) {
+        if (&buffers[i].fb == fb) buffers[i].out = false;
+    }
+}
@@ -0,0 +1,126 @@
+/*
+ * HostClock - see HostHarness.h
+ */
+
+#include "HostHarness.h"
+#include "HostInternal.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+typedef std::chrono::steady_clock SteadyClock;
+
+static const SteadyClock::time_point clockStart = SteadyClock::now();
+static std::atomic<bool> clockFrozen(false);
+static thread_local bool clockSkips = false;     // Per thread, see skipDelays()
+static std::atomic<int64_t> clockOffsetUs(0);   // Virtual - real, or the frozen time
+static std::thread::id clockDriver;
+static std::mutex clockMutex;
+static std::condition_variable clockMoved;
+
+static int64_t realUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - clockStart).count();
+}
+
+void hostClockNotify() {
+    std::lock_guard<std::mutex> lock(clockMutex);
+    clockMoved.notify_all();
+}
+
+uint64_t HostClock::nowUs() {
+    int64_t offset = clockOffsetUs.load();
+    return clockFrozen ? (uint64_t)offset : (uint64_t)(offset + realUs());
+}
+
+bool HostClock::frozen() {
+    return clockFrozen;
+}
+
+void HostClock::run() {
+    std::lock_guard<std::mutex> lock(clockMutex);
+    if (clockFrozen) {
+        clockOffsetUs = clockOffsetUs.load() - realUs();
+        clockFrozen = false;
+    }
+    clockMoved.notify_all();
+}
+
+void HostClock::freeze() {
+    std::lock_guard<std::mutex> lock(clockMutex);
+    if (!clockFrozen) {
+        clockOffsetUs = clockOffsetUs.load() + realUs();
+        clockFrozen = true;
+    }
+    clockDriver = std::this_thread::get_id();
+}
+
+void HostClock::skipDelays(bool on) {
+    clockSkips = on;
+}
+
+void HostClock::advanceUs(uint64_t us) {
+    if (!clockFrozen) {
+        clockOffsetUs += (int64_t)us;
+        hostClockNotify();
+        return;
+    }
+    
+    // Step through the echo edges on the way, each at its own time
+    uint64_t target = nowUs() + us;
+    uint64_t due;
+    while ((due = hostGpioNextDueUs()) <= target) {
+        if ((int64_t)due > clockOffsetUs.load()) {
+            clockOffsetUs = (int64_t)due;
+        }
+        HostGpio::runDue(due);
+    }
+    clockOffsetUs = (int64_t)target;
+    hostClockNotify();
+}
+
+void HostClock::sleepUntilUs(uint64_t targetUs) {
+    uint64_t now = nowUs();
+    if (now >= targetUs) {
+        return;
+    }
+    if (clockSkips || (clockFrozen && std::this_thread::get_id() == clockDriver)) {
+        advanceUs(targetUs - now);
+        return;
+    }
+    
+    std::unique_lock<std::mutex> lock(clockMutex);
+    while ((now = nowUs()) < targetUs) {
+        // Frozen: poll for the driver; running: wake early if time jumps
+        uint64_t waitUs = clockFrozen ? 1000 : targetUs - now;
+        clockMoved.wait_for(lock, std::chrono::microseconds(waitUs));
+    }
+}
+
+// ===========================================
+// Arduino / IDF time API
+// ===========================================
+unsigned long millis() {
+    return (uint32_t)(HostClock::nowUs() / 1000);
+}
+
+unsigned long micros() {
+    return (uint32_t)HostClock::nowUs();
+}
+
+void delay(uint32_t ms) {
+    HostClock::sleepUntilUs(HostClock::nowUs() + (uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us) {
+    HostClock::sleepUntilUs(HostClock::nowUs() + us);
+}
+
+void yield() {
+    std::this_thread::yield();
+}
+
+int64_t esp_timer_get_time() {
+    return (int64_t)HostClock::nowUs();
+}
@@ -0,0 +1,200 @@
+/*
+ * LittleFS stand-in - see FS.h, LittleFS.h and HostHarness.h
+ */
+
+#include <LittleFS.h>
+#include <HostHarness.h>
+#include "HostInternal.h"
+#include <atomic>
+#include <dirent.h>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define HOST_FS_TOTAL_BYTES     0x160000  // spiffs partition of the default table
+
+fs::LittleFSFS LittleFS;
+
+static std::mutex fsMutex;
+static std::string fsRoot;               // Empty until mounted
+static std::atomic<bool> fsFailWrites(false);
+
+static std::string hostPath(const char *path) {
+    std::lock_guard<std::mutex> lock(fsMutex);
+    if (fsRoot.empty()) {
+        fsRoot = hostTempDir() + "/littlefs";
+        ::mkdir(fsRoot.c_str(), 0700);
+    }
+    std::string p = path ? path : "";
+    return fsRoot + (p.empty() || p[0] != '/' ? "/" : "") + p;
+}
+
+namespace fs {
+
+class FileImpl {
+public:
+    FileImpl(FILE *f, const char *path) : file(f), name(path) {}
+    ~FileImpl() { if (file) fclose(file); }
+    FILE *file;
+    std::string name;
+};
+
+size_t File::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *buf, size_t size) {
+    if (!_impl || !_impl->file || fsFailWrites) return 0;
+    return fwrite(buf, 1, size, _impl->file);
+}
+
+int File::available() {
+    if (!_impl || !_impl->file) return 0;
+    return (int)(size() - position());
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+    if (!_impl || !_impl->file) return -1;
+    int c = fgetc(_impl->file);
+    if (c != EOF) ungetc(c, _impl->file);
+    return c == EOF ? -1 : c;
+}
+
+void File::flush() {
+    if (_impl && _impl->file) fflush(_impl->file);
+}
+
+size_t File::read(uint8_t *buf, size_t size) {
+    if (!_impl || !_impl->file) return 0;
+    return fread(buf, 1, size, _impl->file);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    if (!_impl || !_impl->file) return false;
+    int whence = mode == SeekCur ? SEEK_CUR : mode == SeekEnd ? SEEK_END : SEEK_SET;
+    return fseek(_impl->file, (long)pos, whence) == 0;
+}
+
+size_t File::position() const {
+    if (!_impl || !_impl->file) return 0;
+    long pos = ftell(_impl->file);
+    return pos < 0 ? 0 : (size_t)pos;
+}
+
+size_t File::size() const {
+    if (!_impl || !_impl->file) return 0;
+    fflush(_impl->file);
+    struct stat st;
+    return fstat(fileno(_impl->file), &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+void File::close() {
+    _impl.reset();
+}
+
+const char *File::path() const {
+    return _impl ? _impl->name.c_str() : "";
+}
+
+File FS::open(const char *path, const char *mode, const bool create) {
+    (void)create;
+    std::string host = hostPath(path);
+    const char *hostMode = strcmp(mode, "w") == 0 ? "w+b" : strcmp(mode, "a") == 0 ? "a+b" : "rb";
+    FILE *f = fopen(host.c_str(), hostMode);
+    if (!f) {
+        return File();
+    }
+    return File(std::make_shared<FileImpl>(f, path));
+}
+
+bool FS::exists(const char *path) {
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char *path) {
+    return ::unlink(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char *from, const char *to) {
+    return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char *path) {
+    return ::mkdir(hostPath(path).c_str(), 0700) == 0;
+}
+
+bool FS::rmdir(const char *path) {
+    return ::rmdir(hostPath(path).c_str()) == 0;
+}
+
+bool LittleFSFS::begin(bool formatOnFail, const char *basePath, uint8_t maxOpenFiles,
+                       const char *partitionLabel) {
+    (void)formatOnFail;
+    (void)basePath;
+    (void)maxOpenFiles;
+    (void)partitionLabel;
+    struct stat st;
+    return stat(hostPath("/").c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+void LittleFSFS::end() {
+}
+
+bool LittleFSFS::format() {
+    HostFs::wipe();
+    return true;
+}
+
+size_t LittleFSFS::totalBytes() {
+    return HOST_FS_TOTAL_BYTES;
+}
+
+size_t LittleFSFS::usedBytes() {
+    std::string root = hostPath("/");
+    size_t used = 0;
+    if (DIR *d = opendir(root.c_str())) {
+        while (struct dirent *e = readdir(d)) {
+            struct stat st;
+            if (stat((root + e->d_name).c_str(), &st) == 0 && S_ISREG(st.st_mode)) used += st.st_size;
+        }
+        closedir(d);
+    }
+    return used;
+}
+
+}  // namespace fs
+
+// ===========================================
+// HostFs
+// ===========================================
+void HostFs::mount(const char *dir) {
+    ::mkdir(dir, 0700);
+    std::lock_guard<std::mutex> lock(fsMutex);
+    fsRoot = dir;
+}
+
+std::string HostFs::root() {
+    return hostPath("");
+}
+
+void HostFs::failWrites(bool fail) {
+    fsFailWrites = fail;
+}
+
+void HostFs::wipe() {
+    std::string root = hostPath("/");
+    if (DIR *d = opendir(root.c_str())) {
+        while (struct dirent *e = readdir(d)) {
+            if (strcmp(e->d_name, ".") != 0 && strcmp(e->d_name, "..") != 0) {
+                ::unlink((root + e->d_name).c_str());
+            }
+        }
+        closedir(d);
+    }
+}
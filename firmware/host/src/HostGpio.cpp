@@ -0,0 +1,258 @@
+/*
+ * HostGpio - see HostHarness.h
+ */
+
+#include "HostHarness.h"
+#include "HostInternal.h"
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#define HOST_PIN_COUNT          64
+#define HOST_TRIGGER_MIN_US     10        // HC-SR04 needs a 10 us trigger pulse
+#define HOST_US_PER_CM          58.3f     // Echo round trip at 343 m/s
+#define HOST_EDGE_SPIN_US       200       // Busy-wait this close to an edge
+
+struct HostPin {
+    uint8_t mode;
+    uint8_t level;
+    uint32_t writes;
+    int intMode;                          // 0 = no interrupt
+    void (*isr)(void);
+    void (*isrArg)(void *);
+    void *arg;
+};
+
+struct HostEcho {
+    uint8_t echoPin;
+    float distanceCm;
+    uint64_t triggerHighUs;
+    uint64_t busyUntilUs;                 // Sensor ignores triggers while echoing
+    uint32_t pings;
+};
+
+struct HostEdge {
+    uint8_t pin;
+    uint8_t level;
+};
+
+static std::mutex gpioMutex;
+static std::condition_variable gpioQueued;
+static HostPin pins[HOST_PIN_COUNT];
+static std::map<uint8_t, HostEcho> echoes;         // By trigger pin
+static std::multimap<uint64_t, HostEdge> edges;    // Pending echo edges by time
+static bool dispatcherStarted = false;
+
+static bool validPin(uint8_t pin) {
+    return pin < HOST_PIN_COUNT;
+}
+
+// Runs echo edges while the clock is running; a frozen clock runs them
+// itself from advanceUs() so they land on their exact time
+static void dispatchEdges() {
+    std::unique_lock<std::mutex> lock(gpioMutex);
+    while (true) {
+        if (edges.empty() || HostClock::frozen()) {
+            gpioQueued.wait_for(lock, std::chrono::milliseconds(1));
+            continue;
+        }
+        uint64_t due = edges.begin()->first;
+        uint64_t now = HostClock::nowUs();
+        if (now + HOST_EDGE_SPIN_US < due) {
+            gpioQueued.wait_for(lock, std::chrono::microseconds(due - now - HOST_EDGE_SPIN_US));
+            continue;
+        }
+        if (now < due) {
+            // Timed waits wake late by tens of us; spin the rest so echo
+            // widths (58 us per cm) stay accurate
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+            continue;
+        }
+        lock.unlock();
+        HostGpio::runDue(now);
+        lock.lock();
+    }
+}
+
+uint64_t hostGpioNextDueUs() {
+    std::lock_guard<std::mutex> lock(gpioMutex);
+    return edges.empty() ? UINT64_MAX : edges.begin()->first;
+}
+
+void HostGpio::runDue(uint64_t nowUs) {
+    while (true) {
+        HostEdge edge;
+        {
+            std::lock_guard<std::mutex> lock(gpioMutex);
+            if (edges.empty() || edges.begin()->first > nowUs) {
+                return;
+            }
+            edge = edges.begin()->second;
+            edges.erase(edges.begin());
+        }
+        drive(edge.pin, edge.level);
+    }
+}
+
+// Called with gpioMutex held
+static void scheduleEcho(HostEcho &echo, uint64_t nowUs) {
+    uint64_t width = echo.distanceCm > 0 ? (uint64_t)(echo.distanceCm * HOST_US_PER_CM) : HOST_ECHO_TIMEOUT_US;
+    uint64_t rise = nowUs + HOST_ECHO_DELAY_US;
+    HostEdge up = { echo.echoPin, HIGH };
+    HostEdge down = { echo.echoPin, LOW };
+    edges.insert(std::make_pair(rise, up));
+    edges.insert(std::make_pair(rise + width, down));
+    echo.busyUntilUs = rise + width;
+    echo.pings++;
+    
+    if (!dispatcherStarted) {
+        dispatcherStarted = true;
+        std::thread(dispatchEdges).detach();
+    }
+    gpioQueued.notify_all();
+}
+
+void HostGpio::drive(uint8_t pin, int level) {
+    if (!validPin(pin)) return;
+    void (*isr)(void) = NULL;
+    void (*isrArg)(void *) = NULL;
+    void *arg = NULL;
+    {
+        std::lock_guard<std::mutex> lock(gpioMutex);
+        HostPin &p = pins[pin];
+        uint8_t old = p.level;
+        p.level = level ? HIGH : LOW;
+        bool rising = old == LOW && p.level == HIGH;
+        bool falling = old == HIGH && p.level == LOW;
+        bool fire = (p.intMode == CHANGE && (rising || falling)) ||
+                    (p.intMode == RISING && rising) ||
+                    (p.intMode == FALLING && falling);
+        if (fire) {
+            isr = p.isr;
+            isrArg = p.isrArg;
+            arg = p.arg;
+        }
+    }
+    // Like an ISR: runs outside every lock, preempting nobody
+    if (isrArg) {
+        isrArg(arg);
+    } else if (isr) {
+        isr();
+    }
+}
+
+int HostGpio::level(uint8_t pin) {
+    std::lock_guard<std::mutex> lock(gpioMutex);
+    return validPin(pin) ? pins[pin].level : LOW;
+}
+
+int HostGpio::mode(uint8_t pin) {
+    std::lock_guard<std::mutex> lock(gpioMutex);
+    return validPin(pin) ? pins[pin].mode : 0;
+}
+
+uint32_t HostGpio::writes(uint8_t pin) {
+    std::lock_guard<std::mutex> lock(gpioMutex);
+    return validPin(pin) ? pins[pin].writes : 0;
+}
+
+void HostGpio::attachEcho(uint8_t trigPin, uint8_t echoPin) {
+    std::lock_guard<std::mutex> lock(gpioMutex);
+    HostEcho echo = { echoPin, 0.0f, 0, 0, 0 };
+    echoes[trigPin] = echo;
+}
+
+void HostGpio::setDistance(uint8_t trigPin, float cm) {
+    std::lock_guard<std::mutex> lock(gpioMutex);
+    std::map<uint8_t, HostEcho>::iterator it = echoes.find(trigPin);
+    if (it != echoes.end()) {
+        it->second.distanceCm = cm;
+    }
+}
+
+uint32_t HostGpio::pings(uint8_t trigPin) {
+    std::lock_guard<std::mutex> lock(gpioMutex);
+    std::map<uint8_t, HostEcho>::iterator it = echoes.find(trigPin);
+    return it != echoes.end() ? it->second.pings : 0;
+}
+
+void HostGpio::reset() {
+    std::lock_guard<std::mutex> lock(gpioMutex);
+    for (int i = 0; i < HOST_PIN_COUNT; i++) {
+        HostPin p = {};
+        pins[i] = p;
+    }
+    echoes.clear();
+    edges.clear();
+}
+
+// ===========================================
+// Arduino GPIO API
+// ===========================================
+void pinMode(uint8_t pin, uint8_t mode) {
+    std::lock_guard<std::mutex> lock(gpioMutex);
+    if (validPin(pin)) {
+        pins[pin].mode = mode;
+        if (mode == INPUT_PULLUP) {
+            pins[pin].level = HIGH;
+        }
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if (!validPin(pin)) return;
+    uint64_t now = HostClock::nowUs();
+    std::lock_guard<std::mutex> lock(gpioMutex);
+    HostPin &p = pins[pin];
+    uint8_t old = p.level;
+    p.level = val ? HIGH : LOW;
+    p.writes++;
+    
+    // HC-SR04: the falling edge of a long enough trigger pulse starts a ping
+    std::map<uint8_t, HostEcho>::iterator it = echoes.find(pin);
+    if (it == echoes.end()) return;
+    HostEcho &echo = it->second;
+    if (old == LOW && p.level == HIGH) {
+        echo.triggerHighUs = now;
+    } else if (old == HIGH && p.level == LOW &&
+               now - echo.triggerHighUs >= HOST_TRIGGER_MIN_US && now >= echo.busyUntilUs) {
+        scheduleEcho(echo, now);
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    return HostGpio::level(pin);
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode) {
+    std::lock_guard<std::mutex> lock(gpioMutex);
+    if (validPin(pin)) {
+        pins[pin].isr = isr;
+        pins[pin].isrArg = NULL;
+        pins[pin].arg = NULL;
+        pins[pin].intMode = mode;
+    }
+}
+
+void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode) {
+    std::lock_guard<std::mutex> lock(gpioMutex);
+    if (validPin(pin)) {
+        pins[pin].isr = NULL;
+        pins[pin].isrArg = isr;
+        pins[pin].arg = arg;
+        pins[pin].intMode = mode;
+    }
+}
+
+void detachInterrupt(uint8_t pin) {
+    std::lock_guard<std::mutex> lock(gpioMutex);
+    if (validPin(pin)) {
+        pins[pin].isr = NULL;
+        pins[pin].isrArg = NULL;
+        pins[pin].intMode = 0;
+    }
+}
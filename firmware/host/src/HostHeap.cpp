@@ -0,0 +1,181 @@
+/*
+ * HostHeap - see HostHarness.h
+ *
+ * Wraps glibc's allocator to count calls, so a test can show that a code
+ * path does not allocate. Linked into every host executable as an object
+ * file (not from the archive) so these definitions win over libc's.
+ */
+
+#include "HostHarness.h"
+#include <atomic>
+#include <errno.h>
+#include <malloc.h>
+#include <new>
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+void *__libc_memalign(size_t alignment, size_t size);
+}
+
+#define HOST_HEAP_INTERNAL      (320 * 1024)      // ESP32-S3 internal RAM left for the app
+#define HOST_HEAP_PSRAM         (8 * 1024 * 1024) // N16R8
+
+static std::atomic<uint64_t> allocCount(0);
+static std::atomic<int64_t> liveBytes(0);
+static std::atomic<int64_t> peakBytes(0);
+static __thread uint64_t threadAllocCount;      // Plain TLS: usable inside malloc
+
+static void *counted(void *p) {
+    if (p) {
+        allocCount.fetch_add(1, std::memory_order_relaxed);
+        threadAllocCount++;
+        int64_t live = liveBytes.fetch_add((int64_t)malloc_usable_size(p), std::memory_order_relaxed) +
+                       (int64_t)malloc_usable_size(p);
+        int64_t peak = peakBytes.load(std::memory_order_relaxed);
+        while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+    }
+    return p;
+}
+
+static void released(void *p) {
+    if (p) {
+        liveBytes.fetch_sub((int64_t)malloc_usable_size(p), std::memory_order_relaxed);
+    }
+}
+
+extern "C" {
+
+void *malloc(size_t size) {
+    return counted(__libc_malloc(size));
+}
+
+void *calloc(size_t count, size_t size) {
+    return counted(__libc_calloc(count, size));
+}
+
+void *realloc(void *ptr, size_t size) {
+    released(ptr);
+    void *p = __libc_realloc(ptr, size);
+    if (!p && ptr && size) {
+        // Failed: the old block is still live
+        liveBytes.fetch_add((int64_t)malloc_usable_size(ptr), std::memory_order_relaxed);
+        return NULL;
+    }
+    return counted(p);
+}
+
+void free(void *ptr) {
+    released(ptr);
+    __libc_free(ptr);
+}
+
+void *memalign(size_t alignment, size_t size) {
+    return counted(__libc_memalign(alignment, size));
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    return counted(__libc_memalign(alignment, size));
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size) {
+    void *p = counted(__libc_memalign(alignment, size));
+    if (!p) return ENOMEM;
+    *out = p;
+    return 0;
+}
+
+}  // extern "C"
+
+void *operator new(size_t size) {
+    void *p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return malloc(size ? size : 1);
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    free(p);
+}
+
+uint64_t HostHeap::allocations() {
+    return allocCount.load(std::memory_order_relaxed);
+}
+
+uint64_t HostHeap::threadAllocations() {
+    return threadAllocCount;
+}
+
+size_t HostHeap::liveBytes() {
+    int64_t live = ::liveBytes.load(std::memory_order_relaxed);
+    return live > 0 ? (size_t)live : 0;
+}
+
+// ===========================================
+// IDF heap API on the notional heaps
+// ===========================================
+static size_t freeOf(int64_t total, int64_t used) {
+    return used >= total ? 0 : (size_t)(total - used);
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps) {
+    (void)caps;
+    return malloc(size);
+}
+
+void heap_caps_free(void *ptr) {
+    free(ptr);
+}
+
+void *ps_malloc(size_t size) {
+    return malloc(size);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    int64_t live = liveBytes.load(std::memory_order_relaxed);
+    return (caps & MALLOC_CAP_SPIRAM) ? freeOf(HOST_HEAP_PSRAM, 0) : freeOf(HOST_HEAP_INTERNAL, live);
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    int64_t peak = peakBytes.load(std::memory_order_relaxed);
+    return (caps & MALLOC_CAP_SPIRAM) ? freeOf(HOST_HEAP_PSRAM, 0) : freeOf(HOST_HEAP_INTERNAL, peak);
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return heap_caps_get_free_size(caps);
+}
+
+uint32_t EspClass::getHeapSize() { return HOST_HEAP_INTERNAL; }
+uint32_t EspClass::getFreeHeap() { return (uint32_t)heap_caps_get_free_size(MALLOC_CAP_INTERNAL); }
+uint32_t EspClass::getMinFreeHeap() { return (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL); }
+uint32_t EspClass::getMaxAllocHeap() { return getFreeHeap(); }
+uint32_t EspClass::getPsramSize() { return HOST_HEAP_PSRAM; }
+uint32_t EspClass::getFreePsram() { return (uint32_t)heap_caps_get_free_size(MALLOC_CAP_SPIRAM); }
+uint32_t EspClass::getMinFreePsram() { return (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM); }
+uint32_t EspClass::getMaxAllocPsram() { return getFreePsram(); }
@@ -0,0 +1,345 @@
+/*
+ * HostHttpServer, HostHttpClient - see HostHarness.h
+ *
+ * Plain POSIX sockets on the test side, so the firmware's HTTP code is the
+ * only thing under test on the device side of the loopback.
+ */
+
+#include "HostHarness.h"
+#include <lwip/sockets.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <poll.h>
+
+#define HOST_HTTP_CHUNK         512
+
+static std::string lower(std::string s) {
+    for (size_t i = 0; i < s.size(); i++) s[i] = (char)tolower((unsigned char)s[i]);
+    return s;
+}
+
+static bool sendAll(int fd, const std::string &data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+// Buffered reader over a blocking socket. Gives up after timeoutMs without
+// data, or, with a running flag, only once the flag drops.
+class LineReader {
+public:
+    LineReader(int fd, uint32_t timeoutMs, const std::atomic<bool> *running = NULL)
+        : _fd(fd), _timeoutMs(timeoutMs), _running(running), _pos(0) {}
+
+    bool fill() {
+        struct pollfd p = { _fd, POLLIN, 0 };
+        while (poll(&p, 1, _timeoutMs) != 1) {
+            if (!_running || !*_running) return false;
+        }
+        char buf[4096];
+        ssize_t n = recv(_fd, buf, sizeof(buf), 0);
+        if (n <= 0) return false;
+        if (_pos > 0) {
+            _buf.erase(0, _pos);
+            _pos = 0;
+        }
+        _buf.append(buf, n);
+        return true;
+    }
+
+    bool line(std::string &out) {
+        while (true) {
+            size_t eol = _buf.find("\r\n", _pos);
+            if (eol != std::string::npos) {
+                out = _buf.substr(_pos, eol - _pos);
+                _pos = eol + 2;
+                return true;
+            }
+            if (!fill()) return false;
+        }
+    }
+
+    bool bytes(size_t len, std::string &out) {
+        while (_buf.size() - _pos < len) {
+            if (!fill()) return false;
+        }
+        out.append(_buf, _pos, len);
+        _pos += len;
+        return true;
+    }
+
+    void rest(std::string &out) {
+        do {
+            out.append(_buf, _pos, std::string::npos);
+            _pos = _buf.size();
+        } while (fill());
+    }
+
+private:
+    int _fd;
+    uint32_t _timeoutMs;
+    const std::atomic<bool> *_running;
+    std::string _buf;
+    size_t _pos;
+};
+
+// Head lines into the header map; false on a broken head
+static bool readHead(LineReader &in, std::string &first, std::map<std::string, std::string> &headers) {
+    if (!in.line(first)) return false;
+    std::string line;
+    while (in.line(line)) {
+        if (line.empty()) return true;
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        size_t v = colon + 1;
+        while (v < line.size() && line[v] == ' ') v++;
+        headers[lower(line.substr(0, colon))] = line.substr(v);
+    }
+    return false;
+}
+
+static bool readBody(LineReader &in, const std::map<std::string, std::string> &headers, std::string &body,
+                     bool untilClose) {
+    std::map<std::string, std::string>::const_iterator te = headers.find("transfer-encoding");
+    if (te != headers.end() && lower(te->second).find("chunked") != std::string::npos) {
+        std::string line;
+        while (in.line(line)) {
+            size_t size = strtoul(line.c_str(), NULL, 16);
+            if (size == 0) {
+                while (in.line(line) && !line.empty()) {
+                }
+                return true;
+            }
+            if (!in.bytes(size, body) || !in.line(line)) return false;
+        }
+        return false;
+    }
+    std::map<std::string, std::string>::const_iterator cl = headers.find("content-length");
+    if (cl != headers.end()) {
+        return in.bytes(strtoul(cl->second.c_str(), NULL, 10), body);
+    }
+    if (untilClose) {
+        in.rest(body);
+    }
+    return true;
+}
+
+std::string HostHttpRequest::header(const char *name) const {
+    std::map<std::string, std::string>::const_iterator it = headers.find(lower(name));
+    return it != headers.end() ? it->second : std::string();
+}
+
+std::string HostHttpRequest::arg(const char *name) const {
+    std::string key = std::string(name) + "=";
+    size_t pos = 0;
+    while (pos < query.size()) {
+        size_t end = query.find('&', pos);
+        if (end == std::string::npos) end = query.size();
+        if (query.compare(pos, key.size(), key) == 0) {
+            return query.substr(pos + key.size(), end - pos - key.size());
+        }
+        pos = end + 1;
+    }
+    return std::string();
+}
+
+// ===========================================
+// HostHttpServer
+// ===========================================
+struct HostHttpServer::State {
+    State(Handler h) : handler(h), fd(-1), running(true), requests(0), connections(0), live(0) {}
+    Handler handler;
+    int fd;
+    std::atomic<bool> running;
+    std::atomic<uint32_t> requests;
+    std::atomic<uint32_t> connections;
+    std::atomic<int> live;               // Threads still using this state
+    std::mutex mutex;
+    std::vector<int> clients;
+};
+
+static const char *reason(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 201: return "Created";
+        case 204: return "No Content";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 415: return "Unsupported Media Type";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default:  return "Status";
+    }
+}
+
+static void serveConnection(HostHttpServer::Handler handler, std::atomic<bool> *running,
+                            std::atomic<uint32_t> *requests, std::atomic<int> *live, int fd) {
+    // Idle keep-alive connections wait as long as the server runs
+    LineReader in(fd, 200, running);
+    while (*running) {
+        std::string first;
+        std::map<std::string, std::string> headers;
+        if (!readHead(in, first, headers)) break;
+        HostHttpRequest req;
+        size_t sp1 = first.find(' ');
+        size_t sp2 = first.find(' ', sp1 + 1);
+        if (sp1 == std::string::npos || sp2 == std::string::npos) break;
+        req.method = first.substr(0, sp1);
+        std::string target = first.substr(sp1 + 1, sp2 - sp1 - 1);
+        size_t q = target.find('?');
+        req.path = target.substr(0, q);
+        req.query = q == std::string::npos ? std::string() : target.substr(q + 1);
+        req.headers = headers;
+        if (!readBody(in, headers, req.body, false)) break;
+        (*requests)++;
+        
+        HostHttpReply reply = handler(req);
+        if (reply.delayMs) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(reply.delayMs));
+        }
+        bool close = reply.close || lower(req.header("connection")) == "close";
+        std::string head = "HTTP/1.1 " + std::to_string(reply.status) + " " + reason(reply.status) + "\r\n";
+        head += "Content-Type: " + reply.contentType + "\r\n";
+        for (size_t i = 0; i < reply.headers.size(); i++) {
+            head += reply.headers[i].first + ": " + reply.headers[i].second + "\r\n";
+        }
+        if (reply.chunked) {
+            head += "Transfer-Encoding: chunked\r\n";
+        } else {
+            head += "Content-Length: " + std::to_string(reply.body.size()) + "\r\n";
+        }
+        head += close ? "Connection: close\r\n\r\n" : "Connection: keep-alive\r\n\r\n";
+        
+        std::string out = head;
+        if (reply.chunked) {
+            char size[16];
+            for (size_t pos = 0; pos < reply.body.size(); pos += HOST_HTTP_CHUNK) {
+                size_t n = std::min((size_t)HOST_HTTP_CHUNK, reply.body.size() - pos);
+                snprintf(size, sizeof(size), "%zx\r\n", n);
+                out += size;
+                out.append(reply.body, pos, n);
+                out += "\r\n";
+            }
+            out += "0\r\n\r\n";
+        } else {
+            out += reply.body;
+        }
+        if (!sendAll(fd, out) || close) break;
+    }
+    ::close(fd);
+    (*live)--;
+}
+
+static void acceptLoop(HostHttpServer::Handler handler, std::atomic<bool> *running,
+                       std::atomic<uint32_t> *requests, std::atomic<uint32_t> *connections,
+                       std::atomic<int> *live, int listenFd) {
+    while (*running) {
+        struct pollfd p = { listenFd, POLLIN, 0 };
+        if (poll(&p, 1, 50) != 1) continue;
+        int fd = accept(listenFd, NULL, NULL);
+        if (fd < 0) continue;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        (*connections)++;
+        (*live)++;
+        std::thread(serveConnection, handler, running, requests, live, fd).detach();
+    }
+    ::close(listenFd);
+    (*live)--;
+}
+
+HostHttpServer::HostHttpServer(Handler handler)
+    : _state(new State(handler)),
+      _port(0) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 16) < 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &len) < 0) {
+        ::close(fd);
+        _state->running = false;
+        return;
+    }
+    _port = ntohs(addr.sin_port);
+    _state->fd = fd;
+    _state->live = 1;
+    std::thread(acceptLoop, handler, &_state->running, &_state->requests, &_state->connections,
+                &_state->live, fd).detach();
+}
+
+HostHttpServer::~HostHttpServer() {
+    stop();
+    delete _state;
+}
+
+void HostHttpServer::stop() {
+    _state->running = false;
+    // Connection threads notice within their 200 ms read timeout
+    while (_state->live > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+uint32_t HostHttpServer::requests() const {
+    return _state->requests;
+}
+
+uint32_t HostHttpServer::connections() const {
+    return _state->connections;
+}
+
+// ===========================================
+// HostHttpClient
+// ===========================================
+bool HostHttpClient::request(uint16_t port, const char *method, const char *target, HostHttpResult &out,
+                             const std::string &body, const std::map<std::string, std::string> &headers,
+                             uint32_t timeoutMs) {
+    out.status = 0;
+    out.headers.clear();
+    out.body.clear();
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        ::close(fd);
+        return false;
+    }
+    std::string req = std::string(method) + " " + target + " HTTP/1.1\r\nHost: 127.0.0.1\r\n";
+    for (std::map<std::string, std::string>::const_iterator it = headers.begin(); it != headers.end(); ++it) {
+        req += it->first + ": " + it->second + "\r\n";
+    }
+    if (!body.empty()) {
+        req += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    }
+    req += "Connection: close\r\n\r\n" + body;
+    
+    bool ok = false;
+    if (sendAll(fd, req)) {
+        LineReader in(fd, timeoutMs);
+        std::string first;
+        if (readHead(in, first, out.headers) && first.size() > 12) {
+            out.status = atoi(first.c_str() + 9);
+            ok = readBody(in, out.headers, out.body, true);
+        }
+    }
+    ::close(fd);
+    return ok;
+}
@@ -0,0 +1,29 @@
+/*
+ * Shared between the host stand-in translation units; not for tests
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+// Earliest pending GPIO edge, UINT64_MAX if none (HostGpio.cpp)
+uint64_t hostGpioNextDueUs();
+
+// Wakes threads waiting on the clock after time moved or events were queued
+void hostClockNotify();
+
+// Thrown into a deleted task to unwind it (HostRtos.cpp)
+struct HostTaskExit {};
+
+// Core the calling thread is "pinned" to (HostRtos.cpp)
+void hostSetCore(int core);
+
+// Serial/log output sink (HostArduino.cpp)
+void hostConsoleWrite(const char *data, size_t len);
+
+// Logs a camera driver line through the esp_log hook (HostArduino.cpp)
+void hostCamLog(const char *format);
+
+// Creates the host temp directory once and returns it
+std::string hostTempDir();
@@ -0,0 +1,192 @@
+/*
+ * libjpeg side of the host stand-ins: HostJpeg and esp_jpg_decode()
+ *
+ * Kept apart from the Arduino headers: libjpeg's boolean is an int and
+ * must not meet the core's bool typedef.
+ */
+
+#define boolean arduino_boolean
+#include <HostHarness.h>
+#include <esp_jpg_decode.h>
+#undef boolean
+
+#include <jpeglib.h>
+#include <setjmp.h>
+
+namespace {
+
+struct ErrorJump {
+    jpeg_error_mgr mgr;
+    jmp_buf jump;
+};
+
+void onJpegError(j_common_ptr cinfo) {
+    longjmp(reinterpret_cast<ErrorJump *>(cinfo->err)->jump, 1);
+}
+
+void quietJpeg(j_common_ptr, int) {
+}
+
+}  // namespace
+
+// ===========================================
+// HostJpeg
+// ===========================================
+bool HostJpeg::encode(const uint8_t *rgb, uint16_t width, uint16_t height, int quality,
+                      std::vector<uint8_t> &out) {
+    jpeg_compress_struct cinfo;
+    ErrorJump err;
+    cinfo.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit = onJpegError;
+    unsigned char *mem = NULL;
+    unsigned long memLen = 0;
+    if (setjmp(err.jump)) {
+        jpeg_destroy_compress(&cinfo);
+        free(mem);
+        return false;
+    }
+    jpeg_create_compress(&cinfo);
+    jpeg_mem_dest(&cinfo, &mem, &memLen);
+    cinfo.image_width = width;
+    cinfo.image_height = height;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality, TRUE);
+    // 4:2:2 like the OV2640's JPEG output
+    cinfo.comp_info[0].h_samp_factor = 2;
+    cinfo.comp_info[0].v_samp_factor = 1;
+    jpeg_start_compress(&cinfo, TRUE);
+    while (cinfo.next_scanline < cinfo.image_height) {
+        JSAMPROW row = const_cast<uint8_t *>(rgb) + (size_t)cinfo.next_scanline * width * 3;
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    out.assign(mem, mem + memLen);
+    free(mem);
+    return true;
+}
+
+static bool decodeScaled(const uint8_t *jpeg, size_t len, unsigned denom, std::vector<uint8_t> &rgb,
+                         uint16_t &width, uint16_t &height, int &mcuW, int &mcuH) {
+    jpeg_decompress_struct cinfo;
+    ErrorJump err;
+    cinfo.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit = onJpegError;
+    err.mgr.emit_message = quietJpeg;
+    if (setjmp(err.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, const_cast<uint8_t *>(jpeg), len);
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_RGB;
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = denom;
+    cinfo.dct_method = JDCT_ISLOW;
+    jpeg_start_decompress(&cinfo);
+    mcuW = cinfo.max_h_samp_factor * 8;
+    mcuH = cinfo.max_v_samp_factor * 8;
+    width = (uint16_t)cinfo.output_width;
+    height = (uint16_t)cinfo.output_height;
+    rgb.resize((size_t)width * height * 3);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = rgb.data() + (size_t)cinfo.output_scanline * width * 3;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+bool HostJpeg::decode(const uint8_t *jpeg, size_t len, std::vector<uint8_t> &rgb,
+                      uint16_t &width, uint16_t &height) {
+    int mcuW, mcuH;
+    return decodeScaled(jpeg, len, 1, rgb, width, height, mcuW, mcuH);
+}
+
+bool HostJpeg::size(const uint8_t *jpeg, size_t len, uint16_t &width, uint16_t &height) {
+    size_t i = 2;
+    if (len < 4 || jpeg[0] != 0xFF || jpeg[1] != 0xD8) return false;
+    while (i + 4 <= len) {
+        if (jpeg[i] != 0xFF) return false;
+        uint8_t marker = jpeg[i + 1];
+        if (marker == 0xFF) {
+            i++;
+            continue;
+        }
+        size_t segment = ((size_t)jpeg[i + 2] << 8) | jpeg[i + 3];
+        // SOF0..SOF15, minus DHT (C4), JPG (C8) and DAC (CC)
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            if (i + 9 > len) return false;
+            height = (uint16_t)((jpeg[i + 5] << 8) | jpeg[i + 6]);
+            width = (uint16_t)((jpeg[i + 7] << 8) | jpeg[i + 8]);
+            return true;
+        }
+        i += 2 + segment;
+    }
+    return false;
+}
+
+double HostJpeg::psnr(const uint8_t *a, const uint8_t *b, size_t len) {
+    double sum = 0;
+    for (size_t i = 0; i < len; i++) {
+        double d = (double)a[i] - b[i];
+        sum += d * d;
+    }
+    if (len == 0 || sum == 0) return 99.0;
+    return 10.0 * log10(255.0 * 255.0 / (sum / len));
+}
+
+// ===========================================
+// esp_jpg_decode
+// ===========================================
+esp_err_t esp_jpg_decode(size_t len, jpg_scale_t scale, jpg_reader_cb reader, jpg_writer_cb writer, void *arg) {
+    // Per thread, like the decoder's work area: no allocation per frame
+    // once the buffers have grown to the frame size
+    static thread_local std::vector<uint8_t> input;
+    static thread_local std::vector<uint8_t> rgb;
+    static thread_local std::vector<uint8_t> block;
+
+    input.resize(len);
+    if (len == 0 || reader(arg, 0, input.data(), len) != len) {
+        return ESP_FAIL;
+    }
+    uint16_t width, height;
+    int mcuW, mcuH;
+    unsigned denom = 1u << scale;
+    if (!decodeScaled(input.data(), len, denom, rgb, width, height, mcuW, mcuH)) {
+        return ESP_FAIL;
+    }
+    // TJpgDec rounds the scaled size down where libjpeg rounds up
+    uint16_t outW, outH;
+    if (!HostJpeg::size(input.data(), len, outW, outH)) {
+        return ESP_FAIL;
+    }
+    outW >>= scale;
+    outH >>= scale;
+    int bw = mcuW >> scale;
+    int bh = mcuH >> scale;
+    if (bw < 1) bw = 1;
+    if (bh < 1) bh = 1;
+
+    // The device ignores the start call's result, and so does this
+    writer(arg, 0, 0, outW, outH, NULL);
+    bool ok = true;
+    block.resize((size_t)bw * bh * 3);
+    for (int y = 0; y < outH && ok; y += bh) {
+        for (int x = 0; x < outW && ok; x += bw) {
+            int w = x + bw <= outW ? bw : outW - x;
+            int h = y + bh <= outH ? bh : outH - y;
+            for (int row = 0; row < h; row++) {
+                memcpy(block.data() + (size_t)row * w * 3,
+                       rgb.data() + ((size_t)(y + row) * width + x) * 3, (size_t)w * 3);
+            }
+            ok = writer(arg, (uint16_t)x, (uint16_t)y, (uint16_t)w, (uint16_t)h, block.data());
+        }
+    }
+    writer(arg, outW, outH, outW, outH, NULL);
+    return ok ? ESP_OK : ESP_FAIL;
+}
@@ -0,0 +1,399 @@
+/*
+ * WiFi, WiFiClient, WiFiServer stand-ins - see WiFi.h; HostNet - see HostHarness.h
+ */
+
+#include "HostHarness.h"
+#include "HostInternal.h"
+#include <WiFi.h>
+#include <lwip/sockets.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <poll.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+
+#define HOST_DEFAULT_TIMEOUT_MS 3000      // WiFiClient's default socket timeout
+#define HOST_LOW_PORT_SHIFT     10000     // 80 -> 10080 unless mapped
+
+// Writes to a closed socket must fail with EPIPE, not kill the process
+// (MjpegStreamer uses plain send() on fd())
+static struct IgnoreSigpipe {
+    IgnoreSigpipe() { signal(SIGPIPE, SIG_IGN); }
+} ignoreSigpipe;
+
+// ===========================================
+// HostNet
+// ===========================================
+static std::mutex netMutex;
+static std::map<uint16_t, uint16_t> portMap;
+static std::map<uint16_t, uint16_t> boundPorts;
+static std::atomic<bool> stationUp(false);
+static std::atomic<uint32_t> connectCount(0);
+
+struct HostWiFiHandler {
+    WiFiEventCb cb;
+    arduino_event_id_t event;
+};
+static std::vector<HostWiFiHandler> wifiHandlers;
+
+void HostNet::mapPort(uint16_t devicePort, uint16_t hostPort) {
+    std::lock_guard<std::mutex> lock(netMutex);
+    portMap[devicePort] = hostPort;
+}
+
+uint16_t HostNet::hostPort(uint16_t devicePort) {
+    std::lock_guard<std::mutex> lock(netMutex);
+    std::map<uint16_t, uint16_t>::iterator it = portMap.find(devicePort);
+    if (it != portMap.end()) return it->second;
+    return devicePort < 1024 ? devicePort + HOST_LOW_PORT_SHIFT : devicePort;
+}
+
+uint16_t HostNet::boundPort(uint16_t devicePort) {
+    std::lock_guard<std::mutex> lock(netMutex);
+    std::map<uint16_t, uint16_t>::iterator it = boundPorts.find(devicePort);
+    return it != boundPorts.end() ? it->second : 0;
+}
+
+void HostNet::bound(uint16_t devicePort, uint16_t hostPort) {
+    std::lock_guard<std::mutex> lock(netMutex);
+    boundPorts[devicePort] = hostPort;
+}
+
+static void fireWiFiEvent(arduino_event_id_t event) {
+    std::vector<HostWiFiHandler> handlers;
+    {
+        std::lock_guard<std::mutex> lock(netMutex);
+        handlers = wifiHandlers;
+    }
+    for (size_t i = 0; i < handlers.size(); i++) {
+        if (handlers[i].event == ARDUINO_EVENT_MAX || handlers[i].event == event) {
+            handlers[i].cb(event);
+        }
+    }
+}
+
+void HostNet::dropWiFi() {
+    if (stationUp.exchange(false)) {
+        fireWiFiEvent(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+    }
+}
+
+void HostNet::restoreWiFi() {
+    if (!stationUp.exchange(true)) {
+        fireWiFiEvent(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+        fireWiFiEvent(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    }
+}
+
+bool HostNet::wifiUp() {
+    return stationUp;
+}
+
+uint32_t HostNet::connects() {
+    return connectCount;
+}
+
+// ===========================================
+// WiFiClass
+// ===========================================
+WiFiClass WiFi;
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventCb cb, arduino_event_id_t event) {
+    std::lock_guard<std::mutex> lock(netMutex);
+    HostWiFiHandler h = { cb, event };
+    wifiHandlers.push_back(h);
+    return (wifi_event_id_t)wifiHandlers.size();
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+    (void)mode;
+    return true;
+}
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *passphrase) {
+    (void)ssid;
+    (void)passphrase;
+    HostNet::restoreWiFi();
+    return status();
+}
+
+wl_status_t WiFiClass::status() {
+    return stationUp ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+bool WiFiClass::reconnect() {
+    // Comes back when the test restores the station
+    return stationUp;
+}
+
+bool WiFiClass::disconnect(bool wifioff) {
+    (void)wifioff;
+    HostNet::dropWiFi();
+    return true;
+}
+
+bool WiFiClass::setAutoReconnect(bool autoReconnect) {
+    (void)autoReconnect;
+    return true;
+}
+
+bool WiFiClass::setSleep(bool enabled) {
+    (void)enabled;
+    return true;
+}
+
+IPAddress WiFiClass::localIP() {
+    return stationUp ? IPAddress(127, 0, 0, 1) : IPAddress();
+}
+
+String WiFiClass::macAddress() {
+    return String("24:AC:2C:3B:6A:10");
+}
+
+int8_t WiFiClass::RSSI() {
+    return stationUp ? -55 : 0;
+}
+
+// ===========================================
+// HostSocket
+// ===========================================
+class HostSocket {
+public:
+    HostSocket(int fd, uint32_t remote, uint16_t port) : fd(fd), remote(remote), port(port) {}
+    ~HostSocket() { close(); }
+    void close() {
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    int fd;
+    uint32_t remote;
+    uint16_t port;
+};
+
+static void setTimeouts(int fd, uint32_t timeoutMs) {
+    struct timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+// ===========================================
+// WiFiClient
+// ===========================================
+WiFiClient::WiFiClient() : _timeoutMs(HOST_DEFAULT_TIMEOUT_MS) {
+}
+
+WiFiClient::WiFiClient(int fd) : _timeoutMs(HOST_DEFAULT_TIMEOUT_MS) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    getpeername(fd, (struct sockaddr *)&addr, &len);
+    _sock = std::make_shared<HostSocket>(fd, addr.sin_addr.s_addr, ntohs(addr.sin_port));
+    setTimeouts(fd, _timeoutMs);
+}
+
+WiFiClient::~WiFiClient() {
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip, port, _timeoutMs);
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port, int32_t timeoutMs) {
+    (void)ip;   // Every address is this host
+    return connect("127.0.0.1", port, timeoutMs);
+}
+
+int WiFiClient::connect(const char *host, uint16_t port) {
+    return connect(host, port, _timeoutMs);
+}
+
+int WiFiClient::connect(const char *host, uint16_t port, int32_t timeoutMs) {
+    (void)host;  // LAN names and addresses all resolve to loopback
+    stop();
+    if (!stationUp) {
+        return 0;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return 0;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(HostNet::hostPort(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    int res = ::connect(fd, (struct sockaddr *)&addr, sizeof(addr));
+    if (res < 0 && errno == EINPROGRESS) {
+        struct pollfd p = { fd, POLLOUT, 0 };
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (poll(&p, 1, timeoutMs) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0) {
+            res = 0;
+        }
+    }
+    if (res < 0) {
+        ::close(fd);
+        return 0;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK);
+    setTimeouts(fd, _timeoutMs);
+    connectCount++;
+    _sock = std::make_shared<HostSocket>(fd, addr.sin_addr.s_addr, port);
+    return 1;
+}
+
+size_t WiFiClient::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t size) {
+    if (!_sock || _sock->fd < 0) return 0;
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t n = send(_sock->fd, buf + sent, size - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            break;
+        }
+        sent += n;
+    }
+    return sent;
+}
+
+int WiFiClient::available() {
+    if (!_sock || _sock->fd < 0) return 0;
+    int n = 0;
+    if (ioctl(_sock->fd, FIONREAD, &n) < 0) return 0;
+    return n;
+}
+
+int WiFiClient::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t *buf, size_t size) {
+    if (!_sock || _sock->fd < 0) return -1;
+    ssize_t n = recv(_sock->fd, buf, size, MSG_DONTWAIT);
+    return n > 0 ? (int)n : -1;
+}
+
+int WiFiClient::peek() {
+    if (!_sock || _sock->fd < 0) return -1;
+    uint8_t c;
+    return recv(_sock->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 1 ? c : -1;
+}
+
+void WiFiClient::stop() {
+    if (_sock) {
+        _sock->close();
+        _sock.reset();
+    }
+}
+
+uint8_t WiFiClient::connected() {
+    if (!_sock || _sock->fd < 0) return 0;
+    uint8_t c;
+    ssize_t n = recv(_sock->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n > 0) return 1;
+    if (n == 0) return 0;   // Orderly shutdown by the peer, nothing left to read
+    return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 1 : 0;
+}
+
+int WiFiClient::setNoDelay(bool nodelay) {
+    if (!_sock || _sock->fd < 0) return -1;
+    int flag = nodelay ? 1 : 0;
+    return setsockopt(_sock->fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+int WiFiClient::setTimeout(uint32_t seconds) {
+    _timeoutMs = seconds * 1000;
+    Stream::setTimeout(_timeoutMs);
+    if (_sock && _sock->fd >= 0) {
+        setTimeouts(_sock->fd, _timeoutMs);
+    }
+    return 0;
+}
+
+int WiFiClient::fd() const {
+    return _sock ? _sock->fd : -1;
+}
+
+IPAddress WiFiClient::remoteIP() const {
+    return _sock ? IPAddress(_sock->remote) : IPAddress();
+}
+
+uint16_t WiFiClient::remotePort() const {
+    return _sock ? _sock->port : 0;
+}
+
+// ===========================================
+// WiFiServer
+// ===========================================
+WiFiServer::WiFiServer(uint16_t port, uint8_t maxClients)
+    : _port(port),
+      _fd(-1),
+      _noDelay(false) {
+    (void)maxClients;
+}
+
+WiFiServer::~WiFiServer() {
+    end();
+}
+
+void WiFiServer::begin(uint16_t port) {
+    if (port) _port = port;
+    end();
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(HostNet::hostPort(_port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 8) < 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &len) < 0) {
+        Serial.printf("[HOST] Cannot listen on port %u: %s\n", HostNet::hostPort(_port), strerror(errno));
+        ::close(fd);
+        return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    _fd = fd;
+    HostNet::bound(_port, ntohs(addr.sin_port));
+}
+
+void WiFiServer::end() {
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+}
+
+WiFiClient WiFiServer::accept() {
+    if (_fd < 0) return WiFiClient();
+    int fd = ::accept(_fd, NULL, NULL);
+    if (fd < 0) return WiFiClient();
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK);
+    if (_noDelay) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return WiFiClient(fd);
+}
+
+bool WiFiServer::hasClient() {
+    if (_fd < 0) return false;
+    struct pollfd p = { _fd, POLLIN, 0 };
+    return poll(&p, 1, 0) == 1;
+}
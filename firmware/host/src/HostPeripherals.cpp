@@ -0,0 +1,139 @@
+/*
+ * Servo, I2C and LCD stand-ins - see ESP32Servo.h, Wire.h,
+ * LiquidCrystal_I2C.h and HostHarness.h
+ */
+
+#include <ESP32Servo.h>
+#include <LiquidCrystal_I2C.h>
+#include <Wire.h>
+#include <HostHarness.h>
+#include <mutex>
+
+#define HOST_LCD_ROWS           4
+#define HOST_LCD_COLS           40
+
+TwoWire Wire;
+
+static std::mutex servoMutex;
+static std::vector<HostServoCommand> servoHistory;
+static int servoAngle = -1;
+
+static std::mutex lcdMutex;
+static char lcdText[HOST_LCD_ROWS][HOST_LCD_COLS + 1];
+static uint32_t lcdClears = 0;
+static bool lcdBacklight = false;
+
+// ===========================================
+// Servo
+// ===========================================
+int Servo::attach(int pin) {
+    _pin = pin;
+    return 1;
+}
+
+void Servo::detach() {
+    _pin = -1;
+}
+
+void Servo::write(int angle) {
+    _angle = constrain(angle, 0, 180);
+    if (_pin < 0) return;
+    HostServoCommand cmd = { HostClock::nowUs(), _pin, _angle };
+    std::lock_guard<std::mutex> lock(servoMutex);
+    servoHistory.push_back(cmd);
+    servoAngle = _angle;
+}
+
+int HostServo::angle() {
+    std::lock_guard<std::mutex> lock(servoMutex);
+    return servoAngle;
+}
+
+std::vector<HostServoCommand> HostServo::history() {
+    std::lock_guard<std::mutex> lock(servoMutex);
+    return servoHistory;
+}
+
+void HostServo::clear() {
+    std::lock_guard<std::mutex> lock(servoMutex);
+    servoHistory.clear();
+}
+
+// ===========================================
+// I2C
+// ===========================================
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+    (void)frequency;
+    _sda = sda;
+    _scl = scl;
+    return true;
+}
+
+// ===========================================
+// LCD
+// ===========================================
+LiquidCrystal_I2C::LiquidCrystal_I2C(uint8_t address, uint8_t cols, uint8_t rows)
+    : _cols(cols < HOST_LCD_COLS ? cols : HOST_LCD_COLS),
+      _rows(rows < HOST_LCD_ROWS ? rows : HOST_LCD_ROWS),
+      _col(0),
+      _row(0) {
+    (void)address;
+}
+
+void LiquidCrystal_I2C::init() {
+    clear();
+}
+
+void LiquidCrystal_I2C::clear() {
+    std::lock_guard<std::mutex> lock(lcdMutex);
+    for (int r = 0; r < HOST_LCD_ROWS; r++) {
+        memset(lcdText[r], ' ', _cols);
+        lcdText[r][_cols] = 0;
+    }
+    lcdClears++;
+    _col = 0;
+    _row = 0;
+}
+
+void LiquidCrystal_I2C::setCursor(uint8_t col, uint8_t row) {
+    _col = col;
+    _row = row < _rows ? row : _rows - 1;
+}
+
+void LiquidCrystal_I2C::backlight() {
+    std::lock_guard<std::mutex> lock(lcdMutex);
+    lcdBacklight = true;
+}
+
+void LiquidCrystal_I2C::noBacklight() {
+    std::lock_guard<std::mutex> lock(lcdMutex);
+    lcdBacklight = false;
+}
+
+size_t LiquidCrystal_I2C::write(uint8_t c) {
+    std::lock_guard<std::mutex> lock(lcdMutex);
+    // Like the HD44780, characters past the visible width are lost
+    if (_col < _cols) {
+        lcdText[_row][_col] = (char)c;
+    }
+    _col++;
+    return 1;
+}
+
+std::string HostLcd::line(uint8_t row) {
+    std::lock_guard<std::mutex> lock(lcdMutex);
+    if (row >= HOST_LCD_ROWS) return std::string();
+    std::string s(lcdText[row]);
+    size_t end = s.find_last_not_of(' ');
+    return end == std::string::npos ? std::string() : s.substr(0, end + 1);
+}
+
+uint32_t HostLcd::clears() {
+    std::lock_guard<std::mutex> lock(lcdMutex);
+    return lcdClears;
+}
+
+bool HostLcd::backlight() {
+    std::lock_guard<std::mutex> lock(lcdMutex);
+    return lcdBacklight;
+}
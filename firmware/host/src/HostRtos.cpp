@@ -0,0 +1,389 @@
+/*
+ * FreeRTOS stand-in - see freertos/FreeRTOS.h
+ *
+ * Every blocking call waits in short slices so it can notice the virtual
+ * clock moving and vTaskDelete() of the calling task; a deleted task
+ * unwinds out of its function at its next blocking call.
+ */
+
+#include "HostHarness.h"
+#include "HostInternal.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define HOST_WAIT_SLICE_US      2000      // Deletion/clock re-check period of blocked calls
+
+struct HostTask {
+    HostTask(const char *taskName, UBaseType_t prio, int taskCore)
+        : name(taskName ? taskName : ""), priority(prio), core(taskCore), deleted(false), exited(false) {}
+    std::string name;
+    UBaseType_t priority;
+    int core;
+    std::atomic<bool> deleted;
+    std::atomic<bool> exited;
+};
+
+static std::mutex taskMutex;
+static std::map<void *, std::shared_ptr<HostTask> > tasks;
+static thread_local std::shared_ptr<HostTask> currentTask;
+static thread_local int currentCore = 1;   // Arduino loopTask runs on core 1
+
+void hostSetCore(int core) {
+    currentCore = core;
+}
+
+static HostTask *selfTask() {
+    if (!currentTask) {
+        currentTask = std::make_shared<HostTask>("main", 1, currentCore);
+        std::lock_guard<std::mutex> lock(taskMutex);
+        tasks[currentTask.get()] = currentTask;
+    }
+    return currentTask.get();
+}
+
+static void checkDeleted() {
+    if (currentTask && currentTask->deleted) {
+        throw HostTaskExit();
+    }
+}
+
+// Sleeps until the virtual deadline, unwinding if the task gets deleted
+static void taskSleepUntilUs(uint64_t targetUs) {
+    while (true) {
+        checkDeleted();
+        uint64_t now = HostClock::nowUs();
+        if (now >= targetUs) return;
+        HostClock::sleepUntilUs(targetUs - now > HOST_WAIT_SLICE_US ? now + HOST_WAIT_SLICE_US : targetUs);
+    }
+}
+
+static uint64_t deadlineUs(TickType_t ticks) {
+    return ticks == portMAX_DELAY ? UINT64_MAX : HostClock::nowUs() + (uint64_t)ticks * 1000 * portTICK_PERIOD_MS;
+}
+
+// Waits on cv until ready() or the virtual deadline; false on timeout
+template<class Ready>
+static bool waitFor(std::unique_lock<std::mutex> &lock, std::condition_variable &cv,
+                    uint64_t deadline, Ready ready) {
+    while (!ready()) {
+        if (HostClock::nowUs() >= deadline) return false;
+        if (currentTask && currentTask->deleted) {
+            lock.unlock();
+            throw HostTaskExit();
+        }
+        cv.wait_for(lock, std::chrono::microseconds(HOST_WAIT_SLICE_US));
+    }
+    return true;
+}
+
+// ===========================================
+// Tasks
+// ===========================================
+static void taskMain(std::shared_ptr<HostTask> task, TaskFunction_t code, void *param) {
+    currentTask = task;
+    currentCore = task->core;
+    try {
+        code(param);
+    } catch (const HostTaskExit &) {
+    }
+    task->exited = true;
+    std::lock_guard<std::mutex> lock(taskMutex);
+    tasks.erase(task.get());
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stackDepth,
+                                   void *param, UBaseType_t priority, TaskHandle_t *created,
+                                   BaseType_t coreId) {
+    (void)stackDepth;
+    int core = coreId == tskNO_AFFINITY ? currentCore : (int)coreId;
+    std::shared_ptr<HostTask> task = std::make_shared<HostTask>(name, priority, core);
+    {
+        std::lock_guard<std::mutex> lock(taskMutex);
+        tasks[task.get()] = task;
+    }
+    try {
+        std::thread(taskMain, task, code, param).detach();
+    } catch (const std::system_error &) {
+        std::lock_guard<std::mutex> lock(taskMutex);
+        tasks.erase(task.get());
+        return pdFAIL;
+    }
+    if (created) {
+        *created = task.get();
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stackDepth,
+                       void *param, UBaseType_t priority, TaskHandle_t *created) {
+    return xTaskCreatePinnedToCore(code, name, stackDepth, param, priority, created, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t handle) {
+    if (handle == NULL || handle == selfTask()) {
+        selfTask()->deleted = true;
+        throw HostTaskExit();
+    }
+    std::shared_ptr<HostTask> task;
+    {
+        std::lock_guard<std::mutex> lock(taskMutex);
+        std::map<void *, std::shared_ptr<HostTask> >::iterator it = tasks.find(handle);
+        if (it == tasks.end()) return;
+        task = it->second;
+    }
+    // FreeRTOS never runs a deleted task again; here it leaves at its next
+    // blocking call, so wait for that before the caller frees its state
+    task->deleted = true;
+    while (!task->exited) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+void vTaskDelay(TickType_t ticks) {
+    taskSleepUntilUs(HostClock::nowUs() + (uint64_t)ticks * 1000 * portTICK_PERIOD_MS);
+}
+
+void vTaskDelayUntil(TickType_t *previousWake, TickType_t increment) {
+    TickType_t target = *previousWake + increment;
+    TickType_t now = xTaskGetTickCount();
+    *previousWake = target;
+    int32_t ahead = (int32_t)(target - now);
+    if (ahead > 0) {
+        vTaskDelay((TickType_t)ahead);
+    } else {
+        checkDeleted();
+    }
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)(HostClock::nowUs() / (1000 * portTICK_PERIOD_MS));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return selfTask();
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+    return task ? ((HostTask *)task)->priority : selfTask()->priority;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    (void)task;
+    return 0;
+}
+
+const char *pcTaskGetName(TaskHandle_t task) {
+    return task ? ((HostTask *)task)->name.c_str() : selfTask()->name.c_str();
+}
+
+void taskYIELD() {
+    checkDeleted();
+    std::this_thread::yield();
+}
+
+BaseType_t xPortGetCoreID() {
+    return currentCore;
+}
+
+// ===========================================
+// Critical sections
+// ===========================================
+static uint32_t threadTag() {
+    static std::atomic<uint32_t> nextTag(1);
+    static thread_local uint32_t tag = nextTag++;
+    return tag;
+}
+
+void vPortEnterCritical(portMUX_TYPE *mux) {
+    uint32_t self = threadTag();
+    uint32_t *owner = (uint32_t *)&mux->owner;
+    if (__atomic_load_n(owner, __ATOMIC_ACQUIRE) == self) {
+        mux->count++;
+        return;
+    }
+    uint32_t expected = 0;
+    while (!__atomic_compare_exchange_n(owner, &expected, self, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        expected = 0;
+        std::this_thread::yield();
+    }
+    mux->count = 1;
+}
+
+void vPortExitCritical(portMUX_TYPE *mux) {
+    if (--mux->count == 0) {
+        __atomic_store_n((uint32_t *)&mux->owner, 0, __ATOMIC_RELEASE);
+    }
+}
+
+// ===========================================
+// Queues
+// ===========================================
+struct HostQueue {
+    HostQueue(UBaseType_t len, UBaseType_t size) : length(len), itemSize(size) {}
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::vector<uint8_t> > items;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    if (length == 0) return NULL;
+    return new HostQueue(length, itemSize);
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete (HostQueue *)queue;
+}
+
+static BaseType_t queueSend(QueueHandle_t handle, const void *item, TickType_t wait, bool overwrite) {
+    HostQueue *q = (HostQueue *)handle;
+    std::unique_lock<std::mutex> lock(q->mutex);
+    if (overwrite) {
+        q->items.clear();
+    } else if (!waitFor(lock, q->changed, deadlineUs(wait), [q] { return q->items.size() < q->length; })) {
+        return pdFALSE;
+    }
+    const uint8_t *bytes = (const uint8_t *)item;
+    q->items.push_back(std::vector<uint8_t>(bytes, bytes + q->itemSize));
+    q->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait) {
+    return queueSend(queue, item, wait, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t wait) {
+    return queueSend(queue, item, wait, false);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken) {
+    if (woken) *woken = pdFALSE;
+    return queueSend(queue, item, 0, false);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item) {
+    return queueSend(queue, item, 0, true);
+}
+
+static BaseType_t queueReceive(QueueHandle_t handle, void *item, TickType_t wait, bool remove) {
+    HostQueue *q = (HostQueue *)handle;
+    std::unique_lock<std::mutex> lock(q->mutex);
+    if (!waitFor(lock, q->changed, deadlineUs(wait), [q] { return !q->items.empty(); })) {
+        return pdFALSE;
+    }
+    memcpy(item, q->items.front().data(), q->itemSize);
+    if (remove) {
+        q->items.pop_front();
+        q->changed.notify_all();
+    }
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait) {
+    return queueReceive(queue, item, wait, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t wait) {
+    return queueReceive(queue, item, wait, false);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t handle) {
+    HostQueue *q = (HostQueue *)handle;
+    std::lock_guard<std::mutex> lock(q->mutex);
+    return (UBaseType_t)q->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t handle) {
+    HostQueue *q = (HostQueue *)handle;
+    std::lock_guard<std::mutex> lock(q->mutex);
+    return q->length - (UBaseType_t)q->items.size();
+}
+
+// ===========================================
+// Semaphores
+// ===========================================
+struct HostSemaphore {
+    HostSemaphore(UBaseType_t max, UBaseType_t initial) : count(initial), maxCount(max) {}
+    std::mutex mutex;
+    std::condition_variable changed;
+    UBaseType_t count;
+    UBaseType_t maxCount;
+};
+
+// A task may still wait on a semaphore that is being deleted (its own
+// deletion is pending), so handles resolve through a registry
+static std::mutex semMutex;
+static std::map<void *, std::shared_ptr<HostSemaphore> > semaphores;
+
+static SemaphoreHandle_t semCreate(UBaseType_t max, UBaseType_t initial) {
+    std::shared_ptr<HostSemaphore> sem = std::make_shared<HostSemaphore>(max, initial);
+    std::lock_guard<std::mutex> lock(semMutex);
+    semaphores[sem.get()] = sem;
+    return sem.get();
+}
+
+static std::shared_ptr<HostSemaphore> semFind(SemaphoreHandle_t handle) {
+    std::lock_guard<std::mutex> lock(semMutex);
+    std::map<void *, std::shared_ptr<HostSemaphore> >::iterator it = semaphores.find(handle);
+    return it != semaphores.end() ? it->second : std::shared_ptr<HostSemaphore>();
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return semCreate(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return semCreate(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    return semCreate(maxCount, initialCount);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t handle) {
+    std::lock_guard<std::mutex> lock(semMutex);
+    semaphores.erase(handle);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t handle, TickType_t wait) {
+    std::shared_ptr<HostSemaphore> sem = semFind(handle);
+    if (!sem) return pdFALSE;
+    std::unique_lock<std::mutex> lock(sem->mutex);
+    HostSemaphore *s = sem.get();
+    if (!waitFor(lock, s->changed, deadlineUs(wait), [s] { return s->count > 0; })) {
+        return pdFALSE;
+    }
+    s->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t handle) {
+    std::shared_ptr<HostSemaphore> sem = semFind(handle);
+    if (!sem) return pdFALSE;
+    std::lock_guard<std::mutex> lock(sem->mutex);
+    if (sem->count >= sem->maxCount) {
+        return pdFALSE;
+    }
+    sem->count++;
+    sem->changed.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t handle, BaseType_t *woken) {
+    if (woken) *woken = pdFALSE;
+    return xSemaphoreGive(handle);
+}
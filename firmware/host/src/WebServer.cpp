@@ -0,0 +1,295 @@
+/*
+ * WebServer stand-in - see WebServer.h
+ *
+ * Follows the request cycle of the Arduino-ESP32 library, including its
+ * quirk that a client still connected after the handler (a stream viewer)
+ * is held for up to HTTP_MAX_CLOSE_WAIT before the next one is accepted.
+ */
+
+#include <WebServer.h>
+#include <lwip/sockets.h>
+#include <poll.h>
+
+#define HTTP_MAX_DATA_WAIT      5000      // ms to wait for the request
+#define HTTP_MAX_CLOSE_WAIT     2000      // ms to wait for the client to close
+#define HTTP_MAX_SEND_WAIT      5000      // Socket timeout while responding
+#define HTTP_MAX_HEAD           4096
+
+enum { HC_NONE, HC_WAIT_READ, HC_WAIT_CLOSE };
+
+static int clientState = HC_NONE;         // One server per firmware image
+static unsigned long statusChange = 0;
+
+static const char *reasonPhrase(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default:  return "";
+    }
+}
+
+static String urlDecode(const std::string &s) {
+    std::string out;
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '+') {
+            out += ' ';
+        } else if (s[i] == '%' && i + 2 < s.size()) {
+            out += (char)strtol(s.substr(i + 1, 2).c_str(), NULL, 16);
+            i += 2;
+        } else {
+            out += s[i];
+        }
+    }
+    return String(out);
+}
+
+// Reads one CRLF-terminated line within the deadline (real time, like lwIP)
+static bool readLine(WiFiClient &client, std::string &out, uint32_t timeoutMs) {
+    out.clear();
+    int fd = client.fd();
+    while (out.size() < HTTP_MAX_HEAD) {
+        int c = client.read();
+        if (c < 0) {
+            struct pollfd p = { fd, POLLIN, 0 };
+            if (fd < 0 || poll(&p, 1, timeoutMs) != 1 || !client.connected()) return false;
+            continue;
+        }
+        if (c == '\n') {
+            if (!out.empty() && out[out.size() - 1] == '\r') out.erase(out.size() - 1);
+            return true;
+        }
+        out += (char)c;
+    }
+    return false;
+}
+
+WebServer::WebServer(int port)
+    : _port(port),
+      _server(port),
+      _method(HTTP_ANY),
+      _contentLength(CONTENT_LENGTH_NOT_SET),
+      _chunked(false) {
+}
+
+WebServer::~WebServer() {
+    close();
+}
+
+void WebServer::begin() {
+    clientState = HC_NONE;
+    _server.begin();
+    _server.setNoDelay(true);
+}
+
+void WebServer::close() {
+    _server.end();
+}
+
+void WebServer::on(const String &uri, HTTPMethod method, THandlerFunction handler) {
+    Route r = { uri, method, handler };
+    _routes.push_back(r);
+}
+
+void WebServer::collectHeaders(const char *headerKeys[], const size_t headerKeysCount) {
+    _headers.clear();
+    for (size_t i = 0; i < headerKeysCount; i++) {
+        Pair p = { String(headerKeys[i]), String() };
+        _headers.push_back(p);
+    }
+}
+
+String WebServer::header(const char *name) const {
+    for (size_t i = 0; i < _headers.size(); i++) {
+        if (_headers[i].name.equalsIgnoreCase(name)) return _headers[i].value;
+    }
+    return String();
+}
+
+bool WebServer::hasHeader(const char *name) const {
+    return header(name).length() > 0;
+}
+
+String WebServer::arg(const char *name) const {
+    for (size_t i = 0; i < _args.size(); i++) {
+        if (_args[i].name == name) return _args[i].value;
+    }
+    return String();
+}
+
+bool WebServer::hasArg(const char *name) const {
+    for (size_t i = 0; i < _args.size(); i++) {
+        if (_args[i].name == name) return true;
+    }
+    return false;
+}
+
+bool WebServer::readRequest() {
+    std::string line;
+    if (!readLine(_client, line, HTTP_MAX_DATA_WAIT)) return false;
+    size_t sp1 = line.find(' ');
+    size_t sp2 = line.find(' ', sp1 + 1);
+    if (sp1 == std::string::npos || sp2 == std::string::npos) return false;
+    std::string method = line.substr(0, sp1);
+    std::string target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+    
+    _method = method == "GET" ? HTTP_GET : method == "POST" ? HTTP_POST : method == "PUT" ? HTTP_PUT :
+              method == "HEAD" ? HTTP_HEAD : method == "DELETE" ? HTTP_DELETE :
+              method == "PATCH" ? HTTP_PATCH : method == "OPTIONS" ? HTTP_OPTIONS : HTTP_ANY;
+    size_t q = target.find('?');
+    _uri = String(target.substr(0, q));
+    _args.clear();
+    if (q != std::string::npos) {
+        std::string query = target.substr(q + 1);
+        size_t pos = 0;
+        while (pos <= query.size()) {
+            size_t end = query.find('&', pos);
+            if (end == std::string::npos) end = query.size();
+            std::string kv = query.substr(pos, end - pos);
+            if (!kv.empty()) {
+                size_t eq = kv.find('=');
+                Pair p = { urlDecode(kv.substr(0, eq)),
+                           eq == std::string::npos ? String() : urlDecode(kv.substr(eq + 1)) };
+                _args.push_back(p);
+            }
+            pos = end + 1;
+        }
+    }
+    
+    for (size_t i = 0; i < _headers.size(); i++) {
+        _headers[i].value = String();
+    }
+    size_t bodyLen = 0;
+    while (true) {
+        if (!readLine(_client, line, HTTP_MAX_DATA_WAIT)) return false;
+        if (line.empty()) break;
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        String name(line.substr(0, colon));
+        size_t v = colon + 1;
+        while (v < line.size() && line[v] == ' ') v++;
+        String value(line.substr(v));
+        if (name.equalsIgnoreCase("Content-Length")) bodyLen = (size_t)value.toInt();
+        for (size_t i = 0; i < _headers.size(); i++) {
+            if (_headers[i].name.equalsIgnoreCase(name)) _headers[i].value = value;
+        }
+    }
+    // Bodies are not used by the firmware's routes; drain them
+    uint8_t buf[256];
+    while (bodyLen > 0) {
+        int n = _client.read(buf, bodyLen < sizeof(buf) ? bodyLen : sizeof(buf));
+        if (n <= 0) {
+            struct pollfd p = { _client.fd(), POLLIN, 0 };
+            if (poll(&p, 1, HTTP_MAX_DATA_WAIT) != 1) return false;
+            continue;
+        }
+        bodyLen -= n;
+    }
+    return true;
+}
+
+void WebServer::handleClient() {
+    if (clientState == HC_NONE) {
+        WiFiClient client = _server.accept();
+        if (!client) {
+            return;
+        }
+        _client = client;
+        clientState = HC_WAIT_READ;
+        statusChange = millis();
+    }
+    
+    bool keep = false;
+    if (_client.connected()) {
+        if (clientState == HC_WAIT_READ) {
+            if (_client.available()) {
+                if (readRequest()) {
+                    _client.setTimeout(HTTP_MAX_SEND_WAIT / 1000);
+                    _contentLength = CONTENT_LENGTH_NOT_SET;
+                    _chunked = false;
+                    _responseHeaders = String();
+                    bool handled = false;
+                    for (size_t i = 0; i < _routes.size() && !handled; i++) {
+                        if (_routes[i].uri == _uri && (_routes[i].method == HTTP_ANY || _routes[i].method == _method)) {
+                            _routes[i].handler();
+                            handled = true;
+                        }
+                    }
+                    if (!handled) {
+                        if (_notFound) {
+                            _notFound();
+                        } else {
+                            send(404, "text/plain", String("Not found: ") + _uri);
+                        }
+                    }
+                    if (_client.connected()) {
+                        clientState = HC_WAIT_CLOSE;
+                        statusChange = millis();
+                        keep = true;
+                    }
+                }
+            } else if (millis() - statusChange <= HTTP_MAX_DATA_WAIT) {
+                keep = true;
+            }
+        } else if (clientState == HC_WAIT_CLOSE) {
+            keep = millis() - statusChange <= HTTP_MAX_CLOSE_WAIT;
+        }
+    }
+    if (!keep) {
+        _client = WiFiClient();
+        clientState = HC_NONE;
+    }
+}
+
+void WebServer::sendHeader(const String &name, const String &value, bool first) {
+    String line = name + ": " + value + "\r\n";
+    _responseHeaders = first ? line + _responseHeaders : _responseHeaders + line;
+}
+
+void WebServer::writeHead(int code, const char *contentType, size_t contentLength) {
+    String head = String("HTTP/1.1 ") + String(code) + " " + reasonPhrase(code) + "\r\n";
+    if (contentType && *contentType) {
+        head += String("Content-Type: ") + contentType + "\r\n";
+    }
+    if (_contentLength == CONTENT_LENGTH_UNKNOWN) {
+        head += "Transfer-Encoding: chunked\r\n";
+        _chunked = true;
+    } else {
+        size_t len = _contentLength == CONTENT_LENGTH_NOT_SET ? contentLength : _contentLength;
+        head += String("Content-Length: ") + String((unsigned long)len) + "\r\n";
+    }
+    head += "Connection: close\r\n";
+    head += _responseHeaders;
+    head += "\r\n";
+    _responseHeaders = String();
+    _client.write((const uint8_t *)head.c_str(), head.length());
+}
+
+void WebServer::send(int code, const char *contentType, const String &content) {
+    writeHead(code, contentType, content.length());
+    if (content.length()) {
+        sendContent(content);
+    }
+}
+
+void WebServer::send_P(int code, const char *contentType, const char *content, size_t contentLength) {
+    writeHead(code, contentType, contentLength);
+    sendContent(content, contentLength);
+}
+
+void WebServer::sendContent(const char *content, size_t size) {
+    if (_chunked) {
+        char len[12];
+        int n = snprintf(len, sizeof(len), "%zx\r\n", size);
+        _client.write((const uint8_t *)len, n);
+    }
+    _client.write((const uint8_t *)content, size);
+    if (_chunked) {
+        _client.write((const uint8_t *)"\r\n", 2);
+        if (size == 0) _chunked = false;
+    }
+}
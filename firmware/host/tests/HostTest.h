@@ -0,0 +1,388 @@
+/*
+ * HostTest - checks and stand-in services shared by the host tests and
+ * the benchmark runner
+ *
+ *   int main() {
+ *       FakeBackend backend;                       // /api/... on loopback
+ *       FakeAiService ai(800);                     // /analyze answers in 800 ms
+ *       HostArduino::start();
+ *       CHECK(HostServo::angle() == 0);
+ *       return hostTestResult("test_x");
+ *   }
+ */
+
+#pragma once
+
+#include <HostHarness.h>
+#include "MjpegStreamer.h"
+#include <ArduinoJson.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static int hostTestFailures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        hostTestFailures++; \
+    } \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+    long long va_ = (long long)(a); \
+    long long vb_ = (long long)(b); \
+    if (va_ != vb_) { \
+        fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, \
+                #a, #b, va_, vb_); \
+        hostTestFailures++; \
+    } \
+} while (0)
+
+// Prints the verdict; tests running the firmware end through
+// HostArduino::exit() so live tasks never meet static destructors
+static inline int hostTestResult(const char *name) {
+    if (hostTestFailures == 0) {
+        printf("[PASS] %s\n", name);
+    } else {
+        printf("[FAIL] %s: %d check(s) failed\n", name, hostTestFailures);
+    }
+    fflush(stdout);
+    return hostTestFailures == 0 ? 0 : 1;
+}
+
+// Waits up to timeoutMs (host time) for cond()
+template<class Cond>
+static bool waitFor(Cond cond, uint32_t timeoutMs) {
+    for (uint32_t waited = 0; !cond(); waited += 5) {
+        if (waited >= timeoutMs) return false;
+        usleep(5000);
+    }
+    return true;
+}
+
+static inline std::string readTextFile(const std::string &path) {
+    std::string text;
+    if (FILE *f = fopen(path.c_str(), "rb")) {
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+        fclose(f);
+    }
+    return text;
+}
+
+// Textured frame with a bright car-sized block; frames with another
+// variant move the block far enough for SceneGate to upload them
+static inline std::vector<uint8_t> sceneFrame(uint16_t width, uint16_t height, int variant) {
+    std::vector<uint8_t> rgb((size_t)width * height * 3);
+    uint32_t noise = 12345;
+    int blockW = width * 3 / 8;
+    int blockH = height * 5 / 12;
+    int blockX = width / 16 + (variant % 3) * (width * 9 / 32);
+    int blockY = height * 7 / 24;
+    for (size_t i = 0; i < rgb.size(); i += 3) {
+        int x = (int)(i / 3 % width);
+        int y = (int)(i / 3 / width);
+        noise = noise * 1103515245 + 12345;
+        int v = 80 + ((x / 8 + y / 8) % 2) * 40 + (int)(noise >> 27);
+        if (x >= blockX && x < blockX + blockW && y >= blockY && y < blockY + blockH) v = 230;
+        rgb[i] = rgb[i + 1] = rgb[i + 2] = (uint8_t)v;
+    }
+    std::vector<uint8_t> jpeg;
+    HostJpeg::encode(rgb.data(), width, height, 80, jpeg);
+    return jpeg;
+}
+
+// Lot seen from the camera: asphalt, painted slot outlines and a car in
+// every slot with cars[i] != 0 (its body luma, roof and windows darker).
+// Slots are the ai-service/parking_regions.json polygons, drawn on 800x600
+// frames and scaled to width x height. variant shifts noise and exposure.
+static inline std::vector<uint8_t> slotFrame(uint16_t width, uint16_t height, const std::vector<int> &cars,
+                                             int variant) {
+    struct Poly { std::vector<float> x, y; float cx, cy; };
+    std::vector<Poly> polys;
+    DynamicJsonDocument doc(8192);
+    deserializeJson(doc, readTextFile(std::string(REPO_DIR) + "/ai-service/parking_regions.json"));
+    for (JsonObject region : doc.as<JsonArray>()) {
+        Poly p;
+        p.cx = p.cy = 0;
+        for (JsonArray pt : region["points"].as<JsonArray>()) {
+            p.x.push_back(pt[0].as<float>() * width / 800);
+            p.y.push_back(pt[1].as<float>() * height / 600);
+            p.cx += p.x.back() / region["points"].size();
+            p.cy += p.y.back() / region["points"].size();
+        }
+        polys.push_back(p);
+    }
+    // Point in polygon, the polygon shrunk towards its centre by scale
+    auto inside = [](const Poly &p, float x, float y, float scale) {
+        bool in = false;
+        for (size_t i = 0, j = p.x.size() - 1; i < p.x.size(); j = i++) {
+            float xi = p.cx + (p.x[i] - p.cx) * scale, yi = p.cy + (p.y[i] - p.cy) * scale;
+            float xj = p.cx + (p.x[j] - p.cx) * scale, yj = p.cy + (p.y[j] - p.cy) * scale;
+            if ((yi > y) != (yj > y) && x < (xj - xi) * (y - yi) / (yj - yi) + xi) in = !in;
+        }
+        return in;
+    };
+
+    std::vector<uint8_t> rgb((size_t)width * height * 3);
+    uint32_t noise = variant * 2654435761u + 1;
+    int exposure = (int)(20 * sin(variant * 0.05));
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            noise = noise * 1103515245 + 12345;
+            int v = 92 + (int)(noise >> 28);
+            for (size_t i = 0; i < polys.size(); i++) {
+                if (!inside(polys[i], x + 0.5f, y + 0.5f, 1.0f)) continue;
+                if (!inside(polys[i], x + 0.5f, y + 0.5f, 0.93f)) {
+                    v = 210;                                  // Paint
+                } else if (i < cars.size() && cars[i] && inside(polys[i], x + 0.5f, y + 0.5f, 0.7f)) {
+                    v = cars[i];
+                    if (inside(polys[i], x + 0.5f, y + 0.5f, 0.4f)) v = cars[i] / 3 + 10;
+                    if (inside(polys[i], x + 0.5f, y + 0.5f, 0.25f)) v = cars[i] * 4 / 5;
+                }
+                break;
+            }
+            v = constrain(v + exposure, 0, 255);
+            size_t i = ((size_t)y * width + x) * 3;
+            rgb[i] = rgb[i + 1] = rgb[i + 2] = (uint8_t)v;
+        }
+    }
+    std::vector<uint8_t> jpeg;
+    HostJpeg::encode(rgb.data(), width, height, 80, jpeg);
+    return jpeg;
+}
+
+// ===========================================
+// Backend stand-in
+// ===========================================
+// Slots P1..P4, stats from them, session batches acked up to their
+// highest seq (or at most setAckLimit()). Answers JSON only, after delayMs.
+// Maps device port 8080 to itself.
+class FakeBackend {
+public:
+    explicit FakeBackend(uint32_t delayMs = 0)
+        : _delayMs(delayMs),
+          _occupied(4, false),
+          _server([this](const HostHttpRequest &r) { return handle(r); }) {
+        HostNet::mapPort(8080, _server.port());
+    }
+
+    uint32_t requests() const { return _server.requests(); }
+    uint32_t connections() const { return _server.connections(); }
+    uint32_t events() const { return _events; }
+    uint32_t batches() const { return _batches; }
+    uint32_t slotReads() const { return _slotReads; }
+    void setDelay(uint32_t ms) { _delayMs = ms; }
+    // Acks no higher than this, like a backend that lost its cursor
+    void setAckLimit(uint32_t seq) { _ackLimit = seq; }
+    std::vector<uint32_t> seqs() {                // Every event seq received
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _seqs;
+    }
+    void setOccupied(int slot, bool occupied) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _occupied[slot] = occupied;
+    }
+    std::vector<std::string> paths() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _paths;
+    }
+
+private:
+    HostHttpReply handle(const HostHttpRequest &r) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _paths.push_back(r.method + " " + r.path);
+        HostHttpReply reply;
+        reply.delayMs = _delayMs;
+        char buf[128];
+        if (r.method == "GET" && r.path == "/api/slots/stats") {
+            int occupied = 0;
+            for (size_t i = 0; i < _occupied.size(); i++) occupied += _occupied[i] ? 1 : 0;
+            snprintf(buf, sizeof(buf), "{\"success\":true,\"data\":{\"total\":%u,\"occupied\":%d}}",
+                     (unsigned)_occupied.size(), occupied);
+            reply.body = buf;
+        } else if (r.method == "GET" && r.path == "/api/slots") {
+            _slotReads++;
+            reply.body = "{\"success\":true,\"data\":[";
+            for (size_t i = 0; i < _occupied.size(); i++) {
+                snprintf(buf, sizeof(buf), "%s{\"id\":\"slot-%u\",\"code\":\"P%u\",\"is_occupied\":%s}",
+                         i ? "," : "", (unsigned)i + 1, (unsigned)i + 1, _occupied[i] ? "true" : "false");
+                reply.body += buf;
+            }
+            reply.body += "]}";
+        } else if (r.method == "PUT" && r.path.compare(0, 16, "/api/slots/slot-") == 0) {
+            size_t slot = (size_t)atoi(r.path.c_str() + 16) - 1;
+            if (slot < _occupied.size()) _occupied[slot] = r.body.find("true") != std::string::npos;
+            reply.body = "{\"success\":true}";
+        } else if (r.method == "POST" && r.path == "/api/sessions/batch") {
+            unsigned long maxSeq = 0;
+            for (size_t pos = r.body.find("\"seq\":"); pos != std::string::npos;
+                 pos = r.body.find("\"seq\":", pos + 6)) {
+                unsigned long seq = strtoul(r.body.c_str() + pos + 6, NULL, 10);
+                maxSeq = std::max(maxSeq, seq);
+                _seqs.push_back((uint32_t)seq);
+                _events++;
+            }
+            maxSeq = std::min(maxSeq, (unsigned long)_ackLimit);
+            _batches++;
+            snprintf(buf, sizeof(buf), "{\"success\":true,\"data\":{\"acked_seq\":%lu}}", maxSeq);
+            reply.body = buf;
+        } else {
+            reply.status = 404;
+            reply.body = "{\"success\":false,\"error\":\"not found\"}";
+        }
+        return reply;
+    }
+
+    std::atomic<uint32_t> _delayMs;
+    std::mutex _mutex;
+    std::vector<bool> _occupied;
+    std::vector<std::string> _paths;
+    std::vector<uint32_t> _seqs;
+    std::atomic<uint32_t> _ackLimit{UINT32_MAX};
+    std::atomic<uint32_t> _events{0};
+    std::atomic<uint32_t> _batches{0};
+    std::atomic<uint32_t> _slotReads{0};
+    HostHttpServer _server;
+};
+
+// ===========================================
+// AI service stand-in
+// ===========================================
+// GET /regions of the AI service, from the repo's parking_regions.json
+// (drawn on 800x600 frames, the service's default region frame)
+static inline std::string regionsReply() {
+    return "{\"success\":true,\"frame\":{\"width\":800,\"height\":600},\"regions\":" +
+           readTextFile(std::string(REPO_DIR) + "/ai-service/parking_regions.json") + "}";
+}
+
+// /regions serves ai-service/parking_regions.json, /analyze answers after
+// delayMs with every slot free. Maps device port 5000 to itself.
+class FakeAiService {
+public:
+    explicit FakeAiService(uint32_t delayMs = 0)
+        : _delayMs(delayMs),
+          _regions(regionsReply()),
+          _server([this](const HostHttpRequest &r) { return handle(r); }) {
+        HostNet::mapPort(5000, _server.port());
+    }
+
+    uint32_t analyzed() const { return _analyzed; }
+    size_t lastImageBytes() const { return _lastImageBytes; }
+    std::string lastQuery() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _lastQuery;
+    }
+    void setDelay(uint32_t ms) { _delayMs = ms; }
+
+private:
+    HostHttpReply handle(const HostHttpRequest &r) {
+        HostHttpReply reply;
+        if (r.path == "/regions") {
+            reply.body = _regions;
+        } else if (r.path == "/analyze") {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _lastQuery = r.query;
+            }
+            _lastImageBytes = r.body.size();
+            _analyzed++;
+            reply.delayMs = _delayMs;
+            reply.body = "{\"success\":true,\"vehicles_detected\":0,\"slot_status\":"
+                         "{\"P1\":false,\"P2\":false,\"P3\":false,\"P4\":false}}";
+        } else {
+            reply.status = 404;
+            reply.body = "{\"success\":false}";
+        }
+        return reply;
+    }
+
+    std::atomic<uint32_t> _delayMs;
+    std::string _regions;
+    std::mutex _mutex;
+    std::string _lastQuery;
+    std::atomic<size_t> _lastImageBytes{0};
+    std::atomic<uint32_t> _analyzed{0};
+    HostHttpServer _server;
+};
+
+// ===========================================
+// Stream viewer
+// ===========================================
+// GET /stream on its own thread; counts multipart frames and bytes.
+// readKbps > 0 throttles reading to emulate a slow link.
+class StreamViewer {
+public:
+    explicit StreamViewer(uint16_t port, uint32_t readKbps = 0)
+        : _frames(0), _bytes(0), _running(true), _fd(-1) {
+        _fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (readKbps > 0) {
+            int rcvbuf = 4096;                        // Keep the kernel from hiding the throttle
+            setsockopt(_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        }
+        timeval tv = { 0, 200000 };
+        setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        if (connect(_fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+            _running = false;
+            return;
+        }
+        static const char request[] = "GET /stream HTTP/1.1\r\nHost: device\r\n\r\n";
+        send(_fd, request, sizeof(request) - 1, MSG_NOSIGNAL);
+        _thread = std::thread([this, readKbps] { run(readKbps); });
+    }
+
+    ~StreamViewer() { close(); }
+
+    void close() {
+        _running = false;
+        if (_thread.joinable()) _thread.join();
+        if (_fd >= 0) ::close(_fd);
+        _fd = -1;
+    }
+
+    uint32_t frames() const { return _frames; }
+    uint64_t bytes() const { return _bytes; }
+
+private:
+    void run(uint32_t readKbps) {
+        static const char boundary[] = "--" MJPEG_PART_BOUNDARY;
+        const size_t boundaryLen = sizeof(boundary) - 1;
+        std::string tail;
+        char buf[2048];
+        size_t chunk = readKbps > 0 ? std::min<size_t>(sizeof(buf), readKbps * 1000 / 8 / 100) : sizeof(buf);
+        if (chunk == 0) chunk = 1;
+        while (_running) {
+            ssize_t n = recv(_fd, buf, chunk, 0);
+            if (n == 0) break;
+            if (n < 0) continue;
+            _bytes += n;
+            tail.append(buf, n);
+            size_t pos;
+            while ((pos = tail.find(boundary)) != std::string::npos) {
+                _frames++;
+                tail.erase(0, pos + boundaryLen);
+            }
+            if (tail.size() > boundaryLen) tail.erase(0, tail.size() - boundaryLen);
+            if (readKbps > 0) usleep((useconds_t)(n * 8 * 1000 / readKbps));
+        }
+    }
+
+    std::atomic<uint32_t> _frames;
+    std::atomic<uint64_t> _bytes;
+    std::atomic<bool> _running;
+    int _fd;
+    std::thread _thread;
+};
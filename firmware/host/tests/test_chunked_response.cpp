@@ -0,0 +1,185 @@
+/*
+ * ChunkedResponse renders a flash template and serializes a /status-sized
+ * JSON document without a single heap allocation on the calling thread,
+ * in RESPONSE_CHUNK_SIZE chunks that decode to the expected body byte for
+ * byte. Then the firmware's own page: fillRootPage() allocates nothing
+ * either, and GET / serves what it fills in.
+ */
+
+#include "HostTest.h"
+#include "ChunkedResponse.h"
+#include <ArduinoJson.h>
+
+// In src/main.cpp
+void fillRootPage(Print &out, const char *name);
+
+// Records what the response writes; capacity reserved up front so that
+// recording does not allocate either
+class CaptureClient : public Client {
+public:
+    CaptureClient() : writes(0) { data.reserve(1 << 16); }
+    int connect(IPAddress, uint16_t) override { return 1; }
+    int connect(const char *, uint16_t) override { return 1; }
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buf, size_t size) override {
+        writes++;
+        data.append((const char *)buf, size);
+        return size;
+    }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int read(uint8_t *, size_t) override { return -1; }
+    int peek() override { return -1; }
+    void flush() override {}
+    void stop() override {}
+    uint8_t connected() override { return 1; }
+    operator bool() override { return true; }
+    using Print::write;
+
+    std::string data;
+    uint32_t writes;
+};
+
+// Splits a captured response into head and decoded body; chunk sizes go
+// to sizes, false if the framing is broken
+static bool decode(const std::string &raw, std::string &head, std::string &body, std::vector<size_t> &sizes) {
+    size_t end = raw.find("\r\n\r\n");
+    if (end == std::string::npos) return false;
+    head = raw.substr(0, end + 4);
+    size_t pos = end + 4;
+    while (true) {
+        size_t eol = raw.find("\r\n", pos);
+        if (eol == std::string::npos) return false;
+        size_t size = strtoul(raw.c_str() + pos, NULL, 16);
+        pos = eol + 2;
+        if (size == 0) return raw.compare(pos, std::string::npos, "\r\n") == 0;
+        if (pos + size + 2 > raw.size() || raw.compare(pos + size, 2, "\r\n") != 0) return false;
+        body.append(raw, pos, size);
+        sizes.push_back(size);
+        pos += size + 2;
+    }
+}
+
+static void fillTest(Print &out, const char *name) {
+    if (strcmp(name, "free") == 0) {
+        out.print(17);
+    } else if (strcmp(name, "gate") == 0) {
+        out.print("CLOSED");
+    }
+}
+
+static void rendersTemplate() {
+    // Over two chunks, placeholders on both sides of a chunk boundary
+    std::string tmpl = "<html>" + std::string(500, 'a') + "{{free}}|{{gate}}" + std::string(600, 'b') +
+                       "{{unknown}}{{free}}</html>";
+    std::string expected = "<html>" + std::string(500, 'a') + "17|CLOSED" + std::string(600, 'b') + "17</html>";
+
+    // The counter does see what the firmware used to do
+    uint64_t before = HostHeap::threadAllocations();
+    String page = "<p>Slot Tersedia: <b>";
+    page += String(17) + "/" + String(20) + "</b></p>";
+    CHECK(HostHeap::threadAllocations() > before);
+
+    CaptureClient client;
+    before = HostHeap::threadAllocations();
+    {
+        ChunkedResponse out(client);
+        out.begin(200, "text/html");
+        out.render(tmpl.c_str(), fillTest);
+        CHECK_EQ(out.end(), expected.size());
+    }
+    CHECK_EQ(HostHeap::threadAllocations() - before, 0);
+
+    std::string head, body;
+    std::vector<size_t> sizes;
+    CHECK(decode(client.data, head, body, sizes));
+    CHECK(head.find("HTTP/1.1 200 OK\r\n") == 0);
+    CHECK(head.find("Content-Type: text/html\r\n") != std::string::npos);
+    CHECK(head.find("Transfer-Encoding: chunked\r\n") != std::string::npos);
+    CHECK(body == expected);
+    CHECK_EQ(sizes.size(), (expected.size() + RESPONSE_CHUNK_SIZE - 1) / RESPONSE_CHUNK_SIZE);
+    for (size_t i = 0; i + 1 < sizes.size(); i++) CHECK_EQ(sizes[i], RESPONSE_CHUNK_SIZE);
+    // Head, one write per chunk, the last chunk
+    CHECK_EQ(client.writes, 1 + sizes.size() + 1);
+}
+
+static void serializesJson() {
+    // Shaped like /status: nested objects, arrays, strings and numbers
+    StaticJsonDocument<2816> doc;
+    doc["device"] = "ESP32-S3-CAM-Full";
+    doc["ip"] = "192.168.1.50";
+    doc["stream_url"] = "http://192.168.1.50/stream";
+    doc["uptime_ms"] = 123456789;
+    JsonObject slots = doc.createNestedObject("slots");
+    slots["available"] = 3;
+    slots["total"] = 4;
+    JsonObject edge = doc.createNestedObject("edge");
+    JsonArray states = edge.createNestedArray("states");
+    for (int i = 0; i < 16; i++) {
+        JsonObject s = states.createNestedObject();
+        s["code"] = "P1";
+        s["state"] = i % 3 - 1;
+        s["confidence"] = 50 + i;
+    }
+    std::string expected;
+    serializeJson(doc, expected);
+    CHECK(expected.size() > RESPONSE_CHUNK_SIZE);
+
+    CaptureClient client;
+    uint64_t before = HostHeap::threadAllocations();
+    {
+        ChunkedResponse out(client);
+        out.begin(200, "application/json");
+        serializeJson(doc, out);
+        CHECK_EQ(out.end(), expected.size());
+    }
+    CHECK_EQ(HostHeap::threadAllocations() - before, 0);
+
+    std::string head, body;
+    std::vector<size_t> sizes;
+    CHECK(decode(client.data, head, body, sizes));
+    CHECK(body == expected);
+    printf("json %u bytes: %u chunks, %u socket writes, 0 allocations\n", (unsigned)body.size(),
+           (unsigned)sizes.size(), (unsigned)client.writes);
+}
+
+static void rendersRootPage() {
+    FakeBackend backend;
+    FakeAiService ai;
+    HostArduino::start();
+
+    CaptureClient client;
+    uint64_t before = HostHeap::threadAllocations();
+    {
+        ChunkedResponse out(client);
+        out.begin(200, "text/html");
+        out.render("{{available}}/{{total}} {{gate}}", fillRootPage);
+        out.end();
+    }
+    CHECK_EQ(HostHeap::threadAllocations() - before, 0);
+    std::string head, filled;
+    std::vector<size_t> sizes;
+    CHECK(decode(client.data, head, filled, sizes));
+
+    HostHttpResult page;
+    CHECK(HostHttpClient::get(HostNet::boundPort(80), "/", page));
+    CHECK_EQ(page.status, 200);
+    CHECK(page.headers["transfer-encoding"] == "chunked");
+    size_t slash = filled.find('/');
+    size_t space = filled.find(' ');
+    std::string counts = filled.substr(0, space);
+    std::string gate = filled.substr(space + 1);
+    CHECK(slash != std::string::npos && space != std::string::npos);
+    CHECK(page.body.find("<b>" + counts + "</b>") != std::string::npos);
+    CHECK(page.body.find("<b>" + gate + "</b>") != std::string::npos);
+    CHECK(page.body.find("{{") == std::string::npos);
+    CHECK(page.body.find("</html>") != std::string::npos);
+}
+
+int main() {
+    HostSerial::mute(getenv("HOST_VERBOSE") == NULL);
+    rendersTemplate();
+    serializesJson();
+    rendersRootPage();
+    HostArduino::exit(hostTestResult("test_chunked_response"));
+}
@@ -0,0 +1,288 @@
+/*
+ * EventJournal on the file-backed LittleFS stand-in: records and the ack
+ * survive a reboot, a torn or corrupt tail and an interrupted compaction
+ * are recovered, a full journal refuses appends, reserve() hands out
+ * numbers that later boots keep counting past, and the epoch stays put
+ * until sequence numbers can start over; a state file of the wrong size
+ * counts as corrupt.
+ *
+ * Then the firmware's delivery on top of it: a backend that acks below
+ * the batch is retried on the EVENT_RETRY_MS backoff, not at once, and
+ * events that could not be journaled still carry a real sequence number.
+ */
+
+#include "HostTest.h"
+#include "EventJournal.h"
+#include <LittleFS.h>
+
+#define LOG_PATH        "/test.log"
+#define STATE_PATH      "/test.state"
+
+static std::string hostFile(const char *path) {
+    return HostFs::root() + path;
+}
+
+static size_t fileSize(const char *path) {
+    return readTextFile(hostFile(path)).size();
+}
+
+static void appendBytes(const char *path, const std::string &bytes) {
+    FILE *f = fopen(hostFile(path).c_str(), "ab");
+    fwrite(bytes.data(), 1, bytes.size(), f);
+    fclose(f);
+}
+
+static uint32_t crc32(const uint8_t *data, size_t len) {
+    uint32_t crc = 0xFFFFFFFF;
+    while (len--) {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+static void survivesReboot() {
+    uint32_t seq = 0;
+    uint32_t epoch = 0;
+    {
+        EventJournal journal(LittleFS, LOG_PATH, STATE_PATH);
+        CHECK_EQ(journal.epoch(), 0);
+        CHECK(journal.begin());
+        CHECK_EQ(journal.boot(), 1);
+        epoch = journal.epoch();
+        CHECK(epoch != 0);
+        for (int i = 0; i < 5; i++) {
+            CHECK(journal.append(i % 2, 1000 + i, seq));
+            CHECK_EQ(seq, i + 1);
+        }
+        CHECK(journal.ack(2));
+        CHECK_EQ(journal.pending(), 3);
+    }
+
+    EventJournal journal(LittleFS, LOG_PATH, STATE_PATH);
+    CHECK(journal.begin());
+    CHECK_EQ(journal.boot(), 2);
+    CHECK_EQ(journal.epoch(), epoch);
+    CHECK_EQ(journal.pending(), 3);
+    JournalRecord records[8];
+    size_t n = journal.peek(records, 8);
+    CHECK_EQ(n, 3);
+    CHECK_EQ(records[0].seq, 3);
+    CHECK_EQ(records[0].type, 0);
+    CHECK_EQ(records[0].boot, 1);
+    CHECK_EQ(records[0].timestampMs, 1002);
+    CHECK_EQ(records[2].seq, 5);
+    CHECK(journal.append(1, 2000, seq));
+    CHECK_EQ(seq, 6);
+    CHECK(journal.ack(6));
+    CHECK_EQ(journal.pending(), 0);
+    CHECK_EQ(journal.peek(records, 8), 0);
+}
+
+static void recoversTornTail() {
+    // Power lost mid-append: half a record at the end
+    appendBytes(LOG_PATH, std::string(sizeof(JournalRecord) / 2, '\x5a'));
+
+    EventJournal journal(LittleFS, LOG_PATH, STATE_PATH);
+    CHECK(journal.begin());
+    CHECK_EQ(journal.stats().recovered, sizeof(JournalRecord) / 2);
+    CHECK_EQ(fileSize(LOG_PATH), 0);              // Compacted: everything was acked
+    uint32_t seq = 0;
+    CHECK(journal.append(0, 1, seq));
+    CHECK_EQ(seq, 7);
+
+    // A whole record with a broken CRC is cut off the same way
+    JournalRecord bad;
+    memset(&bad, 0, sizeof(bad));
+    bad.seq = 8;
+    bad.crc = 0xDEADBEEF;
+    appendBytes(LOG_PATH, std::string((const char *)&bad, sizeof(bad)));
+    EventJournal again(LittleFS, LOG_PATH, STATE_PATH);
+    CHECK(again.begin());
+    CHECK_EQ(again.stats().recovered, sizeof(JournalRecord));
+    CHECK_EQ(again.pending(), 1);
+    JournalRecord rec;
+    CHECK_EQ(again.peek(&rec, 1), 1);
+    CHECK_EQ(rec.seq, 7);
+    CHECK(again.ack(7));
+}
+
+static void recoversInterruptedCompaction() {
+    // Crash between writing the new log and renaming it over the old one
+    appendBytes(LOG_PATH ".tmp", std::string(40, '\x01'));
+    EventJournal journal(LittleFS, LOG_PATH, STATE_PATH);
+    CHECK(journal.begin());
+    CHECK(!LittleFS.exists(LOG_PATH ".tmp"));
+    CHECK_EQ(journal.pending(), 0);
+    uint32_t seq = 0;
+    CHECK(journal.append(1, 5, seq));
+    CHECK_EQ(seq, 8);
+    CHECK(journal.ack(8));
+}
+
+static void compactsAndFills() {
+    LittleFS.remove(LOG_PATH);
+    LittleFS.remove(STATE_PATH);
+    EventJournal journal(LittleFS, LOG_PATH, STATE_PATH);
+    CHECK(journal.begin());
+
+    // Acked records are dropped once the log passes JOURNAL_COMPACT_BYTES
+    uint32_t seq = 0;
+    size_t records = JOURNAL_COMPACT_BYTES / sizeof(JournalRecord);
+    for (size_t i = 0; i < records; i++) {
+        CHECK(journal.append(0, i, seq));
+    }
+    CHECK(journal.ack(seq));
+    CHECK_EQ(journal.stats().compactions, 1);
+    CHECK_EQ(fileSize(LOG_PATH), 0);
+
+    // Nothing acked: the journal stops at JOURNAL_MAX_BYTES and says so
+    size_t max = JOURNAL_MAX_BYTES / sizeof(JournalRecord);
+    size_t appended = 0;
+    while (journal.append(1, 0, seq)) appended++;
+    CHECK_EQ(appended, max);
+    CHECK_EQ(journal.stats().dropped, 1);
+    CHECK_EQ(fileSize(LOG_PATH), JOURNAL_MAX_BYTES);
+
+    // Half delivered: the next append compacts and fits again
+    CHECK(journal.ack(seq - max / 2));
+    CHECK(journal.append(1, 0, seq));
+    CHECK_EQ(fileSize(LOG_PATH), (max / 2 + 1) * sizeof(JournalRecord));
+    CHECK(journal.ack(seq));
+}
+
+static void reservesPastFailedWrites() {
+    LittleFS.remove(LOG_PATH);
+    LittleFS.remove(STATE_PATH);
+    uint32_t seq = 0;
+    {
+        EventJournal journal(LittleFS, LOG_PATH, STATE_PATH);
+        CHECK(journal.begin());
+        CHECK(journal.append(0, 1, seq));
+        CHECK_EQ(journal.reserve(), 0);           // Pending record in front
+        CHECK(journal.ack(seq));
+
+        HostFs::failWrites(true);
+        CHECK(!journal.append(0, 2, seq));
+        HostFs::failWrites(false);
+        uint32_t reserved = journal.reserve();
+        CHECK_EQ(reserved, 2);
+        CHECK_EQ(journal.pending(), 1);
+        journal.ack(reserved);
+        CHECK_EQ(journal.pending(), 0);
+    }
+
+    // The gap before the next record is not mistaken for a torn log
+    EventJournal journal(LittleFS, LOG_PATH, STATE_PATH);
+    CHECK(journal.begin());
+    CHECK(journal.append(0, 3, seq));
+    CHECK_EQ(seq, 3);
+    EventJournal again(LittleFS, LOG_PATH, STATE_PATH);
+    CHECK(again.begin());
+    CHECK_EQ(again.stats().recovered, 0);
+    CHECK_EQ(again.pending(), 1);
+    JournalRecord rec;
+    CHECK_EQ(again.peek(&rec, 1), 1);
+    CHECK_EQ(rec.seq, 3);
+    CHECK(again.ack(3));
+}
+
+static void keepsEpochUntilRestart() {
+    uint32_t epoch;
+    {
+        EventJournal journal(LittleFS, LOG_PATH, STATE_PATH);
+        CHECK(journal.begin());
+        epoch = journal.epoch();
+    }
+
+    // State file of another size, even with a valid CRC (the layout from
+    // before epochs): corrupt, so ack and boot start over under a new epoch
+    struct { uint32_t ackedSeq; uint16_t boot; uint16_t reserved; uint32_t crc; } shortState = { 3, 7, 0, 0 };
+    shortState.crc = crc32((const uint8_t *)&shortState, 8);
+    LittleFS.remove(STATE_PATH);
+    appendBytes(STATE_PATH, std::string((const char *)&shortState, sizeof(shortState)));
+    {
+        EventJournal journal(LittleFS, LOG_PATH, STATE_PATH);
+        CHECK(journal.begin());
+        CHECK_EQ(journal.boot(), 1);
+        CHECK(journal.epoch() != 0 && journal.epoch() != epoch);
+        epoch = journal.epoch();
+    }
+    {
+        EventJournal journal(LittleFS, LOG_PATH, STATE_PATH);
+        CHECK(journal.begin());
+        CHECK_EQ(journal.epoch(), epoch);         // Rewritten at full size
+    }
+
+    // Journal wiped: numbers restart at 1 under a new epoch
+    LittleFS.remove(LOG_PATH);
+    LittleFS.remove(STATE_PATH);
+    EventJournal journal(LittleFS, LOG_PATH, STATE_PATH);
+    CHECK(journal.begin());
+    CHECK(journal.epoch() != 0 && journal.epoch() != epoch);
+
+    // No journal at all: reserve() draws one for this boot
+    EventJournal none(LittleFS, "/none.log", "/none.state");
+    CHECK_EQ(none.reserve(), 1);
+    CHECK(none.epoch() != 0);
+    none.ack(1);
+    CHECK_EQ(none.reserve(), 2);
+}
+
+// One car at the entry sensor once the gate is closed, then the sensor clears
+static void carAtEntry() {
+    CHECK(waitFor([] { return HostServo::angle() == 0; }, 8000));
+    HostGpio::setDistance(1, 3.0f);
+    CHECK(waitFor([] { return HostServo::angle() == 90; }, 2000));
+    HostGpio::setDistance(1, 0);
+    delay(1500);                                  // Past SENSOR_CLEAR_MS
+}
+
+static void deliversThroughFirmware(FakeBackend &backend) {
+    HostArduino::start();
+
+    // Acked below the batch: nothing taken, wait EVENT_RETRY_MS to resend
+    backend.setAckLimit(0);
+    carAtEntry();
+    CHECK(waitFor([&] { return backend.batches() >= 1; }, 3000));
+    delay(3000);
+    CHECK_EQ(backend.batches(), 1);
+    backend.setAckLimit(UINT32_MAX);
+    CHECK(waitFor([&] { return backend.batches() >= 2; }, 4000));
+    std::vector<uint32_t> seqs = backend.seqs();
+    CHECK_EQ(seqs.size(), 2);
+    CHECK(seqs.size() == 2 && seqs[0] == seqs[1] && seqs[0] > 0);
+
+    // Flash refuses writes: the event is sent directly, with the next number
+    HostFs::failWrites(true);
+    carAtEntry();
+    CHECK(waitFor([&] { return backend.events() >= 3; }, 3000));
+    carAtEntry();
+    CHECK(waitFor([&] { return backend.events() >= 4; }, 3000));
+    HostFs::failWrites(false);
+    seqs = backend.seqs();
+    CHECK_EQ(seqs.size(), 4);
+    if (seqs.size() == 4) {
+        CHECK_EQ(seqs[2], seqs[1] + 1);
+        CHECK_EQ(seqs[3], seqs[2] + 1);
+    }
+}
+
+int main() {
+    HostSerial::mute(getenv("HOST_VERBOSE") == NULL);
+    CHECK(LittleFS.begin(true));
+    survivesReboot();
+    recoversTornTail();
+    recoversInterruptedCompaction();
+    compactsAndFills();
+    reservesPastFailedWrites();
+    keepsEpochUntilRestart();
+
+    FakeBackend backend;
+    FakeAiService ai;
+    HostGpio::attachEcho(1, 2);
+    HostGpio::attachEcho(42, 41);
+    deliversThroughFirmware(backend);
+
+    HostArduino::exit(hostTestResult("test_event_journal"));
+}
@@ -0,0 +1,73 @@
+/*
+ * Full firmware (src/main.cpp) against the stand-in backend and AI
+ * service: boots, opens the gate for a car at the entry sensor, journals
+ * and delivers the entry event, serves /status and /capture (and refuses a
+ * malformed max_age).
+ */
+
+#include "HostTest.h"
+
+int main() {
+    HostSerial::mute(getenv("HOST_VERBOSE") == NULL);
+    FakeBackend backend;
+    FakeAiService ai;
+    HostGpio::attachEcho(1, 2);                   // US1: entry
+    HostGpio::attachEcho(42, 41);                 // US2: exit
+
+    HostArduino::start();
+    CHECK(HostArduino::started());
+    CHECK_EQ(HostServo::angle(), 0);
+    CHECK(waitFor([] { return HostLcd::line(0).size() > 0; }, 2000));
+
+    // Car at the entry sensor: gate opens, the event reaches the backend
+    HostGpio::setDistance(1, 3.0f);
+    CHECK(waitFor([] { return HostServo::angle() == 90; }, 2000));
+    HostGpio::setDistance(1, 0);
+    CHECK(waitFor([&] { return backend.events() >= 1; }, 3000));
+
+    uint16_t port = HostNet::boundPort(80);
+    HostHttpResult status;
+    CHECK(HostHttpClient::get(port, "/status", status));
+    CHECK_EQ(status.status, 200);
+    CHECK(status.body.find("\"device\"") != std::string::npos);
+
+    HostHttpResult capture;
+    CHECK(HostHttpClient::get(port, "/capture", capture));
+    CHECK_EQ(capture.status, 200);
+    CHECK(capture.body.size() > 2 && (uint8_t)capture.body[0] == 0xFF && (uint8_t)capture.body[1] == 0xD8);
+
+    // Same frame: 304. A tag from an earlier boot with the same sequence
+    // number is a different frame
+    std::string etag = capture.headers["etag"];
+    size_t dash = etag.find('-');
+    CHECK(etag.size() > 2 && dash != std::string::npos);
+    std::map<std::string, std::string> conditional;
+    conditional["If-None-Match"] = etag;
+    HostHttpResult same;
+    CHECK(HostHttpClient::request(port, "GET", "/capture?max_age=60000", same, "", conditional));
+    CHECK_EQ(same.status, 304);
+    std::string otherBoot = etag;
+    otherBoot[1] = otherBoot[1] == '0' ? '1' : '0';
+    conditional["If-None-Match"] = otherBoot;
+    HostHttpResult beforeReboot;
+    CHECK(HostHttpClient::request(port, "GET", "/capture?max_age=60000", beforeReboot, "", conditional));
+    CHECK_EQ(beforeReboot.status, 200);
+
+    // max_age is milliseconds; anything else is refused, not read as 0 or 49 days
+    const char *badAges[] = { "-5", "abc", "10x", "", "99999999999" };
+    for (size_t i = 0; i < sizeof(badAges) / sizeof(badAges[0]); i++) {
+        HostHttpResult bad;
+        std::string target = std::string("/capture?max_age=") + badAges[i];
+        CHECK(HostHttpClient::get(port, target.c_str(), bad));
+        CHECK_EQ(bad.status, 400);
+    }
+    HostHttpResult fresh;
+    CHECK(HostHttpClient::get(port, "/capture?max_age=0", fresh));
+    CHECK_EQ(fresh.status, 200);
+    CHECK(atoi(fresh.headers["x-frame-age-ms"].c_str()) < 100);     // Grabbed for this request
+
+    // Gate closes again after GATE_OPEN_DURATION_MS
+    CHECK(waitFor([] { return HostServo::angle() == 0; }, 8000));
+
+    HostArduino::exit(hostTestResult("test_firmware_smoke"));
+}
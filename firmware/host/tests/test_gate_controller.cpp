@@ -0,0 +1,190 @@
+/*
+ * GateController on a virtual clock, fed like the sensor task feeds it:
+ * each sensor is sampled every other ping slot while a vehicle is in
+ * front of it. Back-to-back arrivals are each served once, an exit car
+ * that pulls up during the entry cooldown is released when it ends, a car
+ * turned away at a full lot is admitted once a slot frees, and a minute
+ * of traffic prints how many vehicles the gate serves.
+ */
+
+#include "HostTest.h"
+#include "GateController.h"
+
+// As in src/main.cpp
+#define GATE_OPEN_DURATION_MS   5000
+#define GATE_MESSAGE_MS         3000
+#define SENSOR_COOLDOWN_MS      5000
+#define SENSOR_POLL_MS          10
+#define SENSOR_PING_SLOT_MS     30
+#define SENSOR_CLEAR_MS         1000
+
+#define SAMPLE_MS               (2 * SENSOR_PING_SLOT_MS)   // Per sensor
+
+// A vehicle in front of one sensor from arriveMs until leaveMs
+struct Visit {
+    GateSide side;
+    uint32_t arriveMs;
+    uint32_t leaveMs;
+};
+
+struct Served {
+    GateDecision decision;
+    uint32_t atMs;
+};
+
+// Runs the controller over the visits until endMs; freeFromMs: the lot has
+// a free slot from then on. Gate cycles count the closes update() reports.
+class GateRun {
+public:
+    GateRun() : gate(timings()), cycles(0) {}
+
+    static GateTimings timings() {
+        GateTimings t = { GATE_OPEN_DURATION_MS, GATE_MESSAGE_MS, SENSOR_COOLDOWN_MS, SENSOR_CLEAR_MS };
+        return t;
+    }
+
+    void run(const std::vector<Visit> &visits, uint32_t endMs, uint32_t freeFromMs = 0) {
+        for (uint32_t now = 0; now < endMs; now += SENSOR_POLL_MS) {
+            if (gate.update(now) & GATE_ACTION_CLOSE) cycles++;
+            for (int side = 0; side < 2; side++) {
+                // Entry pinged in even slots, exit in odd ones
+                if (now % SAMPLE_MS != (uint32_t)side * SENSOR_PING_SLOT_MS) continue;
+                for (size_t i = 0; i < visits.size(); i++) {
+                    const Visit &v = visits[i];
+                    if (v.side != side || now < v.arriveMs || now >= v.leaveMs) continue;
+                    GateDecision d = gate.onVehicle(v.side, now >= freeFromMs, now);
+                    if (d != GATE_IGNORED) {
+                        Served s = { d, now };
+                        served.push_back(s);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    uint32_t count(GateDecision d) const {
+        uint32_t n = 0;
+        for (size_t i = 0; i < served.size(); i++) {
+            if (served[i].decision == d) n++;
+        }
+        return n;
+    }
+
+    GateController gate;
+    std::vector<Served> served;
+    uint32_t cycles;
+};
+
+static void arrivalBurst() {
+    // Five cars queued at the entry, each 2 s at the sensor with a 1.5 s gap
+    std::vector<Visit> visits;
+    for (int i = 0; i < 5; i++) {
+        Visit v = { GATE_SIDE_ENTRY, 1000 + (uint32_t)i * 3500, 3000 + (uint32_t)i * 3500 };
+        visits.push_back(v);
+    }
+    GateRun r;
+    r.run(visits, 30000);
+    CHECK_EQ(r.served.size(), 5);
+    CHECK_EQ(r.count(GATE_ADMIT), 5);
+    for (size_t i = 0; i < r.served.size(); i++) {
+        CHECK(r.served[i].atMs - visits[i].arriveMs < SAMPLE_MS);
+    }
+    // Each car extends the open time; the gate closes once after the last
+    CHECK_EQ(r.cycles, 1);
+    CHECK(r.gate.counters().ignored > 0);
+
+    // A gap shorter than SENSOR_CLEAR_MS reads as the same car
+    std::vector<Visit> close;
+    Visit a = { GATE_SIDE_ENTRY, 1000, 3000 };
+    Visit b = { GATE_SIDE_ENTRY, 3500, 5500 };
+    close.push_back(a);
+    close.push_back(b);
+    GateRun r2;
+    r2.run(close, 10000);
+    CHECK_EQ(r2.count(GATE_ADMIT), 1);
+}
+
+static void exitDuringCooldown() {
+    // Admitted at 1 s; an exit car pulls up at 2 s and waits
+    std::vector<Visit> visits;
+    Visit entry = { GATE_SIDE_ENTRY, 1000, 2500 };
+    Visit exit = { GATE_SIDE_EXIT, 2000, 20000 };
+    visits.push_back(entry);
+    visits.push_back(exit);
+    GateRun r;
+    r.run(visits, 25000);
+    CHECK_EQ(r.count(GATE_ADMIT), 1);
+    CHECK_EQ(r.count(GATE_RELEASE), 1);
+    if (r.served.size() == 2) {
+        uint32_t cooldownEnd = r.served[0].atMs + SENSOR_COOLDOWN_MS;
+        CHECK(r.served[1].atMs >= cooldownEnd && r.served[1].atMs - cooldownEnd < SAMPLE_MS);
+    }
+}
+
+static void fullThenFree() {
+    // Waits at the entry from 1 s; a slot frees at 4 s
+    std::vector<Visit> visits;
+    Visit entry = { GATE_SIDE_ENTRY, 1000, 9000 };
+    visits.push_back(entry);
+    GateRun r;
+    r.run(visits, 12000, 4000);
+    CHECK_EQ(r.served.size(), 2);
+    CHECK_EQ(r.count(GATE_REJECT_FULL), 1);
+    CHECK_EQ(r.count(GATE_ADMIT), 1);
+    if (r.served.size() == 2) {
+        CHECK(r.served[1].atMs >= 4000 && r.served[1].atMs - 4000 < SAMPLE_MS);
+    }
+
+    // Still full: turned away once, however long it waits
+    GateRun r2;
+    r2.run(visits, 12000, UINT32_MAX);
+    CHECK_EQ(r2.served.size(), 1);
+    CHECK_EQ(r2.count(GATE_REJECT_FULL), 1);
+}
+
+static void throughput() {
+    // One minute: a car every 6 s, 2 s at the entry sensor, then 2 s at
+    // the exit sensor as it drives through
+    std::vector<Visit> visits;
+    for (uint32_t t = 0; t < 60000; t += 6000) {
+        Visit entry = { GATE_SIDE_ENTRY, t, t + 2000 };
+        Visit exit = { GATE_SIDE_EXIT, t + 3000, t + 5000 };
+        visits.push_back(entry);
+        visits.push_back(exit);
+    }
+    GateRun r;
+    r.run(visits, 60000);
+    uint32_t admitted = r.count(GATE_ADMIT), released = r.count(GATE_RELEASE);
+    printf("a car every 6 s: %u admitted, %u released per minute, %u gate cycles\n", (unsigned)admitted,
+           (unsigned)released, (unsigned)r.cycles);
+    CHECK_EQ(admitted, 10);
+    // Driving through inside the cooldown is not an exit
+    CHECK_EQ(released, 0);
+
+    // An entry and an exit car right behind it, waiting out the cooldown
+    visits.clear();
+    for (uint32_t t = 0; t < 60000; t += 12000) {
+        Visit entry = { GATE_SIDE_ENTRY, t, t + 2000 };
+        Visit exit = { GATE_SIDE_EXIT, t + 3000, t + 7000 };
+        visits.push_back(entry);
+        visits.push_back(exit);
+    }
+    GateRun r2;
+    r2.run(visits, 60000);
+    admitted = r2.count(GATE_ADMIT);
+    released = r2.count(GATE_RELEASE);
+    printf("entry and waiting exit every 12 s: %u admitted, %u released per minute, %u gate cycles\n",
+           (unsigned)admitted, (unsigned)released, (unsigned)r2.cycles);
+    CHECK_EQ(admitted, 5);
+    CHECK_EQ(released, 5);
+}
+
+int main() {
+    HostSerial::mute(getenv("HOST_VERBOSE") == NULL);
+    arrivalBurst();
+    exitDuringCooldown();
+    fullThenFree();
+    throughput();
+    return hostTestResult("test_gate_controller");
+}
@@ -0,0 +1,268 @@
+/*
+ * HttpEndpoint against a stand-in keep-alive server over loopback: one
+ * socket carries many requests, a socket the server dropped while idle is
+ * replaced without failing the request, chunked bodies are decoded without
+ * giving up the connection, pipelined responses come back in order, and
+ * stats() reports the latency the server adds.
+ */
+
+#include "HostTest.h"
+#include "HttpEndpoint.h"
+
+#define REQUESTS            50
+#define SERVER_DELAY_MS     30
+
+static std::string baseUrl(uint16_t port) {
+    return "http://127.0.0.1:" + std::to_string(port);
+}
+
+// Answers every request with keep-alive, then hangs up without a word:
+// the next request on that socket finds it closed
+class IdleDropServer {
+public:
+    IdleDropServer() : _running(true), _accepted(0) {
+        _fd = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(_fd, (struct sockaddr *)&addr, sizeof(addr));
+        listen(_fd, 4);
+        socklen_t len = sizeof(addr);
+        getsockname(_fd, (struct sockaddr *)&addr, &len);
+        _port = ntohs(addr.sin_port);
+        _thread = std::thread([this] { serve(); });
+    }
+    ~IdleDropServer() {
+        _running = false;
+        shutdown(_fd, SHUT_RDWR);
+        ::close(_fd);
+        _thread.join();
+    }
+    uint16_t port() const { return _port; }
+    uint32_t accepted() const { return _accepted; }
+
+private:
+    void serve() {
+        while (_running) {
+            int c = accept(_fd, NULL, NULL);
+            if (c < 0) break;
+            _accepted++;
+            std::string req;
+            char buf[512];
+            while (req.find("\r\n\r\n") == std::string::npos) {
+                ssize_t n = recv(c, buf, sizeof(buf), 0);
+                if (n <= 0) break;
+                req.append(buf, n);
+            }
+            static const char reply[] =
+                "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 2\r\n"
+                "Connection: keep-alive\r\n\r\nok";
+            send(c, reply, sizeof(reply) - 1, MSG_NOSIGNAL);
+            usleep(20000);
+            ::close(c);
+        }
+    }
+
+    int _fd;
+    uint16_t _port;
+    std::atomic<bool> _running;
+    std::atomic<uint32_t> _accepted;
+    std::thread _thread;
+};
+
+static void reusesOneSocket() {
+    HostHttpServer server([](const HostHttpRequest &r) {
+        HostHttpReply reply;
+        reply.body = "{\"path\":\"" + r.path + "\"}";
+        return reply;
+    });
+    std::string url = baseUrl(server.port());
+    HttpEndpoint ep("test", url.c_str());
+    CHECK(ep.valid());
+
+    uint64_t start = HostClock::nowUs();
+    for (int i = 0; i < REQUESTS; i++) {
+        HttpResponse resp;
+        CHECK_EQ(ep.get("/api/slots", resp, 2000), 200);
+        CHECK(resp.keepAlive);
+        CHECK(resp.body == "{\"path\":\"/api/slots\"}");
+    }
+    uint64_t keepAliveUs = HostClock::nowUs() - start;
+    CHECK_EQ(ep.stats().requests, REQUESTS);
+    CHECK_EQ(ep.stats().connects, 1);
+    CHECK_EQ(ep.stats().failures, 0);
+    CHECK_EQ(server.connections(), 1);
+
+    // Same requests with a handshake each, as before the pool
+    start = HostClock::nowUs();
+    for (int i = 0; i < REQUESTS; i++) {
+        HostHttpResult res;
+        CHECK(HostHttpClient::get(server.port(), "/api/slots", res));
+    }
+    uint64_t closeUs = HostClock::nowUs() - start;
+    // Loopback handshakes are nearly free; on the LAN each one is a round trip
+    printf("%d requests: keep-alive %.1f ms over 1 connection, %.1f ms over %d\n",
+           REQUESTS, keepAliveUs / 1000.0, closeUs / 1000.0, REQUESTS);
+}
+
+static void reconnectsAfterClose() {
+    std::atomic<int> n(0);
+    HostHttpServer server([&](const HostHttpRequest &r) {
+        (void)r;
+        HostHttpReply reply;
+        reply.close = ++n == 2;                 // Second reply ends the connection
+        reply.body = "{}";
+        return reply;
+    });
+    std::string url = baseUrl(server.port());
+    HttpEndpoint ep("test", url.c_str());
+
+    for (int i = 0; i < 4; i++) {
+        HttpResponse resp;
+        CHECK_EQ(ep.get("/x", resp, 2000), 200);
+        CHECK(resp.keepAlive == (i != 1));
+    }
+    CHECK_EQ(ep.stats().connects, 2);
+    CHECK_EQ(server.connections(), 2);
+    CHECK_EQ(ep.stats().failures, 0);
+}
+
+static void retriesStaleSocket() {
+    IdleDropServer server;
+    std::string url = baseUrl(server.port());
+    HttpEndpoint ep("test", url.c_str());
+
+    for (int i = 0; i < 3; i++) {
+        HttpResponse resp;
+        CHECK_EQ(ep.get("/x", resp, 2000), 200);
+        CHECK(resp.body == "ok");
+        usleep(60000);                          // Server hangs up meanwhile
+    }
+    // Every request after the first found a dead socket and went out again
+    CHECK_EQ(ep.stats().connects, 3);
+    CHECK_EQ(server.accepted(), 3);
+}
+
+static void decodesChunked() {
+    // Larger than one 512-byte chunk, like /api/slots on a full lot
+    std::string body = "[";
+    for (int i = 0; i < 40; i++) {
+        if (i) body += ",";
+        body += "{\"slot_code\":\"A" + std::to_string(i) + "\",\"is_occupied\":" + (i % 3 ? "true" : "false") + "}";
+    }
+    body += "]";
+    HostHttpServer server([&](const HostHttpRequest &r) {
+        (void)r;
+        HostHttpReply reply;
+        reply.chunked = true;
+        reply.body = body;
+        return reply;
+    });
+    std::string url = baseUrl(server.port());
+    HttpEndpoint ep("test", url.c_str());
+
+    uint64_t start = HostClock::nowUs();
+    for (int i = 0; i < 3; i++) {
+        HttpResponse resp;
+        CHECK_EQ(ep.get("/api/slots", resp, 2000), 200);
+        CHECK(resp.chunked);
+        CHECK(resp.keepAlive);
+        CHECK(resp.body == body.c_str());
+    }
+    // Ends at the last chunk, not at the read deadline
+    CHECK(HostClock::nowUs() - start < 1000000);
+    CHECK_EQ(ep.stats().connects, 1);
+    CHECK_EQ(server.connections(), 1);
+
+    // Cut to maxBody, still framed correctly for the next request
+    WiFiClient client;
+    CHECK(client.connect("127.0.0.1", server.port()));
+    for (int i = 0; i < 2; i++) {
+        client.print("GET /api/slots HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n");
+        HttpResponse resp;
+        CHECK_EQ(readHttpResponse(client, resp, 2000, 100), 200);
+        CHECK_EQ(resp.body.length(), 100);
+        CHECK(resp.keepAlive);
+    }
+    client.stop();
+}
+
+static void pipelines() {
+    HostHttpServer server([](const HostHttpRequest &r) {
+        HostHttpReply reply;
+        reply.body = r.path + ":" + r.body;
+        reply.contentType = "text/plain";
+        return reply;
+    });
+    std::string url = baseUrl(server.port());
+    HttpEndpoint ep("test", url.c_str());
+
+    for (int i = 0; i < HTTP_MAX_PIPELINE; i++) {
+        std::string path = "/e" + std::to_string(i);
+        std::string body = std::to_string(i * 7);
+        CHECK(ep.send("POST", path.c_str(), "text/plain", (const uint8_t *)body.data(), body.size()));
+    }
+    CHECK_EQ(ep.inFlight(), HTTP_MAX_PIPELINE);
+    CHECK(!ep.send("GET", "/full", NULL, NULL, 0));
+
+    // No synchronous call while responses are outstanding
+    HttpResponse sync;
+    CHECK_EQ(ep.get("/x", sync, 1000), HTTP_ERR_SEND);
+
+    for (int i = 0; i < HTTP_MAX_PIPELINE; i++) {
+        HttpResponse resp;
+        CHECK_EQ(ep.receive(resp, 2000), 200);
+        CHECK(resp.body == ("/e" + std::to_string(i) + ":" + std::to_string(i * 7)).c_str());
+    }
+    CHECK_EQ(ep.inFlight(), 0);
+    HttpResponse none;
+    CHECK_EQ(ep.receive(none, 100), HTTP_ERR_PROTOCOL);
+    CHECK_EQ(server.connections(), 1);
+    CHECK_EQ(ep.stats().connects, 1);
+}
+
+static void measuresLatency() {
+    HostHttpServer server([](const HostHttpRequest &r) {
+        (void)r;
+        HostHttpReply reply;
+        reply.delayMs = SERVER_DELAY_MS;
+        reply.body = "{}";
+        return reply;
+    });
+    std::string url = baseUrl(server.port());
+    HttpEndpoint ep("test", url.c_str());
+
+    for (int i = 0; i < 5; i++) {
+        HttpResponse resp;
+        CHECK_EQ(ep.get("/slow", resp, 2000), 200);
+    }
+    const HttpEndpointStats &s = ep.stats();
+    CHECK(s.lastLatencyUs >= SERVER_DELAY_MS * 1000);
+    CHECK(s.maxLatencyUs >= s.lastLatencyUs);
+    CHECK(s.avgLatencyUs >= SERVER_DELAY_MS * 1000 && s.avgLatencyUs <= s.maxLatencyUs);
+    printf("latency: last %u us, avg %u us, max %u us\n",
+           (unsigned)s.lastLatencyUs, (unsigned)s.avgLatencyUs, (unsigned)s.maxLatencyUs);
+
+    // Nobody listening: connect error, counted as a failure
+    uint16_t port = server.port();
+    server.stop();
+    HttpEndpoint gone("gone", baseUrl(port).c_str());
+    HttpResponse resp;
+    CHECK_EQ(gone.get("/x", resp, 500), HTTP_ERR_CONNECT);
+    CHECK_EQ(gone.stats().failures, 1);
+}
+
+int main() {
+    HostSerial::mute(getenv("HOST_VERBOSE") == NULL);
+    WiFi.begin("lot", "secret");
+    reusesOneSocket();
+    reconnectsAfterClose();
+    retriesStaleSocket();
+    decodesChunked();
+    pipelines();
+    measuresLatency();
+    return hostTestResult("test_http_endpoint");
+}
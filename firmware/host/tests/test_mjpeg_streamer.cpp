@@ -0,0 +1,156 @@
+/*
+ * MjpegStreamer over loopback with recorded frames: every viewer gets
+ * whole, unmodified JPEGs; a slow viewer drops frames on its own and does
+ * not hold back the fast ones; gone viewers are dropped and their frames
+ * returned to the camera.
+ */
+
+#include "HostTest.h"
+#include "FrameBus.h"
+#include "MjpegStreamer.h"
+
+#define STREAM_PORT             81
+#define FRAME_INTERVAL_MS       50        // 20 frames/s cap
+#define RUN_SECONDS             3
+
+static std::vector<std::vector<uint8_t> > recorded;
+
+// The stream task: accepts viewers and pumps frames until told to stop
+struct StreamTask {
+    StreamTask(WiFiServer &s, MjpegStreamer &m) : server(s), streamer(m), running(true) {
+        thread = std::thread([this] {
+            while (running) {
+                WiFiClient client = server.accept();
+                if (client) {
+                    streamer.addClient(client);
+                }
+                streamer.loop();
+                delay(2);
+            }
+        });
+    }
+    ~StreamTask() { stop(); }
+    void stop() {
+        running = false;
+        if (thread.joinable()) thread.join();
+    }
+
+    WiFiServer &server;
+    MjpegStreamer &streamer;
+    std::atomic<bool> running;
+    std::thread thread;
+};
+
+// Reads the response head and the first part; true if its body is one
+// of the recorded frames, byte for byte
+static bool firstPartIsRecorded(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    timeval tv = { 2, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return false;
+    }
+    static const char request[] = "GET /stream HTTP/1.1\r\n\r\n";
+    send(fd, request, sizeof(request) - 1, MSG_NOSIGNAL);
+
+    std::string data;
+    char buf[4096];
+    size_t bodyAt = std::string::npos;
+    size_t length = 0;
+    while (true) {
+        size_t part = data.find("Content-Type: image/jpeg");
+        if (part != std::string::npos && bodyAt == std::string::npos) {
+            size_t lenAt = data.find("Content-Length: ", part);
+            size_t end = data.find("\r\n\r\n", part);
+            if (lenAt != std::string::npos && end != std::string::npos) {
+                length = strtoul(data.c_str() + lenAt + 16, NULL, 10);
+                bodyAt = end + 4;
+            }
+        }
+        if (bodyAt != std::string::npos && data.size() >= bodyAt + length) break;
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            close(fd);
+            return false;
+        }
+        data.append(buf, n);
+    }
+    close(fd);
+    std::vector<uint8_t> body(data.begin() + bodyAt, data.begin() + bodyAt + length);
+    for (size_t i = 0; i < recorded.size(); i++) {
+        if (recorded[i] == body) return true;
+    }
+    return false;
+}
+
+int main() {
+    HostSerial::mute(getenv("HOST_VERBOSE") == NULL);
+    for (int i = 0; i < 5; i++) {
+        recorded.push_back(sceneFrame(640, 480, i));
+        HostCamera::addFrame(recorded.back());
+    }
+    camera_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.pixel_format = PIXFORMAT_JPEG;
+    config.frame_size = FRAMESIZE_VGA;
+    config.fb_count = FRAME_BUS_SLOTS;
+    config.grab_mode = CAMERA_GRAB_LATEST;
+    CHECK(esp_camera_init(&config) == ESP_OK);
+
+    FrameBus bus;
+    MjpegStreamer streamer(bus, FRAME_INTERVAL_MS);
+    HostNet::mapPort(STREAM_PORT, 0);
+    WiFiServer server(STREAM_PORT);
+    server.begin();
+    uint16_t port = HostNet::boundPort(STREAM_PORT);
+
+    // Two fast viewers and one on a ~400 kbit/s link
+    StreamTask *task = new StreamTask(server, streamer);
+    CHECK(firstPartIsRecorded(port));
+    StreamViewer fast1(port);
+    StreamViewer fast2(port);
+    StreamViewer slow(port, 400);
+    sleep(RUN_SECONDS);
+    task->stop();
+    delete task;
+
+    double fps1 = fast1.frames() / (double)RUN_SECONDS;
+    double fps2 = fast2.frames() / (double)RUN_SECONDS;
+    double fpsSlow = slow.frames() / (double)RUN_SECONDS;
+    printf("fast %.1f / %.1f frames/s, slow %.1f frames/s\n", fps1, fps2, fpsSlow);
+    CHECK(fps1 >= 15 && fps2 >= 15);
+    CHECK(fpsSlow < fps1 / 2);
+
+    // Per-client stats: the slow client fell behind by dropping frames
+    CHECK_EQ(streamer.clientCount(), 3);
+    uint32_t maxDropped = 0;
+    size_t maxBacklog = 0;
+    for (size_t i = 0; i < streamer.clientCount(); i++) {
+        MjpegClientStats st;
+        CHECK(streamer.clientStats(i, st));
+        maxDropped = std::max(maxDropped, st.framesDropped);
+        maxBacklog = std::max(maxBacklog, st.backlog);
+    }
+    CHECK(maxDropped > 0);
+    CHECK(maxBacklog > 0);
+    CHECK(streamer.framesCaptured() >= (uint32_t)(fps1 * RUN_SECONDS));
+
+    // Viewers hang up: all dropped, frames back with the bus
+    fast1.close();
+    fast2.close();
+    slow.close();
+    task = new StreamTask(server, streamer);
+    waitFor([&] { return HostCamera::held() <= 1; }, 2000);
+    task->stop();
+    delete task;
+    CHECK_EQ(streamer.clientCount(), 0);
+    CHECK(HostCamera::held() <= 1);                // The bus keeps the newest frame
+
+    return hostTestResult("test_mjpeg_streamer");
+}
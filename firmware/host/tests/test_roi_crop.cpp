@@ -0,0 +1,133 @@
+/*
+ * RoiCrop and the slot bounds it crops to: align() snaps any box outwards
+ * to the MCU grid and only clips the margin, the bundled regions (drawn on
+ * 800x600 frames) land inside every stream frame size, and the cropped
+ * JPEG holds the source pixels at the offset sent to the AI service.
+ * Prints how much of each frame size the bundled slots let the crop save.
+ */
+
+#include "HostTest.h"
+#include "RoiCrop.h"
+#include "SlotClassifier.h"
+
+#define MARGIN          16
+#define MIN_PSNR_DB     30.0
+
+static bool covers(const RoiRect &roi, int x0, int y0, int x1, int y1, uint16_t w, uint16_t h) {
+    return roi.x <= std::max(x0, 0) && roi.y <= std::max(y0, 0) &&
+           roi.x + roi.w >= std::min(x1, (int)w) && roi.y + roi.h >= std::min(y1, (int)h);
+}
+
+static void alignsToBlocks() {
+    struct Case { int x0, y0, x1, y1; bool whole; } cases[] = {
+        { 100, 60, 300, 200, false },       // Inside
+        { 0, 0, 640, 480, true },           // Whole frame
+        { 600, 440, 700, 520, false },      // Margin and box past the corner
+        { 320, 240, 321, 241, false },      // One pixel
+        { 300, 200, 100, 60, true },        // Inverted
+        { 700, 500, 900, 700, true },       // Misses the frame
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const Case &c = cases[i];
+        RoiRect roi = RoiCrop::align(c.x0, c.y0, c.x1, c.y1, 640, 480, MARGIN);
+        CHECK(roi.x + roi.w <= 640 && roi.y + roi.h <= 480);
+        CHECK_EQ(roi.x % ROI_MCU_SIZE, 0);
+        CHECK_EQ(roi.y % ROI_MCU_SIZE, 0);
+        CHECK(roi.w % ROI_MCU_SIZE == 0 || roi.x + roi.w == 640);
+        CHECK(roi.h % ROI_MCU_SIZE == 0 || roi.y + roi.h == 480);
+        if (c.whole) {
+            CHECK(roi.x == 0 && roi.y == 0 && roi.w == 640 && roi.h == 480);
+        } else {
+            CHECK(covers(roi, c.x0 - MARGIN, c.y0 - MARGIN, c.x1 + MARGIN, c.y1 + MARGIN, 640, 480));
+        }
+    }
+}
+
+static void scalesRegions() {
+    std::string regions = regionsReply();
+    SlotClassifier slots;
+    CHECK(slots.loadRegions(regions.c_str(), regions.size()));
+    CHECK_EQ(slots.regionFrameWidth(), 800);
+    CHECK_EQ(slots.regionFrameHeight(), 600);
+    CHECK_EQ(slots.clippedPoints(), 2);           // P2 at x=801, P4 at x=804
+
+    static const uint16_t sizes[][2] = { { 800, 600 }, { 640, 480 }, { 400, 296 }, { 320, 240 } };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        uint16_t w = sizes[i][0], h = sizes[i][1];
+        int x0, y0, x1, y1;
+        CHECK(slots.bounds(w, h, x0, y0, x1, y1));
+        CHECK(x0 >= 0 && y0 >= 0 && x1 <= w && y1 <= h);
+        // Same share of every frame: y 50..598 of 600
+        CHECK(abs(y0 - 50 * h / 600) <= 1);
+        CHECK(y1 >= 598 * h / 600);
+        RoiRect roi = RoiCrop::align(x0, y0, x1, y1, w, h, MARGIN);
+        CHECK(covers(roi, x0, y0, x1, y1, w, h));
+        printf("%ux%u: slots in %d,%d..%d,%d, crop %ux%u at %u,%u = %u%% of the frame\n", w, h, x0, y0, x1, y1,
+               roi.w, roi.h, roi.x, roi.y, (unsigned)(roi.w * roi.h * 100 / (w * h)));
+    }
+
+    // Without "frame" the regions are taken as SLOT_REGION_FRAME_W x _H
+    SlotClassifier legacy;
+    const char json[] = "{\"regions\":[{\"code\":\"A\",\"points\":[[400,300],[800,300],[800,600],[400,600]]}]}";
+    CHECK(legacy.loadRegions(json, sizeof(json) - 1));
+    int x0, y0, x1, y1;
+    CHECK(legacy.bounds(640, 480, x0, y0, x1, y1));
+    CHECK(x0 == 320 && y0 == 240 && x1 == 640 && y1 == 480);
+    CHECK_EQ(legacy.clippedPoints(), 0);
+}
+
+static void cropsAtOffset() {
+    const uint16_t W = 640, H = 480;
+    std::vector<uint8_t> rgb((size_t)W * H * 3);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            uint8_t *p = &rgb[((size_t)y * W + x) * 3];
+            p[0] = (uint8_t)(x * 255 / W);
+            p[1] = (uint8_t)(y * 255 / H);
+            p[2] = (uint8_t)((x / 24 + y / 24) % 2 ? 200 : 40);
+        }
+    }
+    std::vector<uint8_t> frame;
+    CHECK(HostJpeg::encode(rgb.data(), W, H, 90, frame));
+    std::vector<uint8_t> source;
+    uint16_t sw = 0, sh = 0;
+    CHECK(HostJpeg::decode(frame.data(), frame.size(), source, sw, sh));
+
+    RoiCrop cropper(90);
+    RoiRect roi = RoiCrop::align(130, 75, 410, 330, W, H, MARGIN);
+    uint8_t *out = NULL;
+    size_t outLen = 0;
+    CHECK(cropper.crop(frame.data(), frame.size(), roi, &out, &outLen));
+    std::vector<uint8_t> cropped;
+    uint16_t cw = 0, ch = 0;
+    CHECK(out && HostJpeg::decode(out, outLen, cropped, cw, ch));
+    free(out);
+    CHECK(cw == roi.w && ch == roi.h);
+
+    // Pixel (x, y) of the crop is pixel (roi.x + x, roi.y + y) of the frame
+    std::vector<uint8_t> expected;
+    for (int y = 0; y < roi.h; y++) {
+        const uint8_t *row = &source[((size_t)(roi.y + y) * W + roi.x) * 3];
+        expected.insert(expected.end(), row, row + roi.w * 3);
+    }
+    double psnr = cropped.size() == expected.size() ?
+                  HostJpeg::psnr(cropped.data(), expected.data(), expected.size()) : 0;
+    printf("crop %ux%u at %u,%u: %.1f dB against the source\n", roi.w, roi.h, roi.x, roi.y, psnr);
+    CHECK(psnr >= MIN_PSNR_DB);
+    CHECK_EQ(cropper.stats().crops, 1);
+
+    // A ROI past the frame is refused, not read out of bounds
+    RoiRect outside = { 560, 400, 160, 160 };
+    out = NULL;
+    CHECK(!cropper.crop(frame.data(), frame.size(), outside, &out, &outLen));
+    CHECK(out == NULL);
+    CHECK_EQ(cropper.stats().failures, 1);
+}
+
+int main() {
+    HostSerial::mute(getenv("HOST_VERBOSE") == NULL);
+    alignsToBlocks();
+    scalesRegions();
+    cropsAtOffset();
+    return hostTestResult("test_roi_crop");
+}
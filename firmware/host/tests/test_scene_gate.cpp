@@ -0,0 +1,111 @@
+/*
+ * SceneGate on a recorded hour of the lot, one JPEG per detection cycle
+ * (DETECTION_INTERVAL_MS): sensor noise, exposure drift, a passing cloud,
+ * a pedestrian and cars arriving and leaving. Every arrival/departure
+ * must be uploaded on the frame it happens; the rest only as heartbeats.
+ * Prints the upload reduction ratio against uploading every frame.
+ */
+
+#include "HostTest.h"
+#include "SceneGate.h"
+
+// As in src/main.cpp
+#define DETECTION_INTERVAL_MS   5000
+#define SCENE_CELL_DELTA        12
+#define SCENE_CHANGE_PERCENT    4
+#define SCENE_HEARTBEAT_MS      60000
+
+#define WIDTH                   640
+#define HEIGHT                  480
+#define FRAMES                  720       // One hour
+#define MIN_REDUCTION_PERCENT   85
+
+struct LotState {
+    uint8_t cars;                         // Bit per slot, 2x2 layout
+    int brightness;                       // Added to every pixel
+    int pedestrianX;                      // < 0: nobody
+};
+
+// One recorded frame: textured asphalt, bright cars in their slots
+static std::vector<uint8_t> lotFrame(const LotState &s, uint32_t seed) {
+    std::vector<uint8_t> rgb((size_t)WIDTH * HEIGHT * 3);
+    uint32_t noise = seed * 2654435761u + 1;
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            noise = noise * 1103515245 + 12345;
+            int v = 90 + ((x / 16 + y / 16) % 2) * 20 + (int)(noise >> 28);
+            int slot = (y >= HEIGHT / 2 ? 2 : 0) + (x >= WIDTH / 2 ? 1 : 0);
+            int sx = x % (WIDTH / 2);
+            int sy = y % (HEIGHT / 2);
+            if ((s.cars >> slot & 1) && sx > 60 && sx < 260 && sy > 50 && sy < 190) v = 200;
+            if (s.pedestrianX >= 0 && x >= s.pedestrianX && x < s.pedestrianX + 12 && y >= 300 && y < 340) v = 40;
+            v = constrain(v + s.brightness, 0, 255);
+            size_t i = ((size_t)y * WIDTH + x) * 3;
+            rgb[i] = rgb[i + 1] = rgb[i + 2] = (uint8_t)v;
+        }
+    }
+    std::vector<uint8_t> jpeg;
+    HostJpeg::encode(rgb.data(), WIDTH, HEIGHT, 80, jpeg);
+    return jpeg;
+}
+
+int main() {
+    HostSerial::mute(getenv("HOST_VERBOSE") == NULL);
+
+    // Arrivals and departures: frame -> slot toggled
+    std::map<int, int> carEvents = {
+        { 40, 0 }, { 95, 1 }, { 96, 2 }, { 210, 0 }, { 300, 3 },
+        { 301, 1 }, { 420, 2 }, { 555, 0 }, { 610, 3 }, { 700, 1 },
+    };
+
+    SceneGate gate(SCENE_CELL_DELTA, SCENE_CHANGE_PERCENT, SCENE_HEARTBEAT_MS);
+    LotState state = { 0x5, 0, -1 };
+    uint32_t uploads = 0, heartbeats = 0, missed = 0, falseUploads = 0;
+    uint64_t signatureUs = 0;
+
+    for (int f = 0; f < FRAMES; f++) {
+        bool changed = carEvents.count(f) > 0;
+        if (changed) state.cars ^= 1 << carEvents[f];
+        // Auto exposure drifting over the hour, and a cloud for 10 minutes
+        state.brightness = (int)(15 * sin(f * 2 * M_PI / FRAMES)) + (f >= 240 && f < 360 ? -30 : 0);
+        // Someone walks across the lot for a minute
+        state.pedestrianX = f >= 500 && f < 512 ? 40 + (f - 500) * 48 : -1;
+
+        std::vector<uint8_t> jpeg = lotFrame(state, (uint32_t)f);
+        SceneSignature sig;
+        uint64_t t0 = HostClock::nowUs();
+        bool ok = gate.signature(jpeg.data(), jpeg.size(), sig);
+        signatureUs += HostClock::nowUs() - t0;
+        CHECK(ok);
+
+        uint32_t nowMs = (uint32_t)f * DETECTION_INTERVAL_MS;
+        SceneDecision d = gate.decide(sig, nowMs);
+        if (d == SCENE_SKIP) {
+            if (changed) missed++;
+            continue;
+        }
+        uploads++;
+        if (d == SCENE_UPLOAD_HEARTBEAT) heartbeats++;
+        if (d == SCENE_UPLOAD_CHANGED && !changed) falseUploads++;
+        if (changed) CHECK_EQ(d, SCENE_UPLOAD_CHANGED);
+        gate.markUploaded(sig, nowMs);
+    }
+
+    const SceneStats &s = gate.stats();
+    CHECK_EQ(s.frames, FRAMES);
+    CHECK_EQ(s.uploads, uploads);
+    CHECK_EQ(s.skipped, FRAMES - uploads);
+    CHECK_EQ(s.heartbeats, heartbeats);
+    CHECK_EQ(missed, 0);
+    CHECK_EQ(falseUploads, 0);
+    // One heartbeat per quiet minute at most
+    CHECK(heartbeats <= (uint32_t)FRAMES * DETECTION_INTERVAL_MS / SCENE_HEARTBEAT_MS);
+
+    uint32_t reduction = 100 - uploads * 100 / FRAMES;
+    printf("%u frames: %u uploads (%zu changes, %u heartbeats), %u%% fewer than every frame; "
+           "signature %.0f us/frame\n", (unsigned)FRAMES, (unsigned)uploads, carEvents.size(),
+           (unsigned)heartbeats, (unsigned)reduction, (double)signatureUs / FRAMES);
+    CHECK(reduction >= MIN_REDUCTION_PERCENT);
+
+    return hostTestResult("test_scene_gate");
+}
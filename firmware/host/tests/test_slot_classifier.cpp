@@ -0,0 +1,79 @@
+/*
+ * SlotClassifier against the AI service on 25 recorded minutes of the lot,
+ * one frame per detection cycle: cars of every shade come and go while the
+ * exposure drifts. Frames with an unknown slot go to /analyze, whose
+ * verdict (here the ground truth, which YOLO gets right on these frames)
+ * teaches the baselines, as in the camera firmware. Every slot decided on
+ * the device must agree with the AI service; prints the agreement, how
+ * many frames still needed YOLO and the classifier's CPU time per frame.
+ */
+
+#include "HostTest.h"
+#include "SlotClassifier.h"
+
+#define WIDTH                   800       // SVGA, what the regions were drawn on
+#define HEIGHT                  600
+#define FRAMES                  300       // 25 minutes at DETECTION_INTERVAL_MS
+#define CHANGE_PERCENT          3         // Chance a slot changes between frames
+#define MIN_AGREEMENT_PERMILLE  990
+#define MAX_ESCALATED_PERCENT   40
+
+int main() {
+    HostSerial::mute(getenv("HOST_VERBOSE") == NULL);
+
+    std::string regions = regionsReply();
+    SlotClassifier slots;
+    CHECK(slots.loadRegions(regions.c_str(), regions.size()));
+    CHECK_EQ(slots.regionCount(), 4);
+
+    // Body luma of the cars: black, dark grey, asphalt-grey, silver, white
+    static const int shades[] = { 35, 70, 110, 170, 230 };
+    std::vector<int> cars(4, 0);
+    uint32_t rng = 7;
+    uint32_t escalated = 0, confident = 0, agree = 0, toggles = 0;
+    uint64_t classifyUs = 0;
+
+    for (int f = 0; f < FRAMES; f++) {
+        for (size_t i = 0; i < cars.size(); i++) {
+            rng = rng * 1103515245 + 12345;
+            if ((rng >> 16) % 100 < CHANGE_PERCENT) {
+                cars[i] = cars[i] ? 0 : shades[(rng >> 8) % 5];
+                toggles++;
+            }
+        }
+        std::vector<uint8_t> jpeg = slotFrame(WIDTH, HEIGHT, cars, f);
+        CHECK(slots.classify(jpeg.data(), jpeg.size(), WIDTH, HEIGHT));
+        classifyUs += slots.stats().lastFrameUs;
+
+        for (uint8_t i = 0; i < slots.regionCount(); i++) {
+            const SlotResult &r = slots.result(i);
+            if (r.state == SLOT_UNKNOWN) continue;
+            confident++;
+            if ((r.state == SLOT_OCCUPIED) == (cars[i] != 0)) agree++;
+        }
+        if (slots.unknownCount() > 0) {
+            escalated++;
+            for (uint8_t i = 0; i < slots.regionCount(); i++) {
+                slots.learn(slots.code(i), cars[i] != 0);
+            }
+        }
+    }
+
+    const SlotClassifierStats &s = slots.stats();
+    CHECK_EQ(s.frames, FRAMES);
+    CHECK_EQ(s.decided, FRAMES - escalated);
+    uint32_t permille = confident ? agree * 1000 / confident : 0;
+    printf("%u frames, %u arrivals/departures: %u/%u device decisions agree (%.1f%%), "
+           "%u frames escalated to YOLO (%u%%), classify %.0f us/frame\n",
+           (unsigned)FRAMES, (unsigned)toggles, (unsigned)agree, (unsigned)confident, permille / 10.0,
+           (unsigned)escalated, (unsigned)(escalated * 100 / FRAMES), (double)classifyUs / FRAMES);
+    CHECK(permille >= MIN_AGREEMENT_PERMILLE);
+    CHECK(escalated * 100 <= (uint32_t)FRAMES * MAX_ESCALATED_PERCENT);
+
+    // The stream tuner dropped to VGA: baselines learned on SVGA do not apply
+    std::vector<uint8_t> vga = slotFrame(640, 480, cars, FRAMES);
+    CHECK(slots.classify(vga.data(), vga.size(), 640, 480));
+    CHECK_EQ(slots.unknownCount(), slots.regionCount());
+
+    return hostTestResult("test_slot_classifier");
+}
@@ -0,0 +1,117 @@
+/*
+ * StreamTuner against a simulated viewer link: capacity follows a trace
+ * (LAN, weak Wi-Fi, a near-outage, recovery, somewhere in between) with
+ * +-10% noise per period. Frame bytes follow the setting: pixels of the
+ * frame size times a per-quality cost. Within each stage the tuner must
+ * settle on a setting that fits the link, without flapping, at the full
+ * frame rate wherever some rung of the ladder allows it.
+ */
+
+#include "HostTest.h"
+#include "StreamTuner.h"
+
+// As in src/main.cpp
+#define STREAM_FRAME_DELAY_MS   50
+#define STREAM_JPEG_QUALITY     12
+#define STREAM_BEST_QUALITY     10
+#define STREAM_MAX_KBPS         4000
+
+#define PERIOD_MS               1000
+#define STAGE_S                 60
+#define SETTLED_S               20        // Last seconds of a stage that must be steady
+#define TARGET_FPS              (1000 / STREAM_FRAME_DELAY_MS)
+
+// VGA, CIF, QVGA as in STREAM_FRAME_SIZES
+static const uint32_t SIZE_PIXELS[] = { 640 * 480, 400 * 296, 320 * 240 };
+
+// Bytes of one frame: ~0.25 byte/pixel at quality 10, falling with quality
+static uint32_t frameBytes(const StreamSetting &s) {
+    return (uint32_t)(SIZE_PIXELS[s.sizeStep] * 2.5f / s.quality);
+}
+
+struct Stage {
+    uint32_t kBps;            // Link capacity, kB/s
+    bool fullRate;            // Some rung fits TARGET_FPS in 80% of it
+};
+
+int main() {
+    HostSerial::mute(getenv("HOST_VERBOSE") == NULL);
+
+    StreamTunerConfig config = { TARGET_FPS, STREAM_MAX_KBPS, 3, STREAM_BEST_QUALITY, STREAM_JPEG_QUALITY };
+    StreamTuner tuner(config);
+    CHECK_EQ(tuner.levels(), 21);
+    CHECK_EQ(tuner.setting().sizeStep, 0);
+    CHECK_EQ(tuner.setting().quality, STREAM_JPEG_QUALITY);
+
+    // Coarsest rung is QVGA at quality 38: ~5 kB/frame, ~100 kB/s at 20 fps
+    static const Stage stages[] = {
+        { 400, true }, { 80, false }, { 15, false }, { 400, true }, { 150, true },
+    };
+    uint32_t rng = 1;
+    uint32_t nowMs = 0;
+    uint32_t reversals = 0;
+    int lastDirection = 0;
+
+    for (size_t st = 0; st < sizeof(stages) / sizeof(stages[0]); st++) {
+        uint8_t settledLevel = tuner.stats().level;
+        uint32_t changes = 0;
+        float fps = 0, kBpsUsed = 0;
+        for (int t = 0; t < STAGE_S; t++) {
+            StreamSetting s = tuner.setting();
+            rng = rng * 1103515245 + 12345;
+            float capacity = stages[st].kBps * 1000.0f * (0.9f + 0.2f * (rng >> 16) / 65535.0f);
+
+            // One viewer: the interval paces frames, the link caps them
+            uint32_t bytes = frameBytes(s);
+            float rate = std::min(1000.0f / s.frameIntervalMs, capacity / bytes);
+            MjpegLinkSample sample;
+            sample.frames = (uint32_t)rate;
+            sample.bytes = sample.frames * bytes;
+            sample.sendUs = (uint32_t)(sample.bytes * 1e6f / capacity);
+            sample.clients = 1;
+
+            uint8_t level = tuner.stats().level;
+            nowMs += PERIOD_MS;
+            StreamSetting out;
+            if (tuner.update(sample, nowMs, out)) {
+                if (t >= STAGE_S - SETTLED_S) changes++;
+                int direction = tuner.stats().level > level ? 1 : (tuner.stats().level < level ? -1 : 0);
+                if (direction != 0) {
+                    if (lastDirection != 0 && direction != lastDirection) reversals++;
+                    lastDirection = direction;
+                }
+            }
+            if (t == STAGE_S - SETTLED_S) settledLevel = tuner.stats().level;
+            if (t >= STAGE_S - SETTLED_S) {
+                fps += sample.frames / (float)SETTLED_S;
+                kBpsUsed += sample.bytes / 1000.0f / SETTLED_S;
+            }
+        }
+
+        StreamSetting s = tuner.setting();
+        printf("%4u kB/s: size step %u, quality %u, %u ms/frame -> %.1f fps, %.0f kB/s\n",
+               (unsigned)stages[st].kBps, s.sizeStep, s.quality, s.frameIntervalMs, fps, kBpsUsed);
+        // Settled: one late correction at most, a pacing change or one step
+        // down off a rung that fits the link only when the noise is kind;
+        // never back up
+        CHECK(changes <= 1);
+        CHECK(tuner.stats().level == settledLevel || tuner.stats().level == settledLevel + 1);
+        // Within the link, leaving room for the noise
+        CHECK(kBpsUsed <= stages[st].kBps * 0.9f);
+        if (stages[st].fullRate) {
+            CHECK(fps >= TARGET_FPS * 0.9f);
+            CHECK_EQ(s.frameIntervalMs, STREAM_FRAME_DELAY_MS);
+        } else {
+            // Coarsest rung, paced to fit
+            CHECK_EQ(tuner.stats().level, tuner.levels() - 1);
+            CHECK(s.frameIntervalMs > STREAM_FRAME_DELAY_MS);
+            CHECK(fps >= 1);
+        }
+    }
+    printf("%u steps down, %u steps up, %u reversals\n", (unsigned)tuner.stats().stepsDown,
+           (unsigned)tuner.stats().stepsUp, (unsigned)reversals);
+    // Down, up, down: one reversal per change of trend in the trace
+    CHECK(reversals <= 3);
+
+    return hostTestResult("test_stream_tuner");
+}
@@ -0,0 +1,398 @@
+/*
+ * StripeJpeg against libjpeg: every output decodes to the source image,
+ * its luma as close as libjpeg's own encoding at the same quality gets
+ * (the reference codec subsamples chroma 4:2:2, StripeJpeg 4:2:0), with
+ * one restart interval per MCU row with RST0..7 in sequence, and the
+ * bottom stripe runs on the helper task (a thread of its own here) for
+ * every image taller than one MCU row. Prints the speedup on VGA, the
+ * CPU time both threads spend over the wall time, next to the host's
+ * core count; with two cores or more it must be 1.5x at least.
+ *
+ * Encoders on concurrent threads, each switching image and quality every
+ * frame, produce byte for byte what a lone encoder does, and all of them
+ * share one set of quantization tables per quality.
+ *
+ * The fixed-point DCT and reciprocal quantization keep up with libjpeg's
+ * accurate integer DCT from quality 10 to 100, and the encoder's blocks
+ * per CPU second are printed next to libjpeg's.
+ *
+ * Golden output: a digest over 120 encodes (sizes, scenes from smooth to
+ * pure noise, qualities 1 to 100), fixed before the Huffman coder moved
+ * to a 64-bit bit buffer, with thousands of stuffed 0xFF bytes among
+ * them. Prints the blocks/s of the entropy-heavy case.
+ */
+
+#include "HostTest.h"
+#include "StripeJpeg.h"
+
+#define QUALITY             80
+#define MAX_PSNR_LOSS_DB    0.5       // Against libjpeg at the same quality
+#define SPEED_FRAMES        30
+#define MIN_SPEEDUP         1.5       // With two cores or more
+#define THREADS             6
+#define THREAD_FRAMES       150
+#define BENCH_FRAMES        20
+#define GOLDEN_DIGEST       0x1a5e6d27d55f94c2ull  // FNV-1a of the encodes in goldenOutput()
+#define MIN_STUFFED_BYTES   1000
+
+// Photo-like BGR image: gradients, soft texture and a few hard-edged
+// blocks; seed moves them
+static std::vector<uint8_t> bgrImage(uint16_t width, uint16_t height, int seed) {
+    std::vector<uint8_t> bgr((size_t)width * height * 3);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t *p = &bgr[((size_t)y * width + x) * 3];
+            p[2] = (uint8_t)((x * 255 / width + seed * 40) & 255);
+            p[1] = (uint8_t)(y * 255 / height);
+            p[0] = (uint8_t)(128 + 100 * sin((x + seed) / 23.0) * cos(y / 31.0));
+            if ((x / 40 + y / 30 + seed) % 5 == 0) {
+                p[2] = 230;
+                p[1] = 200;
+                p[0] = 40;
+            }
+        }
+    }
+    return bgr;
+}
+
+static std::vector<uint8_t> toRgb(const std::vector<uint8_t> &bgr) {
+    std::vector<uint8_t> rgb(bgr.size());
+    for (size_t i = 0; i < bgr.size(); i += 3) {
+        rgb[i] = bgr[i + 2];
+        rgb[i + 1] = bgr[i + 1];
+        rgb[i + 2] = bgr[i];
+    }
+    return rgb;
+}
+
+// PSNR of the BT.601 luma of two RGB images
+static double lumaPsnr(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b) {
+    if (a.size() != b.size()) return 0;
+    std::vector<uint8_t> ya(a.size() / 3), yb(b.size() / 3);
+    for (size_t i = 0; i < ya.size(); i++) {
+        const uint8_t *p = &a[i * 3];
+        const uint8_t *q = &b[i * 3];
+        ya[i] = (uint8_t)(0.299 * p[0] + 0.587 * p[1] + 0.114 * p[2] + 0.5);
+        yb[i] = (uint8_t)(0.299 * q[0] + 0.587 * q[1] + 0.114 * q[2] + 0.5);
+    }
+    return HostJpeg::psnr(ya.data(), yb.data(), ya.size());
+}
+
+// Walks the markers of an encoder output: the DRI interval, and in the
+// entropy-coded data the restart markers (which must count RST0..7 round)
+// up to EOI. False if anything else turns up.
+static bool scanMarkers(const uint8_t *jpg, size_t len, uint16_t &interval, uint32_t &restarts) {
+    interval = 0;
+    restarts = 0;
+    size_t i = 2;
+    while (true) {
+        if (i + 4 > len || jpg[i] != 0xFF) return false;
+        uint8_t marker = jpg[i + 1];
+        size_t segment = (size_t)jpg[i + 2] << 8 | jpg[i + 3];
+        if (marker == 0xDD) interval = (uint16_t)(jpg[i + 4] << 8 | jpg[i + 5]);
+        i += 2 + segment;
+        if (marker == 0xDA) break;
+    }
+    for (; i + 1 < len; i++) {
+        if (jpg[i] != 0xFF) continue;
+        uint8_t next = jpg[++i];
+        if (next == 0x00) continue;
+        if (next == 0xD9) return i + 1 == len;
+        if (next != 0xD0 + (restarts & 7)) return false;
+        restarts++;
+    }
+    return false;
+}
+
+static void roundTrips() {
+    // Partial MCUs on either edge, a single MCU row, one pixel
+    static const uint16_t sizes[][2] = { { 640, 480 }, { 320, 240 }, { 100, 37 }, { 33, 200 }, { 8, 8 }, { 1, 1 } };
+    StripeJpeg encoder(QUALITY);
+    uint32_t parallel = 0;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        uint16_t w = sizes[i][0], h = sizes[i][1];
+        std::vector<uint8_t> bgr = bgrImage(w, h, (int)i);
+        uint8_t *jpg = NULL;
+        size_t len = 0;
+        CHECK(encoder.encode(bgr.data(), w, h, &jpg, &len));
+        if (!jpg) continue;
+
+        uint16_t interval = 0;
+        uint32_t restarts = 0;
+        uint16_t rows = (h + 15) / 16;
+        CHECK(scanMarkers(jpg, len, interval, restarts));
+        CHECK_EQ(interval, (w + 15) / 16);
+        CHECK_EQ(restarts, rows - 1);
+        if (rows > 1) parallel++;
+        CHECK_EQ(encoder.stats().parallel, parallel);
+
+        std::vector<uint8_t> decoded;
+        uint16_t dw = 0, dh = 0;
+        CHECK(HostJpeg::decode(jpg, len, decoded, dw, dh));
+        free(jpg);
+        CHECK(dw == w && dh == h);
+        std::vector<uint8_t> rgb = toRgb(bgr);
+        double psnr = lumaPsnr(decoded, rgb);
+
+        std::vector<uint8_t> reference, referenceDecoded;
+        CHECK(HostJpeg::encode(rgb.data(), w, h, QUALITY, reference));
+        CHECK(HostJpeg::decode(reference.data(), reference.size(), referenceDecoded, dw, dh));
+        double referencePsnr = lumaPsnr(referenceDecoded, rgb);
+        printf("%ux%u: %u restart markers, luma %.1f dB (libjpeg %.1f dB)\n", w, h, (unsigned)restarts, psnr,
+               referencePsnr);
+        CHECK(psnr >= referencePsnr - MAX_PSNR_LOSS_DB);
+    }
+    CHECK_EQ(encoder.stats().frames, sizeof(sizes) / sizeof(sizes[0]));
+    CHECK_EQ(encoder.stats().failures, 0);
+
+    // Nothing to encode
+    uint8_t *jpg = (uint8_t *)1;
+    size_t len = 1;
+    CHECK(!encoder.encode(NULL, 640, 480, &jpg, &len));
+    CHECK(jpg == NULL && len == 0);
+    CHECK_EQ(encoder.stats().failures, 1);
+}
+
+static uint64_t processCpuUs() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// CPU time of the caller and the helper together over the wall time
+static void speedup() {
+    std::vector<uint8_t> bgr = bgrImage(640, 480, 0);
+    StripeJpeg encoder(QUALITY);
+    uint8_t *jpg = NULL;
+    size_t len = 0;
+    CHECK(encoder.encode(bgr.data(), 640, 480, &jpg, &len));     // Starts the helper
+    free(jpg);
+
+    uint64_t wall0 = HostClock::nowUs();
+    uint64_t cpu0 = processCpuUs();
+    for (int f = 0; f < SPEED_FRAMES; f++) {
+        CHECK(encoder.encode(bgr.data(), 640, 480, &jpg, &len));
+        free(jpg);
+    }
+    uint64_t cpuUs = processCpuUs() - cpu0;
+    uint64_t wallUs = HostClock::nowUs() - wall0;
+    CHECK_EQ(encoder.stats().parallel, SPEED_FRAMES + 1);
+
+    unsigned cores = std::thread::hardware_concurrency();
+    double ratio = wallUs ? (double)cpuUs / wallUs : 0;
+    printf("VGA: %.2f ms/frame, %.2f ms of CPU: %.2fx on %u core(s)\n",
+           wallUs / 1000.0 / SPEED_FRAMES, cpuUs / 1000.0 / SPEED_FRAMES, ratio, cores);
+    if (cores >= 2) {
+        CHECK(ratio >= MIN_SPEEDUP);
+    }
+}
+
+static void concurrentEncoders() {
+    static const uint16_t sizes[3][2] = { { 320, 240 }, { 160, 112 }, { 96, 200 } };
+    static const uint8_t qualities[4] = { 30, 50, 80, 95 };
+    std::vector<uint8_t> images[3];
+    std::string expected[3][4];
+    for (int i = 0; i < 3; i++) {
+        images[i] = bgrImage(sizes[i][0], sizes[i][1], i);
+        for (int q = 0; q < 4; q++) {
+            StripeJpeg encoder(qualities[q]);
+            uint8_t *jpg = NULL;
+            size_t len = 0;
+            CHECK(encoder.encode(images[i].data(), sizes[i][0], sizes[i][1], &jpg, &len));
+            expected[i][q].assign((const char *)jpg, len);
+            free(jpg);
+        }
+    }
+
+    std::atomic<uint32_t> encodes(0), mismatches(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.push_back(std::thread([&, t]() {
+            StripeJpeg encoder(qualities[t % 4]);
+            uint32_t rng = t * 7919 + 1;
+            for (int n = 0; n < THREAD_FRAMES; n++) {
+                rng = rng * 1103515245 + 12345;
+                int i = (rng >> 8) % 3;
+                int q = (rng >> 16) % 4;
+                encoder.setQuality(qualities[q]);
+                uint8_t *jpg = NULL;
+                size_t len = 0;
+                if (!encoder.encode(images[i].data(), sizes[i][0], sizes[i][1], &jpg, &len) ||
+                    len != expected[i][q].size() || memcmp(jpg, expected[i][q].data(), len) != 0) {
+                    mismatches++;
+                }
+                free(jpg);
+                encodes++;
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+
+    printf("%u encodes on %d concurrent encoders, image and quality switched every frame: %u mismatches\n",
+           (unsigned)encodes, THREADS, (unsigned)mismatches);
+    CHECK_EQ(encodes, THREADS * THREAD_FRAMES);
+    CHECK_EQ(mismatches, 0);
+    for (int q = 0; q < 4; q++) {
+        const JpegQuantTables *tables = StripeJpeg::quantTables(qualities[q]);
+        CHECK(tables != NULL && tables == StripeJpeg::quantTables(qualities[q]));
+    }
+}
+
+// PSNR at every quality on a grey image, so chroma subsampling plays no
+// part, with grain that high qualities have to keep
+static void qualityLadder() {
+    const uint16_t W = 320, H = 240;
+    std::vector<uint8_t> bgr = bgrImage(W, H, 3);
+    uint32_t rng = 5;
+    for (size_t i = 0; i < bgr.size(); i += 3) {
+        rng = rng * 1103515245 + 12345;
+        int v = (bgr[i] + bgr[i + 1] * 2 + bgr[i + 2]) / 4 + (int)(rng >> 28) - 8;
+        bgr[i] = bgr[i + 1] = bgr[i + 2] = (uint8_t)constrain(v, 0, 255);
+    }
+    std::vector<uint8_t> rgb = toRgb(bgr);
+
+    static const uint8_t qualities[] = { 10, 30, 50, 80, 95, 100 };
+    for (size_t i = 0; i < sizeof(qualities) / sizeof(qualities[0]); i++) {
+        StripeJpeg encoder(qualities[i]);
+        uint8_t *jpg = NULL;
+        size_t len = 0;
+        CHECK(encoder.encode(bgr.data(), W, H, &jpg, &len));
+        std::vector<uint8_t> decoded, reference, referenceDecoded;
+        uint16_t dw = 0, dh = 0;
+        CHECK(jpg && HostJpeg::decode(jpg, len, decoded, dw, dh));
+        free(jpg);
+        CHECK(HostJpeg::encode(rgb.data(), W, H, qualities[i], reference));
+        CHECK(HostJpeg::decode(reference.data(), reference.size(), referenceDecoded, dw, dh));
+        double psnr = HostJpeg::psnr(decoded.data(), rgb.data(), rgb.size());
+        double referencePsnr = HostJpeg::psnr(referenceDecoded.data(), rgb.data(), rgb.size());
+        printf("quality %3u: %6u bytes, %.2f dB (libjpeg %.2f dB)\n", qualities[i], (unsigned)len, psnr,
+               referencePsnr);
+        CHECK(psnr >= referencePsnr - MAX_PSNR_LOSS_DB);
+    }
+}
+
+// 8x8 blocks per CPU second on VGA: six per 16x16 MCU here, four for
+// libjpeg's 4:2:2. Host libjpeg is usually libjpeg-turbo with SIMD, so
+// it gives the scale, not a bar the scalar encoder has to clear.
+static void blockRate() {
+    std::vector<uint8_t> bgr = bgrImage(640, 480, 1);
+    std::vector<uint8_t> rgb = toRgb(bgr);
+    StripeJpeg encoder(QUALITY);
+    uint8_t *jpg = NULL;
+    size_t len = 0;
+    CHECK(encoder.encode(bgr.data(), 640, 480, &jpg, &len));
+    free(jpg);
+
+    uint64_t cpu0 = processCpuUs();
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+        CHECK(encoder.encode(bgr.data(), 640, 480, &jpg, &len));
+        free(jpg);
+    }
+    uint64_t stripeUs = processCpuUs() - cpu0;
+    cpu0 = processCpuUs();
+    std::vector<uint8_t> reference;
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+        CHECK(HostJpeg::encode(rgb.data(), 640, 480, QUALITY, reference));
+    }
+    uint64_t libjpegUs = processCpuUs() - cpu0;
+
+    double blocks = 40.0 * 30 * 6 * BENCH_FRAMES;
+    double referenceBlocks = 40.0 * 60 * 4 * BENCH_FRAMES;
+    printf("VGA quality %u: %.0f blocks/s (libjpeg %.0f blocks/s) per CPU second\n", QUALITY,
+           stripeUs ? blocks * 1e6 / stripeUs : 0, libjpegUs ? referenceBlocks * 1e6 / libjpegUs : 0);
+}
+
+// Scene 0 smooth, 1 hard black/white edges (long runs of 1 bits, so many
+// 0xFF bytes), 2 mild noise, 3 full-range noise (the most Huffman output)
+static std::vector<uint8_t> goldenImage(uint16_t width, uint16_t height, int scene, uint32_t &rng) {
+    std::vector<uint8_t> bgr((size_t)width * height * 3);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            for (int c = 0; c < 3; c++) {
+                rng = rng * 1103515245 + 12345;
+                int v;
+                if (scene == 0) {
+                    v = (x * 255 / width + y + c * 40) & 255;
+                } else if (scene == 1) {
+                    v = (x / 7 + y / 5) % 2 ? 255 : 0;
+                } else if (scene == 2) {
+                    v = 128 + (int)((rng >> 16) % 41) - 20;
+                } else {
+                    v = rng >> 24;
+                }
+                bgr[((size_t)y * width + x) * 3 + c] = (uint8_t)v;
+            }
+        }
+    }
+    return bgr;
+}
+
+// 0xFF 0x00 pairs in the entropy-coded data
+static uint32_t stuffedBytes(const uint8_t *jpg, size_t len) {
+    uint32_t n = 0;
+    for (size_t i = 0; i + 1 < len; i++) {
+        if (jpg[i] == 0xFF && jpg[i + 1] == 0x00) n++;
+    }
+    return n;
+}
+
+static void goldenOutput() {
+    static const uint16_t sizes[][2] = { { 320, 240 }, { 100, 37 }, { 33, 200 }, { 17, 17 }, { 8, 8 } };
+    static const uint8_t qualities[] = { 1, 10, 50, 80, 95, 100 };
+    StripeJpeg encoder(50);
+    uint32_t rng = 7;
+    uint64_t digest = 0xcbf29ce484222325ull;
+    uint32_t encodes = 0, stuffed = 0;
+    size_t bytes = 0;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        for (int scene = 0; scene < 4; scene++) {
+            uint16_t w = sizes[i][0], h = sizes[i][1];
+            std::vector<uint8_t> bgr = goldenImage(w, h, scene, rng);
+            for (size_t q = 0; q < sizeof(qualities) / sizeof(qualities[0]); q++) {
+                encoder.setQuality(qualities[q]);
+                uint8_t *jpg = NULL;
+                size_t len = 0;
+                CHECK(encoder.encode(bgr.data(), w, h, &jpg, &len));
+                for (size_t k = 0; k < len; k++) {
+                    digest = (digest ^ jpg[k]) * 0x100000001b3ull;
+                }
+                stuffed += stuffedBytes(jpg, len);
+                bytes += len;
+                encodes++;
+                free(jpg);
+            }
+        }
+    }
+    printf("%u encodes, %u bytes, %u stuffed: digest %016llx\n", (unsigned)encodes, (unsigned)bytes,
+           (unsigned)stuffed, (unsigned long long)digest);
+    CHECK(digest == GOLDEN_DIGEST);
+    CHECK(stuffed >= MIN_STUFFED_BYTES);
+
+    // Entropy-heavy: full-range noise at quality 95, where the Huffman
+    // coder dominates the encode
+    std::vector<uint8_t> noise = goldenImage(640, 480, 3, rng);
+    encoder.setQuality(95);
+    uint8_t *jpg = NULL;
+    size_t len = 0;
+    CHECK(encoder.encode(noise.data(), 640, 480, &jpg, &len));
+    free(jpg);
+    uint64_t cpu0 = processCpuUs();
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+        CHECK(encoder.encode(noise.data(), 640, 480, &jpg, &len));
+        free(jpg);
+    }
+    uint64_t cpuUs = processCpuUs() - cpu0;
+    printf("VGA noise quality 95: %u bytes/frame, %.0f blocks/s per CPU second\n", (unsigned)len,
+           cpuUs ? 40.0 * 30 * 6 * BENCH_FRAMES * 1e6 / cpuUs : 0);
+}
+
+int main() {
+    HostSerial::mute(getenv("HOST_VERBOSE") == NULL);
+    roundTrips();
+    speedup();
+    concurrentEncoders();
+    qualityLadder();
+    blockRate();
+    goldenOutput();
+    return hostTestResult("test_stripe_jpeg");
+}
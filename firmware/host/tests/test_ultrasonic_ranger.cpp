@@ -0,0 +1,122 @@
+/*
+ * UltrasonicRanger on a frozen clock with the HC-SR04 echo model: readings
+ * match the simulated distances, the two sensors take turns one slot
+ * apart, missing echoes only count as timeouts, a full ring drops and
+ * counts, and loop() costs the trigger pulse instead of the echo wait that
+ * pulseIn() spent.
+ */
+
+#include "HostTest.h"
+#include "UltrasonicRanger.h"
+
+#define ENTRY_TRIG      1
+#define ENTRY_ECHO      2
+#define EXIT_TRIG       42
+#define EXIT_ECHO       41
+#define RUN_MS          3000
+
+struct Run {
+    uint32_t loopUs;            // Virtual time spent inside loop()
+    uint32_t pulseInUs;         // What pulseIn() would have waited for the same pings
+    std::vector<RangeSample> samples;
+};
+
+static float expectedCm[2];
+
+// pulseIn(echo, HIGH, 30000) waits for the rising edge, then the pulse
+static uint32_t pulseInWaitUs(float cm) {
+    if (cm <= 0) return RANGER_MAX_ECHO_US;
+    uint32_t width = (uint32_t)(cm * 58.3f);
+    return HOST_ECHO_DELAY_US + std::min(width, (uint32_t)RANGER_MAX_ECHO_US);
+}
+
+// Runs the ranger for ms of virtual time, 1 ms per iteration like the
+// gate task, optionally draining the ring every iteration
+static Run run(UltrasonicRanger &ranger, uint32_t ms, bool drain) {
+    Run r = { 0, 0, std::vector<RangeSample>() };
+    for (uint32_t t = 0; t < ms; t++) {
+        uint32_t pings = ranger.stats().pings;
+        uint64_t before = HostClock::nowUs();
+        ranger.loop();
+        r.loopUs += (uint32_t)(HostClock::nowUs() - before);
+        if (ranger.stats().pings != pings) {
+            // Sensors alternate, starting with the entry sensor
+            r.pulseInUs += pulseInWaitUs(expectedCm[pings % 2]);
+        }
+        HostClock::advance(1);
+        RangeSample s;
+        while (drain && ranger.read(s)) r.samples.push_back(s);
+    }
+    return r;
+}
+
+int main() {
+    HostSerial::mute(getenv("HOST_VERBOSE") == NULL);
+    HostClock::freeze();
+    HostGpio::attachEcho(ENTRY_TRIG, ENTRY_ECHO);
+    HostGpio::attachEcho(EXIT_TRIG, EXIT_ECHO);
+    expectedCm[0] = 12.5f;                        // Car at the entry sensor
+    expectedCm[1] = 180.0f;                       // Far wall at the exit sensor
+    HostGpio::setDistance(ENTRY_TRIG, expectedCm[0]);
+    HostGpio::setDistance(EXIT_TRIG, expectedCm[1]);
+
+    UltrasonicRanger ranger;
+    int entry = ranger.addSensor(ENTRY_TRIG, ENTRY_ECHO);
+    int exitSensor = ranger.addSensor(EXIT_TRIG, EXIT_ECHO);
+    CHECK_EQ(entry, 0);
+    CHECK_EQ(exitSensor, 1);
+    CHECK_EQ(ranger.addSensor(5, 6), -1);
+    ranger.begin();
+
+    // Readings and staggering
+    Run r = run(ranger, RUN_MS, true);
+    uint32_t pings = RUN_MS / RANGER_PING_SLOT_MS;
+    CHECK(ranger.stats().pings >= pings - 1 && ranger.stats().pings <= pings + 1);
+    CHECK(r.samples.size() >= ranger.stats().pings - 1);
+    CHECK_EQ(ranger.stats().timeouts, 0);
+    CHECK_EQ(ranger.stats().overflows, 0);
+    for (size_t i = 0; i < r.samples.size(); i++) {
+        const RangeSample &s = r.samples[i];
+        CHECK(fabsf(s.distanceCm() - expectedCm[s.sensor]) <= expectedCm[s.sensor] * 0.02f);
+        if (i > 0) {
+            CHECK(s.sensor != r.samples[i - 1].sensor);
+            // Never two bursts in the air: one slot between triggers
+            CHECK(s.triggerUs - r.samples[i - 1].triggerUs >= RANGER_PING_SLOT_MS * 1000);
+        }
+    }
+    CHECK_EQ(HostGpio::pings(ENTRY_TRIG), (ranger.stats().pings + 1) / 2);
+
+    // CPU time: the trigger pulse per ping instead of the whole echo
+    printf("%u pings in %u ms: loop() %u us busy, pulseIn() would block %u us (%.1f%% of the time)\n",
+           (unsigned)ranger.stats().pings, RUN_MS, (unsigned)r.loopUs, (unsigned)r.pulseInUs,
+           100.0 * r.pulseInUs / (RUN_MS * 1000.0));
+    CHECK(r.loopUs <= ranger.stats().pings * 10 + 10);
+    CHECK(r.loopUs * 100 < r.pulseInUs);
+
+    // Nothing in front of the exit sensor: the 38 ms timeout pulse is no
+    // reading, only a timeout per exit ping
+    expectedCm[1] = 0;
+    HostGpio::setDistance(EXIT_TRIG, 0);
+    RangerStats before = ranger.stats();
+    r = run(ranger, RUN_MS, true);
+    uint32_t exitPings = (ranger.stats().pings - before.pings) / 2;
+    CHECK(ranger.stats().timeouts - before.timeouts >= exitPings - 1);
+    for (size_t i = 0; i < r.samples.size(); i++) {
+        CHECK_EQ(r.samples[i].sensor, entry);
+    }
+    CHECK(r.samples.size() >= exitPings - 1);
+    printf("no echo: pulseIn() would block %u us per %u ms, loop() %u us\n",
+           (unsigned)r.pulseInUs, RUN_MS, (unsigned)r.loopUs);
+
+    // Nobody reading: the ring keeps the oldest samples and counts the rest
+    expectedCm[1] = 60.0f;
+    HostGpio::setDistance(EXIT_TRIG, expectedCm[1]);
+    run(ranger, (RANGER_RING_SIZE + 8) * RANGER_PING_SLOT_MS, false);
+    RangeSample s;
+    uint32_t kept = 0;
+    while (ranger.read(s)) kept++;
+    CHECK_EQ(kept, RANGER_RING_SIZE);
+    CHECK(ranger.stats().overflows >= 4);
+
+    return hostTestResult("test_ultrasonic_ranger");
+}
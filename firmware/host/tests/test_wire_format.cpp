@@ -0,0 +1,186 @@
+/*
+ * WireFormat negotiation: bodies stay JSON until the peer has answered in
+ * MessagePack, responses are decoded by their Content-Type (either
+ * MessagePack name, any case, JSON for anything else), and a MessagePack
+ * body refused with 400 or 415 is resent as JSON and never tried again.
+ * Documents survive both encodings unchanged.
+ */
+
+#include "HostTest.h"
+#include "WireFormat.h"
+
+static HttpResponse response(const char *contentType, const std::string &body) {
+    HttpResponse resp;
+    resp.status = 200;
+    resp.keepAlive = true;
+    resp.chunked = false;
+    resp.contentLength = body.size();
+    strncpy(resp.contentType, contentType, sizeof(resp.contentType) - 1);
+    resp.contentType[sizeof(resp.contentType) - 1] = '\0';
+    resp.body = String(body);
+    return resp;
+}
+
+static std::string msgpack(const JsonDocument &doc) {
+    std::string out;
+    serializeMsgPack(doc, out);
+    return out;
+}
+
+static void batch(JsonDocument &doc) {
+    doc["camera_id"] = "esp32-main";
+    doc["epoch"] = 2841553617u;
+    JsonArray events = doc.createNestedArray("events");
+    for (int i = 0; i < 3; i++) {
+        JsonObject e = events.createNestedObject();
+        e["seq"] = 41 + i;
+        e["event_type"] = i % 2 ? "exit" : "entry";
+        e["age_ms"] = 250 * i;
+    }
+}
+
+static void negotiates() {
+    WireFormat wire;
+    StaticJsonDocument<1024> doc, reply;
+    batch(doc);
+    char body[256];
+
+    // Nothing heard from the peer yet
+    CHECK_EQ(wire.encoding(), WIRE_JSON);
+    CHECK(strcmp(wire.contentType(), WIRE_MIME_JSON) == 0);
+    size_t len = wire.serialize(doc, body, sizeof(body));
+    CHECK(len > 0 && body[0] == '{');
+
+    // A JSON answer changes nothing
+    CHECK(wire.deserialize(reply, response(WIRE_MIME_JSON, "{\"data\":{\"acked_seq\":43}}")) ==
+          DeserializationError::Ok);
+    CHECK_EQ(reply["data"]["acked_seq"].as<uint32_t>(), 43);
+    CHECK_EQ(wire.encoding(), WIRE_JSON);
+
+    // Answered in MessagePack: bodies follow
+    StaticJsonDocument<64> ack;
+    ack["data"]["acked_seq"] = 44;
+    CHECK(wire.deserialize(reply, response(WIRE_MIME_MSGPACK, msgpack(ack))) == DeserializationError::Ok);
+    CHECK_EQ(reply["data"]["acked_seq"].as<uint32_t>(), 44);
+    CHECK_EQ(wire.encoding(), WIRE_MSGPACK);
+    CHECK(strcmp(wire.contentType(), WIRE_MIME_MSGPACK) == 0);
+    size_t packed = wire.serialize(doc, body, sizeof(body));
+    CHECK(packed > 0 && packed < len);
+
+    // The same document comes back out of the MessagePack body
+    StaticJsonDocument<1024> back;
+    CHECK(wire.deserialize(back, response(WIRE_MIME_MSGPACK, std::string(body, packed))) ==
+          DeserializationError::Ok);
+    CHECK(back == doc);
+
+    // ... and a JSON answer later does not undo it
+    CHECK(wire.deserialize(reply, response(WIRE_MIME_JSON, "{}")) == DeserializationError::Ok);
+    CHECK_EQ(wire.encoding(), WIRE_MSGPACK);
+
+    const WireFormatStats &st = wire.stats();
+    CHECK_EQ(st.sent[WIRE_JSON], 1);
+    CHECK_EQ(st.sent[WIRE_MSGPACK], 1);
+    CHECK_EQ(st.bytesSent[WIRE_MSGPACK], packed);
+    CHECK_EQ(st.received[WIRE_JSON], 2);
+    CHECK_EQ(st.received[WIRE_MSGPACK], 2);
+    CHECK_EQ(st.fallbacks, 0);
+
+    // Cut documents are not sent
+    char tiny[8];
+    CHECK_EQ(wire.serialize(doc, tiny, sizeof(tiny)), 0);
+    CHECK_EQ(wire.stats().sent[WIRE_MSGPACK], 1);
+}
+
+static void decodesByContentType() {
+    StaticJsonDocument<64> doc;
+    doc["is_occupied"] = true;
+    std::string packed = msgpack(doc);
+
+    struct Case { const char *type; bool binary; } cases[] = {
+        { "application/msgpack", true },
+        { "application/x-msgpack", true },
+        { "Application/MsgPack", true },
+        { "APPLICATION/X-MSGPACK", true },
+        { "application/json", false },
+        { "text/plain", false },
+        { "", false },                    // No Content-Type
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        WireFormat wire;
+        StaticJsonDocument<64> out;
+        std::string body = cases[i].binary ? packed : std::string("{\"is_occupied\":true}");
+        CHECK(wire.deserialize(out, response(cases[i].type, body)) == DeserializationError::Ok);
+        CHECK(out["is_occupied"] == true);
+        CHECK_EQ(wire.encoding(), cases[i].binary ? WIRE_MSGPACK : WIRE_JSON);
+        CHECK_EQ(wire.stats().received[cases[i].binary ? WIRE_MSGPACK : WIRE_JSON], 1);
+
+        // The other encoding under this Content-Type does not parse
+        StaticJsonDocument<64> wrong;
+        std::string other = cases[i].binary ? std::string("{\"is_occupied\":true}") : packed;
+        CHECK(wire.deserialize(wrong, response(cases[i].type, other)) != DeserializationError::Ok ||
+              wrong["is_occupied"] != true);
+    }
+
+    // The filtered overload decodes the same way
+    WireFormat wire;
+    StaticJsonDocument<1024> full, filter, out;
+    batch(full);
+    filter["epoch"] = true;
+    CHECK(wire.deserialize(out, response(WIRE_MIME_MSGPACK, msgpack(full)), filter) == DeserializationError::Ok);
+    CHECK_EQ(out["epoch"].as<uint32_t>(), 2841553617u);
+    CHECK(out["events"].isNull());
+    CHECK_EQ(wire.encoding(), WIRE_MSGPACK);
+}
+
+static void fallsBackToJson() {
+    StaticJsonDocument<1024> doc, reply;
+    batch(doc);
+    char body[256];
+    std::string hello = msgpack(doc);
+
+    static const int REFUSED[] = { 400, 415 };
+    for (int status : REFUSED) {
+        WireFormat wire;
+        CHECK(wire.deserialize(reply, response(WIRE_MIME_MSGPACK, hello)) == DeserializationError::Ok);
+
+        // Other outcomes keep MessagePack
+        static const int KEPT[] = { 200, 404, 500, HTTP_ERR_CONNECT };
+        for (int other : KEPT) {
+            CHECK(wire.serialize(doc, body, sizeof(body)) > 0);
+            CHECK(!wire.onStatus(other));
+            CHECK_EQ(wire.encoding(), WIRE_MSGPACK);
+        }
+
+        // Refused: resend as JSON, which is not retried again
+        CHECK(wire.serialize(doc, body, sizeof(body)) > 0);
+        CHECK(wire.onStatus(status));
+        CHECK_EQ(wire.encoding(), WIRE_JSON);
+        CHECK(strcmp(wire.contentType(), WIRE_MIME_JSON) == 0);
+        CHECK(wire.serialize(doc, body, sizeof(body)) > 0 && body[0] == '{');
+        CHECK(!wire.onStatus(status));
+        CHECK_EQ(wire.stats().fallbacks, 1);
+
+        // For good: MessagePack answers no longer switch bodies back
+        CHECK(wire.deserialize(reply, response(WIRE_MIME_MSGPACK, hello)) == DeserializationError::Ok);
+        CHECK_EQ(wire.encoding(), WIRE_JSON);
+        CHECK(wire.serialize(doc, body, sizeof(body)) > 0 && body[0] == '{');
+        CHECK(!wire.onStatus(400));
+        CHECK(!wire.onStatus(415));
+        CHECK_EQ(wire.stats().fallbacks, 1);
+    }
+
+    // A JSON body refused with 400 is a real error, not a negotiation
+    WireFormat json;
+    CHECK(json.serialize(doc, body, sizeof(body)) > 0);
+    CHECK(!json.onStatus(400));
+    CHECK(!json.onStatus(415));
+    CHECK_EQ(json.stats().fallbacks, 0);
+}
+
+int main() {
+    HostSerial::mute(getenv("HOST_VERBOSE") == NULL);
+    negotiates();
+    decodesByContentType();
+    fallsBackToJson();
+    return hostTestResult("test_wire_format");
+}
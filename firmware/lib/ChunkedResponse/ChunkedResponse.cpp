@@ -0,0 +1,113 @@
+/*
+ * ChunkedResponse - see ChunkedResponse.h
+ */
+
+#include "ChunkedResponse.h"
+
+#define CHUNK_HEAD_ROOM     6         // Up to 4 hex digits + CRLF
+
+static_assert(RESPONSE_CHUNK_SIZE <= 0xFFFF, "chunk size must fit 4 hex digits");
+
+static const char *reasonPhrase(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 503: return "Service Unavailable";
+        default:  return code < 400 ? "OK" : "Internal Server Error";
+    }
+}
+
+ChunkedResponse::ChunkedResponse(Client &client)
+    : _client(client),
+      _len(0),
+      _sent(0) {
+}
+
+void ChunkedResponse::begin(int code, const char *contentType) {
+    // The buffer is still empty; borrow it for the head
+    int n = snprintf(_buf, sizeof(_buf),
+                     "HTTP/1.1 %d %s\r\n"
+                     "Content-Type: %s\r\n"
+                     "Access-Control-Allow-Origin: *\r\n"
+                     "Cache-Control: no-cache\r\n"
+                     "Transfer-Encoding: chunked\r\n"
+                     "Connection: close\r\n"
+                     "\r\n",
+                     code, reasonPhrase(code), contentType);
+    if (n > 0) {
+        _client.write((const uint8_t *)_buf, (size_t)n < sizeof(_buf) ? n : sizeof(_buf) - 1);
+    }
+}
+
+size_t ChunkedResponse::write(uint8_t c) {
+    _buf[CHUNK_HEAD_ROOM + _len++] = c;
+    if (_len == RESPONSE_CHUNK_SIZE) {
+        flush();
+    }
+    return 1;
+}
+
+size_t ChunkedResponse::write(const uint8_t *data, size_t len) {
+    size_t left = len;
+    while (left > 0) {
+        size_t n = RESPONSE_CHUNK_SIZE - _len;
+        if (n > left) {
+            n = left;
+        }
+        memcpy(_buf + CHUNK_HEAD_ROOM + _len, data, n);
+        _len += n;
+        data += n;
+        left -= n;
+        if (_len == RESPONSE_CHUNK_SIZE) {
+            flush();
+        }
+    }
+    return len;
+}
+
+void ChunkedResponse::render(const char *tmpl, TemplateFiller fill) {
+    char name[RESPONSE_MAX_FIELD + 1];
+    const char *p = tmpl;
+    while (*p) {
+        const char *open = strstr(p, "{{");
+        const char *close = open ? strstr(open + 2, "}}") : NULL;
+        if (!close) {
+            write((const uint8_t *)p, strlen(p));
+            return;
+        }
+        write((const uint8_t *)p, open - p);
+
+        size_t len = close - (open + 2);
+        if (len > RESPONSE_MAX_FIELD) {
+            len = RESPONSE_MAX_FIELD;
+        }
+        memcpy(name, open + 2, len);
+        name[len] = '\0';
+        fill(*this, name);
+        p = close + 2;
+    }
+}
+
+size_t ChunkedResponse::end() {
+    flush();
+    _client.write((const uint8_t *)"0\r\n\r\n", 5);
+    _client.stop();
+    return _sent;
+}
+
+// Sends the buffered data as one chunk with a single socket write
+void ChunkedResponse::flush() {
+    if (_len == 0) {
+        return;
+    }
+    char head[CHUNK_HEAD_ROOM + 1];
+    int n = snprintf(head, sizeof(head), "%x\r\n", (unsigned)_len);
+    char *start = _buf + CHUNK_HEAD_ROOM - n;
+    memcpy(start, head, n);
+    _buf[CHUNK_HEAD_ROOM + _len] = '\r';
+    _buf[CHUNK_HEAD_ROOM + _len + 1] = '\n';
+    _client.write((const uint8_t *)start, n + _len + 2);
+    _sent += _len;
+    _len = 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * ChunkedResponse - HTTP response streamed from a fixed buffer, no heap
+ *
+ * A Print that collects the body in a RESPONSE_CHUNK_SIZE buffer and sends
+ * each full buffer as one chunk (Transfer-Encoding: chunked), so a page or
+ * JSON document of any size never exists as a String. The response head
+ * is written directly too, instead of through WebServer::send().
+ *
+ * JSON, straight from ArduinoJson:
+ *   WiFiClient client = server.client();
+ *   ChunkedResponse out(client);
+ *   out.begin(200, "application/json");
+ *   serializeJson(doc, out);
+ *   out.end();
+ *
+ * HTML from a template in flash; {{name}} placeholders are filled by a
+ * callback that prints the value:
+ *   void fill(Print &out, const char *name) {
+ *       if (!strcmp(name, "free")) out.print(freeSlots);
+ *   }
+ *   out.begin(200, "text/html");
+ *   out.render(PAGE, fill);
+ *   out.end();
+ *
+ * The connection is closed by end(). Not thread-safe: one per response.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Client.h>
+
+#ifndef RESPONSE_CHUNK_SIZE
+#define RESPONSE_CHUNK_SIZE     512
+#endif
+
+#define RESPONSE_MAX_FIELD      24        // Longest placeholder name
+
+typedef void (*TemplateFiller)(Print &out, const char *name);
+
+class ChunkedResponse : public Print {
+public:
+    explicit ChunkedResponse(Client &client);
+
+    // Status line and headers; the body follows in chunks
+    void begin(int code, const char *contentType);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *data, size_t len) override;
+    using Print::write;
+
+    // Copies tmpl, replacing each {{name}} with what fill prints for it
+    void render(const char *tmpl, TemplateFiller fill);
+
+    // Last chunk, then closes the connection. Returns body bytes sent.
+    size_t end();
+
+private:
+    void flush();
+
+    Client &_client;
+    // Room for the chunk-size line in front of the data and CRLF behind it
+    char _buf[6 + RESPONSE_CHUNK_SIZE + 2];
+    size_t _len;
+    size_t _sent;
+};
@@ -0,0 +1,275 @@
+/*
+ * EventJournal - see EventJournal.h
+ */
+
+#include "EventJournal.h"
+
+#define RECORD_SIZE     sizeof(JournalRecord)
+#define RECORD_CRC_LEN  offsetof(JournalRecord, crc)
+#define STATE_CRC_LEN   offsetof(State, crc)
+
+EventJournal::EventJournal(fs::FS &fs, const char *logPath, const char *statePath)
+    : _fs(fs),
+      _logPath(logPath),
+      _statePath(statePath),
+      _ready(false),
+      _nextSeq(1),
+      _ackedSeq(0),
+      _boot(0),
+      _epoch(0),
+      _logSize(0),
+      _readOffset(0) {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+bool EventJournal::begin() {
+    loadState();
+    _boot++;
+
+    // Interrupted compaction: the old log is still the valid one
+    char tmpPath[64];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", _logPath);
+    if (_fs.exists(tmpPath)) {
+        _fs.remove(tmpPath);
+    }
+
+    // Keep the longest run of valid records with increasing sequences
+    size_t fileSize = 0;
+    uint32_t lastSeq = 0;
+    bool foundPending = false;
+    _logSize = 0;
+    _readOffset = 0;
+
+    File f = _fs.open(_logPath, "r");
+    if (f) {
+        fileSize = f.size();
+        JournalRecord rec;
+        while (f.read((uint8_t *)&rec, RECORD_SIZE) == RECORD_SIZE) {
+            if (rec.crc != crc32((const uint8_t *)&rec, RECORD_CRC_LEN) ||
+                (lastSeq != 0 && rec.seq <= lastSeq)) {
+                break;
+            }
+            if (!foundPending && rec.seq > _ackedSeq) {
+                _readOffset = _logSize;
+                foundPending = true;
+            }
+            lastSeq = rec.seq;
+            _logSize += RECORD_SIZE;
+        }
+        f.close();
+    }
+    if (!foundPending) {
+        _readOffset = _logSize;
+    }
+
+    _nextSeq = (lastSeq > _ackedSeq ? lastSeq : _ackedSeq) + 1;
+    _ready = true;
+
+    if (fileSize > _logSize) {
+        _stats.recovered += fileSize - _logSize;
+        Serial.printf("[JOURNAL] Discarded %u torn byte(s)\n", (unsigned)(fileSize - _logSize));
+        compact();
+    } else if (_readOffset >= JOURNAL_COMPACT_BYTES) {
+        compact();
+    }
+
+    Serial.printf("[JOURNAL] Boot %u, %u event(s) pending\n", _boot, (unsigned)pending());
+    return saveState();
+}
+
+bool EventJournal::append(uint8_t type, uint32_t timestampMs, uint32_t &seq) {
+    if (!_ready) {
+        return false;
+    }
+    if (_logSize + RECORD_SIZE > JOURNAL_MAX_BYTES && _readOffset > 0) {
+        compact();
+    }
+    if (_logSize + RECORD_SIZE > JOURNAL_MAX_BYTES) {
+        _stats.dropped++;
+        return false;
+    }
+
+    JournalRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.seq = _nextSeq;
+    rec.type = type;
+    rec.boot = _boot;
+    rec.timestampMs = timestampMs;
+    rec.crc = crc32((const uint8_t *)&rec, RECORD_CRC_LEN);
+
+    File f = _fs.open(_logPath, "a");
+    if (!f) {
+        return false;
+    }
+    size_t written = f.write((const uint8_t *)&rec, RECORD_SIZE);
+    f.close();
+    if (written != RECORD_SIZE) {
+        // Cut off the partial record now; failing that, begin() will
+        _ready = compact();
+        return false;
+    }
+
+    _logSize += RECORD_SIZE;
+    seq = _nextSeq++;
+    _stats.appended++;
+    return true;
+}
+
+size_t EventJournal::peek(JournalRecord *out, size_t max) {
+    if (!_ready || _readOffset >= _logSize || max == 0) {
+        return 0;
+    }
+
+    File f = _fs.open(_logPath, "r");
+    if (!f || !f.seek(_readOffset)) {
+        return 0;
+    }
+    size_t count = 0;
+    size_t offset = _readOffset;
+    while (count < max && offset < _logSize &&
+           f.read((uint8_t *)&out[count], RECORD_SIZE) == RECORD_SIZE) {
+        offset += RECORD_SIZE;
+        count++;
+    }
+    f.close();
+    return count;
+}
+
+uint32_t EventJournal::reserve() {
+    if (pending() > 0) {
+        return 0;
+    }
+    if (_epoch == 0) {
+        // No journal this boot: numbers start at 1 again
+        _epoch = newEpoch();
+    }
+    return _nextSeq++;
+}
+
+bool EventJournal::ack(uint32_t seq) {
+    if (seq >= _nextSeq) {
+        seq = _nextSeq - 1;
+    }
+    if (seq <= _ackedSeq) {
+        return true;
+    }
+
+    // Pending records are consecutive (gaps from reserve() only come before
+    // them), so the read offset moves by whole records
+    uint32_t count = seq - _ackedSeq;
+    _readOffset += count * RECORD_SIZE;
+    if (_readOffset > _logSize) {
+        _readOffset = _logSize;
+    }
+    _ackedSeq = seq;
+    _stats.acked += count;
+    if (!_ready) {
+        // Reserved numbers still move on without a usable log
+        return false;
+    }
+
+    if (pending() == 0 && _logSize >= JOURNAL_COMPACT_BYTES) {
+        compact();
+    }
+    return saveState();
+}
+
+bool EventJournal::loadState() {
+    State st;
+    File f = _fs.open(_statePath, "r");
+    if (f) {
+        // A state file of any other size is corrupt
+        bool ok = f.size() == sizeof(State) &&
+                  f.read((uint8_t *)&st, sizeof(st)) == sizeof(st) &&
+                  st.crc == crc32((const uint8_t *)&st, STATE_CRC_LEN) && st.epoch != 0;
+        f.close();
+        if (ok) {
+            _ackedSeq = st.ackedSeq;
+            _boot = st.boot;
+            _epoch = st.epoch;
+            return true;
+        }
+    }
+    _ackedSeq = 0;
+    _boot = 0;
+    _epoch = newEpoch();
+    return false;
+}
+
+bool EventJournal::saveState() {
+    State st;
+    memset(&st, 0, sizeof(st));
+    st.ackedSeq = _ackedSeq;
+    st.boot = _boot;
+    st.epoch = _epoch;
+    st.crc = crc32((const uint8_t *)&st, STATE_CRC_LEN);
+
+    File f = _fs.open(_statePath, "w");
+    if (!f) {
+        return false;
+    }
+    bool ok = f.write((const uint8_t *)&st, sizeof(st)) == sizeof(st);
+    f.close();
+    return ok;
+}
+
+// Rewrites the log with only the unacknowledged records. The new log is
+// written beside the old one and renamed over it, so a crash at any point
+// leaves one complete log.
+bool EventJournal::compact() {
+    char tmpPath[64];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", _logPath);
+
+    File out = _fs.open(tmpPath, "w");
+    if (!out) {
+        return false;
+    }
+    File in = _fs.open(_logPath, "r");
+    size_t kept = 0;
+    if (in && in.seek(_readOffset)) {
+        uint8_t buf[16 * RECORD_SIZE];
+        size_t offset = _readOffset;
+        while (offset < _logSize) {
+            size_t want = _logSize - offset < sizeof(buf) ? _logSize - offset : sizeof(buf);
+            size_t got = in.read(buf, want);
+            if (got == 0 || out.write(buf, got) != got) {
+                break;
+            }
+            offset += got;
+            kept += got;
+        }
+    }
+    if (in) {
+        in.close();
+    }
+    out.close();
+
+    if (kept != _logSize - _readOffset || !_fs.rename(tmpPath, _logPath)) {
+        _fs.remove(tmpPath);
+        return false;
+    }
+
+    _logSize = kept;
+    _readOffset = 0;
+    _stats.compactions++;
+    return true;
+}
+
+uint32_t EventJournal::newEpoch() {
+    uint32_t epoch;
+    do {
+        epoch = esp_random();
+    } while (epoch == 0);
+    return epoch;
+}
+
+uint32_t EventJournal::crc32(const uint8_t *data, size_t len) {
+    uint32_t crc = 0xFFFFFFFF;
+    while (len--) {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
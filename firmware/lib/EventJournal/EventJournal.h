@@ -0,0 +1,117 @@
+/*
+ * EventJournal - Append-only flash journal for gate events
+ *
+ * Every event is appended to a LittleFS log with a sequence number before
+ * the uplink tries to deliver it, so sessions survive WiFi outages and
+ * reboots. Delivered events are acknowledged by sequence number; the
+ * uplink replays whatever is still unacknowledged, oldest first.
+ *
+ *   journal.begin();                          // After LittleFS.begin()
+ *   journal.append(GATE_EVENT_ENTRY, millis(), seq);
+ *   n = journal.peek(records, 8);             // Oldest undelivered
+ *   ... deliver ... journal.ack(records[n - 1].seq);
+ *
+ * Crash safety: each 16-byte record carries a CRC. begin() keeps the
+ * valid prefix of the log (CRCs intact, sequence numbers increasing; a
+ * reserve()d number leaves a gap) and rewrites it if a torn record is found at
+ * the tail (power lost mid-append). The acknowledged sequence lives in a
+ * small state file; LittleFS commits a file atomically on close, so it
+ * is either the old or the new value.
+ *
+ * Epoch: a random id drawn whenever sequence numbers may start over (no
+ * readable state, or no journal at all). The backend keeps its duplicate
+ * check per device and epoch, so a wiped journal is not mistaken for a
+ * replay.
+ *
+ * Flash wear: appends never rewrite old data. The log is only rewritten
+ * (unacknowledged records only) once it grows past JOURNAL_COMPACT_BYTES
+ * with nothing pending in front, or when it reaches JOURNAL_MAX_BYTES.
+ *
+ * Not thread-safe: use from a single task.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+#ifndef JOURNAL_MAX_BYTES
+#define JOURNAL_MAX_BYTES       (64 * 1024)  // 4096 records
+#endif
+
+#ifndef JOURNAL_COMPACT_BYTES
+#define JOURNAL_COMPACT_BYTES   (4 * 1024)
+#endif
+
+struct JournalRecord {
+    uint32_t seq;
+    uint8_t type;             // Caller defined (GateEventType)
+    uint8_t reserved;
+    uint16_t boot;            // Boot the event was recorded in
+    uint32_t timestampMs;     // millis() in that boot
+    uint32_t crc;
+};
+
+struct JournalStats {
+    uint32_t appended;
+    uint32_t acked;
+    uint32_t dropped;         // Appends refused because the journal was full
+    uint32_t recovered;       // Torn or corrupt bytes discarded by begin()
+    uint32_t compactions;
+};
+
+class EventJournal {
+public:
+    EventJournal(fs::FS &fs, const char *logPath = "/events.log",
+                 const char *statePath = "/events.state");
+
+    // Recovers the log and bumps the boot counter
+    bool begin();
+
+    // Appends one record; seq receives its sequence number
+    bool append(uint8_t type, uint32_t timestampMs, uint32_t &seq);
+
+    // Copies up to max of the oldest unacknowledged records
+    size_t peek(JournalRecord *out, size_t max);
+
+    // Next sequence number without a record, for an event that is sent
+    // directly because append() failed. Only while nothing is pending, so
+    // the backend still sees sequences in order; ack() it once sent or
+    // given up. Returns 0 while records are pending.
+    uint32_t reserve();
+
+    // Marks every record up to and including seq as delivered
+    bool ack(uint32_t seq);
+
+    uint32_t pending() const { return _nextSeq - 1 - _ackedSeq; }
+    uint16_t boot() const { return _boot; }
+    uint32_t epoch() const { return _epoch; }     // 0 until begin() or reserve()
+    const JournalStats &stats() const { return _stats; }
+
+private:
+    struct State {
+        uint32_t ackedSeq;
+        uint16_t boot;
+        uint16_t reserved;
+        uint32_t epoch;
+        uint32_t crc;
+    };
+
+    bool loadState();
+    static uint32_t newEpoch();
+    bool saveState();
+    bool compact();
+    static uint32_t crc32(const uint8_t *data, size_t len);
+
+    fs::FS &_fs;
+    const char *_logPath;
+    const char *_statePath;
+    bool _ready;
+    uint32_t _nextSeq;
+    uint32_t _ackedSeq;
+    uint16_t _boot;
+    uint32_t _epoch;
+    size_t _logSize;           // Bytes of valid records in the log
+    size_t _readOffset;        // Offset of the oldest unacknowledged record
+    JournalStats _stats;
+};
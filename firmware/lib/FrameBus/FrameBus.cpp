@@ -0,0 +1,142 @@
+/*
+ * FrameBus - see FrameBus.h
+ */
+
+#include "FrameBus.h"
+
+FrameBus::FrameBus() : _latest(-1) {
+    portMUX_INITIALIZE(&_lock);
+    memset(&_stats, 0, sizeof(_stats));
+    memset(&_newest, 0, sizeof(_newest));
+    for (uint8_t i = 0; i < FRAME_BUS_SLOTS; i++) {
+        _slots[i].fb = NULL;
+        _slots[i].refs = 0;
+    }
+}
+
+camera_fb_t *FrameBus::acquire(uint32_t maxAgeMs, FrameInfo *info) {
+    camera_fb_t *evicted = NULL;
+
+    portENTER_CRITICAL(&_lock);
+    if (_latest >= 0) {
+        Slot &s = _slots[_latest];
+        if (maxAgeMs > 0 && millis() - s.info.grabbedMs <= maxAgeMs) {
+            s.refs++;
+            _stats.reuses++;
+            if (info) {
+                *info = s.info;
+            }
+            camera_fb_t *fb = s.fb;
+            portEXIT_CRITICAL(&_lock);
+            return fb;
+        }
+        // Only the bus holds it and the driver would be left one buffer short
+        if (s.refs == 1 && heldCount() >= FRAME_BUS_SLOTS - 1) {
+            evicted = unref(_latest);
+            _latest = -1;
+            _stats.evictions++;
+        }
+    }
+    portEXIT_CRITICAL(&_lock);
+    if (evicted) {
+        esp_camera_fb_return(evicted);
+    }
+
+    // May block for a frame period; never under the lock
+    camera_fb_t *fb = esp_camera_fb_get();
+
+    portENTER_CRITICAL(&_lock);
+    if (!fb) {
+        _stats.failures++;
+        portEXIT_CRITICAL(&_lock);
+        return NULL;
+    }
+    int8_t slot = -1;
+    for (int8_t i = 0; i < FRAME_BUS_SLOTS; i++) {
+        if (!_slots[i].fb) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        _stats.drops++;
+        portEXIT_CRITICAL(&_lock);
+        esp_camera_fb_return(fb);
+        return NULL;
+    }
+
+    Slot &s = _slots[slot];
+    s.fb = fb;
+    s.refs = 2;               // Caller + bus
+    s.info.seq = _newest.seq + 1;
+    s.info.grabbedMs = millis();
+    _newest = s.info;
+    _stats.grabs++;
+    if (info) {
+        *info = s.info;
+    }
+    evicted = _latest >= 0 ? unref(_latest) : NULL;
+    _latest = slot;
+    portEXIT_CRITICAL(&_lock);
+
+    if (evicted) {
+        esp_camera_fb_return(evicted);
+    }
+    return fb;
+}
+
+void FrameBus::release(camera_fb_t *fb) {
+    if (!fb) {
+        return;
+    }
+    camera_fb_t *done = fb;   // Frames that did not come from the bus go straight back
+    portENTER_CRITICAL(&_lock);
+    for (int8_t i = 0; i < FRAME_BUS_SLOTS; i++) {
+        if (_slots[i].fb == fb) {
+            done = unref(i);
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    if (done) {
+        esp_camera_fb_return(done);
+    }
+}
+
+bool FrameBus::latest(FrameInfo &info) {
+    portENTER_CRITICAL(&_lock);
+    info = _newest;
+    portEXIT_CRITICAL(&_lock);
+    return info.seq != 0;
+}
+
+FrameBusStats FrameBus::stats() {
+    portENTER_CRITICAL(&_lock);
+    FrameBusStats s = _stats;
+    s.held = heldCount();
+    portEXIT_CRITICAL(&_lock);
+    return s;
+}
+
+uint8_t FrameBus::heldCount() const {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < FRAME_BUS_SLOTS; i++) {
+        if (_slots[i].fb) {
+            n++;
+        }
+    }
+    return n;
+}
+
+// Drops one reference under the lock; returns the buffer to hand back to
+// the driver (after unlocking) when it was the last one
+camera_fb_t *FrameBus::unref(int8_t index) {
+    Slot &s = _slots[index];
+    if (--s.refs > 0) {
+        return NULL;
+    }
+    camera_fb_t *fb = s.fb;
+    s.fb = NULL;
+    return fb;
+}
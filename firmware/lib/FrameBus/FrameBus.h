@@ -0,0 +1,86 @@
+/*
+ * FrameBus - Reference-counted camera frames shared between consumers
+ *
+ * The camera has only fb_count frame buffers. Without sharing, the stream,
+ * detection and /capture each call esp_camera_fb_get() and pin their own
+ * buffer, so detection had to pause whenever someone was watching. With
+ * the bus every consumer acquires frames through one place:
+ *   - acquire(maxAgeMs) hands out the newest frame if it is at most
+ *     maxAgeMs old (a reuse), and grabs a new one from the camera
+ *     otherwise.
+ *   - release() drops one reference; the buffer goes back to the driver
+ *     when the last holder releases it.
+ * The stream passes maxAgeMs = 0 (it always wants a new frame); detection
+ * and /capture ride along on whatever the stream last grabbed.
+ *
+ * The bus itself keeps a reference on the newest frame, so it can be
+ * served at once even after its consumers are done with it. That frame is
+ * let go (an eviction) before a grab whenever keeping it would leave the
+ * driver without a buffer to capture into.
+ *
+ * Every grab gets a sequence number; together with the grab time it tells
+ * a poller whether anything new was captured (see latest()).
+ *
+ *   FrameInfo info;
+ *   camera_fb_t *fb = frameBus.acquire(FRAME_SHARE_MAX_AGE_MS, &info);
+ *   if (fb) { ...; frameBus.release(fb); }
+ *
+ * Thread-safe: bookkeeping is under a spinlock; the camera is called with
+ * the lock released.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "freertos/FreeRTOS.h"
+
+// Frames referenced at once; match camera fb_count
+#ifndef FRAME_BUS_SLOTS
+#define FRAME_BUS_SLOTS         3
+#endif
+
+struct FrameInfo {
+    uint32_t seq;             // 1 for the first grab, +1 per grab
+    uint32_t grabbedMs;
+};
+
+struct FrameBusStats {
+    uint32_t grabs;           // Frames taken from the camera
+    uint32_t reuses;          // Acquires served from a frame already held
+    uint32_t failures;        // Camera returned no frame
+    uint32_t drops;           // Grabbed, but every slot was in use
+    uint32_t evictions;       // Newest frame let go to keep a buffer free
+    uint8_t held;             // Frames referenced right now
+};
+
+class FrameBus {
+public:
+    FrameBus();
+
+    // New reference to a frame no older than maxAgeMs; NULL if none
+    camera_fb_t *acquire(uint32_t maxAgeMs, FrameInfo *info = NULL);
+
+    void release(camera_fb_t *fb);
+
+    // Newest frame grabbed so far, held or not; false before the first
+    bool latest(FrameInfo &info);
+
+    FrameBusStats stats();
+
+private:
+    struct Slot {
+        camera_fb_t *fb;
+        uint8_t refs;         // Consumers, +1 while it is _latest
+        FrameInfo info;
+    };
+
+    uint8_t heldCount() const;
+    camera_fb_t *unref(int8_t index);
+
+    Slot _slots[FRAME_BUS_SLOTS];
+    int8_t _latest;           // Slot the bus keeps a reference on, -1 if none
+    FrameInfo _newest;        // Outlives the slot
+    portMUX_TYPE _lock;
+    FrameBusStats _stats;
+};
@@ -0,0 +1,90 @@
+/*
+ * GateController - see GateController.h
+ */
+
+#include "GateController.h"
+#include <string.h>
+
+GateController::GateController(const GateTimings &timings)
+    : _timings(timings),
+      _open(false),
+      _closeAtMs(0),
+      _message(GATE_MSG_NONE),
+      _messageUntilMs(0),
+      _waitingFull(false) {
+    memset(_cooldownUntilMs, 0, sizeof(_cooldownUntilMs));
+    memset(_seen, 0, sizeof(_seen));
+    memset(_lastSeenMs, 0, sizeof(_lastSeenMs));
+    memset(&_counters, 0, sizeof(_counters));
+}
+
+GateDecision GateController::onVehicle(GateSide side, bool slotAvailable, uint32_t nowMs) {
+    // Not an arrival, so a vehicle that waits out the cooldown is served
+    // as soon as it ends
+    if (before(nowMs, _cooldownUntilMs[side])) {
+        _counters.ignored++;
+        return GATE_IGNORED;
+    }
+
+    // Still the same vehicle if this side saw something moments ago,
+    // unless it was turned away at a full lot and a slot has freed since
+    bool sameVehicle = _seen[side] && nowMs - _lastSeenMs[side] < _timings.clearMs;
+    _seen[side] = true;
+    _lastSeenMs[side] = nowMs;
+    if (side == GATE_SIDE_ENTRY && _waitingFull && slotAvailable) {
+        sameVehicle = false;
+    }
+    if (sameVehicle) {
+        _counters.ignored++;
+        return GATE_IGNORED;
+    }
+    if (side == GATE_SIDE_ENTRY) {
+        _waitingFull = false;
+    }
+
+    // Keep the other sensor from reacting to the same vehicle passing through
+    GateSide other = side == GATE_SIDE_ENTRY ? GATE_SIDE_EXIT : GATE_SIDE_ENTRY;
+    _cooldownUntilMs[other] = nowMs + _timings.cooldownMs;
+
+    if (side == GATE_SIDE_EXIT) {
+        open(nowMs);
+        show(GATE_MSG_GOODBYE, nowMs);
+        _counters.released++;
+        return GATE_RELEASE;
+    }
+    if (!slotAvailable) {
+        _waitingFull = true;
+        show(GATE_MSG_FULL, nowMs);
+        _counters.rejected++;
+        return GATE_REJECT_FULL;
+    }
+    open(nowMs);
+    show(GATE_MSG_WELCOME, nowMs);
+    _counters.admitted++;
+    return GATE_ADMIT;
+}
+
+uint8_t GateController::update(uint32_t nowMs) {
+    uint8_t actions = 0;
+
+    if (_open && !before(nowMs, _closeAtMs)) {
+        _open = false;
+        actions |= GATE_ACTION_CLOSE;
+    }
+    if (_message != GATE_MSG_NONE && !before(nowMs, _messageUntilMs)) {
+        _message = GATE_MSG_NONE;
+        actions |= GATE_ACTION_RESTORE_DISPLAY;
+    }
+    return actions;
+}
+
+void GateController::open(uint32_t nowMs) {
+    // A second vehicle while open extends the open time
+    _open = true;
+    _closeAtMs = nowMs + _timings.openMs;
+}
+
+void GateController::show(GateMessage msg, uint32_t nowMs) {
+    _message = msg;
+    _messageUntilMs = nowMs + _timings.messageMs;
+}
@@ -0,0 +1,98 @@
+/*
+ * GateController - Timer-driven state machine for the entry/exit gate
+ *
+ * Owns everything about the gate that depends on time: auto-close, how
+ * long an LCD message stays up, and the cross-sensor cooldowns. Nothing
+ * in here blocks or touches hardware; every call takes the current time,
+ * so the same code runs against millis() on the device and against a
+ * virtual clock on the host.
+ *
+ *   GateDecision d = gate.onVehicle(GATE_SIDE_ENTRY, slotsFree, millis());
+ *   if (d == GATE_ADMIT) { servo open, queue entry event, show welcome }
+ *   loop: uint8_t act = gate.update(millis());
+ *         if (act & GATE_ACTION_CLOSE) { servo close }
+ *         if (act & GATE_ACTION_RESTORE_DISPLAY) { redraw slot count }
+ *
+ * A vehicle is reported once per arrival: a side re-arms only after it
+ * has seen nothing for clearMs, so a car waiting at the sensor does not
+ * trigger again every ping. Samples during a side's cooldown are not
+ * arrivals, so a car that pulled up meanwhile is served when it ends;
+ * a car turned away at a full lot is admitted once a slot frees.
+ *
+ * Not thread-safe: call from a single task.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+enum GateSide : uint8_t {
+    GATE_SIDE_ENTRY,
+    GATE_SIDE_EXIT
+};
+
+enum GateDecision : uint8_t {
+    GATE_IGNORED,         // Same vehicle still present, or side in cooldown
+    GATE_ADMIT,           // Entry with a free slot: open the gate
+    GATE_REJECT_FULL,     // Entry while the lot is full: gate stays closed
+    GATE_RELEASE          // Exit: open the gate
+};
+
+enum GateMessage : uint8_t {
+    GATE_MSG_NONE,        // Normal slot display
+    GATE_MSG_WELCOME,
+    GATE_MSG_FULL,
+    GATE_MSG_GOODBYE
+};
+
+// Bits returned by update()
+#define GATE_ACTION_CLOSE            0x01
+#define GATE_ACTION_RESTORE_DISPLAY  0x02
+
+struct GateTimings {
+    uint32_t openMs;      // Gate stays open this long
+    uint32_t messageMs;   // LCD message shown this long
+    uint32_t cooldownMs;  // Opposite sensor ignored this long after a trigger
+    uint32_t clearMs;     // Side re-arms after no detection for this long
+};
+
+struct GateCounters {
+    uint32_t admitted;
+    uint32_t released;
+    uint32_t rejected;
+    uint32_t ignored;     // Detections that did not start a new arrival
+};
+
+class GateController {
+public:
+    explicit GateController(const GateTimings &timings);
+
+    // A detection on one side; call for every sample inside the threshold
+    GateDecision onVehicle(GateSide side, bool slotAvailable, uint32_t nowMs);
+
+    // Advances timers, returns GATE_ACTION_* bits for the caller to carry out
+    uint8_t update(uint32_t nowMs);
+
+    bool isOpen() const { return _open; }
+    GateMessage message() const { return _message; }
+    const GateCounters &counters() const { return _counters; }
+
+private:
+    static bool before(uint32_t nowMs, uint32_t deadlineMs) {
+        return (int32_t)(nowMs - deadlineMs) < 0;
+    }
+
+    void open(uint32_t nowMs);
+    void show(GateMessage msg, uint32_t nowMs);
+
+    GateTimings _timings;
+    bool _open;
+    uint32_t _closeAtMs;
+    GateMessage _message;
+    uint32_t _messageUntilMs;
+    uint32_t _cooldownUntilMs[2];  // Per side
+    bool _seen[2];                 // Side has detected since boot
+    uint32_t _lastSeenMs[2];
+    bool _waitingFull;             // Entry vehicle turned away, still there
+    GateCounters _counters;
+};
@@ -0,0 +1,181 @@
+/*
+ * HttpEndpoint - see HttpEndpoint.h
+ */
+
+#include "HttpEndpoint.h"
+
+HttpEndpoint::HttpEndpoint(const char *name, const char *baseUrl)
+    : _name(name), _accept(NULL), _writtenAt(0), _head(0), _inFlight(0) {
+    _valid = _base.parse(baseUrl);
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+int HttpEndpoint::get(const char *path, HttpResponse &resp, uint32_t timeoutMs) {
+    return exchange("GET", path, NULL, NULL, 0, NULL, resp, timeoutMs);
+}
+
+int HttpEndpoint::post(const char *path, const char *contentType, const uint8_t *body, size_t len,
+                       HttpResponse &resp, uint32_t timeoutMs) {
+    return exchange("POST", path, contentType, body, len, NULL, resp, timeoutMs);
+}
+
+int HttpEndpoint::postMultipart(const char *path, const MultipartUploader &uploader,
+                                const uint8_t *data, size_t len, HttpResponse &resp, uint32_t timeoutMs) {
+    return exchange("POST", path, MULTIPART_CONTENT_TYPE, data, len, &uploader, resp, timeoutMs);
+}
+
+int HttpEndpoint::exchange(const char *method, const char *path, const char *contentType,
+                           const uint8_t *body, size_t len, const MultipartUploader *multipart,
+                           HttpResponse &resp, uint32_t timeoutMs) {
+    if (_inFlight > 0) {
+        // Synchronous call in the middle of a pipeline would mix up responses
+        return HTTP_ERR_SEND;
+    }
+
+    int code = HTTP_ERR_CONNECT;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        bool reused = _client.connected();
+        size_t contentLen = multipart ? multipart->contentLength(len) : len;
+
+        bool ok = writeHead(method, path, contentType, contentLen);
+        if (ok && multipart) {
+            ok = multipart->writePreamble(_client) &&
+                 multipart->writeData(_client, body, len) &&
+                 multipart->writeTail(_client);
+        } else if (ok && len > 0) {
+            ok = _client.write(body, len) == len;
+        }
+
+        if (!ok) {
+            code = _client.connected() || reused ? HTTP_ERR_SEND : HTTP_ERR_CONNECT;
+            close();
+            _stats.failures++;
+            if (reused) {
+                continue;
+            }
+            return code;
+        }
+
+        _writtenAt = micros();
+        code = receive(resp, timeoutMs);
+        if (code == HTTP_ERR_CLOSED && reused) {
+            // Server dropped the idle keep-alive socket, retry on a new one
+            continue;
+        }
+        return code;
+    }
+    return code;
+}
+
+bool HttpEndpoint::send(const char *method, const char *path, const char *contentType,
+                        const uint8_t *body, size_t len) {
+    if (_inFlight >= HTTP_MAX_PIPELINE) {
+        return false;
+    }
+    if (!writeHead(method, path, contentType, len) ||
+        (len > 0 && _client.write(body, len) != len)) {
+        close();
+        _stats.failures++;
+        return false;
+    }
+    return true;
+}
+
+int HttpEndpoint::receive(HttpResponse &resp, uint32_t timeoutMs) {
+    if (_inFlight == 0) {
+        return HTTP_ERR_PROTOCOL;
+    }
+
+    int code = readHttpResponse(_client, resp, timeoutMs);
+    uint32_t sentAt = _sentAt[_head];
+    _head = (_head + 1) % HTTP_MAX_PIPELINE;
+    _inFlight--;
+
+    if (code < 0) {
+        // Responses still outstanding on this socket are lost with it
+        _stats.failures += 1 + _inFlight;
+        close();
+        return code;
+    }
+
+    recordLatency(micros() - sentAt);
+    if (!resp.keepAlive) {
+        close();
+    }
+    return code;
+}
+
+void HttpEndpoint::close() {
+    _client.stop();
+    _head = 0;
+    _inFlight = 0;
+}
+
+bool HttpEndpoint::ensureConnected() {
+    if (_client.connected()) {
+        return true;
+    }
+    if (!_valid) {
+        return false;
+    }
+
+    // Unread bytes on a half-closed socket would poison the next response
+    close();
+    if (!_client.connect(_base.host, _base.port, HTTP_CONNECT_TIMEOUT_MS)) {
+        return false;
+    }
+    _client.setNoDelay(true);
+    _stats.connects++;
+    return true;
+}
+
+bool HttpEndpoint::writeHead(const char *method, const char *path, const char *contentType, size_t len) {
+    if (_inFlight == 0 && !ensureConnected()) {
+        return false;
+    }
+
+    // Base URL path ("http://host:port/prefix") is prepended to path
+    const char *prefix = strcmp(_base.path, "/") == 0 ? "" : _base.path;
+
+    char head[320];
+    int n = snprintf(head, sizeof(head),
+                     "%s %s%s HTTP/1.1\r\n"
+                     "Host: %s:%u\r\n"
+                     "Connection: keep-alive\r\n",
+                     method, prefix, path, _base.host, _base.port);
+    if (n > 0 && _accept && (size_t)n < sizeof(head)) {
+        n += snprintf(head + n, sizeof(head) - n, "Accept: %s\r\n", _accept);
+    }
+    if (n > 0 && contentType && (size_t)n < sizeof(head)) {
+        n += snprintf(head + n, sizeof(head) - n,
+                      "Content-Type: %s\r\n"
+                      "Content-Length: %u\r\n",
+                      contentType, (unsigned)len);
+    }
+    if (n > 0 && (size_t)n < sizeof(head)) {
+        n += snprintf(head + n, sizeof(head) - n, "\r\n");
+    }
+    if (n < 0 || (size_t)n >= sizeof(head)) {
+        return false;
+    }
+
+    uint32_t now = micros();
+    if (_client.write((const uint8_t *)head, n) != (size_t)n) {
+        return false;
+    }
+
+    _sentAt[(_head + _inFlight) % HTTP_MAX_PIPELINE] = now;
+    _inFlight++;
+    _stats.requests++;
+    return true;
+}
+
+void HttpEndpoint::recordLatency(uint32_t us) {
+    _stats.lastLatencyUs = us;
+    if (us > _stats.maxLatencyUs) {
+        _stats.maxLatencyUs = us;
+    }
+    _stats.avgLatencyUs = _stats.avgLatencyUs == 0
+        ? us
+        : _stats.avgLatencyUs - (_stats.avgLatencyUs >> 3) + (us >> 3);
+}
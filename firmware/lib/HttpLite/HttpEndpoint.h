@@ -0,0 +1,88 @@
+/*
+ * HttpEndpoint - One persistent keep-alive connection per remote service
+ *
+ * The device keeps one HttpEndpoint per service (backend, AI service);
+ * together they are its connection pool. Requests reuse the open socket,
+ * so an event costs one round trip instead of a TCP handshake + request.
+ *
+ * - Reconnects transparently; a request that fails on a reused socket
+ *   (server closed it while idle) is retried once on a fresh one.
+ * - Pipelining: send() several requests, then receive() the responses in
+ *   order (up to HTTP_MAX_PIPELINE in flight).
+ * - Per-endpoint latency (request written -> response read) in stats().
+ *
+ * Not thread-safe: use each endpoint from a single task.
+ */
+
+#pragma once
+
+#include <WiFi.h>
+#include "HttpLite.h"
+#include "MultipartUploader.h"
+
+#ifndef HTTP_MAX_PIPELINE
+#define HTTP_MAX_PIPELINE       8
+#endif
+
+#ifndef HTTP_CONNECT_TIMEOUT_MS
+#define HTTP_CONNECT_TIMEOUT_MS 3000
+#endif
+
+struct HttpEndpointStats {
+    uint32_t requests;
+    uint32_t failures;
+    uint32_t connects;        // TCP handshakes, 1 per reconnect
+    uint32_t lastLatencyUs;
+    uint32_t avgLatencyUs;    // Exponential moving average (1/8)
+    uint32_t maxLatencyUs;
+};
+
+class HttpEndpoint {
+public:
+    HttpEndpoint(const char *name, const char *baseUrl);
+
+    // Synchronous requests (with one retry on a stale connection)
+    int get(const char *path, HttpResponse &resp, uint32_t timeoutMs);
+    int post(const char *path, const char *contentType, const uint8_t *body, size_t len,
+             HttpResponse &resp, uint32_t timeoutMs);
+    int postMultipart(const char *path, const MultipartUploader &uploader,
+                      const uint8_t *data, size_t len, HttpResponse &resp, uint32_t timeoutMs);
+
+    // Pipelined requests: send() returns false if the request could not be
+    // written; receive() reads the oldest outstanding response.
+    bool send(const char *method, const char *path, const char *contentType,
+              const uint8_t *body, size_t len);
+    int receive(HttpResponse &resp, uint32_t timeoutMs);
+    uint8_t inFlight() const { return _inFlight; }
+
+    void close();
+
+    // Accept header sent with every request (NULL = none)
+    void setAccept(const char *accept) { _accept = accept; }
+
+    const char *name() const { return _name; }
+    bool valid() const { return _valid; }
+    const HttpEndpointStats &stats() const { return _stats; }
+
+    // micros() when the last synchronous request was fully written
+    uint32_t lastWrittenUs() const { return _writtenAt; }
+
+private:
+    int exchange(const char *method, const char *path, const char *contentType,
+                 const uint8_t *body, size_t len, const MultipartUploader *multipart,
+                 HttpResponse &resp, uint32_t timeoutMs);
+    bool ensureConnected();
+    bool writeHead(const char *method, const char *path, const char *contentType, size_t len);
+    void recordLatency(uint32_t us);
+
+    const char *_name;
+    HttpUrl _base;
+    bool _valid;
+    const char *_accept;
+    WiFiClient _client;
+    uint32_t _sentAt[HTTP_MAX_PIPELINE];   // micros() per outstanding request
+    uint32_t _writtenAt;
+    uint8_t _head;
+    uint8_t _inFlight;
+    HttpEndpointStats _stats;
+};
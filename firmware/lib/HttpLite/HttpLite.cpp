@@ -0,0 +1,241 @@
+/*
+ * HttpLite - see HttpLite.h
+ */
+
+#include "HttpLite.h"
+#include <stdint.h>
+
+bool HttpUrl::parse(const char *url) {
+    return parse(url, "");
+}
+
+bool HttpUrl::parse(const char *base, const char *extraPath) {
+    const char *p = base;
+    if (strncmp(p, "http://", 7) == 0) {
+        p += 7;
+    }
+
+    // Host ends at ':' or '/' or end of string
+    size_t hostLen = strcspn(p, ":/");
+    if (hostLen == 0 || hostLen >= sizeof(host)) {
+        return false;
+    }
+    memcpy(host, p, hostLen);
+    host[hostLen] = '\0';
+    p += hostLen;
+
+    port = 80;
+    if (*p == ':') {
+        port = (uint16_t)strtoul(p + 1, (char **)&p, 10);
+    }
+
+    const char *basePath = (*p == '/') ? p : "";
+    size_t baseLen = strlen(basePath);
+    // Avoid "//" when base ends with '/' and extraPath starts with it
+    if (baseLen > 0 && basePath[baseLen - 1] == '/' && extraPath[0] == '/') {
+        baseLen--;
+    }
+    int n = snprintf(path, sizeof(path), "%.*s%s", (int)baseLen, basePath, extraPath);
+    if (n < 0 || (size_t)n >= sizeof(path)) {
+        return false;
+    }
+    if (path[0] == '\0') {
+        strcpy(path, "/");
+    }
+    return true;
+}
+
+// Reads one CRLF-terminated line into buf (without CRLF).
+// Returns length, -1 on timeout or -2 if the peer closed.
+static int readLine(Client &client, char *buf, size_t size, uint32_t deadline) {
+    size_t len = 0;
+    while (true) {
+        int c = client.read();
+        if (c < 0) {
+            if (!client.connected() && !client.available()) {
+                return -2;
+            }
+            if ((int32_t)(millis() - deadline) >= 0) {
+                return -1;
+            }
+            delay(1);
+            continue;
+        }
+        if (c == '\n') {
+            if (len > 0 && buf[len - 1] == '\r') {
+                len--;
+            }
+            buf[len] = '\0';
+            return len;
+        }
+        if (len < size - 1) {
+            buf[len++] = (char)c;
+        }
+    }
+}
+
+int readHttpHead(Client &client, HttpResponse &resp, uint32_t timeoutMs) {
+    uint32_t deadline = millis() + timeoutMs;
+    char line[128];
+
+    resp.status = 0;
+    resp.keepAlive = true;
+    resp.chunked = false;
+    resp.contentLength = SIZE_MAX;
+    resp.contentType[0] = '\0';
+    resp.body = "";
+
+    // Status line: "HTTP/1.1 200 OK"
+    int statusLen = readLine(client, line, sizeof(line), deadline);
+    if (statusLen < 0) {
+        return statusLen == -2 ? HTTP_ERR_CLOSED : HTTP_ERR_TIMEOUT;
+    }
+    if (strncmp(line, "HTTP/1.", 7) != 0 || strlen(line) < 12) {
+        return HTTP_ERR_PROTOCOL;
+    }
+    if (line[7] == '0') {
+        resp.keepAlive = false;  // HTTP/1.0 closes by default
+    }
+    resp.status = atoi(line + 9);
+
+    // Headers
+    while (true) {
+        int len = readLine(client, line, sizeof(line), deadline);
+        if (len < 0) {
+            return HTTP_ERR_TIMEOUT;
+        }
+        if (len == 0) {
+            break;
+        }
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            resp.contentLength = strtoul(line + 15, NULL, 10);
+        } else if (strncasecmp(line, "Connection:", 11) == 0) {
+            const char *v = line + 11;
+            while (*v == ' ') {
+                v++;
+            }
+            resp.keepAlive = strncasecmp(v, "close", 5) != 0;
+        } else if (strncasecmp(line, "Content-Type:", 13) == 0) {
+            const char *v = line + 13;
+            while (*v == ' ') {
+                v++;
+            }
+            size_t n = strcspn(v, "; ");
+            if (n >= sizeof(resp.contentType)) {
+                n = sizeof(resp.contentType) - 1;
+            }
+            memcpy(resp.contentType, v, n);
+            resp.contentType[n] = '\0';
+        } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+            // "chunked" is always the last coding; anything else (gzip
+            // alone) is left to read-until-close
+            size_t n = strlen(line);
+            resp.chunked = n >= 25 && strcasecmp(line + n - 7, "chunked") == 0;
+        }
+    }
+
+    // These never carry a body
+    if (resp.status < 200 || resp.status == 204 || resp.status == 304) {
+        resp.contentLength = 0;
+        resp.chunked = false;
+    }
+    if (resp.chunked) {
+        // Chunk sizes frame the body, a Content-Length next to them is void
+        resp.contentLength = SIZE_MAX;
+    } else if (resp.contentLength == SIZE_MAX) {
+        resp.keepAlive = false;
+    }
+    return resp.status;
+}
+
+// Reads len body bytes (or until close when len is SIZE_MAX), keeping the
+// first maxBody of the whole body. Returns the bytes read, fewer if the
+// peer closed, or -1 on timeout.
+static long readBody(Client &client, HttpResponse &resp, size_t len, size_t maxBody, uint32_t deadline) {
+    size_t got = 0;
+    while (got < len) {
+        int c = client.read();
+        if (c < 0) {
+            if (!client.connected() && !client.available()) {
+                break;
+            }
+            if ((int32_t)(millis() - deadline) >= 0) {
+                return -1;
+            }
+            delay(1);
+            continue;
+        }
+        if (resp.body.length() < maxBody) {
+            resp.body += (char)c;
+        }
+        got++;
+    }
+    return (long)got;
+}
+
+// Chunk-size line, data and CRLF per chunk up to the 0-size chunk, then
+// the trailer section
+static int readChunkedBody(Client &client, HttpResponse &resp, size_t maxBody, uint32_t deadline) {
+    char line[32];
+    while (true) {
+        int len = readLine(client, line, sizeof(line), deadline);
+        if (len < 0) {
+            return len == -2 ? HTTP_ERR_PROTOCOL : HTTP_ERR_TIMEOUT;
+        }
+        char *end;
+        size_t size = strtoul(line, &end, 16);
+        if (end == line) {
+            return HTTP_ERR_PROTOCOL;
+        }
+        if (size == 0) {
+            break;
+        }
+        long got = readBody(client, resp, size, maxBody, deadline);
+        if (got < 0) {
+            return HTTP_ERR_TIMEOUT;
+        }
+        if ((size_t)got < size || readLine(client, line, sizeof(line), deadline) != 0) {
+            return HTTP_ERR_PROTOCOL;
+        }
+    }
+    while (true) {
+        int len = readLine(client, line, sizeof(line), deadline);
+        if (len < 0) {
+            return len == -2 ? HTTP_ERR_PROTOCOL : HTTP_ERR_TIMEOUT;
+        }
+        if (len == 0) {
+            return resp.status;
+        }
+    }
+}
+
+int readHttpResponse(Client &client, HttpResponse &resp, uint32_t timeoutMs, size_t maxBody) {
+    uint32_t deadline = millis() + timeoutMs;
+    int code = readHttpHead(client, resp, timeoutMs);
+    if (code < 0) {
+        return code;
+    }
+
+    // Body
+    if (resp.chunked) {
+        code = readChunkedBody(client, resp, maxBody, deadline);
+        if (code < 0) {
+            resp.keepAlive = false;
+        }
+        return code;
+    }
+
+    size_t want = resp.contentLength;
+    if (want != SIZE_MAX && want <= maxBody) {
+        resp.body.reserve(want);
+    }
+    long got = readBody(client, resp, want, maxBody, deadline);
+    if (got < 0) {
+        return HTTP_ERR_TIMEOUT;
+    }
+    if (want != SIZE_MAX && (size_t)got < want) {
+        resp.keepAlive = false;
+        return HTTP_ERR_PROTOCOL;
+    }
+    return resp.status;
+}
@@ -0,0 +1,55 @@
+/*
+ * HttpLite - Minimal HTTP/1.1 client primitives on top of Arduino Client
+ *
+ * Used where HTTPClient would copy or allocate more than needed:
+ * - HttpUrl            - parse "http://host:port/path" once, no String
+ * - readHttpResponse() - status line, headers and a bounded body
+ *                        (Content-Length or chunked; keep-alive either way)
+ * - readHttpHead()     - status line and headers only (e.g. 101 upgrade)
+ *
+ * Only plain http:// is supported (backend and AI service are on the LAN).
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Client.h>
+
+// Error codes (negative, HTTP status codes are positive)
+#define HTTP_ERR_CONNECT    -1
+#define HTTP_ERR_SEND       -2
+#define HTTP_ERR_TIMEOUT    -3
+#define HTTP_ERR_PROTOCOL   -4
+#define HTTP_ERR_CLOSED     -5    // Peer closed before sending a status line
+
+#ifndef HTTP_MAX_BODY
+#define HTTP_MAX_BODY       4096
+#endif
+
+struct HttpUrl {
+    char host[64];
+    uint16_t port;
+    char path[96];
+
+    // Parses "http://host[:port][/path]". Returns false if it does not fit.
+    bool parse(const char *url);
+
+    // Parses base + path, e.g. ("http://10.0.0.2:5000", "/analyze")
+    bool parse(const char *base, const char *path);
+};
+
+struct HttpResponse {
+    int status;
+    bool keepAlive;           // Server left the connection open
+    bool chunked;             // Transfer-Encoding: chunked
+    size_t contentLength;     // SIZE_MAX when chunked or unknown (read until close)
+    char contentType[40];     // Media type without parameters, "" if none
+    String body;
+};
+
+// Reads a full response. Returns the status code or an HTTP_ERR_* code.
+int readHttpResponse(Client &client, HttpResponse &resp, uint32_t timeoutMs,
+                     size_t maxBody = HTTP_MAX_BODY);
+
+// Reads status line and headers, leaves the body on the socket.
+int readHttpHead(Client &client, HttpResponse &resp, uint32_t timeoutMs);
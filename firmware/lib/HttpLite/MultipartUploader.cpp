@@ -0,0 +1,90 @@
+/*
+ * MultipartUploader - see MultipartUploader.h
+ */
+
+#include "MultipartUploader.h"
+
+static const char *PREAMBLE_FMT =
+    "--" MULTIPART_BOUNDARY "\r\n"
+    "Content-Disposition: form-data; name=\"%s\"; filename=\"%s\"\r\n"
+    "Content-Type: %s\r\n\r\n";
+static const char *TRAILER = "\r\n--" MULTIPART_BOUNDARY "--\r\n";
+
+MultipartUploader::MultipartUploader(const char *field, const char *filename, const char *mimeType)
+    : _field(field), _filename(filename), _mimeType(mimeType) {}
+
+size_t MultipartUploader::preambleLength() const {
+    return snprintf(NULL, 0, PREAMBLE_FMT, _field, _filename, _mimeType);
+}
+
+size_t MultipartUploader::contentLength(size_t dataLen) const {
+    return preambleLength() + dataLen + strlen(TRAILER);
+}
+
+bool MultipartUploader::writeHead(Client &out, const HttpUrl &url, size_t dataLen, bool keepAlive) const {
+    char head[384];
+    int n = snprintf(head, sizeof(head),
+                     "POST %s HTTP/1.1\r\n"
+                     "Host: %s:%u\r\n"
+                     "Content-Type: " MULTIPART_CONTENT_TYPE "\r\n"
+                     "Content-Length: %u\r\n"
+                     "Connection: %s\r\n\r\n",
+                     url.path, url.host, url.port,
+                     (unsigned)contentLength(dataLen),
+                     keepAlive ? "keep-alive" : "close");
+    if (n < 0 || (size_t)n >= sizeof(head)) {
+        return false;
+    }
+    n += snprintf(head + n, sizeof(head) - n, PREAMBLE_FMT, _field, _filename, _mimeType);
+    if ((size_t)n >= sizeof(head)) {
+        return false;
+    }
+    return out.write((const uint8_t *)head, n) == (size_t)n;
+}
+
+bool MultipartUploader::writePreamble(Client &out) const {
+    char preamble[256];
+    int n = snprintf(preamble, sizeof(preamble), PREAMBLE_FMT, _field, _filename, _mimeType);
+    if (n < 0 || (size_t)n >= sizeof(preamble)) {
+        return false;
+    }
+    return out.write((const uint8_t *)preamble, n) == (size_t)n;
+}
+
+bool MultipartUploader::writeData(Client &out, const uint8_t *data, size_t len) const {
+    while (len > 0) {
+        size_t chunk = len < UPLOAD_CHUNK_SIZE ? len : UPLOAD_CHUNK_SIZE;
+        size_t written = out.write(data, chunk);
+        if (written == 0) {
+            return false;
+        }
+        data += written;
+        len -= written;
+    }
+    return true;
+}
+
+bool MultipartUploader::writeTail(Client &out) const {
+    size_t len = strlen(TRAILER);
+    return out.write((const uint8_t *)TRAILER, len) == len;
+}
+
+int MultipartUploader::post(Client &client, const HttpUrl &url, const uint8_t *data, size_t len,
+                            HttpResponse &resp, uint32_t timeoutMs, bool keepAlive) const {
+    if (!client.connected() && !client.connect(url.host, url.port)) {
+        return HTTP_ERR_CONNECT;
+    }
+
+    if (!writeHead(client, url, len, keepAlive) ||
+        !writeData(client, data, len) ||
+        !writeTail(client)) {
+        client.stop();
+        return HTTP_ERR_SEND;
+    }
+
+    int code = readHttpResponse(client, resp, timeoutMs);
+    if (code < 0 || !keepAlive || !resp.keepAlive) {
+        client.stop();
+    }
+    return code;
+}
@@ -0,0 +1,57 @@
+/*
+ * MultipartUploader - Zero-copy multipart/form-data POST
+ *
+ * Writes request headers and the multipart preamble, then the caller's
+ * buffer (e.g. fb->buf) straight to the socket in UPLOAD_CHUNK_SIZE
+ * pieces, then the trailer. Content-Length is computed up front, so no
+ * buffer ever holds the whole body.
+ *
+ *   MultipartUploader uploader("image", "capture.jpg", "image/jpeg");
+ *   HttpUrl url; url.parse(AI_SERVICE_URL, "/analyze");
+ *   WiFiClient client;
+ *   HttpResponse resp;
+ *   int code = uploader.post(client, url, fb->buf, fb->len, resp, 15000);
+ */
+
+#pragma once
+
+#include "HttpLite.h"
+
+#ifndef UPLOAD_CHUNK_SIZE
+#define UPLOAD_CHUNK_SIZE   4096
+#endif
+
+#define MULTIPART_BOUNDARY      "----ESP32Boundary"
+#define MULTIPART_CONTENT_TYPE  "multipart/form-data; boundary=" MULTIPART_BOUNDARY
+
+class MultipartUploader {
+public:
+    MultipartUploader(const char *field, const char *filename, const char *mimeType);
+
+    // Bytes of preamble + data + trailer
+    size_t contentLength(size_t dataLen) const;
+
+    // Request line, headers and multipart preamble
+    bool writeHead(Client &out, const HttpUrl &url, size_t dataLen, bool keepAlive = false) const;
+
+    // Multipart preamble only, for callers that write their own headers
+    bool writePreamble(Client &out) const;
+
+    // Payload, written directly from data
+    bool writeData(Client &out, const uint8_t *data, size_t len) const;
+
+    // Closing boundary
+    bool writeTail(Client &out) const;
+
+    // Connects if needed, sends the whole request and reads the response.
+    // Returns the HTTP status or an HTTP_ERR_* code.
+    int post(Client &client, const HttpUrl &url, const uint8_t *data, size_t len,
+             HttpResponse &resp, uint32_t timeoutMs, bool keepAlive = false) const;
+
+private:
+    size_t preambleLength() const;
+
+    const char *_field;
+    const char *_filename;
+    const char *_mimeType;
+};
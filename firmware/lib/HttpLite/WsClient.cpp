@@ -0,0 +1,226 @@
+/*
+ * WsClient - see WsClient.h
+ */
+
+#include "WsClient.h"
+
+#define WS_OP_CONTINUATION  0x0
+#define WS_OP_TEXT          0x1
+#define WS_OP_BINARY        0x2
+#define WS_OP_CLOSE         0x8
+#define WS_OP_PING          0x9
+#define WS_OP_PONG          0xA
+
+static void base64Encode(const uint8_t *in, size_t len, char *out) {
+    static const char *table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t o = 0;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = in[i] << 16;
+        if (i + 1 < len) v |= in[i + 1] << 8;
+        if (i + 2 < len) v |= in[i + 2];
+        out[o++] = table[(v >> 18) & 0x3F];
+        out[o++] = table[(v >> 12) & 0x3F];
+        out[o++] = i + 1 < len ? table[(v >> 6) & 0x3F] : '=';
+        out[o++] = i + 2 < len ? table[v & 0x3F] : '=';
+    }
+    out[o] = '\0';
+}
+
+WsClient::WsClient()
+    : _valid(false),
+      _open(false),
+      _onMessage(NULL),
+      _lastAttemptMs(0),
+      _sessions(0),
+      _messages(0) {
+    resetFrame();
+}
+
+bool WsClient::begin(const char *baseUrl, const char *path, MessageCallback onMessage) {
+    _valid = _url.parse(baseUrl, path);
+    _onMessage = onMessage;
+    _lastAttemptMs = millis() - WS_RECONNECT_MS;  // Connect on first loop()
+    return _valid;
+}
+
+void WsClient::loop() {
+    if (!connected()) {
+        if (_open) {
+            Serial.println("[WS] Disconnected from hub");
+            close();
+        }
+        if (_valid && WiFi.status() == WL_CONNECTED &&
+            millis() - _lastAttemptMs >= WS_RECONNECT_MS) {
+            _lastAttemptMs = millis();
+            connect();
+        }
+        return;
+    }
+
+    while (_client.available() > 0) {
+        if (_state == HEADER) {
+            _hdr[_hdrLen++] = (uint8_t)_client.read();
+
+            if (_hdrLen == 2) {
+                // Work out the full header size from the first two bytes
+                uint8_t len7 = _hdr[1] & 0x7F;
+                _hdrNeed = 2 + (len7 == 126 ? 2 : len7 == 127 ? 8 : 0) + ((_hdr[1] & 0x80) ? 4 : 0);
+            }
+            if (_hdrLen < _hdrNeed) {
+                continue;
+            }
+
+            _fin = _hdr[0] & 0x80;
+            _opcode = _hdr[0] & 0x0F;
+            _masked = _hdr[1] & 0x80;
+            uint8_t len7 = _hdr[1] & 0x7F;
+            uint8_t pos = 2;
+            if (len7 == 126) {
+                _payloadLen = (_hdr[2] << 8) | _hdr[3];
+                pos = 4;
+            } else if (len7 == 127) {
+                _payloadLen = 0;
+                for (int i = 0; i < 8; i++) {
+                    _payloadLen = (_payloadLen << 8) | _hdr[2 + i];
+                }
+                pos = 10;
+            } else {
+                _payloadLen = len7;
+            }
+            if (_masked) {
+                memcpy(_mask, _hdr + pos, 4);
+            }
+
+            _payloadRead = 0;
+            _state = PAYLOAD;
+            if (_payloadLen == 0) {
+                handleFrame();
+                resetFrame();
+            }
+            continue;
+        }
+
+        // PAYLOAD: keep what fits, skip the rest
+        int c = _client.read();
+        if (c < 0) {
+            break;
+        }
+        if (_payloadRead < WS_MAX_MESSAGE) {
+            uint8_t b = (uint8_t)c;
+            if (_masked) {
+                b ^= _mask[_payloadRead & 3];
+            }
+            _rx[_payloadRead] = (char)b;
+        }
+        _payloadRead++;
+
+        if (_payloadRead == _payloadLen) {
+            handleFrame();
+            resetFrame();
+        }
+    }
+}
+
+void WsClient::close() {
+    if (_open && _client.connected()) {
+        sendFrame(WS_OP_CLOSE, NULL, 0);
+    }
+    _client.stop();
+    _open = false;
+    resetFrame();
+}
+
+bool WsClient::connect() {
+    _client.stop();
+    resetFrame();
+
+    if (!_client.connect(_url.host, _url.port, WS_HANDSHAKE_TIMEOUT_MS)) {
+        return false;
+    }
+
+    uint8_t nonce[16];
+    for (int i = 0; i < 16; i += 4) {
+        uint32_t r = esp_random();
+        memcpy(nonce + i, &r, 4);
+    }
+    char key[25];
+    base64Encode(nonce, sizeof(nonce), key);
+
+    char req[320];
+    int n = snprintf(req, sizeof(req),
+                     "GET %s HTTP/1.1\r\n"
+                     "Host: %s:%u\r\n"
+                     "Upgrade: websocket\r\n"
+                     "Connection: Upgrade\r\n"
+                     "Sec-WebSocket-Key: %s\r\n"
+                     "Sec-WebSocket-Version: 13\r\n\r\n",
+                     _url.path, _url.host, _url.port, key);
+    if (n < 0 || (size_t)n >= sizeof(req) ||
+        _client.write((const uint8_t *)req, n) != (size_t)n) {
+        _client.stop();
+        return false;
+    }
+
+    HttpResponse resp;
+    int code = readHttpHead(_client, resp, WS_HANDSHAKE_TIMEOUT_MS);
+    if (code != 101) {
+        Serial.printf("[WS] Handshake failed: %d\n", code);
+        _client.stop();
+        return false;
+    }
+
+    _client.setNoDelay(true);
+    _open = true;
+    _sessions++;
+    Serial.printf("[WS] Connected to hub %s:%u%s\n", _url.host, _url.port, _url.path);
+    return true;
+}
+
+void WsClient::resetFrame() {
+    _state = HEADER;
+    _hdrLen = 0;
+    _hdrNeed = 2;
+    _payloadLen = 0;
+    _payloadRead = 0;
+}
+
+void WsClient::handleFrame() {
+    size_t len = _payloadLen < WS_MAX_MESSAGE ? (size_t)_payloadLen : WS_MAX_MESSAGE;
+
+    switch (_opcode) {
+    case WS_OP_TEXT:
+        if (_fin && _payloadLen <= WS_MAX_MESSAGE && _onMessage) {
+            _rx[len] = '\0';
+            _messages++;
+            _onMessage(_rx, len);
+        }
+        break;
+    case WS_OP_PING:
+        sendFrame(WS_OP_PONG, (const uint8_t *)_rx, len);
+        break;
+    case WS_OP_CLOSE:
+        Serial.println("[WS] Hub closed the connection");
+        close();
+        break;
+    default:
+        // Pong, binary and continuation frames are not used by the hub
+        break;
+    }
+}
+
+bool WsClient::sendFrame(uint8_t opcode, const uint8_t *data, size_t len) {
+    // Control frames only (<= 125 bytes), always masked as RFC 6455 requires
+    if (len > 125) {
+        return false;
+    }
+
+    uint8_t frame[2 + 4 + 125];
+    uint32_t key = esp_random();
+    frame[0] = 0x80 | opcode;
+    frame[1] = 0x80 | (uint8_t)len;
+    memcpy(frame + 2, &key, 4);
+    for (size_t i = 0; i < len; i++) {
+        frame[6 + i] = data[i] ^ frame[2 + (i & 3)];
+    }
+    return _client.write(frame, 6 + len) == 6 + len;
+}
@@ -0,0 +1,83 @@
+/*
+ * WsClient - Minimal WebSocket (RFC 6455) client for the backend hub
+ *
+ * Receives text messages from the backend /ws hub without blocking:
+ * loop() parses whatever bytes have arrived and calls the message
+ * callback once a complete text frame is in. Pings are answered with
+ * pongs (the hub drops clients that stay silent for 60 s). When the
+ * socket drops, loop() reconnects every WS_RECONNECT_MS.
+ *
+ *   WsClient hub;
+ *   hub.begin(BACKEND_URL, "/ws", onHubMessage);
+ *   loop: hub.loop();
+ *
+ * Only what the hub needs: no TLS, no fragmented messages, no extensions.
+ * Not thread-safe: call from a single task.
+ */
+
+#pragma once
+
+#include <WiFi.h>
+#include "HttpLite.h"
+
+#ifndef WS_MAX_MESSAGE
+#define WS_MAX_MESSAGE      1024    // Larger messages are skipped
+#endif
+
+#ifndef WS_RECONNECT_MS
+#define WS_RECONNECT_MS     5000
+#endif
+
+#ifndef WS_HANDSHAKE_TIMEOUT_MS
+#define WS_HANDSHAKE_TIMEOUT_MS 3000
+#endif
+
+class WsClient {
+public:
+    typedef void (*MessageCallback)(const char *data, size_t len);
+
+    WsClient();
+
+    bool begin(const char *baseUrl, const char *path, MessageCallback onMessage);
+
+    // Reads pending frames; reconnects when disconnected
+    void loop();
+
+    void close();
+
+    bool connected() { return _open && _client.connected(); }
+
+    // Increments on every successful handshake, lets callers resync state
+    uint32_t sessions() const { return _sessions; }
+    uint32_t messages() const { return _messages; }
+
+private:
+    enum State { HEADER, PAYLOAD };
+
+    bool connect();
+    void resetFrame();
+    void handleFrame();
+    bool sendFrame(uint8_t opcode, const uint8_t *data, size_t len);
+
+    WiFiClient _client;
+    HttpUrl _url;
+    bool _valid;
+    bool _open;
+    MessageCallback _onMessage;
+    uint32_t _lastAttemptMs;
+    uint32_t _sessions;
+    uint32_t _messages;
+
+    // Frame parser
+    State _state;
+    uint8_t _hdr[14];
+    uint8_t _hdrLen;
+    uint8_t _hdrNeed;
+    uint8_t _opcode;
+    bool _fin;
+    bool _masked;
+    uint8_t _mask[4];
+    uint64_t _payloadLen;
+    uint64_t _payloadRead;
+    char _rx[WS_MAX_MESSAGE + 1];
+};
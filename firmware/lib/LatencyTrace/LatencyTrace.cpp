@@ -0,0 +1,100 @@
+/*
+ * LatencyTrace - see LatencyTrace.h
+ */
+
+#include "LatencyTrace.h"
+
+static const char *STAGE_NAMES[TRACE_STAGE_COUNT] = {
+    "prepare", "upload", "inference", "backend", "decision"
+};
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::reset() {
+    memset(_buckets, 0, sizeof(_buckets));
+    _count = 0;
+    _maxMs = 0;
+    _sumMs = 0;
+}
+
+void LatencyHistogram::record(uint32_t ms) {
+    _buckets[bucketOf(ms)]++;
+    _count++;
+    _sumMs += ms;
+    if (ms > _maxMs) {
+        _maxMs = ms;
+    }
+}
+
+uint32_t LatencyHistogram::percentile(uint8_t p) const {
+    if (_count == 0) {
+        return 0;
+    }
+    // Rank of the sample at p, 1-based
+    uint32_t rank = ((uint64_t)_count * p + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += _buckets[b];
+        if (seen >= rank) {
+            uint32_t mid = bucketLow(b) + bucketWidth(b) / 2;
+            return mid < _maxMs ? mid : _maxMs;
+        }
+    }
+    return _maxMs;
+}
+
+// 0-7 ms one bucket each; then 4 buckets per power of two
+uint8_t LatencyHistogram::bucketOf(uint32_t ms) {
+    if (ms < 8) {
+        return ms;
+    }
+    uint8_t octave = 31 - __builtin_clz(ms);
+    uint32_t bucket = 8 + (octave - 3) * 4 + ((ms >> (octave - 2)) & 3);
+    return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+uint32_t LatencyHistogram::bucketLow(uint8_t bucket) {
+    if (bucket < 8) {
+        return bucket;
+    }
+    uint8_t octave = (bucket - 8) / 4 + 3;
+    return (4 + (bucket - 8) % 4) << (octave - 2);
+}
+
+uint32_t LatencyHistogram::bucketWidth(uint8_t bucket) {
+    return bucket < 8 ? 1 : 1 << ((bucket - 8) / 4 + 1);
+}
+
+LatencyTrace::LatencyTrace() : _edge(0), _ai(0) {
+}
+
+void LatencyTrace::record(const FrameTrace &t) {
+    // uint32_t differences survive the 71-minute micros() wrap
+    _stages[TRACE_PREPARE].record((t.sendStartUs - t.captureUs) / 1000);
+    if (t.edge) {
+        _stages[TRACE_BACKEND].record((t.decisionUs - t.sendStartUs) / 1000);
+        _edge++;
+    } else {
+        _stages[TRACE_UPLOAD].record((t.sendEndUs - t.sendStartUs) / 1000);
+        _stages[TRACE_INFERENCE].record((t.decisionUs - t.sendEndUs) / 1000);
+        _ai++;
+    }
+    _stages[TRACE_DECISION].record((t.decisionUs - t.captureUs) / 1000);
+}
+
+void LatencyTrace::reset() {
+    for (uint8_t i = 0; i < TRACE_STAGE_COUNT; i++) {
+        _stages[i].reset();
+    }
+    _edge = 0;
+    _ai = 0;
+}
+
+const char *LatencyTrace::stageName(TraceStage stage) {
+    return stage < TRACE_STAGE_COUNT ? STAGE_NAMES[stage] : "?";
+}
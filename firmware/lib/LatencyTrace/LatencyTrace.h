@@ -0,0 +1,98 @@
+/*
+ * LatencyTrace - Capture-to-decision latency of detection frames
+ *
+ * Each detection frame carries a FrameTrace of micros() timestamps, from
+ * the camera's capture time (camera_fb_t.timestamp, same esp_timer clock)
+ * to the moment a slot decision exists:
+ *   AI path:   capture -> upload start -> request written -> AI response
+ *              (the AI service updates the backend before it answers)
+ *   Edge path: capture -> backend update start -> backend updated
+ * record() folds the trace into one fixed-size histogram per stage; no
+ * heap is touched and nothing is kept per frame.
+ *
+ *   FrameTrace t = { LatencyTrace::captureUs(fb), 0, 0, 0, false };
+ *   t.sendStartUs = micros(); ... t.sendEndUs = http.lastWrittenUs();
+ *   t.decisionUs = micros();
+ *   latency.record(t);
+ *   latency.histogram(TRACE_DECISION).percentile(99);
+ *
+ * Buckets are log-linear: exact below 8 ms, then 4 per power of two
+ * (at most ~12% error on a percentile), up to ~4 min.
+ *
+ * Not thread-safe: record from one task. Readers in another task may see
+ * a histogram mid-update, which only skews one sample.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "esp_camera.h"
+
+#define LATENCY_BUCKETS         72
+
+enum TraceStage : uint8_t {
+    TRACE_PREPARE,            // Capture -> first byte out (queue, scene gate, classifier, crop)
+    TRACE_UPLOAD,             // Upload start -> request written (AI path)
+    TRACE_INFERENCE,          // Request written -> AI response (AI path)
+    TRACE_BACKEND,            // Backend update start -> done (edge path)
+    TRACE_DECISION,           // Capture -> decision, either path
+    TRACE_STAGE_COUNT
+};
+
+struct FrameTrace {
+    uint32_t captureUs;
+    uint32_t sendStartUs;     // Upload or backend update started
+    uint32_t sendEndUs;       // Request written; 0 on the edge path
+    uint32_t decisionUs;
+    bool edge;                // Decided on the device
+};
+
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(uint32_t ms);
+    void reset();
+
+    uint32_t count() const { return _count; }
+    uint32_t maxMs() const { return _maxMs; }
+    uint32_t meanMs() const { return _count ? _sumMs / _count : 0; }
+    uint64_t sumMs() const { return _sumMs; }
+
+    // Value at percentile p (0-100), bucket midpoint
+    uint32_t percentile(uint8_t p) const;
+
+private:
+    static uint8_t bucketOf(uint32_t ms);
+    static uint32_t bucketLow(uint8_t bucket);
+    static uint32_t bucketWidth(uint8_t bucket);
+
+    uint32_t _buckets[LATENCY_BUCKETS];
+    uint32_t _count;
+    uint32_t _maxMs;
+    uint64_t _sumMs;
+};
+
+class LatencyTrace {
+public:
+    LatencyTrace();
+
+    void record(const FrameTrace &trace);
+    void reset();
+
+    const LatencyHistogram &histogram(TraceStage stage) const { return _stages[stage]; }
+    uint32_t edgeDecisions() const { return _edge; }
+    uint32_t aiDecisions() const { return _ai; }
+
+    static const char *stageName(TraceStage stage);
+
+    // Capture time of a frame on the micros() clock
+    static uint32_t captureUs(const camera_fb_t *fb) {
+        return (uint32_t)((uint64_t)fb->timestamp.tv_sec * 1000000ULL + fb->timestamp.tv_usec);
+    }
+
+private:
+    LatencyHistogram _stages[TRACE_STAGE_COUNT];
+    uint32_t _edge;
+    uint32_t _ai;
+};
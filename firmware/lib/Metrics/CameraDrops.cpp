@@ -0,0 +1,53 @@
+/*
+ * CameraDrops - see CameraDrops.h
+ */
+
+#include "CameraDrops.h"
+#include "esp_log.h"
+#include <string.h>
+#include <atomic>
+
+static std::atomic<uint32_t> overflows(0);
+static std::atomic<uint32_t> queueFull(0);
+static std::atomic<uint32_t> noBuffer(0);
+static std::atomic<uint32_t> oversize(0);
+static std::atomic<uint32_t> corrupt(0);
+static vprintf_like_t previousOutput = NULL;
+
+// The format string holds the message text verbatim ("W (%u) %s: FB-OVF\n")
+static int countingOutput(const char *fmt, va_list args) {
+    if (strstr(fmt, "FB-OVF")) {
+        overflows.fetch_add(1, std::memory_order_relaxed);
+    } else if (strstr(fmt, "FBQ-SND")) {
+        queueFull.fetch_add(1, std::memory_order_relaxed);
+    } else if (strstr(fmt, "FBQ-RCV")) {
+        noBuffer.fetch_add(1, std::memory_order_relaxed);
+    } else if (strstr(fmt, "FB-SIZE")) {
+        oversize.fetch_add(1, std::memory_order_relaxed);
+    } else if (strstr(fmt, "NO-SOI") || strstr(fmt, "NO-EOI")) {
+        corrupt.fetch_add(1, std::memory_order_relaxed);
+    }
+    return previousOutput ? previousOutput(fmt, args) : vprintf(fmt, args);
+}
+
+void CameraDrops::begin() {
+    if (previousOutput) {
+        return;
+    }
+    previousOutput = esp_log_set_vprintf(countingOutput);
+    esp_log_level_set("cam_hal", ESP_LOG_WARN);
+}
+
+void CameraDrops::read(CameraDropStats &out) {
+    out.overflows = overflows.load(std::memory_order_relaxed);
+    out.queueFull = queueFull.load(std::memory_order_relaxed);
+    out.noBuffer = noBuffer.load(std::memory_order_relaxed);
+    out.oversize = oversize.load(std::memory_order_relaxed);
+    out.corrupt = corrupt.load(std::memory_order_relaxed);
+}
+
+uint32_t CameraDrops::total() {
+    CameraDropStats s;
+    read(s);
+    return s.overflows + s.queueFull + s.noBuffer + s.oversize + s.corrupt;
+}
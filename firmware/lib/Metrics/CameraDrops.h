@@ -0,0 +1,47 @@
+/*
+ * CameraDrops - Counts frames the camera driver throws away
+ *
+ * The esp32-camera driver (cam_hal.c) has no counters: when a frame is
+ * lost it only logs from its DMA task, e.g.
+ *   FB-OVF   frame buffer full, rest of the frame discarded
+ *   FBQ-SND  frame queue full, finished frame discarded
+ *   FBQ-RCV  no free frame buffer for the next frame
+ *   FB-SIZE  JPEG larger than the frame buffer
+ *   NO-SOI / NO-EOI  truncated or corrupt JPEG
+ * begin() installs an esp_log output hook that recognises those messages
+ * by their format string, counts them and passes every line on to the
+ * previous output unchanged.
+ *
+ * Only messages the driver was compiled with can be seen: the warnings
+ * (FB-OVF, NO-SOI, NO-EOI) need a log level of at least WARN for the
+ * "cam_hal" tag, which begin() sets at runtime.
+ *
+ *   CameraDrops::begin();
+ *   CameraDropStats drops;
+ *   CameraDrops::read(drops);
+ *
+ * Counters are written by the camera task and may be read from any task.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+struct CameraDropStats {
+    uint32_t overflows;       // FB-OVF
+    uint32_t queueFull;       // FBQ-SND
+    uint32_t noBuffer;        // FBQ-RCV
+    uint32_t oversize;        // FB-SIZE
+    uint32_t corrupt;         // NO-SOI, NO-EOI
+};
+
+class CameraDrops {
+public:
+    // Installs the log hook; call once, before the camera starts
+    static void begin();
+
+    static void read(CameraDropStats &out);
+
+    // All of the above
+    static uint32_t total();
+};
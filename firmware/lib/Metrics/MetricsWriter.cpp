@@ -0,0 +1,100 @@
+/*
+ * MetricsWriter - see MetricsWriter.h
+ */
+
+#include "MetricsWriter.h"
+#include <stdarg.h>
+
+static const char METRICS_RESPONSE[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+
+MetricsWriter::MetricsWriter(Print &out)
+    : _out(out),
+      _len(0),
+      _written(0),
+      _truncated(0) {
+}
+
+void MetricsWriter::header() {
+    _out.write((const uint8_t *)METRICS_RESPONSE, sizeof(METRICS_RESPONSE) - 1);
+}
+
+void MetricsWriter::family(const char *name, const char *type, const char *help) {
+    line("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void MetricsWriter::sample(const char *name, uint32_t value, const char *labels) {
+    if (labels) {
+        line("%s{%s} %u\n", name, labels, (unsigned)value);
+    } else {
+        line("%s %u\n", name, (unsigned)value);
+    }
+}
+
+void MetricsWriter::sample(const char *name, int32_t value, const char *labels) {
+    if (labels) {
+        line("%s{%s} %d\n", name, labels, (int)value);
+    } else {
+        line("%s %d\n", name, (int)value);
+    }
+}
+
+void MetricsWriter::sample(const char *name, uint64_t value, const char *labels) {
+    if (labels) {
+        line("%s{%s} %llu\n", name, labels, (unsigned long long)value);
+    } else {
+        line("%s %llu\n", name, (unsigned long long)value);
+    }
+}
+
+void MetricsWriter::sample(const char *name, float value, const char *labels) {
+    if (labels) {
+        line("%s{%s} %.3f\n", name, labels, value);
+    } else {
+        line("%s %.3f\n", name, value);
+    }
+}
+
+size_t MetricsWriter::finish() {
+    flush();
+    return _written;
+}
+
+void MetricsWriter::line(const char *fmt, ...) {
+    va_list args;
+    for (uint8_t attempt = 0; attempt < 2; attempt++) {
+        size_t room = sizeof(_buf) - _len;
+        va_start(args, fmt);
+        int n = vsnprintf(_buf + _len, room, fmt, args);
+        va_end(args);
+        if (n < 0) {
+            return;
+        }
+        if ((size_t)n < room) {
+            _len += n;
+            return;
+        }
+        if (_len == 0) {
+            break;
+        }
+        // Did not fit behind the buffered lines: send those, then retry
+        flush();
+    }
+
+    // Longer than the whole buffer: keep what fits, still end the line
+    _len = sizeof(_buf) - 1;
+    _buf[_len - 1] = '\n';
+    _truncated++;
+}
+
+void MetricsWriter::flush() {
+    if (_len > 0) {
+        _written += _out.write((const uint8_t *)_buf, _len);
+        _len = 0;
+    }
+}
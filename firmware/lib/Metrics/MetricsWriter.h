@@ -0,0 +1,59 @@
+/*
+ * MetricsWriter - Prometheus text exposition (format 0.0.4) without heap
+ *
+ * Lines are formatted into a fixed buffer that is flushed to the output
+ * whenever the next line does not fit, so a scrape of any size costs one
+ * METRICS_BUFFER_SIZE buffer (on the caller's stack) and no String.
+ *
+ *   WiFiClient client = server.client();
+ *   MetricsWriter m(client);
+ *   m.header();
+ *   m.family("parking_heap_free_bytes", "gauge", "Free internal heap");
+ *   m.sample("parking_heap_free_bytes", heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+ *   m.sample("parking_http_requests_total", stats.requests, "endpoint=\"ai\"");
+ *   m.finish();
+ *
+ * Labels are passed preformatted (name="value",...) without braces.
+ *
+ * Not thread-safe: one writer per response.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#ifndef METRICS_BUFFER_SIZE
+#define METRICS_BUFFER_SIZE     512
+#endif
+
+class MetricsWriter {
+public:
+    explicit MetricsWriter(Print &out);
+
+    // HTTP/1.1 200 response head; the connection closes after the body
+    void header();
+
+    // # HELP and # TYPE lines; type is "counter" or "gauge"
+    void family(const char *name, const char *type, const char *help);
+
+    void sample(const char *name, uint32_t value, const char *labels = NULL);
+    void sample(const char *name, int32_t value, const char *labels = NULL);
+    void sample(const char *name, uint64_t value, const char *labels = NULL);
+    void sample(const char *name, float value, const char *labels = NULL);
+
+    // Flushes what is buffered; returns body bytes written
+    size_t finish();
+
+    // Lines longer than the buffer (cut short)
+    uint32_t truncated() const { return _truncated; }
+
+private:
+    void line(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+    void flush();
+
+    Print &_out;
+    char _buf[METRICS_BUFFER_SIZE];
+    size_t _len;
+    size_t _written;
+    uint32_t _truncated;
+};
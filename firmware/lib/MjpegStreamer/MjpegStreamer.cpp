@@ -0,0 +1,281 @@
+/*
+ * MjpegStreamer - see MjpegStreamer.h
+ */
+
+#include "MjpegStreamer.h"
+#include <lwip/sockets.h>
+
+static const char *STREAM_RESPONSE =
+    "HTTP/1.1 200 OK\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Content-Type: multipart/x-mixed-replace;boundary=" MJPEG_PART_BOUNDARY "\r\n\r\n";
+static const char *STREAM_PART =
+    "\r\n--" MJPEG_PART_BOUNDARY "\r\n"
+    "Content-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n";
+
+// Writes what the socket accepts right now.
+// Returns bytes written, 0 if the send buffer is full, -1 on error.
+static int sendNonBlocking(WiFiClient &client, const uint8_t *buf, size_t len) {
+    int fd = client.fd();
+    if (fd < 0) {
+        return -1;
+    }
+    int n = send(fd, buf, len, MSG_DONTWAIT);
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+    return n;
+}
+
+MjpegStreamer::MjpegStreamer(FrameBus &bus, uint32_t minFrameIntervalMs)
+    : _bus(bus),
+      _minFrameIntervalMs(minFrameIntervalMs),
+      _lastGrabMs(0),
+      _nextSeq(1),
+      _framesCaptured(0),
+      _bytesSent(0) {
+    memset(&_link, 0, sizeof(_link));
+    for (size_t i = 0; i < MJPEG_MAX_HELD_FRAMES; i++) {
+        _frames[i].fb = NULL;
+        _frames[i].readers = 0;
+    }
+    for (size_t i = 0; i < MJPEG_MAX_CLIENTS; i++) {
+        _clients[i].active = false;
+        _clients[i].frame = -1;
+    }
+}
+
+bool MjpegStreamer::addClient(WiFiClient client) {
+    for (size_t i = 0; i < MJPEG_MAX_CLIENTS; i++) {
+        Client &c = _clients[i];
+        if (c.active) {
+            continue;
+        }
+
+        // Response header is small, a blocking write is fine here
+        client.setNoDelay(true);
+        client.print(STREAM_RESPONSE);
+
+        uint32_t now = millis();
+        c.conn = client;
+        c.active = true;
+        c.frame = -1;
+        c.offset = 0;
+        c.lastSeq = 0;
+        c.lastProgressMs = now;
+        c.connectedAt = now;
+        c.fpsWindowStart = now;
+        c.fpsWindowFrames = 0;
+        memset(&c.stats, 0, sizeof(c.stats));
+
+        Serial.printf("[STREAM] Client %u connected\n", (unsigned)i);
+        return true;
+    }
+    return false;
+}
+
+void MjpegStreamer::loop() {
+    uint32_t now = millis();
+
+    // Drop disconnected clients
+    for (size_t i = 0; i < MJPEG_MAX_CLIENTS; i++) {
+        if (_clients[i].active && !_clients[i].conn.connected()) {
+            dropClient(_clients[i], "disconnected");
+        }
+    }
+
+    // Attach idle clients to the newest frame, grabbing one if needed
+    for (size_t i = 0; i < MJPEG_MAX_CLIENTS; i++) {
+        Client &c = _clients[i];
+        if (!c.active || c.frame >= 0) {
+            continue;
+        }
+
+        int8_t latest = latestFrame();
+        if (latest < 0 || _frames[latest].seq <= c.lastSeq) {
+            latest = grabFrame(now);
+            if (latest < 0) {
+                continue;
+            }
+        }
+
+        Frame &f = _frames[latest];
+        if (c.lastSeq != 0 && f.seq > c.lastSeq + 1) {
+            c.stats.framesDropped += f.seq - c.lastSeq - 1;
+        }
+        c.frame = latest;
+        c.offset = 0;
+        c.frameStartUs = micros();
+        f.readers++;
+    }
+
+    // Push pending bytes
+    for (size_t i = 0; i < MJPEG_MAX_CLIENTS; i++) {
+        Client &c = _clients[i];
+        if (c.active && c.frame >= 0 && !pump(c, now)) {
+            dropClient(c, "send failed");
+        }
+    }
+}
+
+void MjpegStreamer::stop() {
+    for (size_t i = 0; i < MJPEG_MAX_CLIENTS; i++) {
+        if (_clients[i].active) {
+            dropClient(_clients[i], "stopped");
+        }
+    }
+}
+
+void MjpegStreamer::takeLinkSample(MjpegLinkSample &out) {
+    out = _link;
+    out.clients = clientCount();
+    memset(&_link, 0, sizeof(_link));
+}
+
+size_t MjpegStreamer::clientCount() const {
+    size_t count = 0;
+    for (size_t i = 0; i < MJPEG_MAX_CLIENTS; i++) {
+        if (_clients[i].active) {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool MjpegStreamer::clientStats(size_t index, MjpegClientStats &out) const {
+    // index counts active clients only
+    for (size_t i = 0; i < MJPEG_MAX_CLIENTS; i++) {
+        const Client &c = _clients[i];
+        if (!c.active) {
+            continue;
+        }
+        if (index-- == 0) {
+            out = c.stats;
+            out.connectedMs = millis() - c.connectedAt;
+            out.backlog = 0;
+            if (c.frame >= 0) {
+                const Frame &f = _frames[c.frame];
+                out.backlog = f.headLen + f.fb->len - c.offset;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+int8_t MjpegStreamer::latestFrame() const {
+    int8_t latest = -1;
+    for (int8_t i = 0; i < MJPEG_MAX_HELD_FRAMES; i++) {
+        if (_frames[i].fb && (latest < 0 || _frames[i].seq > _frames[latest].seq)) {
+            latest = i;
+        }
+    }
+    return latest;
+}
+
+int8_t MjpegStreamer::grabFrame(uint32_t now) {
+    if (now - _lastGrabMs < _minFrameIntervalMs) {
+        return -1;
+    }
+
+    int8_t slot = -1;
+    for (int8_t i = 0; i < MJPEG_MAX_HELD_FRAMES; i++) {
+        if (!_frames[i].fb) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        // Every slot is pinned by a client still sending an older frame
+        return -1;
+    }
+
+    // Always a new frame; detection and /capture reuse it, not the reverse
+    camera_fb_t *fb = _bus.acquire(0);
+    if (!fb) {
+        Serial.println("[STREAM] Frame capture failed");
+        return -1;
+    }
+
+    Frame &f = _frames[slot];
+    f.fb = fb;
+    f.seq = _nextSeq++;
+    f.readers = 0;
+    f.headLen = snprintf(f.head, sizeof(f.head), STREAM_PART, (unsigned)fb->len);
+    _lastGrabMs = now;
+    _framesCaptured++;
+    return slot;
+}
+
+void MjpegStreamer::releaseFrame(int8_t index) {
+    Frame &f = _frames[index];
+    if (f.fb && f.readers == 0) {
+        _bus.release(f.fb);
+        f.fb = NULL;
+    }
+}
+
+// Returns false when the client should be dropped
+bool MjpegStreamer::pump(Client &c, uint32_t now) {
+    Frame &f = _frames[c.frame];
+    size_t total = f.headLen + f.fb->len;
+
+    while (c.offset < total) {
+        const uint8_t *buf;
+        size_t len;
+        if (c.offset < f.headLen) {
+            buf = (const uint8_t *)f.head + c.offset;
+            len = f.headLen - c.offset;
+        } else {
+            buf = f.fb->buf + (c.offset - f.headLen);
+            len = total - c.offset;
+        }
+
+        int n = sendNonBlocking(c.conn, buf, len);
+        if (n < 0) {
+            return false;
+        }
+        if (n == 0) {
+            // Socket buffer full, come back next loop
+            return now - c.lastProgressMs < MJPEG_CLIENT_STALL_MS;
+        }
+
+        c.offset += n;
+        c.lastProgressMs = now;
+        c.stats.bytesSent += n;
+        _bytesSent += n;
+    }
+
+    // Frame complete
+    c.lastSeq = f.seq;
+    c.frame = -1;
+    c.stats.framesSent++;
+    _link.frames++;
+    _link.bytes += total;
+    _link.sendUs += micros() - c.frameStartUs;
+    c.fpsWindowFrames++;
+    if (now - c.fpsWindowStart >= 1000) {
+        c.stats.fps = c.fpsWindowFrames * 1000.0f / (now - c.fpsWindowStart);
+        c.fpsWindowStart = now;
+        c.fpsWindowFrames = 0;
+    }
+
+    f.readers--;
+    releaseFrame(&f - _frames);
+    return true;
+}
+
+void MjpegStreamer::dropClient(Client &c, const char *reason) {
+    if (c.frame >= 0) {
+        _frames[c.frame].readers--;
+        releaseFrame(c.frame);
+        c.frame = -1;
+    }
+    c.conn.stop();
+    c.active = false;
+
+    Serial.printf("[STREAM] Client %u %s (sent %u, dropped %u)\n",
+                  (unsigned)(&c - _clients), reason,
+                  (unsigned)c.stats.framesSent, (unsigned)c.stats.framesDropped);
+}
@@ -0,0 +1,123 @@
+/*
+ * MjpegStreamer - Non-blocking multi-client MJPEG fan-out
+ *
+ * Each camera frame is grabbed once and sent to every connected viewer.
+ * Sockets are written with MSG_DONTWAIT, so a slow viewer only falls
+ * behind itself: when it finishes a frame it jumps to the newest one and
+ * the frames in between count as dropped for that client.
+ *
+ * Frames come from a FrameBus, so other consumers can share them.
+ *
+ * Usage (WebServer handler + periodic pump):
+ *   MjpegStreamer streamer(frameBus, 66);
+ *   void handleStream() { streamer.addClient(server.client()); }
+ *   loop: server.handleClient(); streamer.loop();
+ *
+ * Not thread-safe: call every method from the task that runs the WebServer.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "esp_camera.h"
+#include "FrameBus.h"
+
+#ifndef MJPEG_MAX_CLIENTS
+#define MJPEG_MAX_CLIENTS       4
+#endif
+
+// Frames held at once. Keep below FRAME_BUS_SLOTS so detection and
+// /capture can still grab a buffer when the stream's frame is too old.
+#ifndef MJPEG_MAX_HELD_FRAMES
+#define MJPEG_MAX_HELD_FRAMES   2
+#endif
+
+// A client that makes no progress for this long is disconnected
+#ifndef MJPEG_CLIENT_STALL_MS
+#define MJPEG_CLIENT_STALL_MS   5000
+#endif
+
+#define MJPEG_PART_BOUNDARY     "123456789000000000000987654321"
+
+struct MjpegClientStats {
+    uint32_t framesSent;
+    uint32_t framesDropped;
+    uint32_t bytesSent;
+    float fps;                // Frames sent over the last second
+    size_t backlog;           // Bytes of the current frame still to send
+    uint32_t connectedMs;     // Time since the client connected
+};
+
+// Frames completed since the last takeLinkSample(), over all clients
+struct MjpegLinkSample {
+    uint32_t frames;
+    uint32_t bytes;
+    uint32_t sendUs;          // Sum of first byte -> last byte per frame
+    uint8_t clients;          // Connected when the sample was taken
+};
+
+class MjpegStreamer {
+public:
+    MjpegStreamer(FrameBus &bus, uint32_t minFrameIntervalMs);
+
+    // Sends the multipart response header and takes over the socket.
+    // Returns false (and leaves the client alone) when all slots are busy.
+    bool addClient(WiFiClient client);
+
+    // Grabs a frame when a viewer is ready and pushes pending bytes.
+    void loop();
+
+    // Drops all clients and returns held frames
+    void stop();
+
+    void setFrameInterval(uint32_t ms) { _minFrameIntervalMs = ms; }
+    uint32_t frameInterval() const { return _minFrameIntervalMs; }
+
+    // Delivery totals for rate control; resets them
+    void takeLinkSample(MjpegLinkSample &out);
+
+    size_t clientCount() const;
+    bool clientStats(size_t index, MjpegClientStats &out) const;
+    uint32_t framesCaptured() const { return _framesCaptured; }
+    uint32_t bytesSent() const { return _bytesSent; }
+
+private:
+    struct Frame {
+        camera_fb_t *fb;
+        uint32_t seq;
+        uint8_t readers;
+        size_t headLen;
+        char head[96];        // Boundary + part header
+    };
+
+    struct Client {
+        WiFiClient conn;
+        bool active;
+        int8_t frame;         // Index into _frames, -1 when idle
+        size_t offset;        // Progress through head + JPEG
+        uint32_t lastSeq;     // Last frame fully sent
+        uint32_t lastProgressMs;
+        uint32_t frameStartUs;    // Current frame attached
+        uint32_t connectedAt;
+        uint32_t fpsWindowStart;
+        uint16_t fpsWindowFrames;
+        MjpegClientStats stats;
+    };
+
+    int8_t latestFrame() const;
+    int8_t grabFrame(uint32_t now);
+    void releaseFrame(int8_t index);
+    bool pump(Client &c, uint32_t now);
+    void dropClient(Client &c, const char *reason);
+
+    FrameBus &_bus;
+    Frame _frames[MJPEG_MAX_HELD_FRAMES];
+    Client _clients[MJPEG_MAX_CLIENTS];
+    uint32_t _minFrameIntervalMs;
+    uint32_t _lastGrabMs;
+    uint32_t _nextSeq;
+    uint32_t _framesCaptured;
+    uint32_t _bytesSent;
+    MjpegLinkSample _link;
+};
@@ -0,0 +1,77 @@
+/*
+ * PixelLine - see PixelLine.h
+ */
+
+#include "PixelLine.h"
+
+// Word steps need little-endian byte order (byte k at bits 8k) and cheap
+// unaligned access. Xtensa traps on unaligned words, so memcpy would turn
+// each load back into four byte loads; the byte loop is faster there.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ && !defined(__XTENSA__)
+#define PIXEL_LINE_WORDS        1
+#else
+#define PIXEL_LINE_WORDS        0
+#endif
+
+static inline uint8_t lumaOf(uint8_t r, uint8_t g, uint8_t b) {
+    return (r * 77 + g * 150 + b * 29) >> 8;
+}
+
+// memcpy keeps unaligned word access legal; it compiles to a plain load
+static inline uint32_t load32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline void store32(uint8_t *p, uint32_t v) {
+    memcpy(p, &v, 4);
+}
+
+// Per-pixel loops for the last n % 4 pixels
+static void rgbToLumaTail(const uint8_t *rgb, uint8_t *out, size_t n) {
+    for (; n > 0; n--, rgb += 3) {
+        *out++ = lumaOf(rgb[0], rgb[1], rgb[2]);
+    }
+}
+
+static void swapRgbTail(const uint8_t *src, uint8_t *dst, size_t n) {
+    for (; n > 0; n--, src += 3, dst += 3) {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+    }
+}
+
+void PixelLine::rgbToLuma(const uint8_t *rgb, uint8_t *out, size_t n) {
+    for (; n >= 4; n -= 4, rgb += 12, out += 4) {
+        uint32_t y0 = lumaOf(rgb[0], rgb[1], rgb[2]);
+        uint32_t y1 = lumaOf(rgb[3], rgb[4], rgb[5]);
+        uint32_t y2 = lumaOf(rgb[6], rgb[7], rgb[8]);
+        uint32_t y3 = lumaOf(rgb[9], rgb[10], rgb[11]);
+#if PIXEL_LINE_WORDS
+        store32(out, y0 | y1 << 8 | y2 << 16 | y3 << 24);
+#else
+        out[0] = y0;
+        out[1] = y1;
+        out[2] = y2;
+        out[3] = y3;
+#endif
+    }
+    rgbToLumaTail(rgb, out, n);
+}
+
+void PixelLine::swapRgb(const uint8_t *src, uint8_t *dst, size_t n) {
+#if PIXEL_LINE_WORDS
+    // R0 G0 B0 R1 | G1 B1 R2 G2 | B2 R3 G3 B3 -> B0 G0 R0 B1 | G1 R1 B2 G2 | R2 B3 G3 R3
+    for (; n >= 4; n -= 4, src += 12, dst += 12) {
+        uint32_t w0 = load32(src);
+        uint32_t w1 = load32(src + 4);
+        uint32_t w2 = load32(src + 8);
+        store32(dst,     (w0 >> 16 & 0xff) | (w0 & 0xff00) | (w0 & 0xff) << 16 | (w1 & 0xff00) << 16);
+        store32(dst + 4, (w1 & 0xff) | (w0 >> 24) << 8 | (w2 & 0xff) << 16 | (w1 & 0xff000000));
+        store32(dst + 8, (w1 >> 16 & 0xff) | (w2 >> 24) << 8 | (w2 & 0xff0000) | (w2 & 0xff00) << 16);
+    }
+#endif
+    swapRgbTail(src, dst, n);
+}
@@ -0,0 +1,33 @@
+/*
+ * PixelLine - Line kernels for the RGB888 blocks esp_jpg_decode produces
+ *
+ * The decoder hands out small RGB888 blocks (16x16 down to 2x2 pixels
+ * depending on scale); consumers clip each block row once and convert it
+ * with one call instead of testing and converting pixel by pixel.
+ *
+ *   // In a decoder callback, per block row clipped to [fromX, toX):
+ *   PixelLine::rgbToLuma(src, lumaRow + fromX, toX - fromX);
+ *   PixelLine::swapRgb(src, bgrRow + fromX * 3, toX - fromX);
+ *
+ * The kernels work on 4 pixels (12 bytes in, 4 or 12 bytes out) per
+ * step. Where unaligned word access is cheap (little-endian hosts) a step
+ * is three word loads and stores; on Xtensa (ESP32-S3), which traps on
+ * unaligned words, it stays a byte loop, unrolled by 4.
+ *
+ * Luma: (77 R + 150 G + 29 B) >> 8, the BT.601 weights in 8-bit fixed point.
+ *
+ * Stateless; safe from any task.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class PixelLine {
+public:
+    // RGB888 -> 8-bit luma, n pixels
+    static void rgbToLuma(const uint8_t *rgb, uint8_t *out, size_t n);
+
+    // RGB888 <-> BGR888, n pixels; src and dst must not overlap
+    static void swapRgb(const uint8_t *src, uint8_t *dst, size_t n);
+};
@@ -0,0 +1,124 @@
+/*
+ * RoiCrop - see RoiCrop.h
+ */
+
+#include "RoiCrop.h"
+#include "esp_jpg_decode.h"
+#include "PixelLine.h"
+
+RoiCrop::RoiCrop(uint8_t quality)
+    : _encoder(quality),
+      _jpeg(NULL),
+      _frameW(0),
+      _frameH(0),
+      _rgb(NULL),
+      _rgbSize(0) {
+    memset(&_stats, 0, sizeof(_stats));
+    memset(&_roi, 0, sizeof(_roi));
+}
+
+RoiCrop::~RoiCrop() {
+    free(_rgb);
+}
+
+RoiRect RoiCrop::align(int x0, int y0, int x1, int y1,
+                       uint16_t frameW, uint16_t frameH, uint8_t margin) {
+    x0 -= margin;
+    y0 -= margin;
+    x1 += margin;
+    y1 += margin;
+
+    // Outwards to the MCU grid, then into the frame
+    x0 = x0 < 0 ? 0 : x0 / ROI_MCU_SIZE * ROI_MCU_SIZE;
+    y0 = y0 < 0 ? 0 : y0 / ROI_MCU_SIZE * ROI_MCU_SIZE;
+    x1 = (x1 + ROI_MCU_SIZE - 1) / ROI_MCU_SIZE * ROI_MCU_SIZE;
+    y1 = (y1 + ROI_MCU_SIZE - 1) / ROI_MCU_SIZE * ROI_MCU_SIZE;
+    if (x1 > frameW) x1 = frameW;
+    if (y1 > frameH) y1 = frameH;
+
+    RoiRect roi = { 0, 0, frameW, frameH };
+    if (x1 > x0 && y1 > y0) {
+        roi.x = x0;
+        roi.y = y0;
+        roi.w = x1 - x0;
+        roi.h = y1 - y0;
+    }
+    return roi;
+}
+
+bool RoiCrop::crop(const uint8_t *jpeg, size_t len, const RoiRect &roi, uint8_t **out, size_t *outLen) {
+    uint32_t start = micros();
+    size_t size = (size_t)roi.w * roi.h * 3;
+    if (size == 0) {
+        _stats.failures++;
+        return false;
+    }
+    if (size != _rgbSize) {
+        free(_rgb);
+        _rgb = (uint8_t *)malloc(size);
+        _rgbSize = _rgb ? size : 0;
+        if (!_rgb) {
+            _stats.failures++;
+            return false;
+        }
+    }
+
+    _jpeg = jpeg;
+    _roi = roi;
+    _frameW = 0;
+    _frameH = 0;
+    *out = NULL;
+    // The decoder ignores the start call's verdict: check the ROI after it
+    if (esp_jpg_decode(len, JPG_SCALE_NONE, readJpeg, onPixels, this) != ESP_OK ||
+        roi.x + roi.w > _frameW || roi.y + roi.h > _frameH ||
+        !_encoder.encode(_rgb, roi.w, roi.h, out, outLen)) {
+        free(*out);
+        *out = NULL;
+        _stats.failures++;
+        return false;
+    }
+
+    _stats.crops++;
+    _stats.bytesIn = len;
+    _stats.bytesOut = *outLen;
+    _stats.lastUs = micros() - start;
+    _stats.encodeUs = _encoder.stats().lastUs;
+    return true;
+}
+
+// Decoder input; the decoder passes the same arg to reader and writer
+size_t RoiCrop::readJpeg(void *arg, size_t index, uint8_t *buf, size_t len) {
+    if (buf) {
+        memcpy(buf, static_cast<RoiCrop *>(arg)->_jpeg + index, len);
+    }
+    return len;
+}
+
+// Decoder output: copies the part of each RGB888 block inside the ROI
+bool RoiCrop::onPixels(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data) {
+    RoiCrop *self = static_cast<RoiCrop *>(arg);
+    const RoiRect &roi = self->_roi;
+    if (!data) {
+        // Start of frame: remember its size, the ROI must lie inside it
+        if (x == 0 && y == 0) {
+            self->_frameW = w;
+            self->_frameH = h;
+        }
+        return !(x == 0 && y == 0) || (roi.x + roi.w <= w && roi.y + roi.h <= h);
+    }
+
+    int fromX = x > roi.x ? x : roi.x;
+    int toX = x + w < roi.x + roi.w ? x + w : roi.x + roi.w;
+    int fromY = y > roi.y ? y : roi.y;
+    int toY = y + h < roi.y + roi.h ? y + h : roi.y + roi.h;
+    if (fromX >= toX || fromY >= toY) {
+        return true;
+    }
+
+    for (int py = fromY; py < toY; py++) {
+        const uint8_t *src = data + ((size_t)(py - y) * w + (fromX - x)) * 3;
+        uint8_t *dst = self->_rgb + ((size_t)(py - roi.y) * roi.w + (fromX - roi.x)) * 3;
+        PixelLine::swapRgb(src, dst, toX - fromX);
+    }
+    return true;
+}
@@ -0,0 +1,81 @@
+/*
+ * RoiCrop - Upload only the part of the frame that holds parking slots
+ *
+ * The region of interest is the bounding box of all slot polygons on this
+ * frame (SlotClassifier::bounds(), already scaled and inside the frame),
+ * grown by a margin and snapped outwards to the JPEG MCU grid (16 px), so the
+ * crop starts on a block boundary of the source frame and the re-encoded
+ * image has whole blocks. The frame is decoded into an RGB buffer that
+ * only covers the crop, then re-encoded at the configured quality with
+ * StripeJpeg (both cores, one stripe each).
+ *
+ *   slots.bounds(fb->width, fb->height, x0, y0, x1, y1);
+ *   RoiRect roi = RoiCrop::align(x0, y0, x1, y1, fb->width, fb->height, 16);
+ *   uint8_t *jpg; size_t jpgLen;
+ *   if (cropper.crop(fb->buf, fb->len, roi, &jpg, &jpgLen)) {
+ *       upload jpg with crop_x = roi.x, crop_y = roi.y; free(jpg);
+ *   }
+ *
+ * The crop buffer (w * h * 3 bytes) is kept between frames; with PSRAM
+ * the allocator places it there.
+ *
+ * Not thread-safe: use from a single task.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "StripeJpeg.h"
+
+#ifndef ROI_MCU_SIZE
+#define ROI_MCU_SIZE            16    // 4:2:0 / 4:2:2 MCU width and height
+#endif
+
+struct RoiRect {
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+};
+
+struct RoiCropStats {
+    uint32_t crops;
+    uint32_t failures;
+    uint32_t bytesIn;         // Last frame, full JPEG
+    uint32_t bytesOut;        // Last frame, cropped JPEG
+    uint32_t lastUs;          // Decode + re-encode, last frame
+    uint32_t encodeUs;        // Re-encode alone, last frame
+};
+
+class RoiCrop {
+public:
+    // quality: JPEG quality of the re-encoded crop (1-100)
+    explicit RoiCrop(uint8_t quality);
+    ~RoiCrop();
+
+    // Box [x0, x1) x [y0, y1) in frame pixels -> MCU-aligned ROI. Only the
+    // margin is clipped at the frame edges; a box that misses the frame
+    // entirely gives the whole frame.
+    static RoiRect align(int x0, int y0, int x1, int y1,
+                         uint16_t frameW, uint16_t frameH, uint8_t margin);
+
+    // Crops a JPEG frame; false if roi is not inside it. *out is malloc'd,
+    // the caller frees it
+    bool crop(const uint8_t *jpeg, size_t len, const RoiRect &roi, uint8_t **out, size_t *outLen);
+
+    const RoiCropStats &stats() const { return _stats; }
+
+private:
+    static size_t readJpeg(void *arg, size_t index, uint8_t *buf, size_t len);
+    static bool onPixels(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data);
+
+    StripeJpeg _encoder;
+    RoiCropStats _stats;
+
+    // Decoder state for crop()
+    const uint8_t *_jpeg;
+    RoiRect _roi;
+    uint16_t _frameW, _frameH;  // From the decoder's start call
+    uint8_t *_rgb;            // BGR888, as StripeJpeg (and fmt2jpg) expect
+    size_t _rgbSize;
+};
@@ -0,0 +1,146 @@
+/*
+ * SceneGate - see SceneGate.h
+ */
+
+#include "SceneGate.h"
+#include "esp_jpg_decode.h"
+
+SceneGate::SceneGate(uint8_t cellDelta, uint8_t changePercent, uint32_t heartbeatMs)
+    : _cellDelta(cellDelta),
+      _changePercent(changePercent),
+      _heartbeatMs(heartbeatMs),
+      _hasReference(false),
+      _lastUploadMs(0),
+      _jpeg(NULL),
+      _width(0),
+      _height(0) {
+    memset(&_reference, 0, sizeof(_reference));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+bool SceneGate::signature(const uint8_t *jpeg, size_t len, SceneSignature &sig) {
+    memset(_sum, 0, sizeof(_sum));
+    memset(_count, 0, sizeof(_count));
+    _jpeg = jpeg;
+    _width = 0;
+    _height = 0;
+
+    // 1/8 scale only needs the DC coefficient of each 8x8 block
+    if (esp_jpg_decode(len, JPG_SCALE_8X, readJpeg, onPixels, this) != ESP_OK || _width == 0) {
+        return false;
+    }
+    finish(sig);
+    return true;
+}
+
+void SceneGate::signatureFromGray(const uint8_t *gray, uint16_t width, uint16_t height,
+                                  SceneSignature &sig) {
+    uint32_t sum[SCENE_CELLS] = { 0 };
+    uint32_t count[SCENE_CELLS] = { 0 };
+    for (uint16_t y = 0; y < height; y++) {
+        uint16_t cy = (uint32_t)y * SCENE_GRID_H / height;
+        for (uint16_t x = 0; x < width; x++) {
+            uint16_t c = cy * SCENE_GRID_W + (uint32_t)x * SCENE_GRID_W / width;
+            sum[c] += gray[(uint32_t)y * width + x];
+            count[c]++;
+        }
+    }
+    for (int i = 0; i < SCENE_CELLS; i++) {
+        sig.cell[i] = count[i] ? sum[i] / count[i] : 0;
+    }
+}
+
+uint8_t SceneGate::score(const SceneSignature &a, const SceneSignature &b) const {
+    // Remove the global brightness shift first
+    int32_t total = 0;
+    for (int i = 0; i < SCENE_CELLS; i++) {
+        total += (int)a.cell[i] - (int)b.cell[i];
+    }
+    int32_t offset = total / SCENE_CELLS;
+
+    int changed = 0;
+    for (int i = 0; i < SCENE_CELLS; i++) {
+        int32_t d = (int)a.cell[i] - (int)b.cell[i] - offset;
+        if (d > _cellDelta || d < -(int32_t)_cellDelta) {
+            changed++;
+        }
+    }
+    return changed * 100 / SCENE_CELLS;
+}
+
+SceneDecision SceneGate::decide(const SceneSignature &sig, uint32_t nowMs) {
+    _stats.frames++;
+
+    SceneDecision decision = SCENE_SKIP;
+    if (!_hasReference) {
+        decision = SCENE_UPLOAD_FIRST;
+    } else {
+        _stats.lastScore = score(sig, _reference);
+        if (_stats.lastScore >= _changePercent) {
+            decision = SCENE_UPLOAD_CHANGED;
+        } else if (nowMs - _lastUploadMs >= _heartbeatMs) {
+            decision = SCENE_UPLOAD_HEARTBEAT;
+            _stats.heartbeats++;
+        }
+    }
+
+    if (decision == SCENE_SKIP) {
+        _stats.skipped++;
+    } else {
+        _stats.uploads++;
+    }
+    return decision;
+}
+
+void SceneGate::markUploaded(const SceneSignature &sig, uint32_t nowMs) {
+    _reference = sig;
+    _hasReference = true;
+    _lastUploadMs = nowMs;
+}
+
+// Decoder input; the decoder passes the same arg to reader and writer
+size_t SceneGate::readJpeg(void *arg, size_t index, uint8_t *buf, size_t len) {
+    if (buf) {
+        memcpy(buf, static_cast<SceneGate *>(arg)->_jpeg + index, len);
+    }
+    return len;
+}
+
+// Decoder output: RGB888 blocks, or a NULL block announcing the size
+bool SceneGate::onPixels(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data) {
+    SceneGate *self = static_cast<SceneGate *>(arg);
+    if (!data) {
+        if (x == 0 && y == 0) {
+            self->_width = w;
+            self->_height = h;
+        }
+        return true;
+    }
+    if (self->_width == 0) {
+        return false;
+    }
+
+    for (uint16_t iy = 0; iy < h; iy++) {
+        for (uint16_t ix = 0; ix < w; ix++, data += 3) {
+            uint8_t luma = (data[0] * 77 + data[1] * 150 + data[2] * 29) >> 8;
+            self->addLuma(x + ix, y + iy, luma);
+        }
+    }
+    return true;
+}
+
+void SceneGate::addLuma(uint16_t x, uint16_t y, uint8_t luma) {
+    if (x >= _width || y >= _height) {
+        return;
+    }
+    uint16_t c = (uint32_t)y * SCENE_GRID_H / _height * SCENE_GRID_W +
+                 (uint32_t)x * SCENE_GRID_W / _width;
+    _sum[c] += luma;
+    _count[c]++;
+}
+
+void SceneGate::finish(SceneSignature &sig) {
+    for (int i = 0; i < SCENE_CELLS; i++) {
+        sig.cell[i] = _count[i] ? _sum[i] / _count[i] : 0;
+    }
+}
@@ -0,0 +1,99 @@
+/*
+ * SceneGate - Skip AI uploads when the parking lot has not changed
+ *
+ * Each detection frame is reduced to a coarse luma signature: the JPEG is
+ * decoded at 1/8 scale (80x60 for VGA) straight into a SCENE_GRID_W x
+ * SCENE_GRID_H grid of cell averages, without a pixel buffer. The frame
+ * is uploaded when enough cells differ from the last uploaded frame, or
+ * when the heartbeat interval has passed; otherwise it is skipped.
+ *
+ *   SceneSignature sig;
+ *   if (!scene.signature(fb->buf, fb->len, sig) ||
+ *       scene.decide(sig, millis()) != SCENE_SKIP) {
+ *       if (upload ok) scene.markUploaded(sig, millis());
+ *   }
+ *
+ * The score ignores uniform brightness shifts (auto exposure, clouds):
+ * the mean difference over all cells is subtracted before counting.
+ *
+ * Not thread-safe: use from a single task.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#ifndef SCENE_GRID_W
+#define SCENE_GRID_W            16
+#endif
+
+#ifndef SCENE_GRID_H
+#define SCENE_GRID_H            12
+#endif
+
+#define SCENE_CELLS             (SCENE_GRID_W * SCENE_GRID_H)
+
+struct SceneSignature {
+    uint8_t cell[SCENE_CELLS];  // Average luma per cell
+};
+
+enum SceneDecision : uint8_t {
+    SCENE_SKIP,
+    SCENE_UPLOAD_FIRST,         // No reference frame yet
+    SCENE_UPLOAD_CHANGED,
+    SCENE_UPLOAD_HEARTBEAT
+};
+
+struct SceneStats {
+    uint32_t frames;
+    uint32_t uploads;           // Frames decide() let through
+    uint32_t skipped;
+    uint32_t heartbeats;
+    uint8_t lastScore;          // Percent of cells changed, last frame
+};
+
+class SceneGate {
+public:
+    // cellDelta: luma difference for a cell to count as changed
+    // changePercent: changed cells (in %) needed for an upload
+    SceneGate(uint8_t cellDelta, uint8_t changePercent, uint32_t heartbeatMs);
+
+    // Signature of a JPEG frame; false if it could not be decoded
+    bool signature(const uint8_t *jpeg, size_t len, SceneSignature &sig);
+
+    // Signature of an 8-bit grayscale image (recorded frames, tests)
+    static void signatureFromGray(const uint8_t *gray, uint16_t width, uint16_t height,
+                                  SceneSignature &sig);
+
+    // Percent of cells that differ between two signatures
+    uint8_t score(const SceneSignature &a, const SceneSignature &b) const;
+
+    SceneDecision decide(const SceneSignature &sig, uint32_t nowMs);
+
+    // The uploaded frame becomes the new reference
+    void markUploaded(const SceneSignature &sig, uint32_t nowMs);
+
+    const SceneStats &stats() const { return _stats; }
+
+private:
+    static size_t readJpeg(void *arg, size_t index, uint8_t *buf, size_t len);
+    static bool onPixels(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data);
+    void addLuma(uint16_t x, uint16_t y, uint8_t luma);
+    void finish(SceneSignature &sig);
+
+    uint8_t _cellDelta;
+    uint8_t _changePercent;
+    uint32_t _heartbeatMs;
+
+    bool _hasReference;
+    SceneSignature _reference;
+    uint32_t _lastUploadMs;
+    SceneStats _stats;
+
+    // Decoder state for signature()
+    const uint8_t *_jpeg;
+    uint16_t _width;
+    uint16_t _height;
+    uint32_t _sum[SCENE_CELLS];
+    uint16_t _count[SCENE_CELLS];
+};
@@ -0,0 +1,370 @@
+/*
+ * SlotClassifier - see SlotClassifier.h
+ */
+
+#include "SlotClassifier.h"
+#include "esp_jpg_decode.h"
+#include "PixelLine.h"
+#include <ArduinoJson.h>
+
+// Baseline update weight once a slot has a few samples
+#define BASELINE_ALPHA  0.25f
+
+SlotClassifier::SlotClassifier()
+    : _count(0),
+      _frameW(SLOT_REGION_FRAME_W),
+      _frameH(SLOT_REGION_FRAME_H),
+      _clipped(0),
+      _mask(NULL),
+      _maskW(0),
+      _maskH(0),
+      _maskFrameW(0),
+      _maskFrameH(0),
+      _jpeg(NULL),
+      _luma(NULL),
+      _lumaW(0),
+      _lumaH(0) {
+    memset(_regions, 0, sizeof(_regions));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+SlotClassifier::~SlotClassifier() {
+    free(_mask);
+    free(_luma);
+}
+
+bool SlotClassifier::loadRegions(const char *json, size_t len) {
+    DynamicJsonDocument doc(2048 + len);
+    if (deserializeJson(doc, json, len)) {
+        return false;
+    }
+
+    _count = 0;
+    _clipped = 0;
+    _maskW = 0;                     // Rebuild the mask on the next frame
+    setRegionFrame(doc["frame"]["width"] | SLOT_REGION_FRAME_W, doc["frame"]["height"] | SLOT_REGION_FRAME_H);
+    for (JsonObject region : doc["regions"].as<JsonArray>()) {
+        JsonArray points = region["points"];
+        int16_t xs[SLOT_MAX_POINTS];
+        int16_t ys[SLOT_MAX_POINTS];
+        uint8_t n = 0;
+        for (JsonArray p : points) {
+            if (n == SLOT_MAX_POINTS) {
+                break;
+            }
+            xs[n] = p[0];
+            ys[n] = p[1];
+            n++;
+        }
+        addRegion(region["code"] | "", xs, ys, n);
+    }
+    return _count > 0;
+}
+
+void SlotClassifier::setRegionFrame(uint16_t width, uint16_t height) {
+    if (width > 0 && height > 0) {
+        _frameW = width;
+        _frameH = height;
+        _maskW = 0;
+    }
+}
+
+bool SlotClassifier::addRegion(const char *code, const int16_t *xs, const int16_t *ys, uint8_t count) {
+    if (_count >= SLOT_MAX_REGIONS || count < 3 || !code[0]) {
+        return false;
+    }
+    Region &r = _regions[_count++];
+    memset(&r, 0, sizeof(r));
+    strlcpy(r.code, code, sizeof(r.code));
+    r.pointCount = count > SLOT_MAX_POINTS ? SLOT_MAX_POINTS : count;
+    // Annotation slop past the frame edge would misplace the mask and the
+    // crop box on every frame size; keep the points on the frame
+    for (uint8_t k = 0; k < r.pointCount; k++) {
+        r.x[k] = constrain(xs[k], 0, (int16_t)_frameW);
+        r.y[k] = constrain(ys[k], 0, (int16_t)_frameH);
+        if (r.x[k] != xs[k] || r.y[k] != ys[k]) {
+            _clipped++;
+        }
+    }
+    _maskW = 0;
+    return true;
+}
+
+bool SlotClassifier::bounds(uint16_t frameW, uint16_t frameH, int &x0, int &y0, int &x1, int &y1) const {
+    if (_count == 0) {
+        return false;
+    }
+    x0 = y0 = INT16_MAX;
+    x1 = y1 = INT16_MIN;
+    for (uint8_t i = 0; i < _count; i++) {
+        const Region &r = _regions[i];
+        for (uint8_t k = 0; k < r.pointCount; k++) {
+            x0 = min(x0, (int)r.x[k]);
+            y0 = min(y0, (int)r.y[k]);
+            x1 = max(x1, (int)r.x[k]);
+            y1 = max(y1, (int)r.y[k]);
+        }
+    }
+    // Outwards to whole frame pixels
+    x0 = (int32_t)x0 * frameW / _frameW;
+    y0 = (int32_t)y0 * frameH / _frameH;
+    x1 = min((int)frameW, (int)(((int32_t)x1 * frameW + _frameW - 1) / _frameW) + 1);
+    y1 = min((int)frameH, (int)(((int32_t)y1 * frameH + _frameH - 1) / _frameH) + 1);
+    return true;
+}
+
+bool SlotClassifier::classify(const uint8_t *jpeg, size_t len, uint16_t frameW, uint16_t frameH) {
+    if (_count == 0) {
+        return false;
+    }
+    uint32_t start = micros();
+
+    // 1/4 scale: 160x120 for VGA, enough for edges inside a slot
+    uint16_t w = (frameW + 3) / 4;
+    uint16_t h = (frameH + 3) / 4;
+    if (w != _lumaW || h != _lumaH) {
+        free(_luma);
+        _luma = (uint8_t *)malloc((size_t)w * h);
+        _lumaW = _luma ? w : 0;
+        _lumaH = _luma ? h : 0;
+        if (!_luma) {
+            return false;
+        }
+    }
+
+    _jpeg = jpeg;
+    if (esp_jpg_decode(len, JPG_SCALE_4X, readJpeg, onPixels, this) != ESP_OK) {
+        return false;
+    }
+    bool ok = classifyLuma(_luma, _lumaW, _lumaH, frameW, frameH);
+    _stats.lastFrameUs = micros() - start;
+    return ok;
+}
+
+bool SlotClassifier::classifyLuma(const uint8_t *luma, uint16_t w, uint16_t h,
+                                  uint16_t frameW, uint16_t frameH) {
+    if (_count == 0 || !buildMask(w, h, frameW, frameH)) {
+        return false;
+    }
+    for (uint8_t i = 0; i < _count; i++) {
+        memset(&_regions[i].features, 0, sizeof(Features));
+    }
+
+    const uint8_t *m = _mask;
+    const uint8_t *p = luma;
+    for (uint16_t y = 0; y < h; y++) {
+        for (uint16_t x = 0; x < w; x++, m++, p++) {
+            if (*m == 0) {
+                continue;
+            }
+            Features &f = _regions[*m - 1].features;
+            uint8_t v = *p;
+            f.pixels++;
+            f.sum += v;
+            f.sumSq += (uint32_t)v * v;
+
+            int dx = x > 0 ? abs((int)v - p[-1]) : 0;
+            int dy = y > 0 ? abs((int)v - p[-(int)w]) : 0;
+            if (dx > SLOT_EDGE_DELTA || dy > SLOT_EDGE_DELTA) {
+                f.edges++;
+            }
+        }
+    }
+
+    // Histogram around each slot's own mean, so exposure changes cancel out
+    uint8_t means[SLOT_MAX_REGIONS];
+    for (uint8_t i = 0; i < _count; i++) {
+        const Features &f = _regions[i].features;
+        means[i] = f.pixels ? f.sum / f.pixels : 0;
+    }
+    m = _mask;
+    p = luma;
+    for (uint32_t n = (uint32_t)w * h; n > 0; n--, m++, p++) {
+        if (*m != 0) {
+            int v = (int)*p - means[*m - 1] + 128;
+            _regions[*m - 1].features.hist[(v < 0 ? 0 : (v > 255 ? 255 : v)) >> 4]++;
+        }
+    }
+
+    bool decided = true;
+    for (uint8_t i = 0; i < _count; i++) {
+        decide(_regions[i]);
+        decided = decided && _regions[i].result.state != SLOT_UNKNOWN;
+    }
+    _stats.frames++;
+    if (decided) {
+        _stats.decided++;
+    }
+    return true;
+}
+
+uint8_t SlotClassifier::unknownCount() const {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_regions[i].result.state == SLOT_UNKNOWN) {
+            n++;
+        }
+    }
+    return n;
+}
+
+void SlotClassifier::learn(const char *code, bool occupied) {
+    for (uint8_t i = 0; i < _count; i++) {
+        Region &r = _regions[i];
+        if (strcmp(r.code, code) != 0) {
+            continue;
+        }
+        if (r.result.state != SLOT_UNKNOWN) {
+            if ((r.result.state == SLOT_OCCUPIED) == occupied) {
+                _stats.agree++;
+            } else {
+                _stats.disagree++;
+            }
+        }
+
+        // Only empty slots teach the baseline
+        const Features &f = r.features;
+        if (occupied || f.pixels == 0) {
+            return;
+        }
+        Baseline &b = r.baseline;
+        float mean = (float)f.sum / f.pixels;
+        float variance = (float)f.sumSq / f.pixels - mean * mean;
+        float edgeDensity = (float)f.edges / f.pixels;
+
+        // Plain average for the first samples, then an EMA
+        float alpha = b.samples < 4 ? 1.0f / (b.samples + 1) : BASELINE_ALPHA;
+        for (int k = 0; k < SLOT_HIST_BINS; k++) {
+            b.hist[k] += alpha * ((float)f.hist[k] / f.pixels - b.hist[k]);
+        }
+        b.edgeDensity += alpha * (edgeDensity - b.edgeDensity);
+        b.variance += alpha * (variance - b.variance);
+        if (b.samples < 0xFFFF) {
+            b.samples++;
+        }
+        return;
+    }
+}
+
+// Score 0..100: half histogram distance, the rest edge and variance growth
+void SlotClassifier::decide(Region &r) {
+    const Features &f = r.features;
+    const Baseline &b = r.baseline;
+    SlotResult &res = r.result;
+    memset(&res, 0, sizeof(res));
+    if (f.pixels == 0) {
+        return;
+    }
+
+    float mean = (float)f.sum / f.pixels;
+    float variance = (float)f.sumSq / f.pixels - mean * mean;
+    float edgeDensity = (float)f.edges / f.pixels;
+    res.edgePermille = edgeDensity * 1000;
+    res.variance = variance > 65535 ? 65535 : variance;
+    if (b.samples == 0) {
+        return;
+    }
+
+    // L1 distance between normalised histograms is 0..2
+    float hist = 0;
+    for (int k = 0; k < SLOT_HIST_BINS; k++) {
+        hist += fabsf((float)f.hist[k] / f.pixels - b.hist[k]);
+    }
+    float edges = (edgeDensity - b.edgeDensity) * 4;
+    float spread = (variance - b.variance) / (b.variance + 400);
+    edges = edges < 0 ? 0 : (edges > 1 ? 1 : edges);
+    spread = spread < 0 ? 0 : (spread > 1 ? 1 : spread);
+
+    float score = 100 * (0.5f * hist / 2 + 0.3f * edges + 0.2f * spread);
+    res.score = score > 100 ? 100 : score;
+
+    if (res.score <= SLOT_EMPTY_BELOW) {
+        res.state = SLOT_EMPTY;
+        res.confidence = 50 + 50 * (SLOT_EMPTY_BELOW - res.score) / SLOT_EMPTY_BELOW;
+    } else if (res.score >= SLOT_OCCUPIED_ABOVE) {
+        res.state = SLOT_OCCUPIED;
+        res.confidence = 50 + 50 * (res.score - SLOT_OCCUPIED_ABOVE) / (100 - SLOT_OCCUPIED_ABOVE);
+    }
+}
+
+// Maps every luma pixel to the slot whose polygon contains its centre.
+// Polygons are in region frame pixels; the first matching slot wins.
+bool SlotClassifier::buildMask(uint16_t w, uint16_t h, uint16_t frameW, uint16_t frameH) {
+    if (_mask && w == _maskW && h == _maskH && frameW == _maskFrameW && frameH == _maskFrameH) {
+        return true;
+    }
+    // Edge density and variance depend on the scale: a stream that changed
+    // frame size needs new baselines from the AI service
+    if (_maskFrameW != 0 && (frameW != _maskFrameW || frameH != _maskFrameH)) {
+        for (uint8_t i = 0; i < _count; i++) {
+            memset(&_regions[i].baseline, 0, sizeof(Baseline));
+        }
+    }
+    free(_mask);
+    _mask = (uint8_t *)malloc((size_t)w * h);
+    if (!_mask) {
+        _maskW = 0;
+        return false;
+    }
+
+    // Luma pixel -> camera frame pixel -> region frame pixel
+    float sx = (float)frameW / w * _frameW / frameW;
+    float sy = (float)frameH / h * _frameH / frameH;
+    uint8_t *m = _mask;
+    for (uint16_t y = 0; y < h; y++) {
+        for (uint16_t x = 0; x < w; x++) {
+            uint8_t id = 0;
+            for (uint8_t i = 0; i < _count && id == 0; i++) {
+                if (inside(_regions[i], (x + 0.5f) * sx, (y + 0.5f) * sy)) {
+                    id = i + 1;
+                }
+            }
+            *m++ = id;
+        }
+    }
+    _maskW = w;
+    _maskH = h;
+    _maskFrameW = frameW;
+    _maskFrameH = frameH;
+    return true;
+}
+
+// Even-odd rule, as in the AI service's point-in-polygon test
+bool SlotClassifier::inside(const Region &r, float x, float y) {
+    bool in = false;
+    for (uint8_t i = 0, j = r.pointCount - 1; i < r.pointCount; j = i++) {
+        if ((r.y[i] > y) != (r.y[j] > y) &&
+            x < (float)(r.x[j] - r.x[i]) * (y - r.y[i]) / (r.y[j] - r.y[i]) + r.x[i]) {
+            in = !in;
+        }
+    }
+    return in;
+}
+
+// Decoder input; the decoder passes the same arg to reader and writer
+size_t SlotClassifier::readJpeg(void *arg, size_t index, uint8_t *buf, size_t len) {
+    if (buf) {
+        memcpy(buf, static_cast<SlotClassifier *>(arg)->_jpeg + index, len);
+    }
+    return len;
+}
+
+// Decoder output: RGB888 blocks written into the luma buffer
+bool SlotClassifier::onPixels(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data) {
+    SlotClassifier *self = static_cast<SlotClassifier *>(arg);
+    if (!data) {
+        // Size announcement; the buffer was sized from the frame already
+        return !(x == 0 && y == 0) || (w <= self->_lumaW && h <= self->_lumaH);
+    }
+
+    // Clip the block once, then convert whole rows
+    if (x >= self->_lumaW || y >= self->_lumaH) {
+        return true;
+    }
+    uint16_t cols = x + w <= self->_lumaW ? w : self->_lumaW - x;
+    uint16_t rows = y + h <= self->_lumaH ? h : self->_lumaH - y;
+    for (uint16_t iy = 0; iy < rows; iy++, data += (size_t)w * 3) {
+        PixelLine::rgbToLuma(data, self->_luma + (uint32_t)(y + iy) * self->_lumaW + x, cols);
+    }
+    return true;
+}
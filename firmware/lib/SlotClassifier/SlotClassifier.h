@@ -0,0 +1,167 @@
+/*
+ * SlotClassifier - Per-slot occupancy on the device, YOLO only when unsure
+ *
+ * Uses the same slot polygons as the AI service (GET /regions, from
+ * ai-service/parking_regions.json). They are in pixels of the frame they
+ * were drawn on, the reply's "frame" (SLOT_REGION_FRAME_W x _H if absent),
+ * and are scaled to whatever size each camera frame has; points outside
+ * that frame are clipped to its edge and counted in clippedPoints().
+ * Each frame is decoded at 1/4 scale to luma, and per slot it measures:
+ *   - edge density      (share of pixels with a strong local gradient)
+ *   - luma variance
+ *   - 16-bin luma histogram around the slot mean, compared with the
+ *     slot's empty baseline (so exposure changes cancel out)
+ * The three are blended into a score; low = empty, high = occupied, and
+ * anything in between is SLOT_UNKNOWN, to be escalated to YOLO.
+ *
+ * Baselines are learned from the AI service: whenever it reports a slot
+ * empty, learn() folds that frame's features into the slot's baseline.
+ * A slot without a baseline is always SLOT_UNKNOWN; a change of frame
+ * size drops the baselines.
+ *
+ *   slots.loadRegions(json, len);
+ *   if (slots.classify(fb->buf, fb->len, fb->width, fb->height) &&
+ *       slots.unknownCount() == 0) { publish slots.result(i) }
+ *   else { upload to /analyze; slots.learn(code, occupied) per slot }
+ *
+ * Not thread-safe: use from a single task.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#ifndef SLOT_MAX_REGIONS
+#define SLOT_MAX_REGIONS        16
+#endif
+
+// Frame the regions were drawn on, when /regions does not say (SVGA)
+#ifndef SLOT_REGION_FRAME_W
+#define SLOT_REGION_FRAME_W     800
+#endif
+#ifndef SLOT_REGION_FRAME_H
+#define SLOT_REGION_FRAME_H     600
+#endif
+
+#define SLOT_MAX_POINTS         8
+#define SLOT_CODE_LEN           8
+#define SLOT_HIST_BINS          16
+
+// Luma step between neighbours that counts as an edge
+#ifndef SLOT_EDGE_DELTA
+#define SLOT_EDGE_DELTA         24
+#endif
+
+// Score thresholds (0..100)
+#ifndef SLOT_EMPTY_BELOW
+#define SLOT_EMPTY_BELOW        15
+#endif
+#ifndef SLOT_OCCUPIED_ABOVE
+#define SLOT_OCCUPIED_ABOVE     35
+#endif
+
+enum SlotState : uint8_t {
+    SLOT_UNKNOWN,
+    SLOT_EMPTY,
+    SLOT_OCCUPIED
+};
+
+struct SlotResult {
+    SlotState state;
+    uint8_t confidence;       // 0..100, 0 when unknown
+    uint8_t score;            // 0..100, distance from the empty baseline
+    uint16_t edgePermille;    // Edge pixels per 1000
+    uint16_t variance;
+};
+
+struct SlotClassifierStats {
+    uint32_t frames;          // Frames classified
+    uint32_t decided;         // Frames with no unknown slot
+    uint32_t agree;           // Confident slots the AI service agreed with
+    uint32_t disagree;
+    uint32_t lastFrameUs;     // Decode + features, last frame
+};
+
+class SlotClassifier {
+public:
+    SlotClassifier();
+    ~SlotClassifier();
+
+    // Regions as returned by GET /regions:
+    // {"frame":{"width","height"},"regions":[{"code","points"}]}
+    bool loadRegions(const char *json, size_t len);
+    // Points in pixels of the region frame (set it first)
+    void setRegionFrame(uint16_t width, uint16_t height);
+    bool addRegion(const char *code, const int16_t *xs, const int16_t *ys, uint8_t count);
+    uint8_t regionCount() const { return _count; }
+    const char *code(uint8_t i) const { return _regions[i].code; }
+    uint16_t regionFrameWidth() const { return _frameW; }
+    uint16_t regionFrameHeight() const { return _frameH; }
+    // Points that lay outside the region frame, over all loaded regions
+    uint16_t clippedPoints() const { return _clipped; }
+
+    // Bounding box of all regions on a frameW x frameH frame, in its
+    // pixels: [x0, x1) x [y0, y1), inside the frame
+    bool bounds(uint16_t frameW, uint16_t frameH, int &x0, int &y0, int &x1, int &y1) const;
+
+    // Classifies a JPEG frame of frameW x frameH pixels
+    bool classify(const uint8_t *jpeg, size_t len, uint16_t frameW, uint16_t frameH);
+
+    // Same on an 8-bit luma image that covers a frameW x frameH frame
+    bool classifyLuma(const uint8_t *luma, uint16_t w, uint16_t h, uint16_t frameW, uint16_t frameH);
+
+    const SlotResult &result(uint8_t i) const { return _regions[i].result; }
+    uint8_t unknownCount() const;
+
+    // Ground truth for the last classified frame (from the AI service)
+    void learn(const char *code, bool occupied);
+
+    const SlotClassifierStats &stats() const { return _stats; }
+
+private:
+    struct Features {
+        uint32_t pixels;
+        uint32_t edges;
+        uint32_t sum;
+        uint64_t sumSq;
+        uint32_t hist[SLOT_HIST_BINS];
+    };
+
+    struct Baseline {
+        uint16_t samples;
+        float hist[SLOT_HIST_BINS];   // Normalised
+        float edgeDensity;
+        float variance;
+    };
+
+    struct Region {
+        char code[SLOT_CODE_LEN];
+        uint8_t pointCount;
+        int16_t x[SLOT_MAX_POINTS];
+        int16_t y[SLOT_MAX_POINTS];
+        Features features;            // Last frame
+        Baseline baseline;
+        SlotResult result;
+    };
+
+    static size_t readJpeg(void *arg, size_t index, uint8_t *buf, size_t len);
+    static bool onPixels(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data);
+    static bool inside(const Region &r, float x, float y);
+    bool buildMask(uint16_t w, uint16_t h, uint16_t frameW, uint16_t frameH);
+    void decide(Region &r);
+
+    Region _regions[SLOT_MAX_REGIONS];
+    uint8_t _count;
+    uint16_t _frameW, _frameH;        // Region frame
+    uint16_t _clipped;
+    SlotClassifierStats _stats;
+
+    // Slot index + 1 per luma pixel (0 = outside every slot)
+    uint8_t *_mask;
+    uint16_t _maskW, _maskH, _maskFrameW, _maskFrameH;
+
+    // JPEG decode target
+    const uint8_t *_jpeg;
+    uint8_t *_luma;
+    uint16_t _lumaW, _lumaH;
+};
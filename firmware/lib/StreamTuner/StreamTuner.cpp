@@ -0,0 +1,130 @@
+/*
+ * StreamTuner - see StreamTuner.h
+ */
+
+#include "StreamTuner.h"
+
+// JPEG quality per ladder rung, best first; each step is ~25% smaller
+static const uint8_t QUALITY_STEPS[] = { 10, 12, 15, 19, 24, 30, 38 };
+#define QUALITY_STEP_COUNT  (sizeof(QUALITY_STEPS) / sizeof(QUALITY_STEPS[0]))
+
+StreamTuner::StreamTuner(const StreamTunerConfig &config)
+    : _config(config),
+      _firstQuality(0),
+      _level(0),
+      _throughput(0),
+      _downCount(0),
+      _upCount(0),
+      _lastUpdateMs(0),
+      _lastDownMs(0) {
+    memset(&_stats, 0, sizeof(_stats));
+    if (_config.targetFps == 0) _config.targetFps = 1;
+    if (_config.sizeSteps == 0) _config.sizeSteps = 1;
+
+    while (_firstQuality < QUALITY_STEP_COUNT - 1 &&
+           QUALITY_STEPS[_firstQuality] < _config.bestQuality) {
+        _firstQuality++;
+    }
+    uint8_t perSize = QUALITY_STEP_COUNT - _firstQuality;
+    _levels = perSize * _config.sizeSteps;
+
+    // Start at the largest size, closest quality at or above startQuality
+    while (_level < perSize - 1 && QUALITY_STEPS[_firstQuality + _level] < _config.startQuality) {
+        _level++;
+    }
+    _nominalIntervalMs = 1000 / _config.targetFps;
+    _intervalMs = _nominalIntervalMs;
+    _stats.level = _level;
+}
+
+StreamSetting StreamTuner::setting() const {
+    uint8_t perSize = QUALITY_STEP_COUNT - _firstQuality;
+    StreamSetting s;
+    s.sizeStep = _level / perSize;
+    s.quality = QUALITY_STEPS[_firstQuality + _level % perSize];
+    s.frameIntervalMs = _intervalMs;
+    return s;
+}
+
+bool StreamTuner::update(const MjpegLinkSample &sample, uint32_t nowMs, StreamSetting &out) {
+    uint32_t period = nowMs - _lastUpdateMs;
+    _lastUpdateMs = nowMs;
+    if (sample.clients == 0 || period == 0) {
+        _downCount = 0;
+        _upCount = 0;
+        return false;
+    }
+    StreamSetting before = setting();
+
+    // Measure: frame cost now, throughput each socket achieved
+    bool bad = sample.frames == 0;     // Nothing got through at all
+    bool good = false;
+    if (sample.frames > 0) {
+        _stats.frameBytes = sample.bytes / sample.frames;
+        _stats.fps = sample.frames * 1000.0f / period / sample.clients;
+        if (sample.sendUs > 0) {
+            float measured = sample.bytes * 1e6f / sample.sendUs;
+            _throughput = _throughput == 0 ? measured : _throughput + (measured - _throughput) / 4;
+        }
+        _stats.throughputKbps = _throughput * 8 / 1000;
+
+        float budget = _throughput * STREAM_TUNE_HEADROOM;
+        float cap = _config.maxKbps * 1000.0f / 8;
+        if (cap > 0 && cap < budget) {
+            budget = cap;
+        }
+        float need = (float)_stats.frameBytes * _config.targetFps;
+        bool paced = _intervalMs > _nominalIntervalMs;
+
+        bad = need > budget || (!paced && _stats.fps < _config.targetFps * 0.8f);
+        good = need * STREAM_TUNE_STEP_GROWTH < budget && (paced || _stats.fps >= _config.targetFps * 0.9f);
+
+        // Past the last level only pacing is left: fit the budget directly,
+        // unless that is within measurement noise of the current interval
+        // (the budget already keeps STREAM_TUNE_HEADROOM in reserve)
+        if (bad && _level == _levels - 1 && budget > 0) {
+            float interval = _stats.frameBytes * 1000.0f / budget;
+            interval = interval > STREAM_TUNE_MAX_INTERVAL_MS ? STREAM_TUNE_MAX_INTERVAL_MS :
+                       (interval < _nominalIntervalMs ? _nominalIntervalMs : interval);
+            if (interval > _intervalMs * STREAM_TUNE_PACE_DEADBAND ||
+                interval * STREAM_TUNE_PACE_DEADBAND < _intervalMs) {
+                _intervalMs = (uint16_t)interval;
+            }
+        }
+    }
+
+    if (bad) {
+        _upCount = 0;
+        if (++_downCount >= STREAM_TUNE_DOWN_PERIODS) {
+            _downCount = 0;
+            _lastDownMs = nowMs;
+            if (_level < _levels - 1) {
+                _level++;
+                _stats.stepsDown++;
+            } else if (sample.frames == 0 && _intervalMs < STREAM_TUNE_MAX_INTERVAL_MS) {
+                _intervalMs = _intervalMs * 2 > STREAM_TUNE_MAX_INTERVAL_MS ?
+                              STREAM_TUNE_MAX_INTERVAL_MS : _intervalMs * 2;
+            }
+        }
+    } else if (good) {
+        _downCount = 0;
+        if (++_upCount >= STREAM_TUNE_UP_PERIODS && nowMs - _lastDownMs >= STREAM_TUNE_HOLD_MS) {
+            _upCount = 0;
+            if (_intervalMs > _nominalIntervalMs) {
+                // Undo pacing before spending bytes on quality
+                _intervalMs = _intervalMs * 3 / 4 < _nominalIntervalMs ? _nominalIntervalMs : _intervalMs * 3 / 4;
+            } else if (_level > 0) {
+                _level--;
+                _stats.stepsUp++;
+            }
+        }
+    } else {
+        _downCount = 0;
+        _upCount = 0;
+    }
+    _stats.level = _level;
+
+    out = setting();
+    return out.sizeStep != before.sizeStep || out.quality != before.quality ||
+           out.frameIntervalMs != before.frameIntervalMs;
+}
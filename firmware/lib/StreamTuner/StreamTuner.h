@@ -0,0 +1,102 @@
+/*
+ * StreamTuner - Closed-loop JPEG quality, frame size and pacing for MJPEG
+ *
+ * Once per period the stream task hands it what the streamer delivered
+ * (MjpegLinkSample): frames, bytes and the time each frame spent on its
+ * socket. From that it estimates per-viewer link throughput and the cost
+ * of the current setting, and walks a ladder of settings:
+ *   level 0       best allowed quality, largest frame size
+ *   ...           coarser JPEG quality, then the next smaller frame size
+ *   last level    coarsest quality, smallest frame size
+ * Past the last level the only knob left is pacing: the frame interval
+ * grows until the stream fits the budget (and shrinks back first).
+ *
+ * Hysteresis: a step down needs STREAM_TUNE_DOWN_PERIODS bad periods in a
+ * row, a step up STREAM_TUNE_UP_PERIODS good ones with room for the next
+ * level's bigger frames, and never within STREAM_TUNE_HOLD_MS of a step
+ * down. Between the two thresholds nothing changes, and the frame
+ * interval only moves by more than STREAM_TUNE_PACE_DEADBAND.
+ *
+ * The tuner does not touch the camera; the caller maps sizeStep to its
+ * own frame sizes:
+ *   StreamSetting s;
+ *   streamer.takeLinkSample(sample);
+ *   if (tuner.update(sample, millis(), s)) {
+ *       sensor->set_quality(sensor, s.quality);
+ *       sensor->set_framesize(sensor, sizes[s.sizeStep]);
+ *       streamer.setFrameInterval(s.frameIntervalMs);
+ *   }
+ *
+ * Not thread-safe: use from a single task.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "MjpegStreamer.h"
+
+#ifndef STREAM_TUNE_DOWN_PERIODS
+#define STREAM_TUNE_DOWN_PERIODS    2
+#endif
+
+#ifndef STREAM_TUNE_UP_PERIODS
+#define STREAM_TUNE_UP_PERIODS      5
+#endif
+
+#ifndef STREAM_TUNE_HOLD_MS
+#define STREAM_TUNE_HOLD_MS         10000
+#endif
+
+#define STREAM_TUNE_HEADROOM        0.8f    // Share of measured throughput to use
+#define STREAM_TUNE_STEP_GROWTH     1.3f    // Frame bytes, next level up vs this one
+#define STREAM_TUNE_PACE_DEADBAND   1.15f   // Smallest frame interval change applied
+#define STREAM_TUNE_MAX_INTERVAL_MS 1000
+
+struct StreamTunerConfig {
+    uint8_t targetFps;
+    uint32_t maxKbps;         // Bitrate cap per viewer
+    uint8_t sizeSteps;        // Frame sizes behind sizeStep (1 = fixed size)
+    uint8_t bestQuality;      // Lowest JPEG quality number allowed (10-63, lower = better)
+    uint8_t startQuality;
+};
+
+struct StreamSetting {
+    uint8_t sizeStep;         // 0 = largest
+    uint8_t quality;
+    uint16_t frameIntervalMs;
+};
+
+struct StreamTunerStats {
+    uint32_t stepsDown;
+    uint32_t stepsUp;
+    uint8_t level;
+    uint32_t throughputKbps;  // Estimated per viewer
+    uint32_t frameBytes;      // Average, last period
+    float fps;                // Per viewer, last period
+};
+
+class StreamTuner {
+public:
+    explicit StreamTuner(const StreamTunerConfig &config);
+
+    // Feeds one period; true when out holds a new setting to apply
+    bool update(const MjpegLinkSample &sample, uint32_t nowMs, StreamSetting &out);
+
+    StreamSetting setting() const;
+    uint8_t levels() const { return _levels; }
+    const StreamTunerStats &stats() const { return _stats; }
+
+private:
+    StreamTunerConfig _config;
+    uint8_t _firstQuality;    // First usable QUALITY_STEPS index
+    uint8_t _levels;
+    uint8_t _level;
+    uint16_t _intervalMs;
+    uint16_t _nominalIntervalMs;
+    float _throughput;        // Bytes/s, EMA
+    uint8_t _downCount;
+    uint8_t _upCount;
+    uint32_t _lastUpdateMs;
+    uint32_t _lastDownMs;
+    StreamTunerStats _stats;
+};
@@ -0,0 +1,641 @@
+/*
+ * StripeJpeg - see StripeJpeg.h
+ */
+
+#include "StripeJpeg.h"
+#include <atomic>
+
+#define HEADER_MAX              640   // SOI..SOS is 613 bytes
+
+// Natural index of each zigzag position
+static const uint8_t ZIGZAG[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+};
+
+// ITU T.81 Annex K, natural order
+static const uint8_t LUMA_QUANT[64] = {
+    16, 11, 10, 16, 24, 40, 51, 61,
+    12, 12, 14, 19, 26, 58, 60, 55,
+    14, 13, 16, 24, 40, 57, 69, 56,
+    14, 17, 22, 29, 51, 87, 80, 62,
+    18, 22, 37, 56, 68, 109, 103, 77,
+    24, 35, 55, 64, 81, 104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101,
+    72, 92, 95, 98, 112, 100, 103, 99
+};
+
+static const uint8_t CHROMA_QUANT[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99,
+    18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99,
+    47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99
+};
+
+// Code counts per length 1-16, then symbols
+static const uint8_t DC_LUMA_BITS[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+static const uint8_t DC_CHROMA_BITS[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+static const uint8_t DC_VALUES[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+static const uint8_t AC_LUMA_BITS[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+static const uint8_t AC_LUMA_VALUES[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+static const uint8_t AC_CHROMA_BITS[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+static const uint8_t AC_CHROMA_VALUES[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+static const uint8_t *const HUFF_BITS[4] = { DC_LUMA_BITS, AC_LUMA_BITS, DC_CHROMA_BITS, AC_CHROMA_BITS };
+static const uint8_t *const HUFF_VALUES[4] = { DC_VALUES, AC_LUMA_VALUES, DC_VALUES, AC_CHROMA_VALUES };
+static const uint8_t HUFF_CLASS_ID[4] = { 0x00, 0x10, 0x01, 0x11 };
+
+// The DCT runs in fixed point: samples carry DCT_PASS_BITS fraction bits
+// through both passes and the rotations use DCT_CONST_BITS constants.
+// With full-scale input the largest product stays below 2^30.
+#define DCT_PASS_BITS   4
+#define DCT_CONST_BITS  13
+#define DCT_FIX(x)      ((int32_t)((x) * (1 << DCT_CONST_BITS) + 0.5))
+#define DCT_MUL(v, c)   (((v) * (c) + (1 << (DCT_CONST_BITS - 1))) >> DCT_CONST_BITS)
+
+// AAN output scale per index, times sqrt(8)
+static const double AAN_SCALE[8] = {
+    1.0 * 2.828427125, 1.387039845 * 2.828427125, 1.306562965 * 2.828427125,
+    1.175875602 * 2.828427125, 1.0 * 2.828427125, 0.785694958 * 2.828427125,
+    0.541196100 * 2.828427125, 0.275899379 * 2.828427125
+};
+
+static uint8_t huffCount(const uint8_t *bits) {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < 16; i++) {
+        n += bits[i];
+    }
+    return n;
+}
+
+// Canonical codes for the four standard tables (DC Y, AC Y, DC C, AC C),
+// by symbol, packed as code << 8 | length so one load gives both. Built
+// during static initialization, read-only afterwards.
+struct HuffCodes {
+    uint32_t code[4][256];
+
+    HuffCodes() {
+        memset(this, 0, sizeof(*this));
+        for (uint8_t t = 0; t < 4; t++) {
+            uint16_t next = 0;
+            uint8_t k = 0;
+            for (uint8_t len = 1; len <= 16; len++) {
+                for (uint8_t i = 0; i < HUFF_BITS[t][len - 1]; i++, k++) {
+                    code[t][HUFF_VALUES[t][k]] = (uint32_t)next++ << 8 | len;
+                }
+                next <<= 1;
+            }
+        }
+    }
+};
+
+static const HuffCodes HUFF;
+
+// One slot per quality; entries are published once and never change
+static std::atomic<const JpegQuantTables *> quantCache[100];
+
+const JpegQuantTables *StripeJpeg::quantTables(uint8_t quality) {
+    if (quality < 1) quality = 1;
+    if (quality > 100) quality = 100;
+    std::atomic<const JpegQuantTables *> &slot = quantCache[quality - 1];
+    const JpegQuantTables *tables = slot.load(std::memory_order_acquire);
+    if (tables) {
+        return tables;
+    }
+
+    JpegQuantTables *built = (JpegQuantTables *)malloc(sizeof(JpegQuantTables));
+    if (!built) {
+        return NULL;
+    }
+    // Same quality scaling as libjpeg and jpge
+    int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    const uint8_t *base[2] = { LUMA_QUANT, CHROMA_QUANT };
+    for (uint8_t t = 0; t < 2; t++) {
+        for (uint8_t i = 0; i < 64; i++) {
+            int q = (base[t][i] * scale + 50) / 100;
+            built->quant[t][i] = q < 1 ? 1 : (q > 255 ? 255 : q);
+            // Largest is 2^32 / (1 * 0.78^2 * 16), below 2^29
+            double divisor = built->quant[t][i] * AAN_SCALE[i / 8] * AAN_SCALE[i % 8] * (1 << DCT_PASS_BITS);
+            built->reciprocals[t][i] = (uint32_t)(4294967296.0 / divisor + 0.5);
+        }
+    }
+
+    // Another task may have built the same quality meanwhile: keep theirs
+    const JpegQuantTables *expected = NULL;
+    if (!slot.compare_exchange_strong(expected, built, std::memory_order_acq_rel)) {
+        free(built);
+        return expected;
+    }
+    return built;
+}
+
+StripeJpeg::StripeJpeg(uint8_t quality)
+    : _quality(0),
+      _tables(NULL),
+      _src(NULL),
+      _width(0),
+      _height(0),
+      _helper(NULL),
+      _jobReady(NULL),
+      _jobDone(NULL),
+      _helperFailed(false) {
+    memset(&_stats, 0, sizeof(_stats));
+    memset(_stripes, 0, sizeof(_stripes));
+    setQuality(quality);
+}
+
+StripeJpeg::~StripeJpeg() {
+    if (_helper) {
+        vTaskDelete(_helper);
+    }
+    if (_jobReady) {
+        vSemaphoreDelete(_jobReady);
+    }
+    if (_jobDone) {
+        vSemaphoreDelete(_jobDone);
+    }
+    for (uint8_t i = 0; i < STRIPE_JPEG_STRIPES; i++) {
+        free(_stripes[i].buf);
+    }
+}
+
+bool StripeJpeg::encode(const uint8_t *bgr, uint16_t width, uint16_t height, uint8_t **out, size_t *outLen) {
+    uint32_t start = micros();
+    *out = NULL;
+    *outLen = 0;
+    if (!bgr || width == 0 || height == 0) {
+        _stats.failures++;
+        return false;
+    }
+    if (!_tables) {
+        _tables = quantTables(_quality);
+        if (!_tables) {
+            _stats.failures++;
+            return false;
+        }
+    }
+    _src = bgr;
+    _width = width;
+    _height = height;
+
+    // Top stripe to the caller (it also writes headers), the rest to the helper
+    uint16_t rows = (height + 15) / 16;
+    uint8_t stripes = rows > 1 ? STRIPE_JPEG_STRIPES : 1;
+    uint16_t first = 0;
+    for (uint8_t i = 0; i < STRIPE_JPEG_STRIPES; i++) {
+        Stripe &s = _stripes[i];
+        s.firstRow = first;
+        s.rows = i < stripes ? (rows - first) / (stripes - i) : 0;
+        s.len = 0;
+        s.ok = true;
+        s.us = 0;
+        first += s.rows;
+
+        // Output buffers are kept between frames; a quarter byte per pixel
+        // covers typical scenes, reserve() grows it otherwise
+        size_t want = (size_t)width * s.rows * 16 / 4 + 64;
+        if (s.rows > 0 && s.cap < want) {
+            uint8_t *buf = (uint8_t *)realloc(s.buf, want);
+            if (!buf) {
+                _stats.failures++;
+                return false;
+            }
+            s.buf = buf;
+            s.cap = want;
+        }
+    }
+
+    bool parallel = stripes > 1 && startHelper();
+    if (parallel) {
+        xSemaphoreGive(_jobReady);
+    }
+    for (uint8_t i = 0; i < (parallel ? stripes - 1 : stripes); i++) {
+        encodeStripe(_stripes[i]);
+    }
+    if (parallel) {
+        xSemaphoreTake(_jobDone, portMAX_DELAY);
+        _stats.parallel++;
+    }
+
+    size_t total = HEADER_MAX + 2;
+    for (uint8_t i = 0; i < stripes; i++) {
+        if (!_stripes[i].ok) {
+            _stats.failures++;
+            return false;
+        }
+        total += _stripes[i].len;
+    }
+    uint8_t *jpg = (uint8_t *)malloc(total);
+    if (!jpg) {
+        _stats.failures++;
+        return false;
+    }
+    size_t len = writeHeaders(jpg);
+    for (uint8_t i = 0; i < stripes; i++) {
+        memcpy(jpg + len, _stripes[i].buf, _stripes[i].len);
+        len += _stripes[i].len;
+    }
+    jpg[len++] = 0xFF;
+    jpg[len++] = 0xD9;            // EOI
+
+    *out = jpg;
+    *outLen = len;
+    _stats.frames++;
+    _stats.lastUs = micros() - start;
+    for (uint8_t i = 0; i < STRIPE_JPEG_STRIPES; i++) {
+        _stats.stripeUs[i] = _stripes[i].us;
+    }
+    return true;
+}
+
+void StripeJpeg::setQuality(uint8_t quality) {
+    if (quality < 1) quality = 1;
+    if (quality > 100) quality = 100;
+    if (quality != _quality) {
+        _quality = quality;
+        _tables = NULL;
+    }
+}
+
+bool StripeJpeg::startHelper() {
+    if (_helper) {
+        return true;
+    }
+    if (_helperFailed) {
+        return false;
+    }
+#if portNUM_PROCESSORS > 1
+    _jobReady = xSemaphoreCreateBinary();
+    _jobDone = xSemaphoreCreateBinary();
+    if (_jobReady && _jobDone &&
+        xTaskCreatePinnedToCore(helperTask, "jpeg", STRIPE_JPEG_TASK_STACK, this,
+                                STRIPE_JPEG_TASK_PRIO, &_helper, xPortGetCoreID() ^ 1) == pdPASS) {
+        return true;
+    }
+    _helper = NULL;
+    if (_jobReady) {
+        vSemaphoreDelete(_jobReady);
+        _jobReady = NULL;
+    }
+    if (_jobDone) {
+        vSemaphoreDelete(_jobDone);
+        _jobDone = NULL;
+    }
+#endif
+    _helperFailed = true;
+    return false;
+}
+
+void StripeJpeg::helperTask(void *arg) {
+    StripeJpeg *self = static_cast<StripeJpeg *>(arg);
+    for (;;) {
+        xSemaphoreTake(self->_jobReady, portMAX_DELAY);
+        self->encodeStripe(self->_stripes[STRIPE_JPEG_STRIPES - 1]);
+        xSemaphoreGive(self->_jobDone);
+    }
+}
+
+void StripeJpeg::encodeStripe(Stripe &s) {
+    uint32_t start = micros();
+    uint16_t mcusX = (_width + 15) / 16;
+    for (uint16_t row = s.firstRow; row < s.firstRow + s.rows && s.ok; row++) {
+        // Every MCU row is one restart interval: RSTn, fresh predictors
+        if (row > 0) {
+            putByte(s, 0xFF);
+            putByte(s, 0xD0 + ((row - 1) & 7));
+        }
+        s.bitBuf = 0;
+        s.bitCount = 0;
+        s.dc[0] = s.dc[1] = s.dc[2] = 0;
+        for (uint16_t mx = 0; mx < mcusX; mx++) {
+            encodeMcu(s, mx, row);
+        }
+        flushBits(s);
+    }
+    s.us = micros() - start;
+}
+
+// 16x16 pixels: four Y blocks, then Cb and Cr averaged over 2x2. BT.601
+// weights in 16.16; Cb and Cr accumulate the four pixels at full
+// precision and drop to DCT_PASS_BITS fraction bits once.
+void StripeJpeg::encodeMcu(Stripe &s, uint16_t mx, uint16_t my) {
+    int32_t y[4][64];
+    int32_t cb[64];
+    int32_t cr[64];
+    memset(cb, 0, sizeof(cb));
+    memset(cr, 0, sizeof(cr));
+
+    const int32_t yRound = (1 << (15 - DCT_PASS_BITS)) - (128 << 16);
+    for (uint8_t py = 0; py < 16; py++) {
+        uint16_t sy = my * 16 + py;
+        if (sy >= _height) sy = _height - 1;
+        const uint8_t *row = _src + (size_t)sy * _width * 3;
+        for (uint8_t px = 0; px < 16; px++) {
+            uint16_t sx = mx * 16 + px;
+            if (sx >= _width) sx = _width - 1;
+            const uint8_t *p = row + sx * 3;
+            int32_t b = p[0];
+            int32_t g = p[1];
+            int32_t r = p[2];
+            y[(py / 8) * 2 + px / 8][(py % 8) * 8 + px % 8] =
+                (19595 * r + 38470 * g + 7471 * b + yRound) >> (16 - DCT_PASS_BITS);
+            uint8_t c = (py / 2) * 8 + px / 2;
+            cb[c] += -11059 * r - 21709 * g + 32768 * b;
+            cr[c] += 32768 * r - 27439 * g - 5329 * b;
+        }
+    }
+    const int32_t cRound = 1 << (17 - DCT_PASS_BITS);
+    for (uint8_t i = 0; i < 64; i++) {
+        cb[i] = (cb[i] + cRound) >> (18 - DCT_PASS_BITS);
+        cr[i] = (cr[i] + cRound) >> (18 - DCT_PASS_BITS);
+    }
+
+    for (uint8_t i = 0; i < 4; i++) {
+        encodeBlock(s, y[i], 0, s.dc[0]);
+    }
+    encodeBlock(s, cb, 1, s.dc[1]);
+    encodeBlock(s, cr, 1, s.dc[2]);
+}
+
+// AAN forward DCT on 8 values step apart; outputs are scaled by AAN_SCALE
+static void fdct8(int32_t *d, uint8_t step) {
+    int32_t tmp0 = d[0] + d[7 * step];
+    int32_t tmp7 = d[0] - d[7 * step];
+    int32_t tmp1 = d[1 * step] + d[6 * step];
+    int32_t tmp6 = d[1 * step] - d[6 * step];
+    int32_t tmp2 = d[2 * step] + d[5 * step];
+    int32_t tmp5 = d[2 * step] - d[5 * step];
+    int32_t tmp3 = d[3 * step] + d[4 * step];
+    int32_t tmp4 = d[3 * step] - d[4 * step];
+
+    // Even part
+    int32_t tmp10 = tmp0 + tmp3;
+    int32_t tmp13 = tmp0 - tmp3;
+    int32_t tmp11 = tmp1 + tmp2;
+    int32_t tmp12 = tmp1 - tmp2;
+    d[0] = tmp10 + tmp11;
+    d[4 * step] = tmp10 - tmp11;
+    int32_t z1 = DCT_MUL(tmp12 + tmp13, DCT_FIX(0.707106781));
+    d[2 * step] = tmp13 + z1;
+    d[6 * step] = tmp13 - z1;
+
+    // Odd part
+    tmp10 = tmp4 + tmp5;
+    tmp11 = tmp5 + tmp6;
+    tmp12 = tmp6 + tmp7;
+    int32_t z5 = DCT_MUL(tmp10 - tmp12, DCT_FIX(0.382683433));
+    int32_t z2 = DCT_MUL(tmp10, DCT_FIX(0.541196100)) + z5;
+    int32_t z4 = DCT_MUL(tmp12, DCT_FIX(1.306562965)) + z5;
+    int32_t z3 = DCT_MUL(tmp11, DCT_FIX(0.707106781));
+    int32_t z11 = tmp7 + z3;
+    int32_t z13 = tmp7 - z3;
+    d[5 * step] = z13 + z2;
+    d[3 * step] = z13 - z2;
+    d[1 * step] = z11 + z4;
+    d[7 * step] = z11 - z4;
+}
+
+// DCT output over its divisor, rounded half away from zero; the high word
+// of a 32x32 multiply instead of a divide
+static inline int quantize(int32_t v, uint32_t reciprocal) {
+    uint32_t mag = v < 0 ? -v : v;
+    int q = (int)(((uint64_t)mag * reciprocal + 0x80000000u) >> 32);
+    return v < 0 ? -q : q;
+}
+
+// Magnitude category of v and its low bits (negatives as v - 1)
+static inline uint8_t category(int v, uint32_t &bits) {
+    uint32_t mag = v < 0 ? -v : v;
+    uint8_t n = mag ? 32 - __builtin_clz(mag) : 0;
+    bits = (uint32_t)(v < 0 ? v - 1 : v) & ((1u << n) - 1);
+    return n;
+}
+
+// A Huffman code (packed code << 8 | length) followed by count value bits,
+// at most 16 + 11, so the accumulator never holds more than 31 + 27
+inline void StripeJpeg::putSymbol(Stripe &s, uint32_t code, uint32_t bits, uint8_t count) {
+    uint8_t length = (code & 0xFF) + count;
+    s.bitBuf = s.bitBuf << length | (code >> 8) << count | bits;
+    s.bitCount += length;
+    if (s.bitCount >= 32) {
+        s.bitCount -= 32;
+        putWord(s, (uint32_t)(s.bitBuf >> s.bitCount));
+    }
+}
+
+// component: 0 = Y, 1 = Cb/Cr (quantization and Huffman tables).
+// Coefficients are quantized in zigzag order as the Huffman coder reaches
+// them; a zero only extends the run.
+void StripeJpeg::encodeBlock(Stripe &s, int32_t *block, uint8_t component, int &dc) {
+    const uint32_t *reciprocals = _tables->reciprocals[component];
+    const uint32_t *dcCode = HUFF.code[component * 2];
+    const uint32_t *acCode = HUFF.code[component * 2 + 1];
+
+    for (uint8_t i = 0; i < 64; i += 8) {
+        fdct8(block + i, 1);
+    }
+    for (uint8_t i = 0; i < 8; i++) {
+        fdct8(block + i, 8);
+    }
+
+    // Baseline limits: 11-bit DC, 10-bit AC categories
+    uint32_t bits;
+    int q = quantize(block[0], reciprocals[0]);
+    if (q > 2047) q = 2047;
+    if (q < -2047) q = -2047;
+    int diff = q - dc;
+    dc = q;
+    if (diff > 2047) diff = 2047;
+    if (diff < -2047) diff = -2047;
+    uint8_t n = category(diff, bits);
+    putSymbol(s, dcCode[n], bits, n);
+
+    uint8_t run = 0;
+    for (uint8_t k = 1; k < 64; k++) {
+        uint8_t z = ZIGZAG[k];
+        q = quantize(block[z], reciprocals[z]);
+        if (q == 0) {
+            run++;
+            continue;
+        }
+        if (q > 1023) q = 1023;
+        if (q < -1023) q = -1023;
+        for (; run >= 16; run -= 16) {
+            putSymbol(s, acCode[0xF0], 0, 0);     // ZRL
+        }
+        n = category(q, bits);
+        putSymbol(s, acCode[run << 4 | n], bits, n);
+        run = 0;
+    }
+    if (run) {
+        putSymbol(s, acCode[0x00], 0, 0);     // EOB
+    }
+}
+
+// Four entropy-coded bytes, MSB first. A 0xFF byte needs a 0x00 stuffed
+// behind it; the word is only split up when it contains one.
+void StripeJpeg::putWord(Stripe &s, uint32_t word) {
+    if (!reserve(s, 8)) {
+        return;
+    }
+    uint8_t *p = s.buf + s.len;
+    uint32_t inverted = ~word;
+    if (((inverted - 0x01010101u) & ~inverted & 0x80808080u) == 0) {
+        p[0] = word >> 24;
+        p[1] = word >> 16;
+        p[2] = word >> 8;
+        p[3] = word;
+        s.len += 4;
+        return;
+    }
+    for (int8_t shift = 24; shift >= 0; shift -= 8) {
+        uint8_t b = word >> shift;
+        *p++ = b;
+        if (b == 0xFF) {
+            *p++ = 0x00;
+        }
+    }
+    s.len = p - s.buf;
+}
+
+// Pads the last byte with 1 bits, as a restart marker or EOI requires
+void StripeJpeg::flushBits(Stripe &s) {
+    uint8_t pad = (8 - (s.bitCount & 7)) & 7;
+    s.bitBuf = s.bitBuf << pad | ((1u << pad) - 1);
+    s.bitCount += pad;
+    while (s.bitCount > 0) {
+        s.bitCount -= 8;
+        uint8_t b = s.bitBuf >> s.bitCount;
+        putByte(s, b);
+        if (b == 0xFF) {
+            putByte(s, 0x00);
+        }
+    }
+    s.bitBuf = 0;
+}
+
+// Makes room for n more bytes, doubling the buffer as needed
+bool StripeJpeg::reserve(Stripe &s, size_t n) {
+    if (s.len + n <= s.cap) {
+        return true;
+    }
+    if (!s.ok) {
+        return false;
+    }
+    size_t cap = s.cap * 2;
+    while (cap < s.len + n) {
+        cap *= 2;
+    }
+    uint8_t *buf = (uint8_t *)realloc(s.buf, cap);
+    if (!buf) {
+        s.ok = false;
+        return false;
+    }
+    s.buf = buf;
+    s.cap = cap;
+    return true;
+}
+
+void StripeJpeg::putByte(Stripe &s, uint8_t b) {
+    if (reserve(s, 1)) {
+        s.buf[s.len++] = b;
+    }
+}
+
+static uint8_t *putMarker(uint8_t *p, uint8_t marker, uint16_t length) {
+    *p++ = 0xFF;
+    *p++ = marker;
+    *p++ = length >> 8;
+    *p++ = length & 0xFF;
+    return p;
+}
+
+size_t StripeJpeg::writeHeaders(uint8_t *out) const {
+    uint8_t *p = out;
+    *p++ = 0xFF;
+    *p++ = 0xD8;                  // SOI
+
+    static const uint8_t JFIF[14] = { 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+    p = putMarker(p, 0xE0, 2 + sizeof(JFIF));
+    memcpy(p, JFIF, sizeof(JFIF));
+    p += sizeof(JFIF);
+
+    p = putMarker(p, 0xDB, 2 + 2 * 65);
+    for (uint8_t t = 0; t < 2; t++) {
+        *p++ = t;
+        for (uint8_t k = 0; k < 64; k++) {
+            *p++ = _tables->quant[t][ZIGZAG[k]];
+        }
+    }
+
+    // SOF0: 8-bit, Y 2x2 with table 0, Cb and Cr 1x1 with table 1
+    p = putMarker(p, 0xC0, 17);
+    *p++ = 8;
+    *p++ = _height >> 8;
+    *p++ = _height & 0xFF;
+    *p++ = _width >> 8;
+    *p++ = _width & 0xFF;
+    *p++ = 3;
+    static const uint8_t COMPONENTS[9] = { 1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1 };
+    memcpy(p, COMPONENTS, sizeof(COMPONENTS));
+    p += sizeof(COMPONENTS);
+
+    uint16_t dhtLength = 2;
+    for (uint8_t t = 0; t < 4; t++) {
+        dhtLength += 17 + huffCount(HUFF_BITS[t]);
+    }
+    p = putMarker(p, 0xC4, dhtLength);
+    for (uint8_t t = 0; t < 4; t++) {
+        *p++ = HUFF_CLASS_ID[t];
+        memcpy(p, HUFF_BITS[t], 16);
+        p += 16;
+        uint8_t count = huffCount(HUFF_BITS[t]);
+        memcpy(p, HUFF_VALUES[t], count);
+        p += count;
+    }
+
+    // One restart interval per MCU row
+    p = putMarker(p, 0xDD, 4);
+    uint16_t interval = (_width + 15) / 16;
+    *p++ = interval >> 8;
+    *p++ = interval & 0xFF;
+
+    p = putMarker(p, 0xDA, 12);
+    *p++ = 3;
+    static const uint8_t SCAN[9] = { 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0 };
+    memcpy(p, SCAN, sizeof(SCAN));
+    p += sizeof(SCAN);
+    return p - out;
+}
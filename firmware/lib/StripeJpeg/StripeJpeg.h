@@ -0,0 +1,132 @@
+/*
+ * StripeJpeg - Baseline JPEG encoder that uses both cores
+ *
+ * The image is cut into two horizontal stripes of whole MCU rows. The
+ * caller encodes the top stripe while a helper task on the other core
+ * encodes the bottom one, each with its own DC predictors and Huffman
+ * bit buffer. A restart marker (DRI = one MCU row) precedes every MCU
+ * row but the first, so the second stripe starts on a byte boundary with
+ * fresh predictors and the two outputs are simply concatenated behind
+ * the headers.
+ *
+ *   StripeJpeg encoder(80);
+ *   uint8_t *jpg; size_t jpgLen;
+ *   if (encoder.encode(bgr, w, h, &jpg, &jpgLen)) { ...; free(jpg); }
+ *
+ * Output matches fmt2jpg's defaults: YCbCr 4:2:0, Annex K tables scaled
+ * by quality (1-100) the same way. Colour conversion, the AAN DCT and
+ * quantization are all integer (fixed point, reciprocal multiplies), and
+ * each coefficient is quantized as the Huffman coder reaches it in zigzag
+ * order, so a block is a single pass after the DCT.
+ *
+ * No encoder state is static. The Huffman codes are built once at
+ * startup and only read afterwards; quantization tables are built on
+ * first use of a quality and shared, read-only, by every encoder using
+ * it (at most one 640-byte entry per quality, never freed). Encoders on
+ * different tasks therefore run concurrently, and setQuality() is a
+ * pointer swap once the quality has been used. Input is BGR888, the byte order
+ * fmt2jpg expects for PIXFORMAT_RGB888. Partial MCUs at the right and
+ * bottom edges repeat the last column / row.
+ *
+ * The helper task is created on the first encode(), pinned to the core
+ * the caller is not running on, at STRIPE_JPEG_TASK_PRIO. Images of a
+ * single MCU row, single-core chips and a failed task creation fall back
+ * to encoding both stripes in the caller.
+ *
+ * Not thread-safe per instance: one caller at a time for each encoder.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#ifndef STRIPE_JPEG_TASK_PRIO
+#define STRIPE_JPEG_TASK_PRIO   1     // Below every real-time task
+#endif
+
+#ifndef STRIPE_JPEG_TASK_STACK
+#define STRIPE_JPEG_TASK_STACK  4096
+#endif
+
+#define STRIPE_JPEG_STRIPES     2
+
+// Quantization tables for one quality, shared between encoders
+struct JpegQuantTables {
+    uint8_t quant[2][64];     // Y, CbCr; natural order
+    uint32_t reciprocals[2][64];  // 2^32 / (quant * fixed-point DCT scale), natural order
+};
+
+struct StripeJpegStats {
+    uint32_t frames;
+    uint32_t failures;
+    uint32_t parallel;        // Frames whose bottom stripe ran on the helper
+    uint32_t lastUs;          // Wall time, last frame
+    uint32_t stripeUs[STRIPE_JPEG_STRIPES];   // Encode time per stripe, last frame
+};
+
+class StripeJpeg {
+public:
+    explicit StripeJpeg(uint8_t quality);
+    ~StripeJpeg();
+
+    // Encodes a BGR888 image; *out is malloc'd, the caller frees it
+    bool encode(const uint8_t *bgr, uint16_t width, uint16_t height, uint8_t **out, size_t *outLen);
+
+    // Takes effect with the next encode()
+    void setQuality(uint8_t quality);
+    uint8_t quality() const { return _quality; }
+
+    const StripeJpegStats &stats() const { return _stats; }
+
+    // Shared tables for a quality (1-100), built on first use; NULL if
+    // out of memory
+    static const JpegQuantTables *quantTables(uint8_t quality);
+
+private:
+    // One worker's share of the image and its entropy-coded output
+    struct Stripe {
+        uint16_t firstRow;    // MCU rows
+        uint16_t rows;
+        uint8_t *buf;
+        size_t len;
+        size_t cap;
+        bool ok;
+        uint64_t bitBuf;      // Pending bits, right-aligned
+        uint8_t bitCount;     // Below 32 between symbols
+        int dc[3];            // Y, Cb, Cr predictors
+        uint32_t us;
+    };
+
+    bool startHelper();
+    static void helperTask(void *arg);
+
+    void encodeStripe(Stripe &s);
+    void encodeMcu(Stripe &s, uint16_t mx, uint16_t my);
+    void encodeBlock(Stripe &s, int32_t *block, uint8_t component, int &dc);
+    void putSymbol(Stripe &s, uint32_t code, uint32_t bits, uint8_t count);
+    void putWord(Stripe &s, uint32_t word);
+    void flushBits(Stripe &s);
+    void putByte(Stripe &s, uint8_t b);
+    bool reserve(Stripe &s, size_t n);
+
+    size_t writeHeaders(uint8_t *out) const;
+
+    StripeJpegStats _stats;
+    uint8_t _quality;
+    const JpegQuantTables *_tables;   // Looked up on the next encode() if NULL
+
+    // Frame being encoded
+    const uint8_t *_src;
+    uint16_t _width;
+    uint16_t _height;
+    Stripe _stripes[STRIPE_JPEG_STRIPES];
+
+    // Helper task: takes _jobReady, encodes the last stripe, gives _jobDone
+    TaskHandle_t _helper;
+    SemaphoreHandle_t _jobReady;
+    SemaphoreHandle_t _jobDone;
+    bool _helperFailed;
+};
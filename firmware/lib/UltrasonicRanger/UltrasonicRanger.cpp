@@ -0,0 +1,123 @@
+/*
+ * UltrasonicRanger - see UltrasonicRanger.h
+ */
+
+#include "UltrasonicRanger.h"
+
+UltrasonicRanger::UltrasonicRanger(uint32_t pingSlotMs)
+    : _count(0),
+      _current(0),
+      _pinging(false),
+      _pingSlotMs(pingSlotMs),
+      _pingStartMs(0),
+      _head(0),
+      _tail(0),
+      _overflows(0) {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+int UltrasonicRanger::addSensor(uint8_t trigPin, uint8_t echoPin) {
+    if (_count >= RANGER_MAX_SENSORS) {
+        return -1;
+    }
+    Sensor &s = _sensors[_count];
+    s.owner = this;
+    s.index = _count;
+    s.trigPin = trigPin;
+    s.echoPin = echoPin;
+    s.state = IDLE;
+    s.triggerUs = 0;
+    s.riseUs = 0;
+    return _count++;
+}
+
+void UltrasonicRanger::begin() {
+    for (uint8_t i = 0; i < _count; i++) {
+        pinMode(_sensors[i].trigPin, OUTPUT);
+        digitalWrite(_sensors[i].trigPin, LOW);
+        pinMode(_sensors[i].echoPin, INPUT);
+        attachInterruptArg(_sensors[i].echoPin, onEcho, &_sensors[i], CHANGE);
+    }
+}
+
+void UltrasonicRanger::loop() {
+    if (_count == 0) {
+        return;
+    }
+    if (_pinging && millis() - _pingStartMs < _pingSlotMs) {
+        return;
+    }
+    if (_pinging) {
+        finishPing();
+        _current = (_current + 1) % _count;
+    }
+
+    Sensor &s = _sensors[_current];
+    s.triggerUs = micros();
+    s.state = ARMED;
+    digitalWrite(s.trigPin, HIGH);
+    delayMicroseconds(10);
+    digitalWrite(s.trigPin, LOW);
+
+    _pinging = true;
+    _pingStartMs = millis();
+    _stats.pings++;
+}
+
+bool UltrasonicRanger::read(RangeSample &sample) {
+    _stats.overflows = _overflows;
+
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire)) {
+        return false;
+    }
+    sample = _ring[tail % RANGER_RING_SIZE];
+    _tail.store(tail + 1, std::memory_order_release);
+    _stats.samples++;
+    return true;
+}
+
+void UltrasonicRanger::finishPing() {
+    // Anything but DONE means the echo never came back (or was too long)
+    Sensor &s = _sensors[_current];
+    if (s.state != DONE) {
+        _stats.timeouts++;
+    }
+    s.state = IDLE;
+}
+
+void IRAM_ATTR UltrasonicRanger::onEcho(void *arg) {
+    Sensor *s = static_cast<Sensor *>(arg);
+    uint32_t now = micros();
+
+    if (digitalRead(s->echoPin) == HIGH) {
+        if (s->state == ARMED) {
+            s->riseUs = now;
+            s->state = ECHO;
+        }
+        return;
+    }
+
+    if (s->state != ECHO) {
+        return;
+    }
+    uint32_t width = now - s->riseUs;
+    if (width > RANGER_MAX_ECHO_US) {
+        s->state = IDLE;
+        return;
+    }
+    s->state = DONE;
+
+    RangeSample sample = { s->index, s->triggerUs, width };
+    s->owner->publish(sample);
+}
+
+void IRAM_ATTR UltrasonicRanger::publish(const RangeSample &sample) {
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) >= RANGER_RING_SIZE) {
+        _overflows++;
+        return;
+    }
+    _ring[head % RANGER_RING_SIZE] = sample;
+    _head.store(head + 1, std::memory_order_release);
+}
@@ -0,0 +1,108 @@
+/*
+ * UltrasonicRanger - Interrupt-driven HC-SR04 ranging without pulseIn()
+ *
+ * loop() fires a 10 us trigger pulse and returns; the echo pulse is timed
+ * by an edge interrupt on the echo pin. Sensors are pinged one at a time
+ * in turn (one every RANGER_PING_SLOT_MS), so their bursts never overlap.
+ * Finished measurements are published as timestamped samples into a
+ * lock-free ring that the caller drains with read().
+ *
+ *   UltrasonicRanger ranger;
+ *   int entry = ranger.addSensor(US1_TRIG_PIN, US1_ECHO_PIN);
+ *   ranger.begin();
+ *   loop: ranger.loop();
+ *         RangeSample s;
+ *         while (ranger.read(s)) { if (s.sensor == entry) ... s.distanceCm() }
+ *
+ * The echo ISRs are the only producers and must run on one core (call
+ * begin() from the consuming task); loop()/read() belong to one task.
+ * A ping without an echo produces no sample, only a timeout count.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+#ifndef RANGER_MAX_SENSORS
+#define RANGER_MAX_SENSORS      2
+#endif
+
+// Time reserved for each ping before the next sensor is triggered
+#ifndef RANGER_PING_SLOT_MS
+#define RANGER_PING_SLOT_MS     30
+#endif
+
+// Longer echoes (no obstacle, ~5 m) are discarded; same limit as pulseIn()
+#ifndef RANGER_MAX_ECHO_US
+#define RANGER_MAX_ECHO_US      30000
+#endif
+
+#ifndef RANGER_RING_SIZE
+#define RANGER_RING_SIZE        16      // Power of two
+#endif
+
+struct RangeSample {
+    uint8_t sensor;           // Index returned by addSensor()
+    uint32_t triggerUs;       // micros() when the ping was fired
+    uint32_t echoUs;          // Echo pulse width
+
+    float distanceCm() const { return echoUs * 0.034f / 2; }
+};
+
+struct RangerStats {
+    uint32_t pings;
+    uint32_t samples;
+    uint32_t timeouts;        // Pings without a usable echo
+    uint32_t overflows;       // Samples dropped because the ring was full
+};
+
+class UltrasonicRanger {
+public:
+    explicit UltrasonicRanger(uint32_t pingSlotMs = RANGER_PING_SLOT_MS);
+
+    // Returns the sensor index, or -1 when all slots are taken
+    int addSensor(uint8_t trigPin, uint8_t echoPin);
+
+    // Configures the pins and attaches the echo interrupts
+    void begin();
+
+    // Fires the next ping when the current slot is over. Never blocks
+    // longer than the trigger pulse.
+    void loop();
+
+    // Pops the oldest sample; false when the ring is empty
+    bool read(RangeSample &sample);
+
+    const RangerStats &stats() const { return _stats; }
+
+private:
+    enum EchoState : uint8_t { IDLE, ARMED, ECHO, DONE };
+
+    struct Sensor {
+        UltrasonicRanger *owner;
+        uint8_t index;
+        uint8_t trigPin;
+        uint8_t echoPin;
+        volatile uint8_t state;
+        volatile uint32_t triggerUs;
+        volatile uint32_t riseUs;
+    };
+
+    static void IRAM_ATTR onEcho(void *arg);
+    void IRAM_ATTR publish(const RangeSample &sample);
+    void finishPing();
+
+    Sensor _sensors[RANGER_MAX_SENSORS];
+    uint8_t _count;
+    uint8_t _current;
+    bool _pinging;
+    uint32_t _pingSlotMs;
+    uint32_t _pingStartMs;
+
+    RangeSample _ring[RANGER_RING_SIZE];
+    std::atomic<uint32_t> _head;   // Written by the ISR
+    std::atomic<uint32_t> _tail;   // Written by read()
+    RangerStats _stats;
+    volatile uint32_t _overflows;
+};
@@ -0,0 +1,72 @@
+/*
+ * WireFormat - see WireFormat.h
+ */
+
+#include "WireFormat.h"
+
+WireFormat::WireFormat()
+    : _peerBinary(false),
+      _refused(false),
+      _lastSent(WIRE_JSON) {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+const char *WireFormat::contentType() const {
+    return encoding() == WIRE_MSGPACK ? WIRE_MIME_MSGPACK : WIRE_MIME_JSON;
+}
+
+size_t WireFormat::serialize(const JsonDocument &doc, char *buf, size_t size) {
+    _lastSent = encoding();
+    size_t len = _lastSent == WIRE_MSGPACK ? serializeMsgPack(doc, buf, size)
+                                           : serializeJson(doc, buf, size);
+    // Both stop at size; a full buffer may mean the document was cut
+    if (len == 0 || len >= size || doc.overflowed()) {
+        return 0;
+    }
+    _stats.sent[_lastSent]++;
+    _stats.bytesSent[_lastSent] += len;
+    return len;
+}
+
+DeserializationError WireFormat::deserialize(JsonDocument &doc, const HttpResponse &resp) {
+    if (received(resp) == WIRE_MSGPACK) {
+        return deserializeMsgPack(doc, resp.body.c_str(), resp.body.length());
+    }
+    return deserializeJson(doc, resp.body.c_str(), resp.body.length());
+}
+
+DeserializationError WireFormat::deserialize(JsonDocument &doc, const HttpResponse &resp,
+                                             const JsonDocument &filter) {
+    if (received(resp) == WIRE_MSGPACK) {
+        return deserializeMsgPack(doc, resp.body.c_str(), resp.body.length(),
+                                  DeserializationOption::Filter(filter));
+    }
+    return deserializeJson(doc, resp.body.c_str(), resp.body.length(),
+                           DeserializationOption::Filter(filter));
+}
+
+bool WireFormat::onStatus(int status) {
+    if (_lastSent != WIRE_MSGPACK || (status != 400 && status != 415)) {
+        return false;
+    }
+    _refused = true;
+    _lastSent = WIRE_JSON;
+    _stats.fallbacks++;
+    return true;
+}
+
+const char *WireFormat::name(WireEncoding encoding) {
+    return encoding == WIRE_MSGPACK ? "msgpack" : "json";
+}
+
+WireEncoding WireFormat::received(const HttpResponse &resp) {
+    WireEncoding enc = strcasecmp(resp.contentType, WIRE_MIME_MSGPACK) == 0 ||
+                       strcasecmp(resp.contentType, "application/x-msgpack") == 0
+                       ? WIRE_MSGPACK : WIRE_JSON;
+    if (enc == WIRE_MSGPACK) {
+        _peerBinary = true;
+    }
+    _stats.received[enc]++;
+    _stats.bytesReceived[enc] += resp.body.length();
+    return enc;
+}
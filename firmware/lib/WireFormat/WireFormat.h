@@ -0,0 +1,78 @@
+/*
+ * WireFormat - JSON or MessagePack on the wire, negotiated per peer
+ *
+ * Documents are still built with ArduinoJson; only the encoding changes.
+ * Negotiation is passive and falls back on its own:
+ *   - every request advertises WIRE_ACCEPT (MessagePack first)
+ *   - responses are decoded by their Content-Type, so an old backend that
+ *     ignores Accept simply keeps answering JSON
+ *   - once the peer has answered in MessagePack, request bodies are sent
+ *     in MessagePack too
+ *   - a MessagePack body refused with 400/415 switches bodies back to
+ *     JSON for good (until reboot)
+ *
+ *   backendHttp.setAccept(WIRE_ACCEPT);
+ *   size_t len = wire.serialize(doc, body, sizeof(body));
+ *   int code = backendHttp.post(path, wire.contentType(), body, len, resp, 5000);
+ *   if (wire.onStatus(code)) ... serialize and post again
+ *   if (code == 200 && wire.deserialize(reply, resp) == DeserializationError::Ok) ...
+ *
+ * Not thread-safe: use from the task that owns the endpoint.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "HttpLite.h"
+
+#define WIRE_MIME_JSON          "application/json"
+#define WIRE_MIME_MSGPACK       "application/msgpack"
+#define WIRE_ACCEPT             WIRE_MIME_MSGPACK ", " WIRE_MIME_JSON
+
+enum WireEncoding : uint8_t {
+    WIRE_JSON,
+    WIRE_MSGPACK,
+    WIRE_ENCODING_COUNT
+};
+
+struct WireFormatStats {
+    uint32_t sent[WIRE_ENCODING_COUNT];           // Request bodies
+    uint32_t received[WIRE_ENCODING_COUNT];       // Response bodies decoded
+    uint32_t bytesSent[WIRE_ENCODING_COUNT];
+    uint32_t bytesReceived[WIRE_ENCODING_COUNT];
+    uint32_t fallbacks;       // MessagePack bodies refused by the peer
+};
+
+class WireFormat {
+public:
+    WireFormat();
+
+    // Encoding for the next request body
+    WireEncoding encoding() const { return _peerBinary && !_refused ? WIRE_MSGPACK : WIRE_JSON; }
+    const char *contentType() const;
+
+    // Encodes doc into buf; 0 if it did not fit
+    size_t serialize(const JsonDocument &doc, char *buf, size_t size);
+
+    // Decodes a response body in whatever encoding it arrived in
+    DeserializationError deserialize(JsonDocument &doc, const HttpResponse &resp);
+    DeserializationError deserialize(JsonDocument &doc, const HttpResponse &resp,
+                                     const JsonDocument &filter);
+
+    // Status of a request whose body came from serialize(); true when a
+    // MessagePack body was refused and the request should be resent as JSON
+    bool onStatus(int status);
+
+    const WireFormatStats &stats() const { return _stats; }
+
+    static const char *name(WireEncoding encoding);
+
+private:
+    WireEncoding received(const HttpResponse &resp);
+
+    bool _peerBinary;         // Peer has answered in MessagePack
+    bool _refused;            // Peer rejected a MessagePack body
+    WireEncoding _lastSent;
+    WireFormatStats _stats;
+};
@@ -12,7 +12,16 @@
  * - GET /         - Status page
  * - GET /stream   - MJPEG live video stream
  * - GET /capture  - Single frame capture
- * - GET /status   - JSON status
+ * - GET /status   - JSON status (MessagePack with Accept: application/msgpack)
+ * - GET /metrics  - Prometheus metrics
+ * 
+ * Tasks (FreeRTOS, pinned - WiFi/lwIP run on core 0):
+ * - sensor  (core 1) - Ultrasonic sensors, gate servo, LCD, LEDs
+ * - capture (core 1) - Grabs detection frames on DETECTION_INTERVAL_MS
+ * - stream  (core 0) - HTTP server + non-blocking MJPEG fan-out
+ * - uplink  (core 0) - Entry/exit events, YOLO detection, stats fetch
+ * Tasks only talk through bounded queues, so a slow AI call never
+ * delays the gate.
  * 
  * Author: Smart Parking Team
  * Updated: 2026-01-17
@@ -21,10 +30,31 @@
 #include "esp_camera.h"
 #include <WiFi.h>
 #include <WebServer.h>
-#include <HTTPClient.h>
 #include <ArduinoJson.h>
 #include <ESP32Servo.h>
 #include <LiquidCrystal_I2C.h>
+#include "FrameBus.h"
+#include "MjpegStreamer.h"
+#include "StreamTuner.h"
+#include "UltrasonicRanger.h"
+#include "GateController.h"
+#include "EventJournal.h"
+#include <LittleFS.h>
+#include "HttpEndpoint.h"
+#include "WireFormat.h"
+#include "SceneGate.h"
+#include "SlotClassifier.h"
+#include "RoiCrop.h"
+#include "LatencyTrace.h"
+#include "MetricsWriter.h"
+#include "CameraDrops.h"
+#include "ChunkedResponse.h"
+#include "WsClient.h"
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 // ===========================================
 // CONFIGURATION - EDIT THESE!
@@ -83,10 +113,58 @@ const char* AI_SERVICE_URL = "http://YOUR_AI_SERVICE_IP:5000"; // AI service
 #define GATE_OPEN_ANGLE         90    // Servo angle when gate is open
 #define GATE_CLOSE_ANGLE        0     // Servo angle when gate is closed
 #define GATE_OPEN_DURATION_MS   5000  // How long gate stays open
+#define GATE_MESSAGE_MS         3000  // How long entry/exit messages stay on the LCD
 #define DETECTION_INTERVAL_MS   5000  // Run YOLO detection every 5 seconds
-#define STATS_INTERVAL_MS       5000  // Fetch stats every 5 seconds
+#define FRAME_SHARE_MAX_AGE_MS  500   // Detection reuses a stream frame this fresh
+#define CAPTURE_MAX_AGE_MS      1000  // /capture serves the newest frame up to this old
+#define SCENE_CELL_DELTA        12    // Luma change for a signature cell to count as changed
+#define SCENE_CHANGE_PERCENT    4     // Upload when this % of cells changed
+#define SCENE_HEARTBEAT_MS      60000 // Upload at least this often even if unchanged
+#define ROI_CROP_ENABLED        1     // Upload only the bounding box of the slot polygons
+#define ROI_MARGIN_PX           16    // Context around the slots, so edge cars stay whole
+#define ROI_JPEG_QUALITY        80    // Re-encode quality of the crop (1-100)
+#define ROI_MIN_SAVING_PERCENT  20    // Send the whole frame unless the crop is this much smaller
+#define STATS_INTERVAL_MS       5000  // Poll stats every 5 s while the hub socket is down
+#define HUB_WS_PATH             "/ws" // Backend WebSocket hub (pushes slot_stats)
 #define STREAM_FRAME_DELAY_MS   50    // ~20 FPS for stream
+#define STREAM_JPEG_QUALITY     12    // Starting JPEG quality (10-63, lower = better)
+#define STREAM_BEST_QUALITY     10    // Best quality the tuner may step up to
+#define STREAM_MAX_KBPS         4000  // Bitrate cap per stream viewer
+#define STREAM_TUNE_PERIOD_MS   1000  // Adaptive quality/pacing control period
 #define SENSOR_COOLDOWN_MS      5000  // Cooldown between entry/exit sensor activation
+#define SENSOR_POLL_MS          10    // Sensor task period
+#define SENSOR_PING_SLOT_MS     30    // Sensors pinged in turn, one per slot
+#define SENSOR_CLEAR_MS         1000  // No detection this long = vehicle has left the sensor
+
+// Frame sizes the stream tuner may use, largest first. The first is the
+// init size: frame buffers are allocated for it. Detection shares these
+// frames; the slot polygons (drawn on SVGA frames) are scaled to each size,
+// so only 4:3 sizes, which the OV2640 scales from the whole sensor window.
+// HVGA is a 3:2 crop of it and would shift every slot.
+static const framesize_t STREAM_FRAME_SIZES[] = { FRAMESIZE_VGA, FRAMESIZE_CIF, FRAMESIZE_QVGA };
+#define STREAM_FRAME_SIZE_COUNT (sizeof(STREAM_FRAME_SIZES) / sizeof(STREAM_FRAME_SIZES[0]))
+
+// ===========================================
+// TASK PIPELINE
+// ===========================================
+#define SENSOR_TASK_CORE        1
+#define SENSOR_TASK_PRIO        4     // Highest: gate must react first
+#define SENSOR_TASK_STACK       4096
+#define CAPTURE_TASK_CORE       1
+#define CAPTURE_TASK_PRIO       2
+#define CAPTURE_TASK_STACK      3072
+#define STREAM_TASK_CORE        0
+#define STREAM_TASK_PRIO        2
+#define STREAM_TASK_STACK       6144
+#define UPLINK_TASK_CORE        0
+#define UPLINK_TASK_PRIO        1
+#define UPLINK_TASK_STACK       8192
+
+#define EVENT_QUEUE_LEN         8     // Pending entry/exit events
+#define EVENT_BATCH_MAX         16    // Events per batch POST (backend accepts up to 64)
+#define EVENT_BATCH_WINDOW_MS   250   // Coalesce new events this long before sending
+#define EVENT_RETRY_MS          5000  // Replay retry after a failed delivery
+#define DETECT_QUEUE_LEN        1     // Frames waiting for the AI service
 
 // ===========================================
 // GLOBAL OBJECTS
@@ -94,49 +172,135 @@ const char* AI_SERVICE_URL = "http://YOUR_AI_SERVICE_IP:5000"; // AI service
 WebServer server(80);
 Servo gateServo;
 LiquidCrystal_I2C lcd(0x27, 16, 2);  // Address 0x27, 16 chars, 2 lines
+FrameBus frameBus;                                  // Shared by stream, capture and uplink tasks
+MjpegStreamer streamer(frameBus, STREAM_FRAME_DELAY_MS);  // Stream task only
+StreamTunerConfig streamTuning = { 1000 / STREAM_FRAME_DELAY_MS, STREAM_MAX_KBPS, STREAM_FRAME_SIZE_COUNT,
+                                   STREAM_BEST_QUALITY, STREAM_JPEG_QUALITY };
+StreamTuner streamTuner(streamTuning);              // Stream task only
+MultipartUploader imageUploader("image", "capture.jpg", "image/jpeg");
+HttpEndpoint backendHttp("backend", BACKEND_URL);   // Keep-alive connections
+HttpEndpoint aiHttp("ai", AI_SERVICE_URL);
+WireFormat backendWire;                             // Same task as backendHttp
+SceneGate scene(SCENE_CELL_DELTA, SCENE_CHANGE_PERCENT, SCENE_HEARTBEAT_MS);  // Uplink task only
+SlotClassifier slots;                               // Uplink task only
+RoiCrop roiCrop(ROI_JPEG_QUALITY);                  // Uplink task only
+LatencyTrace latency;                               // Recorded by the uplink task
+WsClient hubSocket;                                 // Uplink task only
+EventJournal journal(LittleFS);                     // Uplink task only (after setup)
+UltrasonicRanger ranger(SENSOR_PING_SLOT_MS);       // Sensor task only
+int entrySensor = -1;                               // Ranger sensor indices
+int exitSensor = -1;
+GateTimings gateTimings = { GATE_OPEN_DURATION_MS, GATE_MESSAGE_MS, SENSOR_COOLDOWN_MS, SENSOR_CLEAR_MS };
+GateController gate(gateTimings);                   // Sensor task only
+
+// State variables (shared between tasks)
+std::atomic<int> availableSlots(0);
+std::atomic<int> totalSlots(4);
+std::atomic<bool> gateOpen(false);
+std::atomic<bool> streamActive(false);
+std::atomic<bool> displayDirty(false);     // Set by uplink, LCD redrawn by sensor task
+std::atomic<bool> latencyResetPending(false); // Set by /latency?reset=1, applied by uplink task
+unsigned long lastStatsTime = 0;           // Uplink task only
+unsigned long lastReplayFailTime = 0;      // Uplink task only
+unsigned long batchOpenedTime = 0;         // Uplink task only, first event of the batch
+bool replayFailed = false;                 // Uplink task only
+uint32_t statsSyncedSession = 0;           // Hub session the stats were last fetched in
+unsigned long restartAtMs = 0;             // Stream task only, 0 = no restart pending
+uint32_t bootId = 0;                       // Random per boot, prefixes /capture ETags
+unsigned long lastTuneTime = 0;            // Stream task only
+uint8_t streamSizeStep = 0;                // Stream task only, index into STREAM_FRAME_SIZES
+
+// Gate reaction latency (sensor trigger -> servo command), sensor task writes
+std::atomic<uint32_t> gateLatencyLastUs(0);
+std::atomic<uint32_t> gateLatencyMaxUs(0);
+
+// WiFi station drops and recoveries, written by the WiFi event task
+std::atomic<uint32_t> wifiDisconnects(0);
+std::atomic<uint32_t> wifiReconnects(0);
 
-// State variables
-int availableSlots = 0;
-int totalSlots = 4;
-bool gateOpen = false;
-unsigned long lastDetectionTime = 0;
-unsigned long lastStatsTime = 0;
-unsigned long gateOpenTime = 0;
-bool streamActive = false;
+// Entry/exit events handed from the sensor task to the uplink task
+enum GateEventType : uint8_t {
+    GATE_EVENT_ENTRY,
+    GATE_EVENT_EXIT
+};
 
-// Sensor cooldown state (for single gate setup)
-unsigned long entrySensorCooldownUntil = 0;  // Entry sensor disabled until this time
-unsigned long exitSensorCooldownUntil = 0;   // Exit sensor disabled until this time
+struct GateEvent {
+    GateEventType type;
+    unsigned long timestampMs;
+};
 
-// MJPEG stream boundary
-#define PART_BOUNDARY "123456789000000000000987654321"
-static const char* STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
-static const char* STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
-static const char* STREAM_PART = "Content-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n";
+QueueHandle_t eventQueue = NULL;   // GateEvent
+QueueHandle_t detectQueue = NULL;  // camera_fb_t*, owned by the receiver
+
+// Uplink-owned state as /status, /latency and /metrics show it. The uplink
+// task copies it out on every pass; the web handlers (stream task) render
+// from a copy and never touch the objects the uplink task is changing.
+struct UplinkSnapshot {
+    bool hubConnected;
+    uint32_t journalPending;
+    JournalStats journal;
+    SceneStats scene;
+    SlotClassifierStats edge;
+    uint8_t slotCount;
+    char slotCodes[SLOT_MAX_REGIONS][SLOT_CODE_LEN];
+    int8_t slotStates[SLOT_MAX_REGIONS];   // -1 unknown, 0 free, 1 occupied
+    RoiCropStats roi;
+    HttpEndpointStats http[2];             // backendHttp, aiHttp
+    WireEncoding wireEncoding;
+    WireFormatStats wire;
+    LatencyTrace latency;
+};
+
+UplinkSnapshot uplinkSnapshot;             // Guarded by snapshotMutex
+SemaphoreHandle_t snapshotMutex = NULL;
 
 // ===========================================
 // FUNCTION PROTOTYPES
 // ===========================================
 bool initCamera();
 void connectWiFi();
+void onWiFiEvent(arduino_event_id_t event);
 void setupServer();
 void handleRoot();
+void fillRootPage(Print &out, const char *name);
+void sendDocument(const JsonDocument &doc);
+void formatLocalIP(char *buf, size_t size);
 void handleStream();
 void handleCapture();
 void handleStatus();
+void handleLatency();
+void handleMetrics();
 void handleRestart();
-float measureDistance(int trigPin, int echoPin);
-void handleEntry();
-void handleExit();
-void openGate();
+void tuneStream();
+void handleRangeSample(const RangeSample &sample);
+void handleEntry(uint32_t triggerUs);
+void handleFull();
+void handleExit(uint32_t triggerUs);
+void showGateMessage(GateMessage msg);
+void openGate(uint32_t triggerUs);
 void closeGate();
 void updateDisplay();
 void updateLEDs();
 void beep(int times);
-void runDetection();
 void fetchStats();
-void sendEntryEvent();
-void sendExitEvent();
+bool loadSlotRegions();
+void recordLatency(const FrameTrace &trace);
+bool publishSlotStates();
+bool receiveSlotUpdate(HttpResponse &resp);
+void applySlotStats(int total, int occupied);
+void onHubMessage(const char *data, size_t len);
+int sendGateEvents(const JournalRecord *records, size_t count, uint32_t &ackedSeq);
+void journalGateEvent(const GateEvent &event);
+void replayJournal();
+bool startTasks();
+void sensorTask(void *param);
+void captureTask(void *param);
+void streamTask(void *param);
+void uplinkTask(void *param);
+void publishSnapshot();
+UplinkSnapshot &readSnapshot();
+void queueGateEvent(GateEventType type);
+void runDetection(camera_fb_t *fb);
 
 // ===========================================
 // SETUP
@@ -150,6 +314,9 @@ void setup() {
     Serial.println("  ESP32-S3 + OV2640 + Servo + Ultrasonic");
     Serial.println("========================================\n");
     
+    // Frame sequence numbers restart at 1 on every boot
+    bootId = esp_random();
+    
     // Initialize status LED
     pinMode(LED_STATUS, OUTPUT);
     digitalWrite(LED_STATUS, HIGH);
@@ -172,11 +339,9 @@ void setup() {
     gateServo.write(GATE_CLOSE_ANGLE);
     Serial.println("[OK] Servo initialized (Gate closed)");
     
-    // Initialize Ultrasonic sensors
-    pinMode(US1_TRIG_PIN, OUTPUT);
-    pinMode(US1_ECHO_PIN, INPUT);
-    pinMode(US2_TRIG_PIN, OUTPUT);
-    pinMode(US2_ECHO_PIN, INPUT);
+    // Register Ultrasonic sensors (interrupts attached by the sensor task)
+    entrySensor = ranger.addSensor(US1_TRIG_PIN, US1_ECHO_PIN);
+    exitSensor = ranger.addSensor(US2_TRIG_PIN, US2_ECHO_PIN);
     Serial.println("[OK] Ultrasonic sensors initialized");
     
     // Initialize LEDs
@@ -188,6 +353,9 @@ void setup() {
     lcd.clear();
     lcd.print("Init Camera...");
     
+    // Count frames the camera driver drops (it only logs them)
+    CameraDrops::begin();
+    
     // Initialize Camera
     if (!initCamera()) {
         Serial.println("[ERROR] Camera init FAILED!");
@@ -212,12 +380,33 @@ void setup() {
     // Setup HTTP server for streaming
     setupServer();
     
+    // Offline event journal (events from before a reboot are replayed)
+    if (LittleFS.begin(true) && journal.begin()) {
+        Serial.println("[OK] Event journal ready");
+    } else {
+        Serial.println("[WARN] Event journal unavailable, events are not persisted");
+    }
+    
+    // Backend answers in MessagePack if it can, JSON otherwise
+    backendHttp.setAccept(WIRE_ACCEPT);
+    
     // Initial stats fetch
     fetchStats();
     
+    // Slot changes are pushed by the backend hub from now on
+    hubSocket.begin(BACKEND_URL, HUB_WS_PATH, onHubMessage);
+    
     digitalWrite(LED_STATUS, LOW);
     updateDisplay();
     
+    if (!startTasks()) {
+        Serial.println("[ERROR] Task creation FAILED!");
+        lcd.clear();
+        lcd.print("Task Error!");
+        delay(2000);
+        ESP.restart();
+    }
+    
     Serial.println("\n[READY] System is running!");
     Serial.printf("Stream URL: http://%s/stream\n", WiFi.localIP().toString().c_str());
     Serial.println("=================================\n");
@@ -227,138 +416,285 @@ void setup() {
 // MAIN LOOP
 // ===========================================
 void loop() {
-    // Handle HTTP requests (streaming, capture, status)
-    server.handleClient();
-    
-    unsigned long currentTime = millis();
-    
-    // Check Entry sensor (vehicle wants to enter)
-    // Only check if exit sensor cooldown has expired
-    if (currentTime > exitSensorCooldownUntil) {
-        float entryDistance = measureDistance(US1_TRIG_PIN, US1_ECHO_PIN);
-        if (entryDistance > 0 && entryDistance < DETECTION_DISTANCE_CM) {
-            handleEntry();
-            // Set cooldown: disable exit sensor for a few seconds
-            exitSensorCooldownUntil = currentTime + SENSOR_COOLDOWN_MS;
-            Serial.printf("[SENSOR] Entry triggered, exit sensor disabled for %d ms\n", SENSOR_COOLDOWN_MS);
-        }
+    // All work happens in the pinned tasks started from setup()
+    vTaskDelete(NULL);
+}
+
+// ===========================================
+// TASKS
+// ===========================================
+bool startTasks() {
+    eventQueue = xQueueCreate(EVENT_QUEUE_LEN, sizeof(GateEvent));
+    detectQueue = xQueueCreate(DETECT_QUEUE_LEN, sizeof(camera_fb_t *));
+    snapshotMutex = xSemaphoreCreateMutex();
+    if (eventQueue == NULL || detectQueue == NULL || snapshotMutex == NULL) {
+        return false;
     }
+    publishSnapshot();  // Valid before the first uplink pass
+    
+    bool ok = true;
+    ok &= xTaskCreatePinnedToCore(sensorTask, "sensor", SENSOR_TASK_STACK, NULL,
+                                  SENSOR_TASK_PRIO, NULL, SENSOR_TASK_CORE) == pdPASS;
+    ok &= xTaskCreatePinnedToCore(captureTask, "capture", CAPTURE_TASK_STACK, NULL,
+                                  CAPTURE_TASK_PRIO, NULL, CAPTURE_TASK_CORE) == pdPASS;
+    ok &= xTaskCreatePinnedToCore(streamTask, "stream", STREAM_TASK_STACK, NULL,
+                                  STREAM_TASK_PRIO, NULL, STREAM_TASK_CORE) == pdPASS;
+    ok &= xTaskCreatePinnedToCore(uplinkTask, "uplink", UPLINK_TASK_STACK, NULL,
+                                  UPLINK_TASK_PRIO, NULL, UPLINK_TASK_CORE) == pdPASS;
+    return ok;
+}
+
+// Sensors, gate and LCD. Never touches the network.
+void sensorTask(void *param) {
+    TickType_t lastWake = xTaskGetTickCount();
     
-    // Check Exit sensor (vehicle wants to exit)
-    // Only check if entry sensor cooldown has expired
-    if (currentTime > entrySensorCooldownUntil) {
-        float exitDistance = measureDistance(US2_TRIG_PIN, US2_ECHO_PIN);
-        if (exitDistance > 0 && exitDistance < DETECTION_DISTANCE_CM) {
-            handleExit();
-            // Set cooldown: disable entry sensor for a few seconds
-            entrySensorCooldownUntil = currentTime + SENSOR_COOLDOWN_MS;
-            Serial.printf("[SENSOR] Exit triggered, entry sensor disabled for %d ms\n", SENSOR_COOLDOWN_MS);
+    // Echo interrupts must live on this core (ring has a single producer)
+    ranger.begin();
+    
+    while (true) {
+        // Fire the next ping, then consume finished echoes
+        ranger.loop();
+        
+        RangeSample sample;
+        while (ranger.read(sample)) {
+            handleRangeSample(sample);
+        }
+        
+        // Gate auto-close and message timeout
+        uint8_t actions = gate.update(millis());
+        if (actions & GATE_ACTION_CLOSE) {
+            closeGate();
+        }
+        if (actions & GATE_ACTION_RESTORE_DISPLAY) {
+            displayDirty = true;
+        }
+        
+        // Stats changed in the uplink task (kept until the message is gone)
+        if (gate.message() == GATE_MSG_NONE && displayDirty.exchange(false)) {
+            updateDisplay();
         }
+        
+        // Update LED indicators
+        updateLEDs();
+        
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SENSOR_POLL_MS));
     }
+}
+
+// Grabs a detection frame every DETECTION_INTERVAL_MS and hands it to uplink.
+// If uplink is still busy with the previous frame, the new one is dropped.
+void captureTask(void *param) {
+    TickType_t lastWake = xTaskGetTickCount();
     
-    // Auto-close gate after timeout
-    if (gateOpen && (currentTime - gateOpenTime > GATE_OPEN_DURATION_MS)) {
-        closeGate();
+    while (true) {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(DETECTION_INTERVAL_MS));
+        
+        // Keeps its cadence while streaming: a fresh stream frame is shared
+        if (WiFi.status() != WL_CONNECTED) {
+            continue;
+        }
+        
+        camera_fb_t *fb = frameBus.acquire(FRAME_SHARE_MAX_AGE_MS);
+        if (!fb) {
+            Serial.println("[DETECT] Capture failed");
+            continue;
+        }
+        
+        if (xQueueSend(detectQueue, &fb, 0) != pdTRUE) {
+            Serial.println("[DETECT] Uplink busy, frame dropped");
+            frameBus.release(fb);
+        }
     }
-    
-    // Periodic YOLO detection (only when not streaming to avoid lag)
-    if (!streamActive && (currentTime - lastDetectionTime > DETECTION_INTERVAL_MS)) {
-        runDetection();
-        lastDetectionTime = currentTime;
+}
+
+// HTTP server and MJPEG fan-out to all stream viewers
+void streamTask(void *param) {
+    while (true) {
+        server.handleClient();
+        streamer.loop();
+        streamActive = streamer.clientCount() > 0;
+        
+        if (millis() - lastTuneTime >= STREAM_TUNE_PERIOD_MS) {
+            tuneStream();
+            lastTuneTime = millis();
+        }
+        
+        // Deferred /restart, once the response has gone out
+        if (restartAtMs != 0 && (long)(millis() - restartAtMs) >= 0) {
+            ESP.restart();
+        }
+        vTaskDelay(pdMS_TO_TICKS(2));
     }
+}
+
+// All outbound traffic: events first, then detection, then stats (pushed
+// over the hub socket, polled only while it is down).
+void uplinkTask(void *param) {
+    GateEvent event;
     
-    // Periodic stats fetch
-    if (currentTime - lastStatsTime > STATS_INTERVAL_MS) {
-        fetchStats();
-        lastStatsTime = currentTime;
+    while (true) {
+        publishSnapshot();
+        
+        // Every event goes to the flash journal before delivery is attempted
+        // Wake up in time to close an open batch window
+        bool windowOpen = journal.pending() > 0 && millis() - batchOpenedTime < EVENT_BATCH_WINDOW_MS;
+        TickType_t wait = windowOpen ? pdMS_TO_TICKS(10) : pdMS_TO_TICKS(100);
+        if (xQueueReceive(eventQueue, &event, wait) == pdTRUE) {
+            if (journal.pending() == 0) {
+                batchOpenedTime = millis();
+            }
+            do {
+                journalGateEvent(event);
+            } while (xQueueReceive(eventQueue, &event, 0) == pdTRUE);
+            replayFailed = false;  // New events: try right away
+        }
+        
+        // Deliver the backlog oldest first, once the batch window has closed
+        // or the batch is full; back off while the backend is away
+        bool batchReady = journal.pending() >= EVENT_BATCH_MAX ||
+                          millis() - batchOpenedTime >= EVENT_BATCH_WINDOW_MS;
+        if (journal.pending() > 0 && batchReady && WiFi.status() == WL_CONNECTED &&
+            (!replayFailed || millis() - lastReplayFailTime > EVENT_RETRY_MS)) {
+            replayJournal();
+            continue;  // Drain pending events before slower work
+        }
+        
+        camera_fb_t *fb = NULL;
+        if (xQueueReceive(detectQueue, &fb, 0) == pdTRUE) {
+            runDetection(fb);
+        }
+        
+        // Slot stats pushed by the backend hub
+        hubSocket.loop();
+        
+        // Resync once per hub session, poll only while the hub is down
+        bool resync = hubSocket.sessions() != statsSyncedSession;
+        if (resync || (!hubSocket.connected() && millis() - lastStatsTime > STATS_INTERVAL_MS)) {
+            fetchStats();
+            statsSyncedSession = hubSocket.sessions();
+            lastStatsTime = millis();
+        }
+    }
+}
+
+// Uplink task (and setup, before it starts) only
+void publishSnapshot() {
+    static UplinkSnapshot next;  // Too big for the stack, built outside the lock
+    next.hubConnected = hubSocket.connected();
+    next.journalPending = journal.pending();
+    next.journal = journal.stats();
+    next.scene = scene.stats();
+    next.edge = slots.stats();
+    next.slotCount = slots.regionCount();
+    for (uint8_t i = 0; i < next.slotCount; i++) {
+        const SlotResult &r = slots.result(i);
+        memcpy(next.slotCodes[i], slots.code(i), SLOT_CODE_LEN);
+        next.slotStates[i] = r.state == SLOT_UNKNOWN ? -1 : (r.state == SLOT_OCCUPIED ? 1 : 0);
+    }
+    next.roi = roiCrop.stats();
+    next.http[0] = backendHttp.stats();
+    next.http[1] = aiHttp.stats();
+    next.wireEncoding = backendWire.encoding();
+    next.wire = backendWire.stats();
+    next.latency = latency;
+    
+    xSemaphoreTake(snapshotMutex, portMAX_DELAY);
+    uplinkSnapshot = next;
+    xSemaphoreGive(snapshotMutex);
+}
+
+// Web handlers only (stream task); valid until the next call
+UplinkSnapshot &readSnapshot() {
+    static UplinkSnapshot copy;
+    xSemaphoreTake(snapshotMutex, portMAX_DELAY);
+    copy = uplinkSnapshot;
+    xSemaphoreGive(snapshotMutex);
+    return copy;
+}
+
+void queueGateEvent(GateEventType type) {
+    GateEvent event = { type, millis() };
+    if (xQueueSend(eventQueue, &event, 0) != pdTRUE) {
+        Serial.println("[SESSION] Event queue full, event dropped");
     }
-    
-    // Update LED indicators
-    updateLEDs();
-    
-    delay(10);
 }
 
 // ===========================================
 // ULTRASONIC SENSOR FUNCTIONS
 // ===========================================
-float measureDistance(int trigPin, int echoPin) {
-    digitalWrite(trigPin, LOW);
-    delayMicroseconds(2);
-    digitalWrite(trigPin, HIGH);
-    delayMicroseconds(10);
-    digitalWrite(trigPin, LOW);
-    
-    long duration = pulseIn(echoPin, HIGH, 30000);
-    
-    if (duration == 0) {
-        return -1;
+void handleRangeSample(const RangeSample &sample) {
+    float distance = sample.distanceCm();
+    if (distance <= 0 || distance >= DETECTION_DISTANCE_CM) {
+        return;
     }
     
-    float distance = duration * 0.034 / 2;
-    return distance;
+    // Cooldowns and "same vehicle" filtering live in the gate controller
+    GateSide side = sample.sensor == entrySensor ? GATE_SIDE_ENTRY : GATE_SIDE_EXIT;
+    switch (gate.onVehicle(side, availableSlots > 0, millis())) {
+    case GATE_ADMIT:
+        handleEntry(sample.triggerUs);
+        Serial.printf("[SENSOR] Entry triggered, exit sensor disabled for %d ms\n", SENSOR_COOLDOWN_MS);
+        break;
+    case GATE_REJECT_FULL:
+        handleFull();
+        Serial.println("[SENSOR] Entry rejected, parking lot is full; gate stays closed");
+        break;
+    case GATE_RELEASE:
+        handleExit(sample.triggerUs);
+        Serial.printf("[SENSOR] Exit triggered, entry sensor disabled for %d ms\n", SENSOR_COOLDOWN_MS);
+        break;
+    case GATE_IGNORED:
+        break;
+    }
 }
 
 // ===========================================
 // GATE CONTROL FUNCTIONS
 // ===========================================
-void handleEntry() {
+// Called on GateController decisions; the controller times the message
+// and the auto-close, so none of these block.
+void handleEntry(uint32_t triggerUs) {
     Serial.println("[ENTRY] Vehicle detected at ENTRY");
     
-    if (availableSlots > 0) {
-        openGate();
-        beep(1);
-        
-        // Send entry event to backend for session tracking
-        sendEntryEvent();
-        
-        lcd.clear();
-        lcd.setCursor(0, 0);
-        lcd.print("SELAMAT DATANG!");
-        lcd.setCursor(0, 1);
-        lcd.print("Silakan Masuk");
-        
-        delay(3000);
-        updateDisplay();
-    } else {
-        beep(3);
-        
-        lcd.clear();
-        lcd.setCursor(0, 0);
-        lcd.print("MAAF!");
-        lcd.setCursor(0, 1);
-        lcd.print("PARKIR PENUH!");
-        
-        delay(3000);
-        updateDisplay();
-    }
+    openGate(triggerUs);
+    beep(1);
+    
+    // Hand entry event to the uplink task for session tracking
+    queueGateEvent(GATE_EVENT_ENTRY);
+    
+    showGateMessage(GATE_MSG_WELCOME);
 }
 
-void handleExit() {
+void handleFull() {
+    Serial.println("[ENTRY] Vehicle detected at ENTRY, parking full");
+    
+    beep(3);
+    showGateMessage(GATE_MSG_FULL);
+}
+
+void handleExit(uint32_t triggerUs) {
     Serial.println("[EXIT] Vehicle detected at EXIT");
     
-    openGate();
+    openGate(triggerUs);
     beep(1);
     
-    // Send exit event to backend for session tracking
-    sendExitEvent();
-    
-    lcd.clear();
-    lcd.setCursor(0, 0);
-    lcd.print("TERIMA KASIH!");
-    lcd.setCursor(0, 1);
-    lcd.print("Hati-hati...");
+    // Hand exit event to the uplink task for session tracking
+    queueGateEvent(GATE_EVENT_EXIT);
     
-    delay(3000);
-    updateDisplay();
+    showGateMessage(GATE_MSG_GOODBYE);
 }
 
-void openGate() {
+void openGate(uint32_t triggerUs) {
     if (!gateOpen) {
         Serial.println("[GATE] Opening gate...");
         gateServo.write(GATE_OPEN_ANGLE);
         gateOpen = true;
-        gateOpenTime = millis();
+        
+        uint32_t latencyUs = micros() - triggerUs;
+        gateLatencyLastUs = latencyUs;
+        if (latencyUs > gateLatencyMaxUs) {
+            gateLatencyMaxUs = latencyUs;
+        }
     }
 }
 
@@ -379,9 +715,9 @@ void updateDisplay() {
     lcd.print("PARKIR CERDAS");
     lcd.setCursor(0, 1);
     lcd.print("Slot: ");
-    lcd.print(availableSlots);
+    lcd.print(availableSlots.load());
     lcd.print("/");
-    lcd.print(totalSlots);
+    lcd.print(totalSlots.load());
     
     if (availableSlots == 0) {
         lcd.print(" PENUH");
@@ -390,6 +726,32 @@ void updateDisplay() {
     }
 }
 
+// Message for GATE_MESSAGE_MS, restored by the sensor task afterwards
+void showGateMessage(GateMessage msg) {
+    lcd.clear();
+    lcd.setCursor(0, 0);
+    switch (msg) {
+    case GATE_MSG_WELCOME:
+        lcd.print("SELAMAT DATANG!");
+        lcd.setCursor(0, 1);
+        lcd.print("Silakan Masuk");
+        break;
+    case GATE_MSG_FULL:
+        lcd.print("MAAF!");
+        lcd.setCursor(0, 1);
+        lcd.print("PARKIR PENUH!");
+        break;
+    case GATE_MSG_GOODBYE:
+        lcd.print("TERIMA KASIH!");
+        lcd.setCursor(0, 1);
+        lcd.print("Hati-hati...");
+        break;
+    case GATE_MSG_NONE:
+        updateDisplay();
+        break;
+    }
+}
+
 void updateLEDs() {
     if (availableSlots > 0) {
         digitalWrite(LED_GREEN, HIGH);
@@ -436,9 +798,9 @@ bool initCamera() {
     config.xclk_freq_hz = 20000000;
     config.pixel_format = PIXFORMAT_JPEG;
     
-    config.frame_size = FRAMESIZE_VGA;
-    config.jpeg_quality = 12;
-    config.fb_count = 2;
+    config.frame_size = STREAM_FRAME_SIZES[0];
+    config.jpeg_quality = STREAM_JPEG_QUALITY;
+    config.fb_count = FRAME_BUS_SLOTS;   // Stream holds up to 2, detection/capture share or get the 3rd
     config.grab_mode = CAMERA_GRAB_LATEST;
     
     esp_err_t err = esp_camera_init(&config);
@@ -467,10 +829,17 @@ bool initCamera() {
 // HTTP SERVER SETUP
 // ===========================================
 void setupServer() {
+    // /capture answers a matching If-None-Match with 304; Accept picks
+    // MessagePack for /status and /latency
+    static const char *requestHeaders[] = { "If-None-Match", "Accept" };
+    server.collectHeaders(requestHeaders, 2);
+    
     server.on("/", handleRoot);
     server.on("/stream", handleStream);
     server.on("/capture", handleCapture);
     server.on("/status", handleStatus);
+    server.on("/latency", handleLatency);
+    server.on("/metrics", handleMetrics);
     server.on("/restart", handleRestart);
     
     server.begin();
@@ -484,176 +853,566 @@ void handleRestart() {
     server.sendHeader("Access-Control-Allow-Origin", "*");
     server.send(200, "application/json", "{\"success\":true,\"message\":\"Restarting in 2 seconds...\"}");
     
-    delay(2000);  // Give time for response to be sent
-    ESP.restart();
+    // Restarted from streamTask, which keeps serving in the meantime
+    restartAtMs = millis() + 2000;
 }
 
 // ===========================================
 // HTTP HANDLERS
 // ===========================================
+// Status page, kept in flash; {{...}} are filled by fillRootPage()
+static const char ROOT_PAGE[] =
+    "<!DOCTYPE html><html><head>"
+    "<title>Smart Parking System</title>"
+    "<meta name='viewport' content='width=device-width,initial-scale=1'>"
+    "<style>body{font-family:Arial;text-align:center;background:#1a1a2e;color:#fff;padding:20px}"
+    "h1{color:#4ecca3}a{color:#4ecca3}.stream{max-width:100%;border-radius:10px;}"
+    ".status{background:#16213e;padding:15px;border-radius:8px;margin:10px;display:inline-block}</style>"
+    "</head><body>"
+    "<h1>🅿️ Smart Parking System</h1>"
+    "<p>ESP32-S3 + OV2640 + Servo + Ultrasonic</p>"
+    "<img class='stream' src='/stream'><br><br>"
+    "<div class='status'>"
+    "<p>Slot Tersedia: <b>{{available}}/{{total}}</b></p>"
+    "<p>Gate: <b>{{gate}}</b></p>"
+    "</div>"
+    "<p><a href='/capture'>📸 Capture Single Frame</a></p>"
+    "<p><a href='/status'>📊 JSON Status</a></p>"
+    "</body></html>";
+
+void fillRootPage(Print &out, const char *name) {
+    if (strcmp(name, "available") == 0) {
+        out.print(availableSlots.load());
+    } else if (strcmp(name, "total") == 0) {
+        out.print(totalSlots.load());
+    } else if (strcmp(name, "gate") == 0) {
+        out.print(gateOpen ? "OPEN" : "CLOSED");
+    }
+}
+
 void handleRoot() {
-    String html = "<!DOCTYPE html><html><head>";
-    html += "<title>Smart Parking System</title>";
-    html += "<meta name='viewport' content='width=device-width,initial-scale=1'>";
-    html += "<style>body{font-family:Arial;text-align:center;background:#1a1a2e;color:#fff;padding:20px}";
-    html += "h1{color:#4ecca3}a{color:#4ecca3}.stream{max-width:100%;border-radius:10px;}";
-    html += ".status{background:#16213e;padding:15px;border-radius:8px;margin:10px;display:inline-block}</style>";
-    html += "</head><body>";
-    html += "<h1>🅿️ Smart Parking System</h1>";
-    html += "<p>ESP32-S3 + OV2640 + Servo + Ultrasonic</p>";
-    html += "<img class='stream' src='/stream'><br><br>";
-    html += "<div class='status'>";
-    html += "<p>Slot Tersedia: <b>" + String(availableSlots) + "/" + String(totalSlots) + "</b></p>";
-    html += "<p>Gate: <b>" + String(gateOpen ? "OPEN" : "CLOSED") + "</b></p>";
-    html += "</div>";
-    html += "<p><a href='/capture'>📸 Capture Single Frame</a></p>";
-    html += "<p><a href='/status'>📊 JSON Status</a></p>";
-    html += "</body></html>";
-    
-    server.send(200, "text/html", html);
+    WiFiClient client = server.client();
+    ChunkedResponse out(client);
+    out.begin(200, "text/html");
+    out.render(ROOT_PAGE, fillRootPage);
+    out.end();
 }
 
+// Hands the socket to the streamer; frames are pushed from streamer.loop()
 void handleStream() {
-    streamActive = true;
-    
-    WiFiClient client = server.client();
-    
-    String response = "HTTP/1.1 200 OK\r\n";
-    response += "Access-Control-Allow-Origin: *\r\n";
-    response += "Content-Type: " + String(STREAM_CONTENT_TYPE) + "\r\n\r\n";
-    client.print(response);
-    
-    Serial.println("[STREAM] Client connected");
-    
-    while (client.connected()) {
-        camera_fb_t *fb = esp_camera_fb_get();
-        if (!fb) {
-            Serial.println("[STREAM] Frame capture failed");
-            continue;
-        }
-        
-        client.print(STREAM_BOUNDARY);
-        
-        char partHeader[64];
-        snprintf(partHeader, sizeof(partHeader), STREAM_PART, fb->len);
-        client.print(partHeader);
-        
-        client.write(fb->buf, fb->len);
-        
-        esp_camera_fb_return(fb);
-        
-        delay(STREAM_FRAME_DELAY_MS);
+    if (!streamer.addClient(server.client())) {
+        server.sendHeader("Access-Control-Allow-Origin", "*");
+        server.send(503, "text/plain", "Too many stream clients");
+        return;
     }
-    
-    streamActive = false;
-    Serial.println("[STREAM] Client disconnected");
+    streamActive = true;
 }
 
+// Newest frame at once (usually the stream's), not the next one off the
+// sensor. ?max_age=<ms> bounds how old it may be; the ETag is the boot ID
+// and the frame's sequence number, so a poller that already has that frame
+// gets a 304, and one that cached a frame before a reboot does not.
 void handleCapture() {
-    camera_fb_t *fb = esp_camera_fb_get();
+    uint32_t maxAge = CAPTURE_MAX_AGE_MS;
+    if (server.hasArg("max_age")) {
+        // toInt() would turn "abc" into 0 and "-5" into a 49-day window
+        String arg = server.arg("max_age");
+        char *end;
+        long value = strtol(arg.c_str(), &end, 10);
+        if (arg.length() == 0 || *end != '\0' || value < 0 || value > INT32_MAX) {
+            server.sendHeader("Access-Control-Allow-Origin", "*");
+            server.send(400, "text/plain", "max_age must be milliseconds (0 or more)");
+            return;
+        }
+        maxAge = value;
+    }
+    char etag[24];
+    char age[12];
+    
+    FrameInfo newest;
+    if (frameBus.latest(newest) && millis() - newest.grabbedMs <= maxAge) {
+        snprintf(etag, sizeof(etag), "\"%08x-%u\"", (unsigned)bootId, (unsigned)newest.seq);
+        if (server.header("If-None-Match") == etag) {
+            server.sendHeader("Access-Control-Allow-Origin", "*");
+            server.sendHeader("ETag", etag);
+            server.send(304);
+            return;
+        }
+    }
+    
+    FrameInfo info;
+    camera_fb_t *fb = frameBus.acquire(maxAge, &info);
     if (!fb) {
         server.send(500, "text/plain", "Camera capture failed");
         return;
     }
     
+    uint32_t ageMs = millis() - info.grabbedMs;
+    snprintf(etag, sizeof(etag), "\"%08x-%u\"", (unsigned)bootId, (unsigned)info.seq);
     server.sendHeader("Access-Control-Allow-Origin", "*");
+    server.sendHeader("Access-Control-Expose-Headers", "ETag, X-Frame-Age-Ms");
+    server.sendHeader("Cache-Control", "no-cache");
+    server.sendHeader("ETag", etag);
+    snprintf(age, sizeof(age), "%u", (unsigned)(ageMs / 1000));
+    server.sendHeader("Age", age);
+    snprintf(age, sizeof(age), "%u", (unsigned)ageMs);
+    server.sendHeader("X-Frame-Age-Ms", age);
     server.send_P(200, "image/jpeg", (const char*)fb->buf, fb->len);
     
-    esp_camera_fb_return(fb);
+    frameBus.release(fb);
+}
+
+// Feeds the last period's deliveries to the tuner and applies its setting
+void tuneStream() {
+    MjpegLinkSample sample;
+    streamer.takeLinkSample(sample);
+    
+    StreamSetting setting;
+    if (!streamTuner.update(sample, millis(), setting)) return;
+    
+    sensor_t *s = esp_camera_sensor_get();
+    if (s != NULL) {
+        s->set_quality(s, setting.quality);
+        if (setting.sizeStep != streamSizeStep) {
+            s->set_framesize(s, STREAM_FRAME_SIZES[setting.sizeStep]);
+            streamSizeStep = setting.sizeStep;
+        }
+    }
+    streamer.setFrameInterval(setting.frameIntervalMs);
+    
+    Serial.printf("[STREAM] Tuned: quality %u, size step %u, %u ms/frame (%u kbps measured)\n",
+                  setting.quality, setting.sizeStep, setting.frameIntervalMs,
+                  (unsigned)streamTuner.stats().throughputKbps);
+}
+
+// JSON (or MessagePack if the client accepts it) straight to the socket in
+// chunks; the document never becomes a String
+void sendDocument(const JsonDocument &doc) {
+    bool binary = strstr(server.header("Accept").c_str(), WIRE_MIME_MSGPACK) != NULL;
+    WiFiClient client = server.client();
+    ChunkedResponse out(client);
+    if (binary) {
+        out.begin(200, WIRE_MIME_MSGPACK);
+        serializeMsgPack(doc, out);
+    } else {
+        out.begin(200, WIRE_MIME_JSON);
+        serializeJson(doc, out);
+    }
+    out.end();
+}
+
+// Dotted quad without going through IPAddress::toString()
+void formatLocalIP(char *buf, size_t size) {
+    IPAddress ip = WiFi.localIP();
+    snprintf(buf, size, "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
 }
 
 void handleStatus() {
-    StaticJsonDocument<512> doc;
+    UplinkSnapshot &up = readSnapshot();
+    StaticJsonDocument<2816> doc;
     doc["device"] = "ESP32-S3-CAM-Full";
-    doc["ip"] = WiFi.localIP().toString();
-    doc["stream_url"] = "http://" + WiFi.localIP().toString() + "/stream";
-    doc["available_slots"] = availableSlots;
-    doc["total_slots"] = totalSlots;
-    doc["gate_open"] = gateOpen;
-    doc["stream_active"] = streamActive;
+    char ip[16];
+    char streamUrl[40];
+    formatLocalIP(ip, sizeof(ip));
+    snprintf(streamUrl, sizeof(streamUrl), "http://%s/stream", ip);
+    doc["ip"] = ip;
+    doc["stream_url"] = streamUrl;
+    doc["available_slots"] = availableSlots.load();
+    doc["total_slots"] = totalSlots.load();
+    doc["gate_open"] = gateOpen.load();
+    doc["stream_active"] = streamActive.load();
+    doc["gate_latency_us"] = gateLatencyLastUs.load();
+    doc["gate_latency_max_us"] = gateLatencyMaxUs.load();
+    doc["hub_connected"] = up.hubConnected;
     doc["uptime_ms"] = millis();
     
-    String response;
-    serializeJson(doc, response);
+    JsonObject http = doc.createNestedObject("http");
+    const HttpEndpoint *endpoints[] = { &backendHttp, &aiHttp };
+    for (uint8_t i = 0; i < 2; i++) {
+        const HttpEndpointStats &st = up.http[i];
+        JsonObject e = http.createNestedObject(endpoints[i]->name());
+        e["requests"] = st.requests;
+        e["failures"] = st.failures;
+        e["connects"] = st.connects;
+        e["latency_avg_us"] = st.avgLatencyUs;
+        e["latency_max_us"] = st.maxLatencyUs;
+    }
     
-    server.sendHeader("Access-Control-Allow-Origin", "*");
-    server.send(200, "application/json", response);
+    const JournalStats &js = up.journal;
+    JsonObject journaled = doc.createNestedObject("journal");
+    journaled["pending"] = up.journalPending;
+    journaled["dropped"] = js.dropped;
+    journaled["recovered_bytes"] = js.recovered;
+    
+    const RangerStats &rs = ranger.stats();
+    JsonObject ranging = doc.createNestedObject("ranging");
+    ranging["pings"] = rs.pings;
+    ranging["samples"] = rs.samples;
+    ranging["timeouts"] = rs.timeouts;
+    
+    const SceneStats &ss = up.scene;
+    JsonObject sceneStats = doc.createNestedObject("scene");
+    sceneStats["frames"] = ss.frames;
+    sceneStats["uploads"] = ss.uploads;
+    sceneStats["skipped"] = ss.skipped;
+    sceneStats["heartbeats"] = ss.heartbeats;
+    sceneStats["last_score"] = ss.lastScore;
+    
+    const SlotClassifierStats &cs = up.edge;
+    JsonObject edge = doc.createNestedObject("edge");
+    edge["frames"] = cs.frames;
+    edge["decided"] = cs.decided;
+    edge["agree"] = cs.agree;
+    edge["disagree"] = cs.disagree;
+    edge["frame_us"] = cs.lastFrameUs;
+    JsonObject slotStates = edge.createNestedObject("slots");
+    for (uint8_t i = 0; i < up.slotCount; i++) {
+        slotStates[(const char *)up.slotCodes[i]] = up.slotStates[i];
+    }
+    
+    const RoiCropStats &crop = up.roi;
+    JsonObject roi = doc.createNestedObject("roi");
+    roi["crops"] = crop.crops;
+    roi["failures"] = crop.failures;
+    roi["bytes_in"] = crop.bytesIn;
+    roi["bytes_out"] = crop.bytesOut;
+    roi["crop_us"] = crop.lastUs;
+    roi["encode_us"] = crop.encodeUs;
+    
+    const StreamTunerStats &ts = streamTuner.stats();
+    StreamSetting current = streamTuner.setting();
+    JsonObject tuning = doc.createNestedObject("stream_tuning");
+    tuning["level"] = ts.level;
+    tuning["quality"] = current.quality;
+    tuning["frame_interval_ms"] = current.frameIntervalMs;
+    tuning["throughput_kbps"] = ts.throughputKbps;
+    tuning["frame_bytes"] = ts.frameBytes;
+    tuning["steps_down"] = ts.stepsDown;
+    tuning["steps_up"] = ts.stepsUp;
+    
+    FrameBusStats bs = frameBus.stats();
+    JsonObject bus = doc.createNestedObject("frame_bus");
+    bus["grabs"] = bs.grabs;
+    bus["reuses"] = bs.reuses;
+    bus["failures"] = bs.failures;
+    bus["drops"] = bs.drops;
+    bus["evictions"] = bs.evictions;
+    bus["held"] = bs.held;
+    
+    const WireFormatStats &ws = up.wire;
+    JsonObject wire = doc.createNestedObject("wire");
+    wire["encoding"] = WireFormat::name(up.wireEncoding);
+    for (uint8_t i = 0; i < WIRE_ENCODING_COUNT; i++) {
+        JsonObject w = wire.createNestedObject(WireFormat::name((WireEncoding)i));
+        w["sent"] = ws.sent[i];
+        w["received"] = ws.received[i];
+        w["bytes_sent"] = ws.bytesSent[i];
+        w["bytes_received"] = ws.bytesReceived[i];
+    }
+    wire["fallbacks"] = ws.fallbacks;
+    
+    JsonArray clients = doc.createNestedArray("stream_clients");
+    MjpegClientStats stats;
+    for (size_t i = 0; streamer.clientStats(i, stats); i++) {
+        JsonObject c = clients.createNestedObject();
+        c["fps"] = stats.fps;
+        c["frames_sent"] = stats.framesSent;
+        c["frames_dropped"] = stats.framesDropped;
+        c["backlog_bytes"] = stats.backlog;
+    }
+    
+    sendDocument(doc);
+}
+
+// Capture-to-decision latency of detection frames, per stage
+void handleLatency() {
+    UplinkSnapshot &up = readSnapshot();
+    StaticJsonDocument<1024> doc;
+    doc["device"] = "ESP32-S3-CAM-Full";
+    char ip[16];
+    formatLocalIP(ip, sizeof(ip));
+    doc["ip"] = ip;
+    doc["edge_decisions"] = up.latency.edgeDecisions();
+    doc["ai_decisions"] = up.latency.aiDecisions();
+    
+    JsonObject stages = doc.createNestedObject("stages");
+    for (uint8_t i = 0; i < TRACE_STAGE_COUNT; i++) {
+        const LatencyHistogram &h = up.latency.histogram((TraceStage)i);
+        JsonObject stage = stages.createNestedObject(LatencyTrace::stageName((TraceStage)i));
+        stage["count"] = h.count();
+        stage["p50_ms"] = h.percentile(50);
+        stage["p90_ms"] = h.percentile(90);
+        stage["p99_ms"] = h.percentile(99);
+        stage["mean_ms"] = h.meanMs();
+        stage["max_ms"] = h.maxMs();
+    }
+    if (server.arg("reset") == "1") {
+        latencyResetPending = true;
+    }
+    
+    sendDocument(doc);
+}
+
+// Prometheus text format, streamed from a fixed buffer (no String, no JSON)
+void handleMetrics() {
+    static uint32_t lastFrames = 0;                // Previous scrape
+    static uint32_t lastScrapeMs = 0;
+    char labels[48];
+    
+    UplinkSnapshot &up = readSnapshot();
+    WiFiClient client = server.client();
+    MetricsWriter m(client);
+    m.header();
+    
+    m.family("parking_uptime_seconds", "gauge", "Time since boot");
+    m.sample("parking_uptime_seconds", (uint32_t)(millis() / 1000));
+    m.family("parking_heap_internal_free_bytes", "gauge", "Free internal heap");
+    m.sample("parking_heap_internal_free_bytes", (uint32_t)heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+    m.family("parking_heap_internal_min_free_bytes", "gauge", "Lowest free internal heap since boot");
+    m.sample("parking_heap_internal_min_free_bytes", (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+    m.family("parking_psram_free_bytes", "gauge", "Free PSRAM");
+    m.sample("parking_psram_free_bytes", (uint32_t)ESP.getFreePsram());
+    m.family("parking_psram_min_free_bytes", "gauge", "Lowest free PSRAM since boot");
+    m.sample("parking_psram_min_free_bytes", (uint32_t)ESP.getMinFreePsram());
+    
+    // Camera: stream grab rate since the previous scrape, driver drops
+    uint32_t frames = streamer.framesCaptured();
+    uint32_t now = millis();
+    float fps = lastScrapeMs && now > lastScrapeMs ? (frames - lastFrames) * 1000.0f / (now - lastScrapeMs) : 0;
+    lastFrames = frames;
+    lastScrapeMs = now;
+    m.family("parking_camera_fps", "gauge", "Frames grabbed for the stream per second since the last scrape");
+    m.sample("parking_camera_fps", fps);
+    CameraDropStats drops;
+    CameraDrops::read(drops);
+    m.family("parking_camera_frames_dropped_total", "counter", "Frames discarded by the camera driver");
+    m.sample("parking_camera_frames_dropped_total", drops.overflows, "reason=\"buffer_overflow\"");
+    m.sample("parking_camera_frames_dropped_total", drops.queueFull, "reason=\"queue_full\"");
+    m.sample("parking_camera_frames_dropped_total", drops.noBuffer, "reason=\"no_buffer\"");
+    m.sample("parking_camera_frames_dropped_total", drops.oversize, "reason=\"oversize\"");
+    m.sample("parking_camera_frames_dropped_total", drops.corrupt, "reason=\"corrupt\"");
+    
+    // Frame bus: camera grabs vs frames shared between stream, detection, /capture
+    FrameBusStats bs = frameBus.stats();
+    m.family("parking_frame_bus_grabs_total", "counter", "Frames taken from the camera");
+    m.sample("parking_frame_bus_grabs_total", bs.grabs);
+    m.family("parking_frame_bus_reuses_total", "counter", "Frames handed out again to another consumer");
+    m.sample("parking_frame_bus_reuses_total", bs.reuses);
+    m.family("parking_frame_bus_failures_total", "counter", "Camera returned no frame");
+    m.sample("parking_frame_bus_failures_total", bs.failures);
+    m.family("parking_frame_bus_drops_total", "counter", "Frames grabbed while every bus slot was in use");
+    m.sample("parking_frame_bus_drops_total", bs.drops);
+    m.family("parking_frame_bus_evictions_total", "counter", "Newest frame let go so the camera keeps a free buffer");
+    m.sample("parking_frame_bus_evictions_total", bs.evictions);
+    m.family("parking_frame_bus_held", "gauge", "Frames referenced right now");
+    m.sample("parking_frame_bus_held", (uint32_t)bs.held);
+    
+    // Stream
+    m.family("parking_stream_clients", "gauge", "Connected MJPEG viewers");
+    m.sample("parking_stream_clients", (uint32_t)streamer.clientCount());
+    m.family("parking_stream_frames_total", "counter", "Frames grabbed for the stream");
+    m.sample("parking_stream_frames_total", frames);
+    m.family("parking_stream_bytes_sent_total", "counter", "MJPEG bytes sent to all viewers");
+    m.sample("parking_stream_bytes_sent_total", streamer.bytesSent());
+    MjpegClientStats cs;
+    m.family("parking_stream_client_fps", "gauge", "Frames sent per second, per viewer");
+    for (size_t i = 0; streamer.clientStats(i, cs); i++) {
+        snprintf(labels, sizeof(labels), "client=\"%u\"", (unsigned)i);
+        m.sample("parking_stream_client_fps", cs.fps, labels);
+    }
+    m.family("parking_stream_client_frames_dropped", "gauge", "Frames a viewer skipped while it fell behind");
+    for (size_t i = 0; streamer.clientStats(i, cs); i++) {
+        snprintf(labels, sizeof(labels), "client=\"%u\"", (unsigned)i);
+        m.sample("parking_stream_client_frames_dropped", cs.framesDropped, labels);
+    }
+    
+    // HTTP clients (backend, AI service)
+    const HttpEndpoint *endpoints[] = { &backendHttp, &aiHttp };
+    m.family("parking_http_requests_total", "counter", "Requests sent, per remote service");
+    for (uint8_t i = 0; i < 2; i++) {
+        snprintf(labels, sizeof(labels), "endpoint=\"%s\"", endpoints[i]->name());
+        m.sample("parking_http_requests_total", up.http[i].requests, labels);
+    }
+    m.family("parking_http_failures_total", "counter", "Requests without a response");
+    for (uint8_t i = 0; i < 2; i++) {
+        snprintf(labels, sizeof(labels), "endpoint=\"%s\"", endpoints[i]->name());
+        m.sample("parking_http_failures_total", up.http[i].failures, labels);
+    }
+    m.family("parking_http_connects_total", "counter", "TCP connections opened");
+    for (uint8_t i = 0; i < 2; i++) {
+        snprintf(labels, sizeof(labels), "endpoint=\"%s\"", endpoints[i]->name());
+        m.sample("parking_http_connects_total", up.http[i].connects, labels);
+    }
+    m.family("parking_http_latency_seconds", "gauge", "Request written to response read");
+    for (uint8_t i = 0; i < 2; i++) {
+        const HttpEndpointStats &st = up.http[i];
+        const char *name = endpoints[i]->name();
+        snprintf(labels, sizeof(labels), "endpoint=\"%s\",stat=\"last\"", name);
+        m.sample("parking_http_latency_seconds", st.lastLatencyUs / 1e6f, labels);
+        snprintf(labels, sizeof(labels), "endpoint=\"%s\",stat=\"avg\"", name);
+        m.sample("parking_http_latency_seconds", st.avgLatencyUs / 1e6f, labels);
+        snprintf(labels, sizeof(labels), "endpoint=\"%s\",stat=\"max\"", name);
+        m.sample("parking_http_latency_seconds", st.maxLatencyUs / 1e6f, labels);
+    }
+    
+    // Detection latency, capture -> slot decision
+    m.family("parking_detection_latency_seconds", "summary", "Detection frame latency per stage");
+    for (uint8_t i = 0; i < TRACE_STAGE_COUNT; i++) {
+        const LatencyHistogram &h = up.latency.histogram((TraceStage)i);
+        const char *stage = LatencyTrace::stageName((TraceStage)i);
+        static const uint8_t QUANTILES[] = { 50, 90, 99 };
+        for (uint8_t q : QUANTILES) {
+            snprintf(labels, sizeof(labels), "stage=\"%s\",quantile=\"0.%u\"", stage, q);
+            m.sample("parking_detection_latency_seconds", h.percentile(q) / 1000.0f, labels);
+        }
+        snprintf(labels, sizeof(labels), "stage=\"%s\"", stage);
+        m.sample("parking_detection_latency_seconds_sum", h.sumMs() / 1000.0f, labels);
+        m.sample("parking_detection_latency_seconds_count", h.count(), labels);
+    }
+    
+    // WiFi
+    m.family("parking_wifi_rssi_dbm", "gauge", "Signal strength of the access point");
+    m.sample("parking_wifi_rssi_dbm", (int32_t)WiFi.RSSI());
+    m.family("parking_wifi_disconnects_total", "counter", "Station disconnects");
+    m.sample("parking_wifi_disconnects_total", wifiDisconnects.load());
+    m.family("parking_wifi_reconnects_total", "counter", "Station reconnects after a disconnect");
+    m.sample("parking_wifi_reconnects_total", wifiReconnects.load());
+    
+    m.finish();
+    client.stop();
 }
 
 // ===========================================
 // YOLO DETECTION
 // ===========================================
-void runDetection() {
-    Serial.println("\n[DETECT] Running YOLO detection...");
-    digitalWrite(LED_STATUS, HIGH);
-    
-    camera_fb_t *fb = esp_camera_fb_get();
-    if (!fb) {
-        Serial.println("[DETECT] Capture failed");
-        digitalWrite(LED_STATUS, LOW);
+// Takes ownership of fb (captured by captureTask) and returns it when done
+void runDetection(camera_fb_t *fb) {
+    FrameTrace trace = { LatencyTrace::captureUs(fb), 0, 0, 0, false };
+    
+    // Skip frames that look like the last uploaded one
+    SceneSignature sig;
+    bool hasSig = scene.signature(fb->buf, fb->len, sig);
+    SceneDecision decision = hasSig ? scene.decide(sig, millis()) : SCENE_UPLOAD_FIRST;
+    if (decision == SCENE_SKIP) {
+        Serial.printf("[DETECT] Scene unchanged (%u%% cells), upload skipped\n", scene.stats().lastScore);
+        frameBus.release(fb);
         return;
     }
     
-    Serial.printf("[DETECT] Image: %d bytes\n", fb->len);
+    // Classify slots on the device; YOLO only when a slot is ambiguous.
+    // Heartbeats still go to YOLO to keep the empty-slot baselines fresh.
+    if (slots.regionCount() == 0) {
+        loadSlotRegions();
+    }
+    bool classified = slots.classify(fb->buf, fb->len, fb->width, fb->height);
+    if (classified && slots.unknownCount() == 0 && decision != SCENE_UPLOAD_HEARTBEAT) {
+        trace.sendStartUs = micros();
+        if (publishSlotStates()) {
+            trace.decisionUs = micros();
+            trace.edge = true;
+            recordLatency(trace);
+            Serial.printf("[EDGE] %u slot(s) decided on device in %u us, YOLO skipped\n",
+                          slots.regionCount(), (unsigned)slots.stats().lastFrameUs);
+            if (hasSig) {
+                scene.markUploaded(sig, millis());
+            }
+            frameBus.release(fb);
+            return;
+        }
+    }
+    
+    Serial.println("\n[DETECT] Running YOLO detection...");
+    digitalWrite(LED_STATUS, HIGH);
+    
+    Serial.printf("[DETECT] Image: %u bytes\n", (unsigned)fb->len);
     
     if (WiFi.status() == WL_CONNECTED) {
-        HTTPClient http;
-        String url = String(AI_SERVICE_URL) + "/analyze";
-        
-        http.begin(url);
-        http.setTimeout(15000);
-        
-        String boundary = "----ESP32Boundary";
-        String contentType = "multipart/form-data; boundary=" + boundary;
-        http.addHeader("Content-Type", contentType);
-        
-        String bodyStart = "--" + boundary + "\r\n";
-        bodyStart += "Content-Disposition: form-data; name=\"image\"; filename=\"capture.jpg\"\r\n";
-        bodyStart += "Content-Type: image/jpeg\r\n\r\n";
-        
-        String bodyEnd = "\r\n--" + boundary + "--\r\n";
+        // Only the slot area goes up; the AI service maps boxes back with the offset
+        const uint8_t *image = fb->buf;
+        size_t imageLen = fb->len;
+        uint8_t *cropped = NULL;
+        size_t croppedLen = 0;
+        // The frame size lets the AI service scale boxes to the region frame
+        char path[96];
+        snprintf(path, sizeof(path), "/analyze?frame_w=%u&frame_h=%u", (unsigned)fb->width, (unsigned)fb->height);
+        int x0, y0, x1, y1;
+        if (ROI_CROP_ENABLED && slots.bounds(fb->width, fb->height, x0, y0, x1, y1)) {
+            RoiRect roi = RoiCrop::align(x0, y0, x1, y1, fb->width, fb->height, ROI_MARGIN_PX);
+            // Decode + re-encode costs more than a few percent of upload saves
+            uint32_t frameArea = (uint32_t)fb->width * fb->height;
+            if ((uint32_t)roi.w * roi.h * 100 <= frameArea * (100 - ROI_MIN_SAVING_PERCENT) &&
+                roiCrop.crop(fb->buf, fb->len, roi, &cropped, &croppedLen)) {
+                image = cropped;
+                imageLen = croppedLen;
+                snprintf(path, sizeof(path), "/analyze?frame_w=%u&frame_h=%u&crop_x=%u&crop_y=%u",
+                         (unsigned)fb->width, (unsigned)fb->height, roi.x, roi.y);
+                Serial.printf("[DETECT] ROI %ux%u at %u,%u: %u -> %u bytes\n", roi.w, roi.h, roi.x, roi.y,
+                              (unsigned)fb->len, (unsigned)croppedLen);
+            }
+        }
         
-        size_t totalLen = bodyStart.length() + fb->len + bodyEnd.length();
+        // Preamble, image and trailer are written straight to the socket
+        HttpResponse resp;
+        trace.sendStartUs = micros();
+        int httpCode = aiHttp.postMultipart(path, imageUploader, image, imageLen, resp, 15000);
+        free(cropped);
         
-        uint8_t *payload = (uint8_t*)malloc(totalLen);
-        if (payload) {
-            memcpy(payload, bodyStart.c_str(), bodyStart.length());
-            memcpy(payload + bodyStart.length(), fb->buf, fb->len);
-            memcpy(payload + bodyStart.length() + fb->len, bodyEnd.c_str(), bodyEnd.length());
-            
-            int httpCode = http.POST(payload, totalLen);
+        if (httpCode == 200) {
+            trace.sendEndUs = aiHttp.lastWrittenUs();
+            trace.decisionUs = micros();
+            recordLatency(trace);
+            Serial.printf("[DETECT] AI response received, %u ms after capture\n",
+                          (unsigned)((trace.decisionUs - trace.captureUs) / 1000));
+            if (hasSig) {
+                scene.markUploaded(sig, millis());
+            }
             
-            if (httpCode == 200) {
-                String response = http.getString();
-                Serial.println("[DETECT] AI response received");
-                
-                DynamicJsonDocument doc(2048);
-                if (deserializeJson(doc, response) == DeserializationError::Ok) {
-                    if (doc["success"]) {
-                        int vehicles = doc["vehicles_detected"] | 0;
-                        Serial.printf("[DETECT] Detected %d vehicles\n", vehicles);
+            DynamicJsonDocument doc(2048);
+            if (deserializeJson(doc, resp.body) == DeserializationError::Ok) {
+                if (doc["success"]) {
+                    int vehicles = doc["vehicles_detected"] | 0;
+                    Serial.printf("[DETECT] Detected %d vehicles\n", vehicles);
+                    
+                    // The server's answer is ground truth for this frame
+                    if (classified) {
+                        for (JsonPair kv : doc["slot_status"].as<JsonObject>()) {
+                            slots.learn(kv.key().c_str(), kv.value().as<bool>());
+                        }
                     }
                 }
-            } else {
-                Serial.printf("[DETECT] AI error: %d\n", httpCode);
             }
-            
-            free(payload);
+        } else {
+            Serial.printf("[DETECT] AI error: %d\n", httpCode);
         }
-        
-        http.end();
     }
     
-    esp_camera_fb_return(fb);
+    frameBus.release(fb);
     digitalWrite(LED_STATUS, LOW);
 }
 
 // ===========================================
 // NETWORK FUNCTIONS
 // ===========================================
+// Counts station drops for /metrics; Arduino's auto-reconnect recovers them
+void onWiFiEvent(arduino_event_id_t event) {
+    static bool connected = false;                 // WiFi event task only
+    static bool everConnected = false;
+    if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED && connected) {
+        connected = false;
+        wifiDisconnects++;
+    } else if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        if (everConnected) {
+            wifiReconnects++;
+        }
+        connected = true;
+        everConnected = true;
+    }
+}
+
 void connectWiFi() {
     Serial.printf("[WIFI] Connecting to %s", WIFI_SSID);
     
+    WiFi.onEvent(onWiFiEvent);
     WiFi.mode(WIFI_STA);
     WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
     
@@ -686,94 +1445,247 @@ void connectWiFi() {
 void fetchStats() {
     if (WiFi.status() != WL_CONNECTED) return;
     
-    HTTPClient http;
-    String url = String(BACKEND_URL) + "/api/slots/stats";
-    
-    http.begin(url);
-    http.setTimeout(5000);
-    
-    int httpCode = http.GET();
+    HttpResponse resp;
+    int httpCode = backendHttp.get("/api/slots/stats", resp, 5000);
     
     if (httpCode == 200) {
-        String payload = http.getString();
-        
         StaticJsonDocument<512> doc;
-        if (deserializeJson(doc, payload) == DeserializationError::Ok) {
+        if (backendWire.deserialize(doc, resp) == DeserializationError::Ok) {
             if (doc["success"]) {
-                totalSlots = doc["data"]["total"] | 4;
-                int occupied = doc["data"]["occupied"] | 0;
-                availableSlots = totalSlots - occupied;
-                
-                Serial.printf("[STATS] %d/%d available\n", availableSlots, totalSlots);
-                updateDisplay();
+                applySlotStats(doc["data"]["total"] | 4, doc["data"]["occupied"] | 0);
             }
         }
     }
+}
+
+void recordLatency(const FrameTrace &trace) {
+    if (latencyResetPending.exchange(false)) {
+        latency.reset();
+    }
+    latency.record(trace);
+}
+
+// Slot polygons from the AI service (same file its YOLO matching uses)
+bool loadSlotRegions() {
+    if (WiFi.status() != WL_CONNECTED) return false;
+    
+    HttpResponse resp;
+    if (aiHttp.get("/regions", resp, 5000) != 200 ||
+        !slots.loadRegions(resp.body.c_str(), resp.body.length())) {
+        Serial.println("[EDGE] Slot regions unavailable");
+        return false;
+    }
+    Serial.printf("[EDGE] Loaded %u slot region(s) drawn on %ux%u frames\n", slots.regionCount(),
+                  slots.regionFrameWidth(), slots.regionFrameHeight());
+    if (slots.clippedPoints() > 0) {
+        Serial.printf("[EDGE] %u polygon point(s) outside that frame, clipped to its edge\n",
+                      slots.clippedPoints());
+    }
+    return true;
+}
+
+// Writes the device's slot states to the backend the way the AI service
+// does after YOLO: only slots whose state changed are updated
+bool publishSlotStates() {
+    if (WiFi.status() != WL_CONNECTED) return false;
+    
+    HttpResponse resp;
+    if (backendHttp.get("/api/slots", resp, 5000) != 200) {
+        return false;
+    }
+    StaticJsonDocument<96> filter;
+    filter["data"][0]["id"] = true;
+    filter["data"][0]["code"] = true;
+    filter["data"][0]["is_occupied"] = true;
+    DynamicJsonDocument doc(2048);
+    if (backendWire.deserialize(doc, resp, filter) != DeserializationError::Ok) {
+        return false;
+    }
     
-    http.end();
+    // PUTs are pipelined on the keep-alive connection
+    bool ok = true;
+    for (JsonObject slot : doc["data"].as<JsonArray>()) {
+        for (uint8_t i = 0; i < slots.regionCount(); i++) {
+            if (strcmp(slots.code(i), slot["code"] | "") != 0) continue;
+            
+            const SlotResult &result = slots.result(i);
+            bool occupied = result.state == SLOT_OCCUPIED;
+            if (occupied != (slot["is_occupied"] | false)) {
+                char path[64];
+                snprintf(path, sizeof(path), "/api/slots/%s", slot["id"] | "");
+                StaticJsonDocument<32> update;
+                update["is_occupied"] = occupied;
+                char body[24];
+                size_t len = backendWire.serialize(update, body, sizeof(body));
+                if (backendHttp.inFlight() == HTTP_MAX_PIPELINE && !receiveSlotUpdate(resp)) {
+                    ok = false;
+                }
+                if (len == 0 || !backendHttp.send("PUT", path, backendWire.contentType(), (const uint8_t *)body, len)) {
+                    ok = false;
+                    break;
+                }
+                Serial.printf("[EDGE] %s: %s (%u%%)\n", slots.code(i),
+                              occupied ? "Occupied" : "Available", result.confidence);
+            }
+            break;
+        }
+    }
+    while (backendHttp.inFlight() > 0) {
+        if (!receiveSlotUpdate(resp)) {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// A refused MessagePack PUT fails this round; the next one goes out as JSON
+bool receiveSlotUpdate(HttpResponse &resp) {
+    int httpCode = backendHttp.receive(resp, 5000);
+    backendWire.onStatus(httpCode);
+    return httpCode == 200;
+}
+
+void applySlotStats(int total, int occupied) {
+    totalSlots = total;
+    availableSlots = total - occupied;
+    
+    Serial.printf("[STATS] %d/%d available\n", availableSlots.load(), totalSlots.load());
+    displayDirty = true;
+}
+
+// Backend hub message; only slot_stats is relevant to the device
+void onHubMessage(const char *data, size_t len) {
+    StaticJsonDocument<64> filter;
+    filter["type"] = true;
+    filter["data"]["total"] = true;
+    filter["data"]["occupied"] = true;
+    
+    StaticJsonDocument<192> doc;
+    if (deserializeJson(doc, data, len, DeserializationOption::Filter(filter)) != DeserializationError::Ok) {
+        return;
+    }
+    if (strcmp(doc["type"] | "", "slot_stats") == 0) {
+        applySlotStats(doc["data"]["total"] | totalSlots.load(), doc["data"]["occupied"] | 0);
+    }
 }
 
 // ===========================================
 // SESSION TRACKING - Entry/Exit Events
 // ===========================================
-void sendEntryEvent() {
-    if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("[SESSION] WiFi not connected, skipping entry event");
+void journalGateEvent(const GateEvent &event) {
+    uint32_t seq;
+    if (journal.append(event.type, event.timestampMs, seq)) {
         return;
     }
     
-    HTTPClient http;
-    String url = String(BACKEND_URL) + "/api/sessions/entry";
-    
-    http.begin(url);
-    http.addHeader("Content-Type", "application/json");
-    http.setTimeout(5000);
-    
-    StaticJsonDocument<128> doc;
-    doc["camera_id"] = "esp32-main";
-    doc["event_type"] = "entry";
-    
-    String body;
-    serializeJson(doc, body);
-    
-    int httpCode = http.POST(body);
-    
-    if (httpCode == 200 || httpCode == 201) {
-        Serial.println("[SESSION] Entry event sent successfully");
-    } else {
-        Serial.printf("[SESSION] Entry event failed: %d\n", httpCode);
+    // No journal (flash full or unavailable): best-effort direct delivery.
+    // The backlog goes first so the backend sees sequences in order, and
+    // the event gets a real sequence number so a resend is not applied twice.
+    Serial.println("[JOURNAL] Append failed, sending event unjournaled");
+    while (journal.pending() > 0 && WiFi.status() == WL_CONNECTED) {
+        uint32_t before = journal.pending();
+        replayJournal();
+        if (journal.pending() >= before) {
+            break;
+        }
     }
     
-    http.end();
+    JournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.seq = journal.reserve();
+    record.type = event.type;
+    record.boot = journal.boot();
+    record.timestampMs = event.timestampMs;
+    uint32_t ackedSeq = 0;
+    if (record.seq == 0 || WiFi.status() != WL_CONNECTED ||
+        sendGateEvents(&record, 1, ackedSeq) != 200 || ackedSeq < record.seq) {
+        Serial.println("[SESSION] Event lost");
+    }
+    // Sent or lost, there is nothing to replay for this number
+    if (record.seq != 0) {
+        journal.ack(record.seq);
+    }
 }
 
-void sendExitEvent() {
-    if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("[SESSION] WiFi not connected, skipping exit event");
+// Sends the oldest undelivered events as one batch and acknowledges what
+// the backend has applied
+void replayJournal() {
+    JournalRecord records[EVENT_BATCH_MAX];
+    size_t count = journal.peek(records, EVENT_BATCH_MAX);
+    if (count == 0) {
+        // Pending but unreadable (log lost mid-boot): retry on the backoff
+        replayFailed = journal.pending() > 0;
+        lastReplayFailTime = millis();
         return;
     }
     
-    HTTPClient http;
-    String url = String(BACKEND_URL) + "/api/sessions/exit";
-    
-    http.begin(url);
-    http.addHeader("Content-Type", "application/json");
-    http.setTimeout(5000);
+    uint32_t ackedSeq = 0;
+    int httpCode = sendGateEvents(records, count, ackedSeq);
+    // An ack below the batch means the backend took none of it: back off
+    // like any other failure instead of resending at once
+    bool failed = httpCode != 200 || ackedSeq < records[0].seq;
+    if (httpCode == 200) {
+        journal.ack(ackedSeq);
+        if (failed) {
+            Serial.printf("[SESSION] Backend acked #%u, batch starts at #%u\n",
+                          (unsigned)ackedSeq, (unsigned)records[0].seq);
+        }
+    } else if (httpCode >= 400 && httpCode < 500) {
+        // Rejected as a whole: a retry would fail the same way
+        Serial.printf("[SESSION] Batch rejected (%d), dropping %u event(s)\n", httpCode, (unsigned)count);
+        journal.ack(records[count - 1].seq);
+    }
     
-    StaticJsonDocument<128> doc;
+    replayFailed = journal.pending() > 0 && failed;
+    if (replayFailed) {
+        lastReplayFailTime = millis();
+        Serial.printf("[JOURNAL] %u event(s) waiting for the backend\n", (unsigned)journal.pending());
+    }
+    batchOpenedTime = millis() - EVENT_BATCH_WINDOW_MS;  // Rest of the backlog is due now
+}
+
+// POSTs the events to /api/sessions/batch; the backend applies them in one
+// transaction and returns the highest sequence it holds in ackedSeq.
+// Each event carries its age so the backend can date it.
+int sendGateEvents(const JournalRecord *records, size_t count, uint32_t &ackedSeq) {
+    StaticJsonDocument<1536> doc;
     doc["camera_id"] = "esp32-main";
-    doc["event_type"] = "exit";
-    
-    String body;
-    serializeJson(doc, body);
-    
-    int httpCode = http.POST(body);
+    doc["epoch"] = journal.epoch();  // Sequence numbers are only unique within it
+    JsonArray events = doc.createNestedArray("events");
+    for (size_t i = 0; i < count; i++) {
+        const JournalRecord &rec = records[i];
+        JsonObject e = events.createNestedObject();
+        e["seq"] = rec.seq;
+        e["event_type"] = rec.type == GATE_EVENT_ENTRY ? "entry" : "exit";
+        // Event age is only known for events recorded since this boot
+        if (rec.boot == journal.boot()) {
+            e["age_ms"] = millis() - rec.timestampMs;
+        }
+    }
     
-    if (httpCode == 200 || httpCode == 201) {
-        Serial.println("[SESSION] Exit event sent successfully");
-    } else {
-        Serial.printf("[SESSION] Exit event failed: %d\n", httpCode);
+    char body[1024];
+    HttpResponse resp;
+    int httpCode;
+    do {
+        size_t len = backendWire.serialize(doc, body, sizeof(body));
+        if (len == 0) {
+            return HTTP_ERR_SEND;
+        }
+        httpCode = backendHttp.post("/api/sessions/batch", backendWire.contentType(),
+                                    (const uint8_t *)body, len, resp, 5000);
+    } while (backendWire.onStatus(httpCode));  // Refused as MessagePack: resend as JSON
+    if (httpCode != 200) {
+        Serial.printf("[SESSION] Batch of %u event(s) failed: %d\n", (unsigned)count, httpCode);
+        return httpCode;
     }
     
-    http.end();
+    StaticJsonDocument<64> filter;
+    filter["data"]["acked_seq"] = true;
+    StaticJsonDocument<128> ack;
+    if (backendWire.deserialize(ack, resp, filter) != DeserializationError::Ok) {
+        return HTTP_ERR_PROTOCOL;
+    }
+    ackedSeq = ack["data"]["acked_seq"] | 0;
+    Serial.printf("[SESSION] Batch of %u event(s) sent, acked #%u\n", (unsigned)count, (unsigned)ackedSeq);
+    return httpCode;
 }
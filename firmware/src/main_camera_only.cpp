@@ -12,6 +12,7 @@
  * - GET /         - Status page
  * - GET /stream   - MJPEG video stream
  * - GET /capture  - Single frame capture
+ * - GET /metrics  - Prometheus metrics
  * 
  * Author: Smart Parking Team
  * Updated: 2026-01-17
@@ -20,9 +21,22 @@
 #include "esp_camera.h"
 #include <WiFi.h>
 #include <WebServer.h>
-#include <HTTPClient.h>
 #include <ArduinoJson.h>
 #include <LiquidCrystal_I2C.h>
+#include "FrameBus.h"
+#include "MjpegStreamer.h"
+#include "StreamTuner.h"
+#include "HttpEndpoint.h"
+#include "WireFormat.h"
+#include "SceneGate.h"
+#include "SlotClassifier.h"
+#include "RoiCrop.h"
+#include "LatencyTrace.h"
+#include "MetricsWriter.h"
+#include "CameraDrops.h"
+#include "ChunkedResponse.h"
+#include "WsClient.h"
+#include <atomic>
 
 // ===========================================
 // CONFIGURATION - EDIT THESE!
@@ -67,14 +81,50 @@ const char* AI_SERVICE_URL = "http://localhost:5000"; // AI service
 // CONSTANTS
 // ===========================================
 #define DETECTION_INTERVAL_MS   5000   // Run YOLO detection every 5 seconds
-#define STATS_INTERVAL_MS       10000  // Fetch stats every 10 seconds
+#define FRAME_SHARE_MAX_AGE_MS  500    // Detection reuses a stream frame this fresh
+#define CAPTURE_MAX_AGE_MS      1000   // /capture serves the newest frame up to this old
+#define SCENE_CELL_DELTA        12     // Luma change for a signature cell to count as changed
+#define SCENE_CHANGE_PERCENT    4      // Upload when this % of cells changed
+#define SCENE_HEARTBEAT_MS      60000  // Upload at least this often even if unchanged
+#define ROI_CROP_ENABLED        1      // Upload only the bounding box of the slot polygons
+#define ROI_MARGIN_PX           16     // Context around the slots, so edge cars stay whole
+#define ROI_JPEG_QUALITY        80     // Re-encode quality of the crop (1-100)
+#define ROI_MIN_SAVING_PERCENT  20     // Send the whole frame unless the crop is this much smaller
+#define STATS_INTERVAL_MS       10000  // Poll stats every 10 s while the hub socket is down
+#define HUB_WS_PATH             "/ws"  // Backend WebSocket hub (pushes slot_stats)
 #define STREAM_FRAME_DELAY_MS   50     // ~20 FPS for stream
+#define STREAM_JPEG_QUALITY     12     // Starting JPEG quality (10-63, lower = better)
+#define STREAM_BEST_QUALITY     10     // Best quality the tuner may step up to
+#define STREAM_MAX_KBPS         4000   // Bitrate cap per stream viewer
+#define STREAM_TUNE_PERIOD_MS   1000   // Adaptive quality/pacing control period
+
+// Frame sizes the stream tuner may use, largest first. The first is the
+// init size: frame buffers are allocated for it. Detection shares these
+// frames; the slot polygons (drawn on SVGA frames) are scaled to each size,
+// so only 4:3 sizes, which the OV2640 scales from the whole sensor window.
+// HVGA is a 3:2 crop of it and would shift every slot.
+static const framesize_t STREAM_FRAME_SIZES[] = { FRAMESIZE_VGA, FRAMESIZE_CIF, FRAMESIZE_QVGA };
+#define STREAM_FRAME_SIZE_COUNT (sizeof(STREAM_FRAME_SIZES) / sizeof(STREAM_FRAME_SIZES[0]))
 
 // ===========================================
 // GLOBAL OBJECTS
 // ===========================================
 WebServer server(80);
 LiquidCrystal_I2C lcd(0x27, 16, 2);
+FrameBus frameBus;
+MjpegStreamer streamer(frameBus, STREAM_FRAME_DELAY_MS);
+StreamTunerConfig streamTuning = { 1000 / STREAM_FRAME_DELAY_MS, STREAM_MAX_KBPS, STREAM_FRAME_SIZE_COUNT,
+                                   STREAM_BEST_QUALITY, STREAM_JPEG_QUALITY };
+StreamTuner streamTuner(streamTuning);
+MultipartUploader imageUploader("image", "capture.jpg", "image/jpeg");
+HttpEndpoint backendHttp("backend", BACKEND_URL);   // Keep-alive connections
+HttpEndpoint aiHttp("ai", AI_SERVICE_URL);
+WireFormat backendWire;                             // Same task as backendHttp
+SceneGate scene(SCENE_CELL_DELTA, SCENE_CHANGE_PERCENT, SCENE_HEARTBEAT_MS);
+SlotClassifier slots;
+RoiCrop roiCrop(ROI_JPEG_QUALITY);
+LatencyTrace latency;
+WsClient hubSocket;
 
 // State variables
 int availableSlots = 0;
@@ -82,29 +132,44 @@ int totalSlots = 4;
 int occupiedSlots = 0;
 unsigned long lastDetectionTime = 0;
 unsigned long lastStatsTime = 0;
+unsigned long restartAtMs = 0;    // 0 = no restart pending
+uint32_t bootId = 0;              // Random per boot, prefixes /capture ETags
+unsigned long lastTuneTime = 0;
+uint8_t streamSizeStep = 0;       // Index into STREAM_FRAME_SIZES
+uint32_t statsSyncedSession = 0;  // Hub session the stats were last fetched in
 bool cameraReady = false;
 bool wifiConnected = false;
 bool streamActive = false;
 
-// MJPEG stream boundary
-#define PART_BOUNDARY "123456789000000000000987654321"
-static const char* STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
-static const char* STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
-static const char* STREAM_PART = "Content-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n";
+// WiFi station drops and recoveries, written by the WiFi event task
+std::atomic<uint32_t> wifiDisconnects(0);
+std::atomic<uint32_t> wifiReconnects(0);
 
 // ===========================================
 // FUNCTION PROTOTYPES
 // ===========================================
 bool initCamera();
 void connectWiFi();
+void onWiFiEvent(arduino_event_id_t event);
 void setupServer();
 void handleRoot();
+void fillRootPage(Print &out, const char *name);
+void sendDocument(const JsonDocument &doc);
+void formatLocalIP(char *buf, size_t size);
 void handleStream();
 void handleCapture();
 void handleStatus();
+void handleLatency();
+void handleMetrics();
 void handleRestart();
+void tuneStream();
 void runDetection();
 void fetchStats();
+bool loadSlotRegions();
+bool publishSlotStates();
+bool receiveSlotUpdate(HttpResponse &resp);
+void applySlotStats(int total, int occupied);
+void onHubMessage(const char *data, size_t len);
 void updateDisplay();
 void updateLEDs();
 
@@ -120,6 +185,9 @@ void setup() {
     Serial.println("  ESP32-S3 + OV2640 + MJPEG Streaming");
     Serial.println("========================================\n");
     
+    // Frame sequence numbers restart at 1 on every boot
+    bootId = esp_random();
+    
     // Initialize status LED
     pinMode(LED_STATUS, OUTPUT);
     digitalWrite(LED_STATUS, HIGH);
@@ -147,6 +215,9 @@ void setup() {
     lcd.setCursor(0, 0);
     lcd.print("Init Camera...");
     
+    // Count frames the camera driver drops (it only logs them)
+    CameraDrops::begin();
+    
     // Initialize Camera
     if (!initCamera()) {
         Serial.println("[ERROR] Camera init FAILED!");
@@ -173,8 +244,14 @@ void setup() {
         // Setup HTTP server
         setupServer();
         
+        // Backend answers in MessagePack if it can, JSON otherwise
+        backendHttp.setAccept(WIRE_ACCEPT);
+        
         // Initial stats fetch
         fetchStats();
+        
+        // Slot changes are pushed by the backend hub from now on
+        hubSocket.begin(BACKEND_URL, HUB_WS_PATH, onHubMessage);
     }
     
     digitalWrite(LED_STATUS, LOW);
@@ -192,25 +269,47 @@ void loop() {
     // Handle HTTP requests
     server.handleClient();
     
+    // Push frames to stream viewers (non-blocking)
+    streamer.loop();
+    streamActive = streamer.clientCount() > 0;
+    
     unsigned long currentTime = millis();
     
-    // Periodic detection (only when not streaming to avoid lag)
-    if (cameraReady && wifiConnected && !streamActive) {
+    // Adapt stream quality and pacing to the viewers' links
+    if (currentTime - lastTuneTime >= STREAM_TUNE_PERIOD_MS) {
+        tuneStream();
+        lastTuneTime = currentTime;
+    }
+    
+    // Periodic detection; shares the stream's frames while someone watches
+    if (cameraReady && wifiConnected) {
         if (currentTime - lastDetectionTime > DETECTION_INTERVAL_MS) {
             runDetection();
             lastDetectionTime = currentTime;
         }
     }
     
-    // Periodic stats fetch
-    if (wifiConnected && (currentTime - lastStatsTime > STATS_INTERVAL_MS)) {
-        fetchStats();
-        lastStatsTime = currentTime;
+    // Slot stats pushed by the backend hub
+    if (wifiConnected) {
+        hubSocket.loop();
+        
+        // Resync once per hub session, poll only while the hub is down
+        bool resync = hubSocket.sessions() != statsSyncedSession;
+        if (resync || (!hubSocket.connected() && currentTime - lastStatsTime > STATS_INTERVAL_MS)) {
+            fetchStats();
+            statsSyncedSession = hubSocket.sessions();
+            lastStatsTime = currentTime;
+        }
     }
     
     // Update LED indicators
     updateLEDs();
     
+    // Deferred /restart, once the response has gone out
+    if (restartAtMs != 0 && (long)(currentTime - restartAtMs) >= 0) {
+        ESP.restart();
+    }
+    
     delay(10);
 }
 
@@ -241,9 +340,9 @@ bool initCamera() {
     config.pixel_format = PIXFORMAT_JPEG;
     
     // Use VGA for good quality streaming
-    config.frame_size = FRAMESIZE_VGA;  // 640x480
-    config.jpeg_quality = 12;            // 10-63, lower = better quality
-    config.fb_count = 2;                 // Double buffer for smooth streaming
+    config.frame_size = STREAM_FRAME_SIZES[0];  // 640x480
+    config.jpeg_quality = STREAM_JPEG_QUALITY;            // 10-63, lower = better quality
+    config.fb_count = FRAME_BUS_SLOTS;   // Stream holds up to 2, detection/capture share or get the 3rd
     config.grab_mode = CAMERA_GRAB_LATEST;
     
     esp_err_t err = esp_camera_init(&config);
@@ -272,10 +371,17 @@ bool initCamera() {
 // HTTP SERVER SETUP
 // ===========================================
 void setupServer() {
+    // /capture answers a matching If-None-Match with 304; Accept picks
+    // MessagePack for /status and /latency
+    static const char *requestHeaders[] = { "If-None-Match", "Accept" };
+    server.collectHeaders(requestHeaders, 2);
+    
     server.on("/", handleRoot);
     server.on("/stream", handleStream);
     server.on("/capture", handleCapture);
     server.on("/status", handleStatus);
+    server.on("/latency", handleLatency);
+    server.on("/metrics", handleMetrics);
     server.on("/restart", handleRestart);
     
     server.begin();
@@ -289,169 +395,526 @@ void handleRestart() {
     server.sendHeader("Access-Control-Allow-Origin", "*");
     server.send(200, "application/json", "{\"success\":true,\"message\":\"Restarting in 2 seconds...\"}");
     
-    delay(2000);  // Give time for response to be sent
-    ESP.restart();
+    // Restarted from loop(), which keeps serving in the meantime
+    restartAtMs = millis() + 2000;
 }
 
 // ===========================================
 // HTTP HANDLERS
 // ===========================================
+// Status page, kept in flash; {{...}} are filled by fillRootPage()
+static const char ROOT_PAGE[] =
+    "<!DOCTYPE html><html><head>"
+    "<title>Smart Parking Camera</title>"
+    "<meta name='viewport' content='width=device-width,initial-scale=1'>"
+    "<style>body{font-family:Arial;text-align:center;background:#1a1a2e;color:#fff;padding:20px}"
+    "h1{color:#4ecca3}a{color:#4ecca3}.stream{max-width:100%;border-radius:10px;}</style>"
+    "</head><body>"
+    "<h1>🅿️ Smart Parking Camera</h1>"
+    "<p>ESP32-S3 + OV2640</p>"
+    "<img class='stream' src='/stream'><br><br>"
+    "<p>Available: {{available}}/{{total}} slots</p>"
+    "<p><a href='/capture'>📸 Capture Single Frame</a></p>"
+    "<p><a href='/status'>📊 JSON Status</a></p>"
+    "</body></html>";
+
+void fillRootPage(Print &out, const char *name) {
+    if (strcmp(name, "available") == 0) {
+        out.print(availableSlots);
+    } else if (strcmp(name, "total") == 0) {
+        out.print(totalSlots);
+    }
+}
+
 void handleRoot() {
-    String html = "<!DOCTYPE html><html><head>";
-    html += "<title>Smart Parking Camera</title>";
-    html += "<meta name='viewport' content='width=device-width,initial-scale=1'>";
-    html += "<style>body{font-family:Arial;text-align:center;background:#1a1a2e;color:#fff;padding:20px}";
-    html += "h1{color:#4ecca3}a{color:#4ecca3}.stream{max-width:100%;border-radius:10px;}</style>";
-    html += "</head><body>";
-    html += "<h1>🅿️ Smart Parking Camera</h1>";
-    html += "<p>ESP32-S3 + OV2640</p>";
-    html += "<img class='stream' src='/stream'><br><br>";
-    html += "<p>Available: " + String(availableSlots) + "/" + String(totalSlots) + " slots</p>";
-    html += "<p><a href='/capture'>📸 Capture Single Frame</a></p>";
-    html += "<p><a href='/status'>📊 JSON Status</a></p>";
-    html += "</body></html>";
-    
-    server.send(200, "text/html", html);
+    WiFiClient client = server.client();
+    ChunkedResponse out(client);
+    out.begin(200, "text/html");
+    out.render(ROOT_PAGE, fillRootPage);
+    out.end();
 }
 
+// Hands the socket to the streamer; frames are pushed from streamer.loop()
 void handleStream() {
+    if (!streamer.addClient(server.client())) {
+        server.sendHeader("Access-Control-Allow-Origin", "*");
+        server.send(503, "text/plain", "Too many stream clients");
+        return;
+    }
     streamActive = true;
+}
+
+// Newest frame at once (usually the stream's), not the next one off the
+// sensor. ?max_age=<ms> bounds how old it may be; the ETag is the boot ID
+// and the frame's sequence number, so a poller that already has that frame
+// gets a 304, and one that cached a frame before a reboot does not.
+void handleCapture() {
+    uint32_t maxAge = CAPTURE_MAX_AGE_MS;
+    if (server.hasArg("max_age")) {
+        // toInt() would turn "abc" into 0 and "-5" into a 49-day window
+        String arg = server.arg("max_age");
+        char *end;
+        long value = strtol(arg.c_str(), &end, 10);
+        if (arg.length() == 0 || *end != '\0' || value < 0 || value > INT32_MAX) {
+            server.sendHeader("Access-Control-Allow-Origin", "*");
+            server.send(400, "text/plain", "max_age must be milliseconds (0 or more)");
+            return;
+        }
+        maxAge = value;
+    }
+    char etag[24];
+    char age[12];
     
-    WiFiClient client = server.client();
-    
-    String response = "HTTP/1.1 200 OK\r\n";
-    response += "Access-Control-Allow-Origin: *\r\n";
-    response += "Content-Type: " + String(STREAM_CONTENT_TYPE) + "\r\n\r\n";
-    client.print(response);
-    
-    Serial.println("[STREAM] Client connected");
-    
-    while (client.connected()) {
-        camera_fb_t *fb = esp_camera_fb_get();
-        if (!fb) {
-            Serial.println("[STREAM] Frame capture failed");
-            continue;
+    FrameInfo newest;
+    if (frameBus.latest(newest) && millis() - newest.grabbedMs <= maxAge) {
+        snprintf(etag, sizeof(etag), "\"%08x-%u\"", (unsigned)bootId, (unsigned)newest.seq);
+        if (server.header("If-None-Match") == etag) {
+            server.sendHeader("Access-Control-Allow-Origin", "*");
+            server.sendHeader("ETag", etag);
+            server.send(304);
+            return;
         }
-        
-        client.print(STREAM_BOUNDARY);
-        
-        char partHeader[64];
-        snprintf(partHeader, sizeof(partHeader), STREAM_PART, fb->len);
-        client.print(partHeader);
-        
-        client.write(fb->buf, fb->len);
-        
-        esp_camera_fb_return(fb);
-        
-        delay(STREAM_FRAME_DELAY_MS);
     }
     
-    streamActive = false;
-    Serial.println("[STREAM] Client disconnected");
-}
-
-void handleCapture() {
-    camera_fb_t *fb = esp_camera_fb_get();
+    FrameInfo info;
+    camera_fb_t *fb = frameBus.acquire(maxAge, &info);
     if (!fb) {
         server.send(500, "text/plain", "Camera capture failed");
         return;
     }
     
+    uint32_t ageMs = millis() - info.grabbedMs;
+    snprintf(etag, sizeof(etag), "\"%08x-%u\"", (unsigned)bootId, (unsigned)info.seq);
     server.sendHeader("Access-Control-Allow-Origin", "*");
+    server.sendHeader("Access-Control-Expose-Headers", "ETag, X-Frame-Age-Ms");
+    server.sendHeader("Cache-Control", "no-cache");
+    server.sendHeader("ETag", etag);
+    snprintf(age, sizeof(age), "%u", (unsigned)(ageMs / 1000));
+    server.sendHeader("Age", age);
+    snprintf(age, sizeof(age), "%u", (unsigned)ageMs);
+    server.sendHeader("X-Frame-Age-Ms", age);
     server.send_P(200, "image/jpeg", (const char*)fb->buf, fb->len);
     
-    esp_camera_fb_return(fb);
+    frameBus.release(fb);
+}
+
+// Feeds the last period's deliveries to the tuner and applies its setting
+void tuneStream() {
+    MjpegLinkSample sample;
+    streamer.takeLinkSample(sample);
+    
+    StreamSetting setting;
+    if (!streamTuner.update(sample, millis(), setting)) return;
+    
+    sensor_t *s = esp_camera_sensor_get();
+    if (s != NULL) {
+        s->set_quality(s, setting.quality);
+        if (setting.sizeStep != streamSizeStep) {
+            s->set_framesize(s, STREAM_FRAME_SIZES[setting.sizeStep]);
+            streamSizeStep = setting.sizeStep;
+        }
+    }
+    streamer.setFrameInterval(setting.frameIntervalMs);
+    
+    Serial.printf("[STREAM] Tuned: quality %u, size step %u, %u ms/frame (%u kbps measured)\n",
+                  setting.quality, setting.sizeStep, setting.frameIntervalMs,
+                  (unsigned)streamTuner.stats().throughputKbps);
+}
+
+// JSON (or MessagePack if the client accepts it) straight to the socket in
+// chunks; the document never becomes a String
+void sendDocument(const JsonDocument &doc) {
+    bool binary = strstr(server.header("Accept").c_str(), WIRE_MIME_MSGPACK) != NULL;
+    WiFiClient client = server.client();
+    ChunkedResponse out(client);
+    if (binary) {
+        out.begin(200, WIRE_MIME_MSGPACK);
+        serializeMsgPack(doc, out);
+    } else {
+        out.begin(200, WIRE_MIME_JSON);
+        serializeJson(doc, out);
+    }
+    out.end();
+}
+
+// Dotted quad without going through IPAddress::toString()
+void formatLocalIP(char *buf, size_t size) {
+    IPAddress ip = WiFi.localIP();
+    snprintf(buf, size, "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
 }
 
 void handleStatus() {
-    StaticJsonDocument<256> doc;
+    StaticJsonDocument<2304> doc;
     doc["device"] = "ESP32-S3-CAM";
-    doc["ip"] = WiFi.localIP().toString();
-    doc["stream_url"] = "http://" + WiFi.localIP().toString() + "/stream";
+    char ip[16];
+    char streamUrl[40];
+    formatLocalIP(ip, sizeof(ip));
+    snprintf(streamUrl, sizeof(streamUrl), "http://%s/stream", ip);
+    doc["ip"] = ip;
+    doc["stream_url"] = streamUrl;
     doc["available_slots"] = availableSlots;
     doc["total_slots"] = totalSlots;
     doc["camera_ready"] = cameraReady;
     doc["stream_active"] = streamActive;
+    doc["hub_connected"] = hubSocket.connected();
     doc["uptime_ms"] = millis();
     
-    String response;
-    serializeJson(doc, response);
+    JsonObject http = doc.createNestedObject("http");
+    const HttpEndpoint *endpoints[] = { &backendHttp, &aiHttp };
+    for (const HttpEndpoint *ep : endpoints) {
+        const HttpEndpointStats &st = ep->stats();
+        JsonObject e = http.createNestedObject(ep->name());
+        e["requests"] = st.requests;
+        e["failures"] = st.failures;
+        e["connects"] = st.connects;
+        e["latency_avg_us"] = st.avgLatencyUs;
+        e["latency_max_us"] = st.maxLatencyUs;
+    }
     
-    server.sendHeader("Access-Control-Allow-Origin", "*");
-    server.send(200, "application/json", response);
+    const SceneStats &ss = scene.stats();
+    JsonObject sceneStats = doc.createNestedObject("scene");
+    sceneStats["frames"] = ss.frames;
+    sceneStats["uploads"] = ss.uploads;
+    sceneStats["skipped"] = ss.skipped;
+    sceneStats["heartbeats"] = ss.heartbeats;
+    sceneStats["last_score"] = ss.lastScore;
+    
+    const SlotClassifierStats &cs = slots.stats();
+    JsonObject edge = doc.createNestedObject("edge");
+    edge["frames"] = cs.frames;
+    edge["decided"] = cs.decided;
+    edge["agree"] = cs.agree;
+    edge["disagree"] = cs.disagree;
+    edge["frame_us"] = cs.lastFrameUs;
+    JsonObject slotStates = edge.createNestedObject("slots");
+    for (uint8_t i = 0; i < slots.regionCount(); i++) {
+        const SlotResult &r = slots.result(i);
+        slotStates[slots.code(i)] = r.state == SLOT_UNKNOWN ? -1 : (r.state == SLOT_OCCUPIED ? 1 : 0);
+    }
+    
+    const RoiCropStats &crop = roiCrop.stats();
+    JsonObject roi = doc.createNestedObject("roi");
+    roi["crops"] = crop.crops;
+    roi["failures"] = crop.failures;
+    roi["bytes_in"] = crop.bytesIn;
+    roi["bytes_out"] = crop.bytesOut;
+    roi["crop_us"] = crop.lastUs;
+    roi["encode_us"] = crop.encodeUs;
+    
+    const StreamTunerStats &ts = streamTuner.stats();
+    StreamSetting current = streamTuner.setting();
+    JsonObject tuning = doc.createNestedObject("stream_tuning");
+    tuning["level"] = ts.level;
+    tuning["quality"] = current.quality;
+    tuning["frame_interval_ms"] = current.frameIntervalMs;
+    tuning["throughput_kbps"] = ts.throughputKbps;
+    tuning["frame_bytes"] = ts.frameBytes;
+    tuning["steps_down"] = ts.stepsDown;
+    tuning["steps_up"] = ts.stepsUp;
+    
+    FrameBusStats bs = frameBus.stats();
+    JsonObject bus = doc.createNestedObject("frame_bus");
+    bus["grabs"] = bs.grabs;
+    bus["reuses"] = bs.reuses;
+    bus["failures"] = bs.failures;
+    bus["drops"] = bs.drops;
+    bus["evictions"] = bs.evictions;
+    bus["held"] = bs.held;
+    
+    const WireFormatStats &ws = backendWire.stats();
+    JsonObject wire = doc.createNestedObject("wire");
+    wire["encoding"] = WireFormat::name(backendWire.encoding());
+    for (uint8_t i = 0; i < WIRE_ENCODING_COUNT; i++) {
+        JsonObject w = wire.createNestedObject(WireFormat::name((WireEncoding)i));
+        w["sent"] = ws.sent[i];
+        w["received"] = ws.received[i];
+        w["bytes_sent"] = ws.bytesSent[i];
+        w["bytes_received"] = ws.bytesReceived[i];
+    }
+    wire["fallbacks"] = ws.fallbacks;
+    
+    JsonArray clients = doc.createNestedArray("stream_clients");
+    MjpegClientStats stats;
+    for (size_t i = 0; streamer.clientStats(i, stats); i++) {
+        JsonObject c = clients.createNestedObject();
+        c["fps"] = stats.fps;
+        c["frames_sent"] = stats.framesSent;
+        c["frames_dropped"] = stats.framesDropped;
+        c["backlog_bytes"] = stats.backlog;
+    }
+    
+    sendDocument(doc);
+}
+
+// Capture-to-decision latency of detection frames, per stage
+void handleLatency() {
+    StaticJsonDocument<1024> doc;
+    doc["device"] = "ESP32-S3-CAM";
+    char ip[16];
+    formatLocalIP(ip, sizeof(ip));
+    doc["ip"] = ip;
+    doc["edge_decisions"] = latency.edgeDecisions();
+    doc["ai_decisions"] = latency.aiDecisions();
+    
+    JsonObject stages = doc.createNestedObject("stages");
+    for (uint8_t i = 0; i < TRACE_STAGE_COUNT; i++) {
+        const LatencyHistogram &h = latency.histogram((TraceStage)i);
+        JsonObject stage = stages.createNestedObject(LatencyTrace::stageName((TraceStage)i));
+        stage["count"] = h.count();
+        stage["p50_ms"] = h.percentile(50);
+        stage["p90_ms"] = h.percentile(90);
+        stage["p99_ms"] = h.percentile(99);
+        stage["mean_ms"] = h.meanMs();
+        stage["max_ms"] = h.maxMs();
+    }
+    if (server.arg("reset") == "1") {
+        latency.reset();
+    }
+    
+    sendDocument(doc);
+}
+
+// Prometheus text format, streamed from a fixed buffer (no String, no JSON)
+void handleMetrics() {
+    static uint32_t lastFrames = 0;                // Previous scrape
+    static uint32_t lastScrapeMs = 0;
+    char labels[48];
+    
+    WiFiClient client = server.client();
+    MetricsWriter m(client);
+    m.header();
+    
+    m.family("parking_uptime_seconds", "gauge", "Time since boot");
+    m.sample("parking_uptime_seconds", (uint32_t)(millis() / 1000));
+    m.family("parking_heap_internal_free_bytes", "gauge", "Free internal heap");
+    m.sample("parking_heap_internal_free_bytes", (uint32_t)heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+    m.family("parking_heap_internal_min_free_bytes", "gauge", "Lowest free internal heap since boot");
+    m.sample("parking_heap_internal_min_free_bytes", (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+    m.family("parking_psram_free_bytes", "gauge", "Free PSRAM");
+    m.sample("parking_psram_free_bytes", (uint32_t)ESP.getFreePsram());
+    m.family("parking_psram_min_free_bytes", "gauge", "Lowest free PSRAM since boot");
+    m.sample("parking_psram_min_free_bytes", (uint32_t)ESP.getMinFreePsram());
+    
+    // Camera: stream grab rate since the previous scrape, driver drops
+    uint32_t frames = streamer.framesCaptured();
+    uint32_t now = millis();
+    float fps = lastScrapeMs && now > lastScrapeMs ? (frames - lastFrames) * 1000.0f / (now - lastScrapeMs) : 0;
+    lastFrames = frames;
+    lastScrapeMs = now;
+    m.family("parking_camera_fps", "gauge", "Frames grabbed for the stream per second since the last scrape");
+    m.sample("parking_camera_fps", fps);
+    CameraDropStats drops;
+    CameraDrops::read(drops);
+    m.family("parking_camera_frames_dropped_total", "counter", "Frames discarded by the camera driver");
+    m.sample("parking_camera_frames_dropped_total", drops.overflows, "reason=\"buffer_overflow\"");
+    m.sample("parking_camera_frames_dropped_total", drops.queueFull, "reason=\"queue_full\"");
+    m.sample("parking_camera_frames_dropped_total", drops.noBuffer, "reason=\"no_buffer\"");
+    m.sample("parking_camera_frames_dropped_total", drops.oversize, "reason=\"oversize\"");
+    m.sample("parking_camera_frames_dropped_total", drops.corrupt, "reason=\"corrupt\"");
+    
+    // Frame bus: camera grabs vs frames shared between stream, detection, /capture
+    FrameBusStats bs = frameBus.stats();
+    m.family("parking_frame_bus_grabs_total", "counter", "Frames taken from the camera");
+    m.sample("parking_frame_bus_grabs_total", bs.grabs);
+    m.family("parking_frame_bus_reuses_total", "counter", "Frames handed out again to another consumer");
+    m.sample("parking_frame_bus_reuses_total", bs.reuses);
+    m.family("parking_frame_bus_failures_total", "counter", "Camera returned no frame");
+    m.sample("parking_frame_bus_failures_total", bs.failures);
+    m.family("parking_frame_bus_drops_total", "counter", "Frames grabbed while every bus slot was in use");
+    m.sample("parking_frame_bus_drops_total", bs.drops);
+    m.family("parking_frame_bus_evictions_total", "counter", "Newest frame let go so the camera keeps a free buffer");
+    m.sample("parking_frame_bus_evictions_total", bs.evictions);
+    m.family("parking_frame_bus_held", "gauge", "Frames referenced right now");
+    m.sample("parking_frame_bus_held", (uint32_t)bs.held);
+    
+    // Stream
+    m.family("parking_stream_clients", "gauge", "Connected MJPEG viewers");
+    m.sample("parking_stream_clients", (uint32_t)streamer.clientCount());
+    m.family("parking_stream_frames_total", "counter", "Frames grabbed for the stream");
+    m.sample("parking_stream_frames_total", frames);
+    m.family("parking_stream_bytes_sent_total", "counter", "MJPEG bytes sent to all viewers");
+    m.sample("parking_stream_bytes_sent_total", streamer.bytesSent());
+    MjpegClientStats cs;
+    m.family("parking_stream_client_fps", "gauge", "Frames sent per second, per viewer");
+    for (size_t i = 0; streamer.clientStats(i, cs); i++) {
+        snprintf(labels, sizeof(labels), "client=\"%u\"", (unsigned)i);
+        m.sample("parking_stream_client_fps", cs.fps, labels);
+    }
+    m.family("parking_stream_client_frames_dropped", "gauge", "Frames a viewer skipped while it fell behind");
+    for (size_t i = 0; streamer.clientStats(i, cs); i++) {
+        snprintf(labels, sizeof(labels), "client=\"%u\"", (unsigned)i);
+        m.sample("parking_stream_client_frames_dropped", cs.framesDropped, labels);
+    }
+    
+    // HTTP clients (backend, AI service)
+    const HttpEndpoint *endpoints[] = { &backendHttp, &aiHttp };
+    m.family("parking_http_requests_total", "counter", "Requests sent, per remote service");
+    for (const HttpEndpoint *ep : endpoints) {
+        snprintf(labels, sizeof(labels), "endpoint=\"%s\"", ep->name());
+        m.sample("parking_http_requests_total", ep->stats().requests, labels);
+    }
+    m.family("parking_http_failures_total", "counter", "Requests without a response");
+    for (const HttpEndpoint *ep : endpoints) {
+        snprintf(labels, sizeof(labels), "endpoint=\"%s\"", ep->name());
+        m.sample("parking_http_failures_total", ep->stats().failures, labels);
+    }
+    m.family("parking_http_connects_total", "counter", "TCP connections opened");
+    for (const HttpEndpoint *ep : endpoints) {
+        snprintf(labels, sizeof(labels), "endpoint=\"%s\"", ep->name());
+        m.sample("parking_http_connects_total", ep->stats().connects, labels);
+    }
+    m.family("parking_http_latency_seconds", "gauge", "Request written to response read");
+    for (const HttpEndpoint *ep : endpoints) {
+        const HttpEndpointStats &st = ep->stats();
+        snprintf(labels, sizeof(labels), "endpoint=\"%s\",stat=\"last\"", ep->name());
+        m.sample("parking_http_latency_seconds", st.lastLatencyUs / 1e6f, labels);
+        snprintf(labels, sizeof(labels), "endpoint=\"%s\",stat=\"avg\"", ep->name());
+        m.sample("parking_http_latency_seconds", st.avgLatencyUs / 1e6f, labels);
+        snprintf(labels, sizeof(labels), "endpoint=\"%s\",stat=\"max\"", ep->name());
+        m.sample("parking_http_latency_seconds", st.maxLatencyUs / 1e6f, labels);
+    }
+    
+    // Detection latency, capture -> slot decision
+    m.family("parking_detection_latency_seconds", "summary", "Detection frame latency per stage");
+    for (uint8_t i = 0; i < TRACE_STAGE_COUNT; i++) {
+        const LatencyHistogram &h = latency.histogram((TraceStage)i);
+        const char *stage = LatencyTrace::stageName((TraceStage)i);
+        static const uint8_t QUANTILES[] = { 50, 90, 99 };
+        for (uint8_t q : QUANTILES) {
+            snprintf(labels, sizeof(labels), "stage=\"%s\",quantile=\"0.%u\"", stage, q);
+            m.sample("parking_detection_latency_seconds", h.percentile(q) / 1000.0f, labels);
+        }
+        snprintf(labels, sizeof(labels), "stage=\"%s\"", stage);
+        m.sample("parking_detection_latency_seconds_sum", h.sumMs() / 1000.0f, labels);
+        m.sample("parking_detection_latency_seconds_count", h.count(), labels);
+    }
+    
+    // WiFi
+    m.family("parking_wifi_rssi_dbm", "gauge", "Signal strength of the access point");
+    m.sample("parking_wifi_rssi_dbm", (int32_t)WiFi.RSSI());
+    m.family("parking_wifi_disconnects_total", "counter", "Station disconnects");
+    m.sample("parking_wifi_disconnects_total", wifiDisconnects.load());
+    m.family("parking_wifi_reconnects_total", "counter", "Station reconnects after a disconnect");
+    m.sample("parking_wifi_reconnects_total", wifiReconnects.load());
+    
+    m.finish();
+    client.stop();
 }
 
 // ===========================================
 // DETECTION FUNCTION
 // ===========================================
 void runDetection() {
-    Serial.println("\n[DETECT] Running YOLO detection...");
-    digitalWrite(LED_STATUS, HIGH);
-    
-    camera_fb_t *fb = esp_camera_fb_get();
+    camera_fb_t *fb = frameBus.acquire(FRAME_SHARE_MAX_AGE_MS);
     if (!fb) {
         Serial.println("[DETECT] Capture failed");
-        digitalWrite(LED_STATUS, LOW);
         return;
     }
     
-    Serial.printf("[DETECT] Image: %d bytes\n", fb->len);
+    FrameTrace trace = { LatencyTrace::captureUs(fb), 0, 0, 0, false };
+    
+    // Skip frames that look like the last uploaded one
+    SceneSignature sig;
+    bool hasSig = scene.signature(fb->buf, fb->len, sig);
+    SceneDecision decision = hasSig ? scene.decide(sig, millis()) : SCENE_UPLOAD_FIRST;
+    if (decision == SCENE_SKIP) {
+        Serial.printf("[DETECT] Scene unchanged (%u%% cells), upload skipped\n", scene.stats().lastScore);
+        frameBus.release(fb);
+        return;
+    }
+    
+    // Classify slots on the device; YOLO only when a slot is ambiguous.
+    // Heartbeats still go to YOLO to keep the empty-slot baselines fresh.
+    if (slots.regionCount() == 0) {
+        loadSlotRegions();
+    }
+    bool classified = slots.classify(fb->buf, fb->len, fb->width, fb->height);
+    if (classified && slots.unknownCount() == 0 && decision != SCENE_UPLOAD_HEARTBEAT) {
+        trace.sendStartUs = micros();
+        if (publishSlotStates()) {
+            trace.decisionUs = micros();
+            trace.edge = true;
+            latency.record(trace);
+            Serial.printf("[EDGE] %u slot(s) decided on device in %u us, YOLO skipped\n",
+                          slots.regionCount(), (unsigned)slots.stats().lastFrameUs);
+            if (hasSig) {
+                scene.markUploaded(sig, millis());
+            }
+            frameBus.release(fb);
+            return;
+        }
+    }
+    
+    Serial.println("\n[DETECT] Running YOLO detection...");
+    digitalWrite(LED_STATUS, HIGH);
+    
+    Serial.printf("[DETECT] Image: %u bytes\n", (unsigned)fb->len);
     
     // Send to AI service
     if (WiFi.status() == WL_CONNECTED) {
-        HTTPClient http;
-        String url = String(AI_SERVICE_URL) + "/analyze";
-        
-        http.begin(url);
-        http.setTimeout(15000);
-        
-        // Create multipart form data
-        String boundary = "----ESP32Boundary";
-        String contentType = "multipart/form-data; boundary=" + boundary;
-        http.addHeader("Content-Type", contentType);
-        
-        // Build multipart body
-        String bodyStart = "--" + boundary + "\r\n";
-        bodyStart += "Content-Disposition: form-data; name=\"image\"; filename=\"capture.jpg\"\r\n";
-        bodyStart += "Content-Type: image/jpeg\r\n\r\n";
-        
-        String bodyEnd = "\r\n--" + boundary + "--\r\n";
+        // Only the slot area goes up; the AI service maps boxes back with the offset
+        const uint8_t *image = fb->buf;
+        size_t imageLen = fb->len;
+        uint8_t *cropped = NULL;
+        size_t croppedLen = 0;
+        // The frame size lets the AI service scale boxes to the region frame
+        char path[96];
+        snprintf(path, sizeof(path), "/analyze?frame_w=%u&frame_h=%u", (unsigned)fb->width, (unsigned)fb->height);
+        int x0, y0, x1, y1;
+        if (ROI_CROP_ENABLED && slots.bounds(fb->width, fb->height, x0, y0, x1, y1)) {
+            RoiRect roi = RoiCrop::align(x0, y0, x1, y1, fb->width, fb->height, ROI_MARGIN_PX);
+            // Decode + re-encode costs more than a few percent of upload saves
+            uint32_t frameArea = (uint32_t)fb->width * fb->height;
+            if ((uint32_t)roi.w * roi.h * 100 <= frameArea * (100 - ROI_MIN_SAVING_PERCENT) &&
+                roiCrop.crop(fb->buf, fb->len, roi, &cropped, &croppedLen)) {
+                image = cropped;
+                imageLen = croppedLen;
+                snprintf(path, sizeof(path), "/analyze?frame_w=%u&frame_h=%u&crop_x=%u&crop_y=%u",
+                         (unsigned)fb->width, (unsigned)fb->height, roi.x, roi.y);
+                Serial.printf("[DETECT] ROI %ux%u at %u,%u: %u -> %u bytes\n", roi.w, roi.h, roi.x, roi.y,
+                              (unsigned)fb->len, (unsigned)croppedLen);
+            }
+        }
         
-        size_t totalLen = bodyStart.length() + fb->len + bodyEnd.length();
+        // Preamble, image and trailer are written straight to the socket
+        HttpResponse resp;
+        trace.sendStartUs = micros();
+        int httpCode = aiHttp.postMultipart(path, imageUploader, image, imageLen, resp, 15000);
+        free(cropped);
         
-        uint8_t *payload = (uint8_t*)malloc(totalLen);
-        if (payload) {
-            memcpy(payload, bodyStart.c_str(), bodyStart.length());
-            memcpy(payload + bodyStart.length(), fb->buf, fb->len);
-            memcpy(payload + bodyStart.length() + fb->len, bodyEnd.c_str(), bodyEnd.length());
-            
-            int httpCode = http.POST(payload, totalLen);
+        if (httpCode == 200) {
+            trace.sendEndUs = aiHttp.lastWrittenUs();
+            trace.decisionUs = micros();
+            latency.record(trace);
+            Serial.printf("[DETECT] AI response received, %u ms after capture\n",
+                          (unsigned)((trace.decisionUs - trace.captureUs) / 1000));
+            if (hasSig) {
+                scene.markUploaded(sig, millis());
+            }
             
-            if (httpCode == 200) {
-                String response = http.getString();
-                Serial.println("[DETECT] AI response received");
-                
-                // Parse response
-                DynamicJsonDocument doc(2048);
-                if (deserializeJson(doc, response) == DeserializationError::Ok) {
-                    if (doc["success"]) {
-                        int vehicles = doc["vehicles_detected"] | 0;
-                        Serial.printf("[DETECT] Detected %d vehicles\n", vehicles);
-                        
-                        // Stats will be updated via WebSocket from backend
+            // Parse response
+            DynamicJsonDocument doc(2048);
+            if (deserializeJson(doc, resp.body) == DeserializationError::Ok) {
+                if (doc["success"]) {
+                    int vehicles = doc["vehicles_detected"] | 0;
+                    Serial.printf("[DETECT] Detected %d vehicles\n", vehicles);
+                    
+                    // The server's answer is ground truth for this frame
+                    if (classified) {
+                        for (JsonPair kv : doc["slot_status"].as<JsonObject>()) {
+                            slots.learn(kv.key().c_str(), kv.value().as<bool>());
+                        }
                     }
+                    
+                    // Stats will be updated via WebSocket from backend
                 }
-            } else {
-                Serial.printf("[DETECT] AI error: %d\n", httpCode);
             }
-            
-            free(payload);
+        } else {
+            Serial.printf("[DETECT] AI error: %d\n", httpCode);
         }
-        
-        http.end();
     }
     
-    esp_camera_fb_return(fb);
+    frameBus.release(fb);
     digitalWrite(LED_STATUS, LOW);
 }
 
@@ -461,39 +924,147 @@ void runDetection() {
 void fetchStats() {
     if (WiFi.status() != WL_CONNECTED) return;
     
-    HTTPClient http;
-    String url = String(BACKEND_URL) + "/api/slots/stats";
-    
-    http.begin(url);
-    http.setTimeout(5000);
-    
-    int httpCode = http.GET();
+    HttpResponse resp;
+    int httpCode = backendHttp.get("/api/slots/stats", resp, 5000);
     
     if (httpCode == 200) {
-        String payload = http.getString();
-        
         StaticJsonDocument<512> doc;
-        if (deserializeJson(doc, payload) == DeserializationError::Ok) {
+        if (backendWire.deserialize(doc, resp) == DeserializationError::Ok) {
             if (doc["success"]) {
-                totalSlots = doc["data"]["total"] | 4;
-                occupiedSlots = doc["data"]["occupied"] | 0;
-                availableSlots = totalSlots - occupiedSlots;
-                
-                Serial.printf("[STATS] %d/%d available\n", availableSlots, totalSlots);
-                updateDisplay();
+                applySlotStats(doc["data"]["total"] | 4, doc["data"]["occupied"] | 0);
+            }
+        }
+    }
+}
+
+// Slot polygons from the AI service (same file its YOLO matching uses)
+bool loadSlotRegions() {
+    if (WiFi.status() != WL_CONNECTED) return false;
+    
+    HttpResponse resp;
+    if (aiHttp.get("/regions", resp, 5000) != 200 ||
+        !slots.loadRegions(resp.body.c_str(), resp.body.length())) {
+        Serial.println("[EDGE] Slot regions unavailable");
+        return false;
+    }
+    Serial.printf("[EDGE] Loaded %u slot region(s) drawn on %ux%u frames\n", slots.regionCount(),
+                  slots.regionFrameWidth(), slots.regionFrameHeight());
+    if (slots.clippedPoints() > 0) {
+        Serial.printf("[EDGE] %u polygon point(s) outside that frame, clipped to its edge\n",
+                      slots.clippedPoints());
+    }
+    return true;
+}
+
+// Writes the device's slot states to the backend the way the AI service
+// does after YOLO: only slots whose state changed are updated
+bool publishSlotStates() {
+    if (WiFi.status() != WL_CONNECTED) return false;
+    
+    HttpResponse resp;
+    if (backendHttp.get("/api/slots", resp, 5000) != 200) {
+        return false;
+    }
+    StaticJsonDocument<96> filter;
+    filter["data"][0]["id"] = true;
+    filter["data"][0]["code"] = true;
+    filter["data"][0]["is_occupied"] = true;
+    DynamicJsonDocument doc(2048);
+    if (backendWire.deserialize(doc, resp, filter) != DeserializationError::Ok) {
+        return false;
+    }
+    
+    // PUTs are pipelined on the keep-alive connection
+    bool ok = true;
+    for (JsonObject slot : doc["data"].as<JsonArray>()) {
+        for (uint8_t i = 0; i < slots.regionCount(); i++) {
+            if (strcmp(slots.code(i), slot["code"] | "") != 0) continue;
+            
+            const SlotResult &result = slots.result(i);
+            bool occupied = result.state == SLOT_OCCUPIED;
+            if (occupied != (slot["is_occupied"] | false)) {
+                char path[64];
+                snprintf(path, sizeof(path), "/api/slots/%s", slot["id"] | "");
+                StaticJsonDocument<32> update;
+                update["is_occupied"] = occupied;
+                char body[24];
+                size_t len = backendWire.serialize(update, body, sizeof(body));
+                if (backendHttp.inFlight() == HTTP_MAX_PIPELINE && !receiveSlotUpdate(resp)) {
+                    ok = false;
+                }
+                if (len == 0 || !backendHttp.send("PUT", path, backendWire.contentType(), (const uint8_t *)body, len)) {
+                    ok = false;
+                    break;
+                }
+                Serial.printf("[EDGE] %s: %s (%u%%)\n", slots.code(i),
+                              occupied ? "Occupied" : "Available", result.confidence);
             }
+            break;
+        }
+    }
+    while (backendHttp.inFlight() > 0) {
+        if (!receiveSlotUpdate(resp)) {
+            ok = false;
         }
     }
+    return ok;
+}
+
+// A refused MessagePack PUT fails this round; the next one goes out as JSON
+bool receiveSlotUpdate(HttpResponse &resp) {
+    int httpCode = backendHttp.receive(resp, 5000);
+    backendWire.onStatus(httpCode);
+    return httpCode == 200;
+}
+
+void applySlotStats(int total, int occupied) {
+    totalSlots = total;
+    occupiedSlots = occupied;
+    availableSlots = totalSlots - occupiedSlots;
+    
+    Serial.printf("[STATS] %d/%d available\n", availableSlots, totalSlots);
+    updateDisplay();
+}
+
+// Backend hub message; only slot_stats is relevant to the device
+void onHubMessage(const char *data, size_t len) {
+    StaticJsonDocument<64> filter;
+    filter["type"] = true;
+    filter["data"]["total"] = true;
+    filter["data"]["occupied"] = true;
     
-    http.end();
+    StaticJsonDocument<192> doc;
+    if (deserializeJson(doc, data, len, DeserializationOption::Filter(filter)) != DeserializationError::Ok) {
+        return;
+    }
+    if (strcmp(doc["type"] | "", "slot_stats") == 0) {
+        applySlotStats(doc["data"]["total"] | totalSlots, doc["data"]["occupied"] | 0);
+    }
 }
 
 // ===========================================
 // WIFI CONNECTION
 // ===========================================
+// Counts station drops for /metrics; Arduino's auto-reconnect recovers them
+void onWiFiEvent(arduino_event_id_t event) {
+    static bool connected = false;                 // WiFi event task only
+    static bool everConnected = false;
+    if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED && connected) {
+        connected = false;
+        wifiDisconnects++;
+    } else if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        if (everConnected) {
+            wifiReconnects++;
+        }
+        connected = true;
+        everConnected = true;
+    }
+}
+
 void connectWiFi() {
     Serial.printf("[WIFI] Connecting to %s", WIFI_SSID);
     
+    WiFi.onEvent(onWiFiEvent);
     WiFi.mode(WIFI_STA);
     WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
     